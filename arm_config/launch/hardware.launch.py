@@ -1,9 +1,10 @@
 import os
 from launch import LaunchDescription
 from launch.actions import DeclareLaunchArgument
-from launch.substitutions import LaunchConfiguration, PathJoinSubstitution
+from launch.substitutions import LaunchConfiguration, PathJoinSubstitution, PythonExpression
 from launch.conditions import IfCondition
-from launch_ros.actions import Node
+from launch_ros.actions import Node, ComposableNodeContainer
+from launch_ros.descriptions import ComposableNode
 from launch_ros.substitutions import FindPackageShare
 from ament_index_python.packages import get_package_share_directory
 from moveit_configs_utils import MoveItConfigsBuilder
@@ -28,6 +29,19 @@ def generate_launch_description():
         description="Control mode of arm -- possible values: [plan, servo]",
     )
 
+    # Compose the EtherCAT interface and arm_move_group into one process
+    """
+    Loads ZeroErrInterface and ArmMoveGroup as components into a single multi-threaded
+    container with intra-process communication, instead of running them as separate
+    processes talking over DDS. The EtherCAT cyclic loop keeps its own SCHED_FIFO thread
+    inside the container.
+    """
+    composed = DeclareLaunchArgument(
+        "composed",
+        default_value="false",
+        description="Run arm_ethercat_interface and arm_move_group in one component container -- possible values: [true, false]",
+    )
+
     moveit_config = (
         MoveItConfigsBuilder("ArmProject", package_name="arm_config")
         .robot_description(
@@ -54,12 +68,18 @@ def generate_launch_description():
         .to_moveit_configs()
     )
 
+    # Constraint approximation database of the standard path constraints, see
+    # arm_move_group generate_constraint_database
+    constraint_approximations = {
+        "ompl.constraint_approximations_path": os.path.join(os.getcwd(), "src/arm-project/arm_move_group/constraint_approximations")
+    }
+
     # Start the actual move_group node/action server
     move_group_node = Node(
         package="moveit_ros_move_group",
         executable="move_group",
         output="screen",
-        parameters=[moveit_config.to_dict()],
+        parameters=[moveit_config.to_dict(), constraint_approximations],
         arguments=["--ros-args", "--log-level", "info"],
         remappings=[
             ('/robot_description', '/arm/robot_description')
@@ -70,6 +90,9 @@ def generate_launch_description():
         package="arm_ethercat_interface",
         executable="arm_ethercat_interface",
         output="screen",
+        parameters=[PathJoinSubstitution([
+            FindPackageShare("arm_ethercat_interface"), "config", "joint_envelope.yaml"
+        ])],
     )
 
     # RViz
@@ -144,10 +167,49 @@ def generate_launch_description():
         arguments=["arm_group_controller", "-c", "/controller_manager"],
     )
     
+    # Single process deployment (composed:=true)
+    arm_control_container = ComposableNodeContainer(
+        name="arm_control_container",
+        namespace="",
+        package="rclcpp_components",
+        executable="component_container_mt",
+        composable_node_descriptions=[
+            ComposableNode(
+                package="arm_ethercat_interface",
+                plugin="ZeroErrInterface",
+                name="arm_ethercat_interface",
+                parameters=[
+                    PathJoinSubstitution([FindPackageShare("arm_ethercat_interface"), "config", "feed_forward.yaml"]),
+                    PathJoinSubstitution([FindPackageShare("arm_ethercat_interface"), "config", "joint_envelope.yaml"]),
+                ],
+                extra_arguments=[{"use_intra_process_comms": True}],
+            ),
+            ComposableNode(
+                package="arm_move_group",
+                plugin="ArmMoveGroup",
+                name="arm_move_group",
+                parameters=[
+                    moveit_config.robot_description,
+                    moveit_config.robot_description_semantic,
+                    moveit_config.robot_description_kinematics,
+                    moveit_config.planning_pipelines,
+                    moveit_config.joint_limits,
+                    PathJoinSubstitution([FindPackageShare("arm_config"), "config", "path_constraints.yaml"]),
+                    {"visualize_trajectory": True},
+                    {"servoing": PythonExpression(["'", LaunchConfiguration("control_mode"), "' == 'servo'"])},
+                ],
+                extra_arguments=[{"use_intra_process_comms": True}],
+            ),
+        ],
+        output="screen",
+        condition=IfCondition(LaunchConfiguration("composed")),
+    )
+    
     return LaunchDescription(
         [
             ros2_control_hardware_type,
             control_mode,
+            composed,
             rviz_node,
             static_tf_node,
             robot_state_publisher,
@@ -155,5 +217,6 @@ def generate_launch_description():
             ros2_control_node,
             joint_state_broadcaster_spawner,
             arm_group_spawner,
+            arm_control_container,
         ]
     )
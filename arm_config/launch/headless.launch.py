@@ -56,12 +56,18 @@ def generate_launch_description():
     )
 
 
+    # Constraint approximation database of the standard path constraints, see
+    # arm_move_group generate_constraint_database
+    constraint_approximations = {
+        "ompl.constraint_approximations_path": os.path.join(os.getcwd(), "src/arm-project/arm_move_group/constraint_approximations")
+    }
+
     # Start the actual move_group node/action server
     move_group_node = Node(
         package="moveit_ros_move_group",
         executable="move_group",
         output="screen",
-        parameters=[moveit_config.to_dict()],
+        parameters=[moveit_config.to_dict(), constraint_approximations],
         arguments=["--ros-args", "--log-level", "info"],
         remappings=[
             ('/robot_description', '/arm/robot_description')
@@ -72,6 +78,9 @@ def generate_launch_description():
         package="arm_ethercat_interface",
         executable="arm_ethercat_interface",
         output="screen",
+        parameters=[PathJoinSubstitution([
+            FindPackageShare("arm_ethercat_interface"), "config", "joint_envelope.yaml"
+        ])],
     )
 
     # RViz
@@ -147,6 +156,7 @@ def generate_launch_description():
             moveit_config.robot_description,
             moveit_config.robot_description_semantic,
             moveit_config.robot_description_kinematics,
+            PathJoinSubstitution([FindPackageShare("arm_config"), "config", "path_constraints.yaml"]),
             {"use_sim_time": True}, #! Will not receive joint_states if False
             {"visualize_trajectory": False},
             {"servoing": False}
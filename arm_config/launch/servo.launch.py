@@ -1,9 +1,10 @@
 import os
 from launch import LaunchDescription
 from launch.actions import DeclareLaunchArgument
-from launch.substitutions import LaunchConfiguration, PathJoinSubstitution
-from launch.conditions import IfCondition
-from launch_ros.actions import Node
+from launch.substitutions import LaunchConfiguration, PathJoinSubstitution, PythonExpression
+from launch.conditions import IfCondition, UnlessCondition
+from launch_ros.actions import Node, ComposableNodeContainer, LoadComposableNodes
+from launch_ros.descriptions import ComposableNode
 from launch_ros.substitutions import FindPackageShare
 from launch_param_builder import ParameterBuilder
 from ament_index_python.packages import get_package_share_directory
@@ -29,6 +30,34 @@ def generate_launch_description():
         description="Control mode of arm -- possible values: [plan, servo]",
     )
 
+    # Stream servo output through the forward position controller instead of the JTC
+    """
+    The JointTrajectoryController re-interpolates every servo JointTrajectory before
+    ArmHardwareInterface::write sees it. With direct_streaming the servo_node publishes
+    Float64MultiArray position commands to arm_group_forward_controller, which copies
+    the latest one into the command interfaces at its next update. The commands still
+    go over DDS to the controller, and from write() over DDS on arm/command to the next
+    PDO exchange of arm_ethercat_interface (logged there as transport and latch wait).
+    The JTC is loaded inactive and has to be activated to execute motion plans.
+    """
+    direct_streaming = DeclareLaunchArgument(
+        "direct_streaming",
+        default_value="false",
+        description="Bypass the JointTrajectoryController in servo mode -- possible values: [true, false]",
+    )
+
+    # Compose the servo pipeline into one process
+    """
+    Loads joy, the arm_servo GameController, the servo node and (with real hardware) the
+    EtherCAT interface as components into a single container with intra-process
+    communication, instead of one process per node.
+    """
+    composed = DeclareLaunchArgument(
+        "composed",
+        default_value="false",
+        description="Run joy, game_controller, servo and the EtherCAT interface in one component container -- possible values: [true, false]",
+    )
+
     moveit_config = (
         MoveItConfigsBuilder("ArmProject", package_name="arm_config")
         .robot_description(
@@ -57,12 +86,18 @@ def generate_launch_description():
         .to_moveit_configs()
     )
 
+    # Constraint approximation database of the standard path constraints, see
+    # arm_move_group generate_constraint_database
+    constraint_approximations = {
+        "ompl.constraint_approximations_path": os.path.join(os.getcwd(), "src/arm-project/arm_move_group/constraint_approximations")
+    }
+
     # Start the actual move_group node/action server
     move_group_node = Node(
         package="moveit_ros_move_group",
         executable="move_group",
         output="screen",
-        parameters=[moveit_config.to_dict()],
+        parameters=[moveit_config.to_dict(), constraint_approximations],
         arguments=["--ros-args", "--log-level", "info"],
     )
 
@@ -137,9 +172,24 @@ def generate_launch_description():
         package="controller_manager",
         executable="spawner",
         arguments=["arm_group_controller", "-c", "/controller_manager"],
+        condition=UnlessCondition(LaunchConfiguration("direct_streaming")),
         # prefix=["sudo -E"]
     )
 
+    arm_group_inactive_spawner = Node(
+        package="controller_manager",
+        executable="spawner",
+        arguments=["arm_group_controller", "-c", "/controller_manager", "--inactive"],
+        condition=IfCondition(LaunchConfiguration("direct_streaming")),
+    )
+
+    arm_group_forward_spawner = Node(
+        package="controller_manager",
+        executable="spawner",
+        arguments=["arm_group_forward_controller", "-c", "/controller_manager"],
+        condition=IfCondition(LaunchConfiguration("direct_streaming")),
+    )
+
 
     servo_params = {
         "moveit_servo": ParameterBuilder("arm_config")
@@ -165,12 +215,137 @@ def generate_launch_description():
             moveit_config.joint_limits,
         ],
         output="screen",
+        condition=IfCondition(PythonExpression([
+            "'", LaunchConfiguration("direct_streaming"), "' != 'true' and '",
+            LaunchConfiguration("composed"), "' != 'true'"
+        ])),
+    )
+
+    # Same servo_node, overriding the output to the forward position controller
+    direct_servo_params = {
+        "moveit_servo.command_out_topic": "/arm_group_forward_controller/commands",
+        "moveit_servo.command_out_type": "std_msgs/Float64MultiArray",
+    }
+
+    direct_servo_node = Node(
+        package="moveit_servo",
+        executable="servo_node",
+        parameters=[
+            servo_params,
+            direct_servo_params,
+            acceleration_filter_update_period,
+            planning_group_name,
+            moveit_config.robot_description,
+            moveit_config.robot_description_semantic,
+            moveit_config.robot_description_kinematics,
+            moveit_config.joint_limits,
+        ],
+        output="screen",
+        condition=IfCondition(PythonExpression([
+            "'", LaunchConfiguration("direct_streaming"), "' == 'true' and '",
+            LaunchConfiguration("composed"), "' != 'true'"
+        ])),
+    )
+
+
+    # Plan/servo switching, pauses servo_node, switches the hardware and (direct_streaming) the controllers
+    mode_manager_params = {
+        "control_mode": LaunchConfiguration("control_mode"),
+        "direct_streaming": PythonExpression(["'", LaunchConfiguration("direct_streaming"), "' == 'true'"]),
+    }
+
+    mode_manager_node = Node(
+        package="arm_servo",
+        executable="mode_manager",
+        parameters=[mode_manager_params],
+        output="screen",
+        condition=UnlessCondition(LaunchConfiguration("composed")),
+    )
+
+
+    # Single process deployment (composed:=true)
+    composed_servo_params = {
+        "moveit_servo.command_out_topic": PythonExpression([
+            "'/arm_group_forward_controller/commands' if '", LaunchConfiguration("direct_streaming"),
+            "' == 'true' else '/arm_group_controller/joint_trajectory'"
+        ]),
+        "moveit_servo.command_out_type": PythonExpression([
+            "'std_msgs/Float64MultiArray' if '", LaunchConfiguration("direct_streaming"),
+            "' == 'true' else 'trajectory_msgs/JointTrajectory'"
+        ]),
+    }
+
+    arm_servo_container = ComposableNodeContainer(
+        name="arm_servo_container",
+        namespace="",
+        package="rclcpp_components",
+        executable="component_container_mt",
+        composable_node_descriptions=[
+            ComposableNode(
+                package="joy",
+                plugin="joy::GameController",
+                name="game_controller_node",
+                extra_arguments=[{"use_intra_process_comms": True}],
+            ),
+            ComposableNode(
+                package="arm_servo",
+                plugin="arm_servo::GameController",
+                name="servo_game_controller",
+                extra_arguments=[{"use_intra_process_comms": True}],
+            ),
+            ComposableNode(
+                package="moveit_servo",
+                plugin="moveit_servo::ServoNode",
+                name="servo_node",
+                parameters=[
+                    servo_params,
+                    composed_servo_params,
+                    acceleration_filter_update_period,
+                    planning_group_name,
+                    moveit_config.robot_description,
+                    moveit_config.robot_description_semantic,
+                    moveit_config.robot_description_kinematics,
+                    moveit_config.joint_limits,
+                ],
+                extra_arguments=[{"use_intra_process_comms": True}],
+            ),
+            ComposableNode(
+                package="arm_servo",
+                plugin="arm_servo::ModeManager",
+                name="arm_mode_manager",
+                parameters=[mode_manager_params],
+                extra_arguments=[{"use_intra_process_comms": True}],
+            ),
+        ],
+        output="screen",
+        condition=IfCondition(LaunchConfiguration("composed")),
+    )
+
+    load_arm_interface = LoadComposableNodes(
+        target_container="arm_servo_container",
+        composable_node_descriptions=[
+            ComposableNode(
+                package="arm_ethercat_interface",
+                plugin="ZeroErrInterface",
+                name="arm_ethercat_interface",
+                parameters=[PathJoinSubstitution([
+                    FindPackageShare("arm_ethercat_interface"), "config", "feed_forward.yaml"
+                ])],
+                extra_arguments=[{"use_intra_process_comms": True}],
+            ),
+        ],
+        condition=IfCondition(PythonExpression([
+            "'", LaunchConfiguration("composed"), "' == 'true' and '",
+            LaunchConfiguration("hardware_type"), "' == 'real'"
+        ])),
     )
 
     return LaunchDescription(
         [
             ros2_control_hardware_type,
             control_mode,
+            direct_streaming,
+            composed,
             rviz_node,
             static_tf_node,
             robot_state_publisher,
@@ -178,6 +353,12 @@ def generate_launch_description():
             ros2_control_node,
             joint_state_broadcaster_spawner,
             arm_group_spawner,
-            servo_node
+            arm_group_inactive_spawner,
+            arm_group_forward_spawner,
+            servo_node,
+            direct_servo_node,
+            mode_manager_node,
+            arm_servo_container,
+            load_arm_interface
         ]
     )
@@ -14,7 +14,20 @@ def generate_launch_description():
     ros2_control_hardware_type = DeclareLaunchArgument(
         "hardware_type",
         default_value="sim",
-        description="ROS 2 control hardware interface type to use for the launch file -- possible values: [real, sim]",
+        description="ROS 2 control hardware interface type to use for the launch file -- possible values: [real, sim, sim_drive]",
+    )
+
+    # sim_drive publishes the simulated time, every node has to follow it
+    use_sim_time = DeclareLaunchArgument(
+        "use_sim_time",
+        default_value="false",
+        description="Use the /clock published by the sim_drive hardware -- possible values: [true, false]",
+    )
+
+    real_time_factor = DeclareLaunchArgument(
+        "real_time_factor",
+        default_value="1.0",
+        description="sim_drive simulated time / wall time, 0 for as fast as possible",
     )
 
     control_mode = DeclareLaunchArgument(
@@ -29,7 +42,8 @@ def generate_launch_description():
             file_path="config/zeroerr_arm.urdf.xacro",
             mappings={
                 "ros2_control_hardware_type": LaunchConfiguration("hardware_type"),
-                "control_mode": LaunchConfiguration("control_mode")
+                "control_mode": LaunchConfiguration("control_mode"),
+                "real_time_factor": LaunchConfiguration("real_time_factor"),
             },
         )
         .robot_description_semantic(file_path="config/zeroerr_arm.srdf")
@@ -55,7 +69,7 @@ def generate_launch_description():
         package="moveit_ros_move_group",
         executable="move_group",
         output="screen",
-        parameters=[moveit_config.to_dict()],
+        parameters=[moveit_config.to_dict(), {"use_sim_time": LaunchConfiguration("use_sim_time")}],
         arguments=["--ros-args", "--log-level", "info"],
         remappings=[
             ('/robot_description', '/arm/robot_description')
@@ -79,6 +93,7 @@ def generate_launch_description():
             moveit_config.planning_pipelines,
             moveit_config.robot_description_kinematics,
             moveit_config.joint_limits,
+            {"use_sim_time": LaunchConfiguration("use_sim_time")},
         ],
     )
 
@@ -100,7 +115,7 @@ def generate_launch_description():
         ],
         name="arm_state_publisher",
         output="both",
-        parameters=[moveit_config.robot_description],
+        parameters=[moveit_config.robot_description, {"use_sim_time": LaunchConfiguration("use_sim_time")}],
     )
 
     # ros2_control using FakeSystem as hardware
@@ -112,7 +127,7 @@ def generate_launch_description():
     ros2_control_node = Node(
         package="controller_manager",
         executable="ros2_control_node",
-        parameters=[ros2_controllers_path],
+        parameters=[ros2_controllers_path, {"use_sim_time": LaunchConfiguration("use_sim_time")}],
         remappings=[
             ("/controller_manager/robot_description", '/arm/robot_description'),
         ],
@@ -139,6 +154,8 @@ def generate_launch_description():
         [
             ros2_control_hardware_type,
             control_mode,
+            use_sim_time,
+            real_time_factor,
             rviz_node,
             static_tf_node,
             robot_state_publisher,
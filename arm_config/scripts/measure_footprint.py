@@ -0,0 +1,152 @@
+#!/usr/bin/env python3
+"""
+Measures CPU and memory of the arm control stack processes, to compare the multi-process
+layout against the composed (single container) layout.
+
+Run once per layout while the arm is doing the same thing (e.g. idle in OP, or servoing),
+then compare the totals. Without the arm, the non real-time nodes (joy, game_controller,
+servo_node, mode manager) can be compared on the simulated hardware:
+
+    ros2 launch arm_config servo.launch.py hardware_type:=sim
+    ros2 run arm_config measure_footprint.py --label sim-multi --out footprint.csv
+
+    ros2 launch arm_config servo.launch.py hardware_type:=sim composed:=true
+    ros2 run arm_config measure_footprint.py --label sim-composed --out footprint.csv
+
+With the arm:
+
+    ros2 launch arm_config servo.launch.py hardware_type:=real
+    ros2 run arm_config measure_footprint.py --label multi --out footprint.csv
+
+    ros2 launch arm_config servo.launch.py hardware_type:=real composed:=true
+    ros2 run arm_config measure_footprint.py --label composed --out footprint.csv
+
+Latency is reported by the nodes themselves: the arm_ethercat_interface logs arm/command
+transport latency every second, and arm_servo teleop_latency gives the end-to-end
+breakdown from game controller input to encoder motion.
+"""
+
+import argparse
+import os
+import time
+
+# Process command line fragments belonging to the control stack
+DEFAULT_PATTERNS = [
+    "component_container",
+    "joy_node",
+    "mode_manager",
+    "arm_ethercat_interface",
+    "arm_move_group",
+    "servo_node",
+    "game_controller",
+    "ros2_control_node",
+    "move_group",
+]
+
+CLOCK_TICKS = os.sysconf("SC_CLK_TCK")
+
+
+def find_processes(patterns):
+    """Returns {pid: name} of processes whose command line matches one of the patterns."""
+    procs = {}
+    for pid in filter(str.isdigit, os.listdir("/proc")):
+        try:
+            with open(f"/proc/{pid}/cmdline", "rb") as f:
+                cmdline = f.read().replace(b"\0", b" ").decode(errors="replace")
+        except OSError:
+            continue
+
+        # Skip this script and launch/ros2 cli wrappers
+        if "measure_footprint" in cmdline or cmdline.startswith("ros2 ") or "/ros2 " in cmdline:
+            continue
+
+        for pattern in patterns:
+            if pattern in cmdline:
+                procs[int(pid)] = pattern
+                break
+    return procs
+
+
+def cpu_ticks(pid):
+    with open(f"/proc/{pid}/stat") as f:
+        fields = f.read().rsplit(")", 1)[1].split()
+    # utime and stime are fields 14 and 15 of /proc/<pid>/stat
+    return int(fields[11]) + int(fields[12])
+
+
+def memory_kb(pid):
+    """Returns (rss, pss) in kB, pss counts shared libraries once across processes."""
+    rss = pss = 0
+    try:
+        with open(f"/proc/{pid}/smaps_rollup") as f:
+            for line in f:
+                if line.startswith("Rss:"):
+                    rss = int(line.split()[1])
+                elif line.startswith("Pss:"):
+                    pss = int(line.split()[1])
+    except OSError:
+        pass
+    return rss, pss
+
+
+def num_threads(pid):
+    with open(f"/proc/{pid}/status") as f:
+        for line in f:
+            if line.startswith("Threads:"):
+                return int(line.split()[1])
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--duration", type=float, default=30.0, help="sampling time [s]")
+    parser.add_argument("--label", default="", help="layout label written to --out")
+    parser.add_argument("--out", default="", help="CSV file the totals are appended to")
+    parser.add_argument("--patterns", nargs="+", default=DEFAULT_PATTERNS, help="command line fragments to match")
+    args = parser.parse_args()
+
+    procs = find_processes(args.patterns)
+    if not procs:
+        print("No matching processes found")
+        return
+
+    start = {}
+    for pid in list(procs):
+        try:
+            start[pid] = cpu_ticks(pid)
+        except OSError:
+            del procs[pid]
+
+    start_time = time.monotonic()
+    time.sleep(args.duration)
+    elapsed = time.monotonic() - start_time
+
+    print(f"{'pid':>7} {'process':<24} {'cpu %':>7} {'rss MB':>8} {'pss MB':>8} {'threads':>8}")
+
+    total_cpu = total_rss = total_pss = total_threads = 0
+    for pid, name in sorted(procs.items()):
+        try:
+            cpu = 100.0 * (cpu_ticks(pid) - start[pid]) / CLOCK_TICKS / elapsed
+            rss, pss = memory_kb(pid)
+            threads = num_threads(pid)
+        except OSError:
+            continue
+
+        total_cpu += cpu
+        total_rss += rss
+        total_pss += pss
+        total_threads += threads
+        print(f"{pid:>7} {name:<24} {cpu:>7.1f} {rss / 1024:>8.1f} {pss / 1024:>8.1f} {threads:>8}")
+
+    print(f"{'':>7} {'total':<24} {total_cpu:>7.1f} {total_rss / 1024:>8.1f} {total_pss / 1024:>8.1f} {total_threads:>8}")
+
+    if args.out:
+        new_file = not os.path.exists(args.out)
+        with open(args.out, "a") as f:
+            if new_file:
+                f.write("label,processes,cpu_percent,rss_mb,pss_mb,threads\n")
+            f.write(f"{args.label},{len(procs)},{total_cpu:.1f},{total_rss / 1024:.1f},{total_pss / 1024:.1f},{total_threads}\n")
+
+
+if __name__ == "__main__":
+    main()
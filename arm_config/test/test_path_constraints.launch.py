@@ -0,0 +1,76 @@
+# Loads config/path_constraints.yaml as a params file, the way the launch files pass it to
+# arm_move_group and generate_constraint_database, and checks the standard constraints
+# arrive as the parameters path_constraints.cpp reads.
+import os
+import unittest
+
+import launch
+import launch_ros.actions
+import launch_testing
+import launch_testing.actions
+import launch_testing.asserts
+import pytest
+import rclpy
+from ament_index_python.packages import get_package_share_directory
+from rcl_interfaces.srv import GetParameters
+
+
+PARAMS_FILE = os.path.join(get_package_share_directory("arm_config"), "config", "path_constraints.yaml")
+NODE = "path_constraints_test"
+
+
+@pytest.mark.launch_test
+def generate_test_description():
+    # Declares every parameter it is given, like arm_move_group
+    # (automatically_declare_parameters_from_overrides)
+    blackboard = launch_ros.actions.Node(
+        package="demo_nodes_cpp",
+        executable="parameter_blackboard",
+        name=NODE,
+        parameters=[PARAMS_FILE],
+    )
+    return launch.LaunchDescription([blackboard, launch_testing.actions.ReadyToTest()])
+
+
+class TestPathConstraintsParams(unittest.TestCase):
+
+    @classmethod
+    def setUpClass(cls):
+        rclpy.init()
+        cls.node = rclpy.create_node("path_constraints_test_client")
+
+    @classmethod
+    def tearDownClass(cls):
+        cls.node.destroy_node()
+        rclpy.shutdown()
+
+    def get_parameters(self, names):
+        client = self.node.create_client(GetParameters, "/" + NODE + "/get_parameters")
+        self.assertTrue(client.wait_for_service(timeout_sec=10.0), "node did not start, params file rejected?")
+
+        future = client.call_async(GetParameters.Request(names=names))
+        rclpy.spin_until_future_complete(self.node, future, timeout_sec=10.0)
+        self.assertIsNotNone(future.result())
+        return future.result().values
+
+    def test_constraints_loaded(self):
+        names = list(self.get_parameters(["path_constraints.names"])[0].string_array_value)
+        self.assertEqual(names, ["upright", "upright_tight"])
+
+        for name in names:
+            prefix = "path_constraints." + name + "."
+            link, frame, orientation, tolerance = self.get_parameters(
+                [prefix + "link", prefix + "frame", prefix + "orientation", prefix + "tolerance"])
+
+            self.assertEqual(link.string_value, "j6_Link", name)
+            self.assertEqual(frame.string_value, "arm_Link", name)
+            self.assertEqual(len(orientation.double_array_value), 4, name)
+            self.assertEqual(len(tolerance.double_array_value), 3, name)
+
+
+@launch_testing.post_shutdown_test()
+class TestParamsFileAccepted(unittest.TestCase):
+
+    def test_exit_code(self, proc_info):
+        # A rejected params file fails the node at startup
+        launch_testing.asserts.assertExitCodes(proc_info, allowable_exit_codes=[0, -2, -15])
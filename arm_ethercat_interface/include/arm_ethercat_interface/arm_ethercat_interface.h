@@ -1,12 +1,27 @@
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
 #include <string>
 #include <float.h>
-// #include <thread>
+#include <thread>
 // #include <mutex>
 #include "ec_defines.h"
+#include "gravity_model.h"
+#include "pdo_overlay.h"
+#include "rt_config.h"
+#include "rt_scheduler.h"
+#include "speed_override.h"
 
 #include "rclcpp/rclcpp.hpp"
 #include "sensor_msgs/msg/joint_state.hpp"
+#include "sensor_msgs/msg/time_reference.hpp"
+#include "diagnostic_msgs/msg/diagnostic_array.hpp"
+#include "std_msgs/msg/float64.hpp"
+#include "trajectory_msgs/msg/joint_trajectory.hpp"
+#include "arm_msgs/srv/profile_move.hpp"
 
 
 #define PI          3.1415926538979323846
@@ -24,10 +39,71 @@ bool toggle = false;
 using namespace std::chrono_literals;
 
 
+/**
+ * @brief Min/mean/max accumulator for a latency stage, written by one thread and
+ * drained by the reporting timer.
+ * 
+ */
+struct LatencyStats
+{
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> sum_ns{0};
+    std::atomic<uint64_t> max_ns{0};
+    std::atomic<uint64_t> min_ns{UINT64_MAX};
+
+    inline void add(uint64_t ns)
+    {
+        count.fetch_add(1, std::memory_order_relaxed);
+        sum_ns.fetch_add(ns, std::memory_order_relaxed);
+        if (ns > max_ns.load(std::memory_order_relaxed)) max_ns.store(ns, std::memory_order_relaxed);
+        if (ns < min_ns.load(std::memory_order_relaxed)) min_ns.store(ns, std::memory_order_relaxed);
+    }
+};
+
+
+/**
+ * @brief Position following error accumulator (counts) for one joint, written by the
+ * RT thread and drained by the reporting timer.
+ * 
+ */
+struct FollowingErrorStats
+{
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> sum_sq{0};
+    std::atomic<uint32_t> max_abs{0};
+
+    inline void add(int32_t err)
+    {
+        uint32_t abs_err = (uint32_t) std::abs(err);
+        count.fetch_add(1, std::memory_order_relaxed);
+        sum_sq.fetch_add((uint64_t) abs_err * abs_err, std::memory_order_relaxed);
+        if (abs_err > max_abs.load(std::memory_order_relaxed)) max_abs.store(abs_err, std::memory_order_relaxed);
+    }
+};
+
+
+/**
+ * @brief Joint envelope violations of one joint and kind, written by the RT thread and
+ * drained by the reporting timer.
+ * 
+ */
+struct EnvelopeStats
+{
+    std::atomic<uint64_t> count{0};
+    std::atomic<double> max_excess{0.0};
+
+    inline void add(double excess)
+    {
+        count.fetch_add(1, std::memory_order_relaxed);
+        if (excess > max_excess.load(std::memory_order_relaxed)) max_excess.store(excess, std::memory_order_relaxed);
+    }
+};
+
+
 class ZeroErrInterface : public rclcpp::Node
 {
     public:
-        ZeroErrInterface();
+        explicit ZeroErrInterface(const rclcpp::NodeOptions &options = rclcpp::NodeOptions());
         ~ZeroErrInterface();
 
         rclcpp::CallbackGroup::SharedPtr get_high_prio_callback_group();
@@ -39,11 +115,50 @@ class ZeroErrInterface : public rclcpp::Node
 
         std::chrono::milliseconds CYCLIC_DATA_PERIOD;
         const std::chrono::milliseconds JOINT_STATE_PERIOD = 10ms;
+        const std::chrono::milliseconds LATENCY_REPORT_PERIOD = 1000ms;
+        const std::chrono::milliseconds PROFILE_MOVE_POLL_PERIOD = 10ms;
+        const std::chrono::milliseconds ENVELOPE_POLL_PERIOD = 10ms;
+
+        // Motion onset detection (latency_probe), cycles without new commands before arming
+        const uint32_t ONSET_IDLE_CYCLES = 1200;
+
+        const std::chrono::milliseconds FOLLOWING_ERROR_PERIOD = 1000ms;
+
+        // Profile moves: cycles allowed for a mode switch or set-point acknowledge, cycles
+        // a stale target reached may still be reported after a set-point, arm/command resync
+        // tolerance [counts], time arm/command must be still before a move [ns], time allowed
+        // beyond the planned duration before halting and before giving up on the drives [s],
+        // and the duration of the hold trajectory sent to the controller after a move [s].
+        // A halted move ends once no axis moved more than PP_STANDSTILL_COUNTS per cycle for
+        // PP_STANDSTILL_CYCLES (target reached alone is always set with POS_WINDOW 1e9).
+        const uint32_t PP_HANDSHAKE_CYCLES = 600;
+        const uint32_t PP_STALE_CYCLES = 10;
+        const int32_t PP_STANDSTILL_COUNTS = 5;
+        const uint32_t PP_STANDSTILL_CYCLES = 50;
+        const int32_t PP_RESYNC_TOLERANCE = 100;
+        const int64_t PP_CMD_QUIET_NS = 200000000;
+        const double PP_DEADLINE_MARGIN = 2.0;
+        const double PP_RESPONSE_GRACE = 2.0;
+        const double PP_RESYNC_TIME = 0.1;
 
         const uint32_t SYNC0_CYCLE = 2*PERIOD_NS;
         const int32_t SYNC0_SHIFT = 0;
 
-        int sync_ref_counter = 0;
+        // RT cycle work (see init_scheduler_), task periods [cycles]
+        const double CYCLE_TIME = PERIOD_NS * 1e-9;
+        const uint32_t DC_SYNC_REF_CYCLES = 2;
+        const uint32_t DOMAIN_STATE_CYCLES = 100;
+        const uint32_t MASTER_STATE_CYCLES = FREQUENCY;
+        const uint32_t SDO_CYCLES = 200;
+        RtScheduler<ZeroErrInterface> scheduler_;
+        bool drives_op_ = false;    // all drives Operation Enabled, RT thread only
+        int sdo_joint_ = 0;
+        uint16_t sdo_error_codes_[NUM_JOINTS] = {};
+
+        //* Runtime tunables (see RtConfigBox), written by param_cb_, taken by the RT thread
+        // once per cycle into cfg_ (RT thread only)
+        RtConfigBox<RtConfig> config_;
+        const RtConfig *cfg_ = nullptr;
         struct timespec wakeupTime;
 
         int joint_no_ = 0;
@@ -51,6 +166,7 @@ class ZeroErrInterface : public rclcpp::Node
         double stamp_ = 0;
         bool joints_OP_ = false;
         bool joints_op_enabled_ = false;
+        uint32_t enabled_cycles_ = 0;
 
         unsigned long loop_start_time_;
         unsigned long loop_last_start_time;
@@ -66,26 +182,155 @@ class ZeroErrInterface : public rclcpp::Node
         unsigned long period_max_ns_ = 0;
         unsigned long period_min_ns_ = 0;
 
+        //* Process data of all joints, read after ecrt_domain_process and written before
+        // ecrt_domain_queue (RT thread only)
+        PdoOverlay pdo_;
+        alignas(64) JointInputs pdo_in_[NUM_JOINTS] = {};
+        alignas(64) JointOutputs pdo_out_[NUM_JOINTS] = {};
+
         sensor_msgs::msg::JointState joint_states_;
-        std::vector<int32_t> joint_states_enc_counts_;
+        // Actual positions, written by the RT thread one joint per cycle
+        std::atomic<int32_t> joint_states_enc_counts_[NUM_JOINTS] = {};
         std::vector<int32_t> joint_commands_;
 
+        //* arm/command latency measurement (ArmHardwareInterface::write -> PDO latch)
+        // Header stamp and receive time of latest arm/command, in CLOCK_REALTIME ns
+        std::atomic<int64_t> cmd_stamp_ns_{0};
+        std::atomic<int64_t> cmd_recv_ns_{0};
+        // Stamp of the last command written into the RxPDOs (RT thread only)
+        int64_t latched_stamp_ns_ = 0;
+        LatencyStats cmd_transport_latency_;
+        LatencyStats cmd_latch_latency_;
+        LatencyStats cmd_total_latency_;
+
+        //* Motion onset detection for teleop latency probes (RT thread only unless atomic)
+        bool latency_probe_ = false;
+        bool onset_armed_ = false;
+        uint32_t onset_idle_cycles_ = 0;
+        int64_t onset_latch_ns_ = 0;
+        std::vector<int32_t> onset_rest_counts_;
+        std::vector<int32_t> onset_last_cmd_;
+        LatencyStats cmd_onset_latency_;
+        // Latest onset handed to the normal priority thread, published when onset_seq_ changes
+        std::atomic<int64_t> onset_stamp_ns_{0};
+        std::atomic<int64_t> onset_cmd_latch_ns_{0};
+        std::atomic<int> onset_joint_{0};
+        std::atomic<uint32_t> onset_seq_{0};
+        uint32_t onset_published_seq_ = 0;
+
+        //* Gravity and friction feed-forward through the torque offset RxPDO (0x60B2)
+        GravityModel gravity_model_;
+        uint32_t rated_torque_[NUM_JOINTS] = {};    // mNm (0x6076), 0 disables the joint's offset
+        // RT thread only
+        double ff_gain_ = 0.0;
+        double ff_q_[NUM_JOINTS] = {};
+        double ff_qd_[NUM_JOINTS] = {};
+        double ff_tau_[NUM_JOINTS] = {};
+        int32_t ff_last_cmd_[NUM_JOINTS] = {};
+        bool ff_init_ = false;
+        std::atomic<int> ff_offset_[NUM_JOINTS] = {};  // last written torque offset, per mille
+
+        //* Following error (target written last cycle - actual position)
+        int32_t fe_last_target_[NUM_JOINTS] = {};
+        bool fe_valid_ = false;
+        FollowingErrorStats following_error_[NUM_JOINTS];
+
+        //* Joint envelope of the commands written in CSP (see JointEnvelope)
+        JointEnvelope envelope_;
+        bool envelope_reset_ = true;    // RT thread only
+        EnvelopeStats envelope_stats_[JointEnvelope::KINDS][NUM_JOINTS];
+        std::atomic<bool> envelope_stopped_{false};
+        // Stop, kinds that caused it and the held position, written before envelope_stop_seq_
+        // is released once the arm stands still
+        uint32_t envelope_stop_kinds_ = 0;
+        int32_t envelope_hold_[NUM_JOINTS] = {};
+        std::atomic<uint32_t> envelope_stop_seq_{0};
+        std::atomic<uint32_t> envelope_resume_seq_{0};
+        // Normal priority thread only
+        uint32_t envelope_stop_seen_ = 0;
+        uint32_t envelope_resume_seen_ = 0;
+
+        //* Speed override, arm/command is replayed on a scaled clock (see SpeedOverride)
+        SpeedOverride speed_override_;
+        bool override_was_enabled_ = false;     // RT thread only
+        uint64_t override_overflows_ = 0;
+        double override_published_ = -1.0;      // Normal priority thread only
+        std::atomic<bool> drives_enabled_{false};
+
+        //* Profile Position (PP) moves, the drives generate the profile (see profile_move_())
+        enum class ProfileMoveState { IDLE, SWITCH_TO_PP, SET_POINT, MOVING, HALTING, QUICK_STOP, SWITCH_TO_CSP };
+        enum ProfileMoveResult { PP_REACHED, PP_STOPPED, PP_FOLLOWING_ERROR, PP_MODE_TIMEOUT, PP_ACK_TIMEOUT, PP_DRIVES_DISABLED, PP_HALT_TIMEOUT };
+        // Request, written before pp_request_seq_ is released and only while no move runs
+        int32_t pp_target_[NUM_JOINTS] = {};
+        uint32_t pp_velocity_[NUM_JOINTS] = {};     // counts/s
+        uint32_t pp_accel_[NUM_JOINTS] = {};        // counts/s^2
+        std::atomic<uint32_t> pp_request_seq_{0};
+        std::atomic<bool> pp_abort_{false};
+        // Result, written before pp_done_seq_ is released
+        int32_t pp_final_[NUM_JOINTS] = {};
+        ProfileMoveResult pp_result_ = PP_REACHED;
+        std::atomic<uint32_t> pp_done_seq_{0};
+        // RT thread only
+        ProfileMoveState pp_state_ = ProfileMoveState::IDLE;
+        uint32_t pp_cycles_ = 0;
+        uint32_t pp_still_cycles_ = 0;
+        int32_t pp_last_actual_[NUM_JOINTS] = {};
+        // Normal priority thread only
+        bool pp_waiting_ = false;
+        std::shared_ptr<rmw_request_id_t> pp_header_;
+        std::chrono::steady_clock::time_point pp_start_;
+        std::chrono::steady_clock::time_point pp_deadline_;
+        bool cmd_gated_ = false;
+        int32_t pp_hold_[NUM_JOINTS] = {};
+        int32_t last_cmd_counts_[NUM_JOINTS] = {};
+        int64_t last_cmd_change_ns_ = 0;
+
         rclcpp::Publisher<sensor_msgs::msg::JointState>::SharedPtr arm_state_pub_;
         rclcpp::Subscription<sensor_msgs::msg::JointState>::SharedPtr arm_cmd_sub_;
+        rclcpp::Subscription<std_msgs::msg::Float64>::SharedPtr speed_override_sub_;
+        rclcpp::Publisher<std_msgs::msg::Float64>::SharedPtr speed_override_scale_pub_;
+        rclcpp::Publisher<sensor_msgs::msg::TimeReference>::SharedPtr motion_onset_pub_;
+        rclcpp::Publisher<diagnostic_msgs::msg::DiagnosticArray>::SharedPtr following_error_pub_;
+        rclcpp::Publisher<trajectory_msgs::msg::JointTrajectory>::SharedPtr pp_resync_pub_;
+        rclcpp::Service<arm_msgs::srv::ProfileMove>::SharedPtr profile_move_srv_;
+        OnSetParametersCallbackHandle::SharedPtr param_cb_handle_;
 
         rclcpp::TimerBase::SharedPtr cyclic_pdo_timer_;
         rclcpp::TimerBase::SharedPtr joint_state_pub_timer_;
+        rclcpp::TimerBase::SharedPtr latency_report_timer_;
+        rclcpp::TimerBase::SharedPtr following_error_timer_;
+        rclcpp::TimerBase::SharedPtr profile_move_timer_;
+        rclcpp::TimerBase::SharedPtr envelope_timer_;
 
         rclcpp::CallbackGroup::SharedPtr high_prio_cbg_;
         rclcpp::CallbackGroup::SharedPtr normal_prio_cbg_;
+
+        // The high priority group is not added to the executor spinning this node (standalone
+        // or component container), it is spun by a SCHED_FIFO thread owned by the node
+        rclcpp::executors::SingleThreadedExecutor::SharedPtr rt_executor_;
+        std::thread rt_thread_;
         
 
         bool configure_pdos_();
         bool set_drive_parameters_();
         bool init_();
+        void benchmark_pdo_access_();
+        void start_rt_thread_();
 
         bool state_transition_();
         void cyclic_pdo_loop_();
+        void init_scheduler_();
+        void drive_state_task_();
+        void command_task_();
+        void feed_forward_task_();
+        void dc_sync_reference_task_();
+        void sdo_task_();
+        void detect_motion_onset_();
+        void torque_feed_forward_(double dt);
+        void track_following_error_();
+        void enforce_envelope_();
+        bool profile_move_();
+        void leave_profile_move_(ProfileMoveResult result, const int32_t actual[NUM_JOINTS]);
 
         void read_sdos(int joint_no);
         void check_master_state_();
@@ -93,7 +338,23 @@ class ZeroErrInterface : public rclcpp::Node
         void check_domain_state_();
         
         void joint_state_pub_();
+        void publish_motion_onset_();
+        void following_error_report_();
+        void declare_rt_config_params_();
+        bool apply_rt_config_param_(const rclcpp::Parameter &param, RtConfig &config, std::string &reason) const;
+        bool check_envelope_(const JointEnvelope::Limits &limits, std::string &reason) const;
+        void declare_speed_override_params_();
+        void set_speed_override_(double percent);
+        rcl_interfaces::msg::SetParametersResult param_cb_(const std::vector<rclcpp::Parameter> &params);
+        void latency_report_();
+        void report_stage_(const char *stage, LatencyStats &stats);
+
+        void profile_move_cb_(const std::shared_ptr<rmw_request_id_t> header, const std::shared_ptr<arm_msgs::srv::ProfileMove::Request> request);
+        void profile_move_poll_();
+        void envelope_poll_();
+        void publish_resync_(const int32_t position[NUM_JOINTS]);
 
         void arm_cmd_cb_(sensor_msgs::msg::JointState::UniquePtr arm_cmd);
+        void speed_override_cb_(const std_msgs::msg::Float64::SharedPtr msg);
 
 };
\ No newline at end of file
@@ -39,11 +39,17 @@
 #define TARGET_POS_INDEX    0x607A, 0
 #define DIGI_OUT_INDEX      0x60FE, 0
 #define CTRL_WORD_INDEX     0x6040, 0
+#define TORQUE_OFFSET_INDEX 0x60B2, 0
+#define OP_MODE_INDEX       0x6060, 0
+#define PROFILE_VEL_INDEX   0x6081, 0
+#define PROFILE_ACC_INDEX   0x6083, 0
+#define PROFILE_DEC_INDEX   0x6084, 0
 
 // TxPDO object index, subindex
 #define POS_ACTUAL_INDEX    0x6064, 0
 #define DIGI_INPUT_INDEX    0x60FD, 0
 #define STATUS_WORD_INDEX   0x6041, 0  
+#define OP_MODE_DISP_INDEX  0x6061, 0
 
 // Other objects in dictionary (index, subindex)
 #define SM2_SYNC_TYPE           0x1C32, 1
@@ -64,6 +70,20 @@
 #define POS_WINDOW              0x6067, 0
 #define POS_WINDOW_TIMEOUT      0x6068, 0
 #define TARGET_VELOCITY         0x60FF, 0
+#define RATED_TORQUE            0x6076, 0
+
+// Modes of operation (0x6060)
+#define MODE_PP     0x01    // Profile Position, the drive generates the motion profile
+#define MODE_CSP    0x08    // Cyclic Synchronous Position, a new target every cycle
+
+// Profile Position control word (0x6040) and status word (0x6041) bits
+#define CW_NEW_SET_POINT        (1 << 4)
+#define CW_CHANGE_IMMEDIATELY   (1 << 5)
+#define CW_RELATIVE             (1 << 6)
+#define CW_HALT                 (1 << 8)
+#define SW_TARGET_REACHED       (1 << 10)
+#define SW_SET_POINT_ACK        (1 << 12)
+#define SW_FOLLOWING_ERROR      (1 << 13)
 
 
 //* Ethercat variables
@@ -108,14 +128,21 @@ static uint8_t *domain_pd;
 // RxPDO entry offsets
 static unsigned int target_pos_offset[NUM_JOINTS];
 static unsigned int ctrl_word_offset[NUM_JOINTS];
+static unsigned int torque_offset_offset[NUM_JOINTS];
+static unsigned int op_mode_offset[NUM_JOINTS];
+static unsigned int profile_vel_offset[NUM_JOINTS];
+static unsigned int profile_acc_offset[NUM_JOINTS];
+static unsigned int profile_dec_offset[NUM_JOINTS];
 
 // TxPDO entry offsets
 static unsigned int actual_pos_offset[NUM_JOINTS];
 static unsigned int status_word_offset[NUM_JOINTS];
+static unsigned int op_mode_disp_offset[NUM_JOINTS];
 
 /**
  * @brief Process data domain registry containing the following objects from every joint:
- *  actual position, target position, status word, and control word.
+ *  actual position, target position, status word, control word, torque offset, mode of
+ *  operation (+ display) and the profile velocity/acceleration/deceleration.
  * 
  * @note Omits digital I/O objects from Rx/TxPDOs.
  * 
@@ -125,26 +152,62 @@ const static ec_pdo_entry_reg_t domain_regs_[] = {
     {JOINT1_ALIAS_POS, ZEROERR_EROB, STATUS_WORD_INDEX, &status_word_offset[0], NULL},
     {JOINT1_ALIAS_POS, ZEROERR_EROB, TARGET_POS_INDEX,  &target_pos_offset[0], NULL},
     {JOINT1_ALIAS_POS, ZEROERR_EROB, CTRL_WORD_INDEX,   &ctrl_word_offset[0], NULL},
+    {JOINT1_ALIAS_POS, ZEROERR_EROB, TORQUE_OFFSET_INDEX, &torque_offset_offset[0], NULL},
+    {JOINT1_ALIAS_POS, ZEROERR_EROB, OP_MODE_INDEX,     &op_mode_offset[0], NULL},
+    {JOINT1_ALIAS_POS, ZEROERR_EROB, OP_MODE_DISP_INDEX, &op_mode_disp_offset[0], NULL},
+    {JOINT1_ALIAS_POS, ZEROERR_EROB, PROFILE_VEL_INDEX, &profile_vel_offset[0], NULL},
+    {JOINT1_ALIAS_POS, ZEROERR_EROB, PROFILE_ACC_INDEX, &profile_acc_offset[0], NULL},
+    {JOINT1_ALIAS_POS, ZEROERR_EROB, PROFILE_DEC_INDEX, &profile_dec_offset[0], NULL},
     {JOINT2_ALIAS_POS, ZEROERR_EROB, POS_ACTUAL_INDEX,  &actual_pos_offset[1], NULL},
     {JOINT2_ALIAS_POS, ZEROERR_EROB, STATUS_WORD_INDEX, &status_word_offset[1], NULL},
     {JOINT2_ALIAS_POS, ZEROERR_EROB, TARGET_POS_INDEX,  &target_pos_offset[1], NULL},
     {JOINT2_ALIAS_POS, ZEROERR_EROB, CTRL_WORD_INDEX,   &ctrl_word_offset[1], NULL},
+    {JOINT2_ALIAS_POS, ZEROERR_EROB, TORQUE_OFFSET_INDEX, &torque_offset_offset[1], NULL},
+    {JOINT2_ALIAS_POS, ZEROERR_EROB, OP_MODE_INDEX,     &op_mode_offset[1], NULL},
+    {JOINT2_ALIAS_POS, ZEROERR_EROB, OP_MODE_DISP_INDEX, &op_mode_disp_offset[1], NULL},
+    {JOINT2_ALIAS_POS, ZEROERR_EROB, PROFILE_VEL_INDEX, &profile_vel_offset[1], NULL},
+    {JOINT2_ALIAS_POS, ZEROERR_EROB, PROFILE_ACC_INDEX, &profile_acc_offset[1], NULL},
+    {JOINT2_ALIAS_POS, ZEROERR_EROB, PROFILE_DEC_INDEX, &profile_dec_offset[1], NULL},
     {JOINT3_ALIAS_POS, ZEROERR_EROB, POS_ACTUAL_INDEX,  &actual_pos_offset[2], NULL},
     {JOINT3_ALIAS_POS, ZEROERR_EROB, STATUS_WORD_INDEX, &status_word_offset[2], NULL},
     {JOINT3_ALIAS_POS, ZEROERR_EROB, TARGET_POS_INDEX,  &target_pos_offset[2], NULL},
     {JOINT3_ALIAS_POS, ZEROERR_EROB, CTRL_WORD_INDEX,   &ctrl_word_offset[2], NULL},
+    {JOINT3_ALIAS_POS, ZEROERR_EROB, TORQUE_OFFSET_INDEX, &torque_offset_offset[2], NULL},
+    {JOINT3_ALIAS_POS, ZEROERR_EROB, OP_MODE_INDEX,     &op_mode_offset[2], NULL},
+    {JOINT3_ALIAS_POS, ZEROERR_EROB, OP_MODE_DISP_INDEX, &op_mode_disp_offset[2], NULL},
+    {JOINT3_ALIAS_POS, ZEROERR_EROB, PROFILE_VEL_INDEX, &profile_vel_offset[2], NULL},
+    {JOINT3_ALIAS_POS, ZEROERR_EROB, PROFILE_ACC_INDEX, &profile_acc_offset[2], NULL},
+    {JOINT3_ALIAS_POS, ZEROERR_EROB, PROFILE_DEC_INDEX, &profile_dec_offset[2], NULL},
     {JOINT4_ALIAS_POS, ZEROERR_EROB, POS_ACTUAL_INDEX,  &actual_pos_offset[3], NULL},
     {JOINT4_ALIAS_POS, ZEROERR_EROB, STATUS_WORD_INDEX, &status_word_offset[3], NULL},
     {JOINT4_ALIAS_POS, ZEROERR_EROB, TARGET_POS_INDEX,  &target_pos_offset[3], NULL},
     {JOINT4_ALIAS_POS, ZEROERR_EROB, CTRL_WORD_INDEX,   &ctrl_word_offset[3], NULL},
+    {JOINT4_ALIAS_POS, ZEROERR_EROB, TORQUE_OFFSET_INDEX, &torque_offset_offset[3], NULL},
+    {JOINT4_ALIAS_POS, ZEROERR_EROB, OP_MODE_INDEX,     &op_mode_offset[3], NULL},
+    {JOINT4_ALIAS_POS, ZEROERR_EROB, OP_MODE_DISP_INDEX, &op_mode_disp_offset[3], NULL},
+    {JOINT4_ALIAS_POS, ZEROERR_EROB, PROFILE_VEL_INDEX, &profile_vel_offset[3], NULL},
+    {JOINT4_ALIAS_POS, ZEROERR_EROB, PROFILE_ACC_INDEX, &profile_acc_offset[3], NULL},
+    {JOINT4_ALIAS_POS, ZEROERR_EROB, PROFILE_DEC_INDEX, &profile_dec_offset[3], NULL},
     {JOINT5_ALIAS_POS, ZEROERR_EROB, POS_ACTUAL_INDEX,  &actual_pos_offset[4], NULL},
     {JOINT5_ALIAS_POS, ZEROERR_EROB, STATUS_WORD_INDEX, &status_word_offset[4], NULL},
     {JOINT5_ALIAS_POS, ZEROERR_EROB, TARGET_POS_INDEX,  &target_pos_offset[4], NULL},
     {JOINT5_ALIAS_POS, ZEROERR_EROB, CTRL_WORD_INDEX,   &ctrl_word_offset[4], NULL},
+    {JOINT5_ALIAS_POS, ZEROERR_EROB, TORQUE_OFFSET_INDEX, &torque_offset_offset[4], NULL},
+    {JOINT5_ALIAS_POS, ZEROERR_EROB, OP_MODE_INDEX,     &op_mode_offset[4], NULL},
+    {JOINT5_ALIAS_POS, ZEROERR_EROB, OP_MODE_DISP_INDEX, &op_mode_disp_offset[4], NULL},
+    {JOINT5_ALIAS_POS, ZEROERR_EROB, PROFILE_VEL_INDEX, &profile_vel_offset[4], NULL},
+    {JOINT5_ALIAS_POS, ZEROERR_EROB, PROFILE_ACC_INDEX, &profile_acc_offset[4], NULL},
+    {JOINT5_ALIAS_POS, ZEROERR_EROB, PROFILE_DEC_INDEX, &profile_dec_offset[4], NULL},
     {JOINT6_ALIAS_POS, ZEROERR_EROB, POS_ACTUAL_INDEX,  &actual_pos_offset[5], NULL},
     {JOINT6_ALIAS_POS, ZEROERR_EROB, STATUS_WORD_INDEX, &status_word_offset[5], NULL},
     {JOINT6_ALIAS_POS, ZEROERR_EROB, TARGET_POS_INDEX,  &target_pos_offset[5], NULL},
     {JOINT6_ALIAS_POS, ZEROERR_EROB, CTRL_WORD_INDEX,   &ctrl_word_offset[5], NULL},
+    {JOINT6_ALIAS_POS, ZEROERR_EROB, TORQUE_OFFSET_INDEX, &torque_offset_offset[5], NULL},
+    {JOINT6_ALIAS_POS, ZEROERR_EROB, OP_MODE_INDEX,     &op_mode_offset[5], NULL},
+    {JOINT6_ALIAS_POS, ZEROERR_EROB, OP_MODE_DISP_INDEX, &op_mode_disp_offset[5], NULL},
+    {JOINT6_ALIAS_POS, ZEROERR_EROB, PROFILE_VEL_INDEX, &profile_vel_offset[5], NULL},
+    {JOINT6_ALIAS_POS, ZEROERR_EROB, PROFILE_ACC_INDEX, &profile_acc_offset[5], NULL},
+    {JOINT6_ALIAS_POS, ZEROERR_EROB, PROFILE_DEC_INDEX, &profile_dec_offset[5], NULL},
     {} //! Terminate with empty struct, ignore compiler warning
 };
 
@@ -153,14 +216,20 @@ ec_pdo_entry_info_t erob_pdo_entries_[] = {
     {TARGET_POS_INDEX, 32},
     {DIGI_OUT_INDEX, 32},
     {CTRL_WORD_INDEX, 16},
+    {TORQUE_OFFSET_INDEX, 16},
+    {OP_MODE_INDEX, 8},
+    {PROFILE_VEL_INDEX, 32},
+    {PROFILE_ACC_INDEX, 32},
+    {PROFILE_DEC_INDEX, 32},
     {POS_ACTUAL_INDEX, 32},
     {DIGI_INPUT_INDEX, 32},
-    {STATUS_WORD_INDEX, 16}
+    {STATUS_WORD_INDEX, 16},
+    {OP_MODE_DISP_INDEX, 8}
 };
 
 static ec_pdo_info_t erob_pdos_[] = {
-    {0x1600, 3, erob_pdo_entries_},
-    {0x1A00, 3, erob_pdo_entries_ + 3}
+    {0x1600, 8, erob_pdo_entries_},
+    {0x1A00, 4, erob_pdo_entries_ + 8}
 };
 
 static ec_sync_info_t erob_syncs_[] = {
@@ -0,0 +1,182 @@
+#ifndef __GRAVITY_MODEL_H__
+#define __GRAVITY_MODEL_H__
+
+#include <cmath>
+
+#ifndef NUM_JOINTS
+#define NUM_JOINTS 6
+#endif
+
+
+/**
+ * @brief Static gravity torques of the arm from the arm_description URDF inertials.
+ *
+ * Joint origins, axes and link masses/centers of mass are copied from
+ * arm_description/urdf/zeroerr.urdf (the fixed camera_Link is lumped into j6_Link).
+ * Update them together with the URDF.
+ *
+ * @note compute() is allocation-free and safe to call from the cyclic PDO loop.
+ *
+ */
+class GravityModel
+{
+    public:
+        GravityModel()
+        {
+            for (int i = 0; i < NUM_JOINTS; i++)
+                rpy_to_rot_(JOINT_RPY[i], joint_rot_[i]);
+
+            for (int i = 0; i < NUM_JOINTS; i++)
+            {
+                mass_[i] = LINK_MASS[i];
+                for (int k = 0; k < 3; k++) com_[i][k] = LINK_COM[i][k];
+            }
+
+            // Lump camera_Link into j6_Link
+            double cam_rot[3][3], cam_com[3];
+            rpy_to_rot_(CAMERA_RPY, cam_rot);
+            mat_vec_(cam_rot, CAMERA_COM, cam_com);
+
+            double m = mass_[5] + CAMERA_MASS;
+            for (int k = 0; k < 3; k++)
+                com_[5][k] = (mass_[5] * com_[5][k] + CAMERA_MASS * (cam_com[k] + CAMERA_XYZ[k])) / m;
+            mass_[5] = m;
+        }
+
+        /**
+         * @brief Joint torques [Nm] holding the arm against gravity at joint positions q.
+         *
+         * @param q Joint positions [rad], URDF convention
+         * @param tau Output torques [Nm], positive about the URDF joint axis
+         */
+        void compute(const double q[NUM_JOINTS], double tau[NUM_JOINTS]) const
+        {
+            // Forward kinematics in arm_Link: joint axis/origin and link CoM in world
+            double rot[3][3] = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+            double pos[3] = {0, 0, 0};
+            double axis[NUM_JOINTS][3], origin[NUM_JOINTS][3], com[NUM_JOINTS][3];
+
+            for (int i = 0; i < NUM_JOINTS; i++)
+            {
+                // Frame at joint origin
+                double offset[3], joint_frame[3][3];
+                mat_vec_(rot, JOINT_XYZ[i], offset);
+                for (int k = 0; k < 3; k++) pos[k] += offset[k];
+                mat_mat_(rot, joint_rot_[i], joint_frame);
+
+                mat_vec_(joint_frame, JOINT_AXIS[i], axis[i]);
+                for (int k = 0; k < 3; k++) origin[i][k] = pos[k];
+
+                // Rotate about the joint axis (Rodrigues)
+                double joint_rot[3][3];
+                axis_angle_to_rot_(JOINT_AXIS[i], q[i], joint_rot);
+                mat_mat_(joint_frame, joint_rot, rot);
+
+                double link_com[3];
+                mat_vec_(rot, com_[i], link_com);
+                for (int k = 0; k < 3; k++) com[i][k] = pos[k] + link_com[k];
+            }
+
+            // Torque needed at joint i to hold every link outboard of it
+            for (int i = 0; i < NUM_JOINTS; i++)
+            {
+                double moment[3] = {0, 0, 0};
+                for (int j = i; j < NUM_JOINTS; j++)
+                {
+                    double r[3] = {com[j][0] - origin[i][0], com[j][1] - origin[i][1], com[j][2] - origin[i][2]};
+
+                    // r x (m * g), g = (0, 0, -G)
+                    double f = -mass_[j] * G;
+                    moment[0] += r[1] * f;
+                    moment[1] -= r[0] * f;
+                }
+                tau[i] = -(axis[i][0] * moment[0] + axis[i][1] * moment[1] + axis[i][2] * moment[2]);
+            }
+        }
+
+
+    private:
+        static constexpr double G = 9.80665;
+
+        //* zeroerr.urdf joint origins (parent frame) and axes
+        static constexpr double JOINT_XYZ[NUM_JOINTS][3] = {
+            {0.0774999999999998, -0.0775, 0.0388999999999997},
+            {-0.0491744080889805, 0.0734000000000008, 0.0354152169144622},
+            {0, -0.425, 0},
+            {0, 0.401, 0},
+            {0, -0.0374999756318092, 0.0423999994412073},
+            {0, -0.0485, 0.0375}
+        };
+        static constexpr double JOINT_RPY[NUM_JOINTS][3] = {
+            {1.5707963267949, 0, 2.51744046366525},
+            {0, 0.946644136870351, 3.14159265358979},
+            {3.14159265358979, 0, 0},
+            {3.14159263868863, 0, 0},
+            {0, 0, 0},
+            {3.1416, 0, -1.5708}
+        };
+        static constexpr double JOINT_AXIS[NUM_JOINTS][3] = {
+            {0, 1, 0}, {0, 0, 1}, {0, 0, 1}, {0, 0, 1}, {0, -1, 0}, {0, 0, -1}
+        };
+
+        //* zeroerr.urdf link inertials (j1_Link ... j6_Link)
+        static constexpr double LINK_MASS[NUM_JOINTS] = {
+            1.13778569832606, 2.706624786604, 1.64557213465188,
+            0.324727718002135, 0.307352171858084, 0.104910783608116
+        };
+        static constexpr double LINK_COM[NUM_JOINTS][3] = {
+            {-0.00719467239022037, 0.0669939976973893, 0.00516422430945274},
+            {7.37454684970884E-07, -0.212502487457448, 0.0680174435124814},
+            {4.11768821524661E-06, 0.136177235047512, 0.0441508655223075},
+            {2.65905320264992E-05, -0.000338911001806053, 0.0370989318213302},
+            {-2.80611665418734E-05, -0.0446665067516046, -0.00028846278241848},
+            {-0.000337775360231829, 0.000125548461417394, -0.0168048529947492}
+        };
+
+        //* camera_Link, fixed to j6_Link
+        static constexpr double CAMERA_MASS = 0.00120400775794929;
+        static constexpr double CAMERA_XYZ[3] = {0.073713, -0.0295, -0.0145};
+        static constexpr double CAMERA_RPY[3] = {-1.5708, 0, 1.5708};
+        static constexpr double CAMERA_COM[3] = {0.026783320529774, 0.00170482151528056, -0.00450738744405443};
+
+        double joint_rot_[NUM_JOINTS][3][3];
+        double mass_[NUM_JOINTS];
+        double com_[NUM_JOINTS][3];
+
+
+        static void rpy_to_rot_(const double rpy[3], double r[3][3])
+        {
+            double cr = std::cos(rpy[0]), sr = std::sin(rpy[0]);
+            double cp = std::cos(rpy[1]), sp = std::sin(rpy[1]);
+            double cy = std::cos(rpy[2]), sy = std::sin(rpy[2]);
+
+            // R = Rz(yaw) * Ry(pitch) * Rx(roll)
+            r[0][0] = cy * cp;  r[0][1] = cy * sp * sr - sy * cr;  r[0][2] = cy * sp * cr + sy * sr;
+            r[1][0] = sy * cp;  r[1][1] = sy * sp * sr + cy * cr;  r[1][2] = sy * sp * cr - cy * sr;
+            r[2][0] = -sp;      r[2][1] = cp * sr;                 r[2][2] = cp * cr;
+        }
+
+        static void axis_angle_to_rot_(const double a[3], double angle, double r[3][3])
+        {
+            double c = std::cos(angle), s = std::sin(angle), t = 1.0 - c;
+
+            r[0][0] = t * a[0] * a[0] + c;         r[0][1] = t * a[0] * a[1] - s * a[2];  r[0][2] = t * a[0] * a[2] + s * a[1];
+            r[1][0] = t * a[0] * a[1] + s * a[2];  r[1][1] = t * a[1] * a[1] + c;         r[1][2] = t * a[1] * a[2] - s * a[0];
+            r[2][0] = t * a[0] * a[2] - s * a[1];  r[2][1] = t * a[1] * a[2] + s * a[0];  r[2][2] = t * a[2] * a[2] + c;
+        }
+
+        static void mat_vec_(const double m[3][3], const double v[3], double out[3])
+        {
+            for (int i = 0; i < 3; i++)
+                out[i] = m[i][0] * v[0] + m[i][1] * v[1] + m[i][2] * v[2];
+        }
+
+        static void mat_mat_(const double a[3][3], const double b[3][3], double out[3][3])
+        {
+            for (int i = 0; i < 3; i++)
+                for (int j = 0; j < 3; j++)
+                    out[i][j] = a[i][0] * b[0][j] + a[i][1] * b[1][j] + a[i][2] * b[2][j];
+        }
+};
+
+#endif
@@ -0,0 +1,259 @@
+#ifndef __JOINT_ENVELOPE_H__
+#define __JOINT_ENVELOPE_H__
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#ifndef NUM_JOINTS
+#define NUM_JOINTS 6
+#endif
+
+
+/**
+ * @brief What the RT loop does when a joint command leaves its envelope.
+ *
+ *   WARN   count and report only, the command is written as is
+ *   CLAMP  write the command limited to the envelope (position and velocity only)
+ *   STOP   stop all joints on the path they were on, decelerating at the acceleration
+ *          limits, and hold until the commands come back to the held position
+ *
+ */
+enum class EnvelopeReaction : uint8_t { WARN, CLAMP, STOP };
+
+
+/**
+ * @brief Position, velocity and acceleration envelope of the joint commands, enforced
+ * every cycle before they are written to the drives.
+ *
+ * Checks of one cycle:
+ *   position      the command's stopping position at the acceleration limit lies beyond
+ *                 a position limit while moving towards it, so a STOP ends inside the limits
+ *   velocity      command difference to the last cycle
+ *   acceleration  second difference over ACC_WINDOW cycles; over a single cycle the
+ *                 encoder resolution alone amounts to ~12 rad/s^2
+ *
+ * Joints are processed as fixed-size lanes of structure-of-arrays data (padded to LANES,
+ * the padding lanes are unlimited), with comparisons and clamps written branch-free so the
+ * per-joint loops vectorize.
+ *
+ * All values in encoder counts and cycles (counts, counts/cycle, counts/cycle^2).
+ *
+ * @note apply() is allocation-free and non-blocking, RT thread only.
+ *
+ */
+class JointEnvelope
+{
+    public:
+        static constexpr size_t LANES = 8;
+        static constexpr size_t ACC_WINDOW = 8;
+
+        enum Kind { POSITION, VELOCITY, ACCELERATION, KINDS };
+        enum State { TRACKING, STOPPING, STOPPED };
+
+        static_assert(NUM_JOINTS <= LANES, "JointEnvelope lanes must hold all joints");
+
+        struct Limits
+        {
+            alignas(64) double pos_min[LANES];
+            alignas(64) double pos_max[LANES];
+            alignas(64) double vel[LANES];
+            alignas(64) double acc[LANES];
+            EnvelopeReaction reaction[KINDS] = { EnvelopeReaction::WARN, EnvelopeReaction::WARN, EnvelopeReaction::WARN };
+            // Commands closer than this to the held position end a STOP [counts]
+            double resync_tolerance = 10.0;
+
+            Limits()
+            {
+                std::fill(pos_min, pos_min + LANES, -UNLIMITED);
+                std::fill(pos_max, pos_max + LANES, UNLIMITED);
+                std::fill(vel, vel + LANES, UNLIMITED);
+                std::fill(acc, acc + LANES, UNLIMITED);
+            }
+        };
+
+        /**
+         * @brief Restarts from a standstill at the given position (drive enable, end of a
+         * profile move), without a jump the checks would take as motion.
+         *
+         */
+        void reset(const int32_t position[NUM_JOINTS])
+        {
+            for (size_t i = 0; i < NUM_JOINTS; i++)
+                x_prev_[i] = p_[i] = position[i];
+            std::fill(v_, v_ + LANES, 0.0);
+
+            for (size_t k = 0; k < HISTORY; k++)
+                std::copy(x_prev_, x_prev_ + LANES, history_[k]);
+
+            state_ = TRACKING;
+        }
+
+        /**
+         * @brief Checks one cycle's commands and replaces them by what is to be written.
+         *
+         * @param limits Envelope and reactions
+         * @param target In: commands, out: targets for the drives
+         * @return Violated kinds (1 << Kind), while tracking
+         */
+        uint32_t apply(const Limits &limits, int32_t target[NUM_JOINTS])
+        {
+            alignas(64) double x[LANES] = {};
+            for (size_t i = 0; i < NUM_JOINTS; i++)
+                x[i] = target[i];
+
+            const double *x_w = history_[(head_ + HISTORY - ACC_WINDOW) % HISTORY];
+            const double *x_2w = history_[head_];
+            const double inv_w2 = 1.0 / (ACC_WINDOW * ACC_WINDOW);
+
+            //* Checks, excess_ > 0 where violated
+            double any[KINDS] = {};
+            for (size_t l = 0; l < LANES; l++)
+            {
+                const double vx = x[l] - x_prev_[l];
+                const double ax = (x[l] - 2.0 * x_w[l] + x_2w[l]) * inv_w2;
+                const double x_stop = x[l] + vx * std::fabs(vx) / (2.0 * limits.acc[l]);
+
+                const double over = std::max(x_stop - limits.pos_max[l], 0.0) * (vx > 0.0);
+                const double under = std::max(limits.pos_min[l] - x_stop, 0.0) * (vx < 0.0);
+                excess_[POSITION][l] = over + under;
+                excess_[VELOCITY][l] = std::max(std::fabs(vx) / limits.vel[l] - 1.0, 0.0);
+                excess_[ACCELERATION][l] = std::max(std::fabs(ax) / limits.acc[l] - 1.0, 0.0);
+
+                any[POSITION] += excess_[POSITION][l];
+                any[VELOCITY] += excess_[VELOCITY][l];
+                any[ACCELERATION] += excess_[ACCELERATION][l];
+            }
+
+            std::copy(x, x + LANES, x_prev_);
+            std::copy(x, x + LANES, history_[head_]);
+            head_ = (head_ + 1) % HISTORY;
+
+            uint32_t violated = 0;
+            bool stop = false;
+            for (int k = 0; k < KINDS; k++)
+            {
+                if (any[k] > 0.0)
+                {
+                    violated |= 1u << k;
+                    stop |= (limits.reaction[k] == EnvelopeReaction::STOP);
+                }
+            }
+
+            switch (state_)
+            {
+                case TRACKING:
+                    if (stop)
+                    {
+                        begin_stop_(limits);
+                        step_stop_();
+                    }
+                    else
+                        track_(limits, x);
+                    break;
+
+                case STOPPING:
+                    step_stop_();
+                    violated = 0;
+                    break;
+
+                case STOPPED:
+                    violated = 0;
+                    if (resynced_(limits, x))
+                        state_ = TRACKING;
+                    break;
+            }
+
+            for (size_t i = 0; i < NUM_JOINTS; i++)
+                target[i] = (int32_t) std::lround(p_[i]);
+
+            return violated;
+        }
+
+        State state() const { return state_; }
+
+        //* Last cycle's excess of joint i: position [counts], velocity and acceleration [ratio - 1]
+        double excess(Kind kind, size_t i) const { return excess_[kind][i]; }
+
+
+    private:
+        static constexpr double UNLIMITED = 1e15;
+        static constexpr size_t HISTORY = 2 * ACC_WINDOW;
+
+        State state_ = TRACKING;
+
+        // Written targets, position and velocity per cycle
+        alignas(64) double p_[LANES] = {};
+        alignas(64) double v_[LANES] = {};
+
+        // Commands, last cycle and the last HISTORY cycles (ring, head_ is the oldest)
+        alignas(64) double x_prev_[LANES] = {};
+        alignas(64) double history_[HISTORY][LANES] = {};
+        size_t head_ = 0;
+
+        alignas(64) double excess_[KINDS][LANES] = {};
+
+        // Stop, per cycle velocity decrement and cycles left
+        alignas(64) double decel_[LANES] = {};
+        uint32_t stop_cycles_ = 0;
+
+        void track_(const Limits &limits, const double x[LANES])
+        {
+            const bool clamp_pos = (limits.reaction[POSITION] == EnvelopeReaction::CLAMP);
+            const bool clamp_vel = (limits.reaction[VELOCITY] == EnvelopeReaction::CLAMP);
+
+            for (size_t l = 0; l < LANES; l++)
+            {
+                // A joint outside its limits may stay there or return, not move further out
+                const double lo = std::min(limits.pos_min[l], p_[l]);
+                const double hi = std::max(limits.pos_max[l], p_[l]);
+
+                double p = clamp_pos ? std::clamp(x[l], lo, hi) : x[l];
+                p = clamp_vel ? std::clamp(p, p_[l] - limits.vel[l], p_[l] + limits.vel[l]) : p;
+
+                v_[l] = p - p_[l];
+                p_[l] = p;
+            }
+        }
+
+        // All joints decelerate in the same number of cycles, the slowest to stop sets it,
+        // so the arm stops on the path it was on
+        void begin_stop_(const Limits &limits)
+        {
+            double cycles = 1.0;
+            for (size_t l = 0; l < LANES; l++)
+                cycles = std::max(cycles, std::fabs(v_[l]) / limits.acc[l]);
+
+            stop_cycles_ = (uint32_t) std::ceil(cycles);
+            for (size_t l = 0; l < LANES; l++)
+                decel_[l] = v_[l] / stop_cycles_;
+
+            state_ = STOPPING;
+        }
+
+        void step_stop_()
+        {
+            for (size_t l = 0; l < LANES; l++)
+            {
+                v_[l] -= decel_[l];
+                p_[l] += v_[l];
+            }
+
+            if (--stop_cycles_ == 0)
+            {
+                std::fill(v_, v_ + LANES, 0.0);
+                state_ = STOPPED;
+            }
+        }
+
+        bool resynced_(const Limits &limits, const double x[LANES]) const
+        {
+            double off = 0.0;
+            for (size_t l = 0; l < LANES; l++)
+                off = std::max(off, std::fabs(x[l] - p_[l]));
+            return off <= limits.resync_tolerance;
+        }
+};
+
+#endif
@@ -0,0 +1,235 @@
+#ifndef __PDO_OVERLAY_H__
+#define __PDO_OVERLAY_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#ifndef NUM_JOINTS
+#define NUM_JOINTS 6
+#endif
+
+// The process data image is little endian (EtherCAT), overlays and copies use it as is
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "PdoOverlay needs a little endian host");
+
+
+/**
+ * @brief eRob RxPDO 0x1600 and TxPDO 0x1A00 as mapped in ec_defines.h (erob_pdo_entries_),
+ * byte for byte.
+ *
+ */
+struct __attribute__((packed)) ErobRxPdo
+{
+    int32_t target_pos;         // 0x607A
+    uint32_t digital_out;       // 0x60FE
+    uint16_t ctrl_word;         // 0x6040
+    int16_t torque_offset;      // 0x60B2
+    int8_t op_mode;             // 0x6060
+    uint32_t profile_vel;       // 0x6081
+    uint32_t profile_acc;       // 0x6083
+    uint32_t profile_dec;       // 0x6084
+};
+
+struct __attribute__((packed)) ErobTxPdo
+{
+    int32_t actual_pos;         // 0x6064
+    uint32_t digital_in;        // 0x60FD
+    uint16_t status_word;       // 0x6041
+    int8_t op_mode_disp;        // 0x6061
+};
+
+static_assert(sizeof(ErobRxPdo) == 25 && sizeof(ErobTxPdo) == 11, "PDO structs must match the PDO mapping");
+
+
+/**
+ * @brief Process data of one joint as used by the cyclic loop, naturally aligned.
+ *
+ */
+struct JointInputs
+{
+    int32_t actual_pos;
+    uint16_t status_word;
+    int8_t op_mode_disp;
+};
+
+struct JointOutputs
+{
+    int32_t target_pos;
+    uint16_t ctrl_word;
+    int16_t torque_offset;
+    int8_t op_mode;
+    uint32_t profile_vel;
+    uint32_t profile_acc;
+    uint32_t profile_dec;
+};
+
+
+/**
+ * @brief Domain offsets of one joint's registered PDO entries (ecrt_domain_reg_pdo_entry_list).
+ *
+ */
+struct JointPdoOffsets
+{
+    unsigned int target_pos;
+    unsigned int ctrl_word;
+    unsigned int torque_offset;
+    unsigned int op_mode;
+    unsigned int profile_vel;
+    unsigned int profile_acc;
+    unsigned int profile_dec;
+    unsigned int actual_pos;
+    unsigned int status_word;
+    unsigned int op_mode_disp;
+};
+
+
+/**
+ * @brief Typed view of the process data image, replaces per-field EC_READ/EC_WRITE with
+ * scattered offset arrays in the cyclic loop.
+ *
+ * The domain layout is resolved once after activation. Where every joint's entries sit
+ * where ErobRxPdo/ErobTxPdo put them (the whole PDOs are in the domain, the usual case),
+ * the joints are accessed through packed struct pointers and the field types and offsets
+ * are compile-time constants. Otherwise a copy plan of (domain offset, field, size) is
+ * precomputed and replayed. Either way read() gathers all joints' inputs in one pass and
+ * write() scatters all outputs in one pass.
+ *
+ * @note read()/write() are allocation-free and non-blocking.
+ *
+ */
+class PdoOverlay
+{
+    public:
+        /**
+         * @brief Resolves the layout of the domain.
+         *
+         * @param domain_pd Process data image (ecrt_domain_data)
+         * @param offsets Registered entry offsets, per joint
+         * @return true if the packed struct overlay is used, false for the copy plan
+         */
+        bool map(uint8_t *domain_pd, const JointPdoOffsets offsets[NUM_JOINTS])
+        {
+            domain_pd_ = domain_pd;
+            direct_ = true;
+
+            for (size_t i = 0; i < NUM_JOINTS; i++)
+            {
+                const JointPdoOffsets &o = offsets[i];
+                const unsigned int rx = o.target_pos;
+                const unsigned int tx = o.actual_pos;
+
+                direct_ = direct_
+                    && o.ctrl_word == rx + offsetof(ErobRxPdo, ctrl_word)
+                    && o.torque_offset == rx + offsetof(ErobRxPdo, torque_offset)
+                    && o.op_mode == rx + offsetof(ErobRxPdo, op_mode)
+                    && o.profile_vel == rx + offsetof(ErobRxPdo, profile_vel)
+                    && o.profile_acc == rx + offsetof(ErobRxPdo, profile_acc)
+                    && o.profile_dec == rx + offsetof(ErobRxPdo, profile_dec)
+                    && o.status_word == tx + offsetof(ErobTxPdo, status_word)
+                    && o.op_mode_disp == tx + offsetof(ErobTxPdo, op_mode_disp);
+
+                rx_[i] = reinterpret_cast<ErobRxPdo *>(domain_pd + rx);
+                tx_[i] = reinterpret_cast<const ErobTxPdo *>(domain_pd + tx);
+            }
+
+            //* Copy plan, field order of JointInputs/JointOutputs
+            n_in_ = 0;
+            n_out_ = 0;
+            for (size_t i = 0; i < NUM_JOINTS; i++)
+            {
+                const JointPdoOffsets &o = offsets[i];
+                const size_t in = i * sizeof(JointInputs);
+                const size_t out = i * sizeof(JointOutputs);
+
+                in_plan_[n_in_++] = { o.actual_pos, in + offsetof(JointInputs, actual_pos), sizeof(int32_t) };
+                in_plan_[n_in_++] = { o.status_word, in + offsetof(JointInputs, status_word), sizeof(uint16_t) };
+                in_plan_[n_in_++] = { o.op_mode_disp, in + offsetof(JointInputs, op_mode_disp), sizeof(int8_t) };
+
+                out_plan_[n_out_++] = { o.target_pos, out + offsetof(JointOutputs, target_pos), sizeof(int32_t) };
+                out_plan_[n_out_++] = { o.ctrl_word, out + offsetof(JointOutputs, ctrl_word), sizeof(uint16_t) };
+                out_plan_[n_out_++] = { o.torque_offset, out + offsetof(JointOutputs, torque_offset), sizeof(int16_t) };
+                out_plan_[n_out_++] = { o.op_mode, out + offsetof(JointOutputs, op_mode), sizeof(int8_t) };
+                out_plan_[n_out_++] = { o.profile_vel, out + offsetof(JointOutputs, profile_vel), sizeof(uint32_t) };
+                out_plan_[n_out_++] = { o.profile_acc, out + offsetof(JointOutputs, profile_acc), sizeof(uint32_t) };
+                out_plan_[n_out_++] = { o.profile_dec, out + offsetof(JointOutputs, profile_dec), sizeof(uint32_t) };
+            }
+
+            return direct_;
+        }
+
+        bool direct() const { return direct_; }
+
+        //* Domain -> inputs of all joints
+        void read(JointInputs in[NUM_JOINTS]) const
+        {
+            if (direct_)
+            {
+                for (size_t i = 0; i < NUM_JOINTS; i++)
+                {
+                    const ErobTxPdo *tx = tx_[i];
+                    in[i].actual_pos = tx->actual_pos;
+                    in[i].status_word = tx->status_word;
+                    in[i].op_mode_disp = tx->op_mode_disp;
+                }
+                return;
+            }
+
+            uint8_t *dst = reinterpret_cast<uint8_t *>(in);
+            for (size_t k = 0; k < n_in_; k++)
+                std::memcpy(dst + in_plan_[k].field, domain_pd_ + in_plan_[k].domain, in_plan_[k].size);
+        }
+
+        //* Outputs of all joints -> domain
+        void write(const JointOutputs out[NUM_JOINTS])
+        {
+            if (direct_)
+            {
+                for (size_t i = 0; i < NUM_JOINTS; i++)
+                {
+                    ErobRxPdo *rx = rx_[i];
+                    rx->target_pos = out[i].target_pos;
+                    rx->ctrl_word = out[i].ctrl_word;
+                    rx->torque_offset = out[i].torque_offset;
+                    rx->op_mode = out[i].op_mode;
+                    rx->profile_vel = out[i].profile_vel;
+                    rx->profile_acc = out[i].profile_acc;
+                    rx->profile_dec = out[i].profile_dec;
+                }
+                return;
+            }
+
+            const uint8_t *src = reinterpret_cast<const uint8_t *>(out);
+            for (size_t k = 0; k < n_out_; k++)
+                std::memcpy(domain_pd_ + out_plan_[k].domain, src + out_plan_[k].field, out_plan_[k].size);
+        }
+
+        //* Domain -> outputs, the values currently in the image (e.g. after activation)
+        void read_outputs(JointOutputs out[NUM_JOINTS]) const
+        {
+            uint8_t *dst = reinterpret_cast<uint8_t *>(out);
+            for (size_t k = 0; k < n_out_; k++)
+                std::memcpy(dst + out_plan_[k].field, domain_pd_ + out_plan_[k].domain, out_plan_[k].size);
+        }
+
+
+    private:
+        struct Copy
+        {
+            unsigned int domain;    // byte offset in the image
+            size_t field;           // byte offset in the JointInputs/JointOutputs array
+            size_t size;
+        };
+
+        uint8_t *domain_pd_ = nullptr;
+        bool direct_ = false;
+
+        ErobRxPdo *rx_[NUM_JOINTS] = {};
+        const ErobTxPdo *tx_[NUM_JOINTS] = {};
+
+        Copy in_plan_[3 * NUM_JOINTS];
+        Copy out_plan_[7 * NUM_JOINTS];
+        size_t n_in_ = 0;
+        size_t n_out_ = 0;
+};
+
+#endif
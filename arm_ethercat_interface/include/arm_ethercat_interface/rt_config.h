@@ -0,0 +1,160 @@
+#ifndef __RT_CONFIG_H__
+#define __RT_CONFIG_H__
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "joint_envelope.h"
+
+
+/**
+ * @brief Tunables of the cyclic PDO loop, changed at runtime through the node's parameters
+ * (see ZeroErrInterface::param_cb_).
+ *
+ */
+struct RtConfig
+{
+    //* Gravity and friction feed-forward
+    bool gravity_ff = false;
+    double gravity_ff_scale = 1.0;
+    double max_torque_offset = 1000.0;          // per mille of rated torque
+    double ff_ramp_time = 0.5;                  // [s] gain 0 -> 1
+    double ff_vel_time_constant = 0.06;         // [s] commanded velocity low-pass
+    double friction_vel_eps = 0.01;             // [rad/s] Coulomb friction smoothing
+    double friction_coulomb[NUM_JOINTS] = {};   // Nm
+    double friction_viscous[NUM_JOINTS] = {};   // Nm/(rad/s)
+
+    //* Deadbands [counts]
+    int32_t onset_threshold = 30;               // encoder deviation from rest taken as motion
+    int32_t pp_target_tolerance = 50;           // profile move final position
+
+    //* Joint command envelope and reactions [counts, cycles]
+    JointEnvelope::Limits envelope;
+};
+
+
+/**
+ * @brief Versioned configuration shared between non-RT writers and one RT reader, without
+ * locks on the reader side (read-copy-update).
+ *
+ * A writer copies the current version, modifies the copy and publishes it with a single
+ * pointer store. The reader takes the current version with acquire() once per cycle and
+ * uses it until its next acquire(), so it always sees one consistent version, never a mix
+ * of old and new fields. acquire() also records the version taken; any older version can
+ * no longer be in use by the reader and is freed by the writer side (update(), reclaim()).
+ * In steady state there are two versions, the current one and the one the reader may still
+ * hold.
+ *
+ * @note acquire() is wait-free and allocation-free. update(), snapshot() and reclaim() lock,
+ * allocate and free, they must not be called from the RT thread.
+ *
+ */
+template <typename T>
+class RtConfigBox
+{
+    public:
+        explicit RtConfigBox(const T &initial = T())
+        {
+            current_.store(new Version{ initial, 1 }, std::memory_order_release);
+        }
+
+        ~RtConfigBox()
+        {
+            delete current_.load(std::memory_order_relaxed);
+            for (Version *v : retired_)
+                delete v;
+        }
+
+        RtConfigBox(const RtConfigBox &) = delete;
+        RtConfigBox &operator=(const RtConfigBox &) = delete;
+
+        //* RT reader, once per cycle. The pointer stays valid until the next acquire()
+        const T *acquire()
+        {
+            Version *v = current_.load(std::memory_order_acquire);
+            reader_version_.store(v->version, std::memory_order_release);
+            return &v->value;
+        }
+
+        /**
+         * @brief Publishes a modified copy of the current version.
+         *
+         * @param modify Called with the copy, return false to discard it
+         * @return Version now current
+         */
+        template <typename F>
+        uint64_t update(F &&modify)
+        {
+            std::lock_guard<std::mutex> lock(writer_mutex_);
+
+            Version *old = current_.load(std::memory_order_relaxed);
+            Version *next = new Version{ old->value, old->version + 1 };
+            if (!modify(next->value))
+            {
+                delete next;
+                return old->version;
+            }
+
+            current_.store(next, std::memory_order_release);
+            retired_.push_back(old);
+            reclaim_locked_();
+            return next->version;
+        }
+
+        //* Copy of the current version, for non-RT readers
+        T snapshot() const
+        {
+            std::lock_guard<std::mutex> lock(writer_mutex_);
+            return current_.load(std::memory_order_relaxed)->value;
+        }
+
+        uint64_t version() const { return current_.load(std::memory_order_acquire)->version; }
+
+        //* Frees the versions the reader has moved past, call periodically off the RT thread
+        void reclaim()
+        {
+            std::lock_guard<std::mutex> lock(writer_mutex_);
+            reclaim_locked_();
+        }
+
+        size_t retired() const
+        {
+            std::lock_guard<std::mutex> lock(writer_mutex_);
+            return retired_.size();
+        }
+
+
+    private:
+        struct Version
+        {
+            T value;
+            uint64_t version;
+        };
+
+        std::atomic<Version *> current_{nullptr};
+        // Last version taken by the reader. It is stored after the pointer was loaded, so the
+        // reader holds this version or a newer one and everything older is unused
+        std::atomic<uint64_t> reader_version_{0};
+
+        mutable std::mutex writer_mutex_;
+        std::vector<Version *> retired_;
+
+        void reclaim_locked_()
+        {
+            const uint64_t in_use = reader_version_.load(std::memory_order_acquire);
+
+            size_t kept = 0;
+            for (Version *v : retired_)
+            {
+                if (v->version < in_use)
+                    delete v;
+                else
+                    retired_[kept++] = v;
+            }
+            retired_.resize(kept);
+        }
+};
+
+#endif
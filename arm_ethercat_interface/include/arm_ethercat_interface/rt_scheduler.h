@@ -0,0 +1,129 @@
+#ifndef __RT_SCHEDULER_H__
+#define __RT_SCHEDULER_H__
+
+#include <atomic>
+#include <cstdint>
+#include <numeric>
+#include <time.h>
+
+
+/**
+ * @brief Deterministic cycle-slot scheduler for the work done inside the RT cycle.
+ *
+ * A task runs every `period` cycles, in the cycles where cycle % period == phase, tasks due
+ * in the same cycle in the order they were added. Without an explicit phase, a task gets the
+ * phase that makes it coincide with the fewest slow tasks already added (two tasks with
+ * periods a, b meet iff their phases agree modulo gcd(a, b)), so occasional work is spread
+ * over the cycles instead of piling onto one.
+ *
+ * The execution time of every task is tracked (max since the last take_max_ns()) to
+ * attribute the cycle's worst case.
+ *
+ * @note add() at initialization only; run() is allocation-free and non-blocking.
+ *
+ */
+template <typename Owner, size_t MAX_TASKS = 16>
+class RtScheduler
+{
+    public:
+        using Fn = void (Owner::*)();
+
+        static constexpr int32_t AUTO_PHASE = -1;
+
+        /**
+         * @brief Adds a task.
+         *
+         * @param name Static name for reports
+         * @param fn Member function of the owner
+         * @param period Cycles between runs, >= 1
+         * @param phase Cycle within the period, AUTO_PHASE to spread
+         * @return false if the table is full
+         */
+        bool add(const char *name, Fn fn, uint32_t period, int32_t phase = AUTO_PHASE)
+        {
+            if (size_ >= MAX_TASKS || period == 0)
+                return false;
+
+            if (phase < 0)
+                phase = least_loaded_phase_(period);
+
+            Task &t = tasks_[size_++];
+            t.name = name;
+            t.fn = fn;
+            t.period = period;
+            t.phase = (uint32_t) phase % period;
+            return true;
+        }
+
+        //* Runs the tasks due this cycle, call once per cycle
+        void run(Owner &owner)
+        {
+            for (size_t k = 0; k < size_; k++)
+            {
+                Task &t = tasks_[k];
+                if (cycle_ % t.period != t.phase)
+                    continue;
+
+                struct timespec start, end;
+                clock_gettime(CLOCK_MONOTONIC, &start);
+                (owner.*(t.fn))();
+                clock_gettime(CLOCK_MONOTONIC, &end);
+
+                uint64_t ns = (uint64_t) ((end.tv_sec - start.tv_sec) * 1000000000L + (end.tv_nsec - start.tv_nsec));
+                if (ns > t.max_ns.load(std::memory_order_relaxed))
+                    t.max_ns.store(ns, std::memory_order_relaxed);
+            }
+            cycle_++;
+        }
+
+        size_t size() const { return size_; }
+        const char *name(size_t k) const { return tasks_[k].name; }
+        uint32_t period(size_t k) const { return tasks_[k].period; }
+        uint32_t phase(size_t k) const { return tasks_[k].phase; }
+
+        //* Longest run of task k since the last call [ns], any thread
+        uint64_t take_max_ns(size_t k) { return tasks_[k].max_ns.exchange(0, std::memory_order_relaxed); }
+
+
+    private:
+        struct Task
+        {
+            const char *name = "";
+            Fn fn = nullptr;
+            uint32_t period = 1;
+            uint32_t phase = 0;
+            std::atomic<uint64_t> max_ns{0};
+        };
+
+        Task tasks_[MAX_TASKS];
+        size_t size_ = 0;
+        uint64_t cycle_ = 0;
+
+        uint32_t least_loaded_phase_(uint32_t period) const
+        {
+            uint32_t best_phase = 0;
+            size_t best = SIZE_MAX;
+
+            for (uint32_t p = 0; p < period; p++)
+            {
+                // Every-cycle tasks meet every phase, only slow tasks count
+                size_t meets = 0;
+                for (size_t k = 0; k < size_; k++)
+                {
+                    const Task &t = tasks_[k];
+                    const uint32_t g = std::gcd(t.period, period);
+                    if (t.period > 1 && (t.phase % g) == (p % g))
+                        meets++;
+                }
+
+                if (meets < best)
+                {
+                    best = meets;
+                    best_phase = p;
+                }
+            }
+            return best_phase;
+        }
+};
+
+#endif
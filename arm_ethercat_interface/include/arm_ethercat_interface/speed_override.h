@@ -0,0 +1,331 @@
+#ifndef __SPEED_OVERRIDE_H__
+#define __SPEED_OVERRIDE_H__
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+
+#ifndef NUM_JOINTS
+#define NUM_JOINTS 6
+#endif
+
+
+/**
+ * @brief Single producer single consumer ring of timestamped joint commands.
+ *
+ * Fixed size, lock and allocation-free. When full, push() rejects the sample: the queued
+ * samples are a path, dropping or replacing any of them would cut a corner through it.
+ *
+ */
+template <size_t N>
+class CommandRing
+{
+    static_assert((N & (N - 1)) == 0 && N >= 4, "CommandRing size must be a power of two >= 4");
+
+    public:
+        struct Sample
+        {
+            int64_t t_ns;
+            uint32_t generation;
+            int32_t counts[NUM_JOINTS];
+        };
+
+        //* Producer, false if the ring is full
+        bool push(int64_t t_ns, uint32_t generation, const int32_t counts[NUM_JOINTS])
+        {
+            size_t tail = tail_.load(std::memory_order_relaxed);
+            if (tail - head_.load(std::memory_order_acquire) >= N)
+                return false;
+
+            Sample &s = buffer_[tail & (N - 1)];
+            s.t_ns = t_ns;
+            s.generation = generation;
+            std::copy(counts, counts + NUM_JOINTS, s.counts);
+
+            tail_.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        //* Consumer
+        size_t size() const { return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_relaxed); }
+        const Sample &at(size_t i) const { return buffer_[(head_.load(std::memory_order_relaxed) + i) & (N - 1)]; }
+        void pop() { head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+        void clear() { head_.store(tail_.load(std::memory_order_acquire), std::memory_order_release); }
+
+
+    private:
+        Sample buffer_[N];
+        std::atomic<size_t> head_{0};
+        std::atomic<size_t> tail_{0};
+};
+
+
+/**
+ * @brief Execution-level speed override of the arm/command stream.
+ *
+ * Commands are replayed on a playback clock tau that advances by s * dt per cycle, where
+ * s is the override [0, 1]: the arm follows q(tau), the commanded motion re-timed on the
+ * fly. At 100% and no backlog tau sits on the newest command, i.e. plain pass-through with
+ * no added delay. Below 100% a backlog builds up; 0% is a feed hold. Back at 100% the clock
+ * runs faster, up to max_catchup and in proportion to the lag, until the backlog is
+ * replayed, so the delay of a slow phase does not stay for the rest of the stream.
+ *
+ * The scale moves towards its target with limited rate and acceleration. Joint velocity is
+ * s * q' and acceleration s^2 * q'' + s' * q', so a continuous s' keeps the joint
+ * accelerations continuous and the override transitions jerk-limited.
+ *
+ * A full backlog faults the stream: commands are rejected until the queued ones have been
+ * replayed, and the arm stops on the last accepted command (last_accepted()) instead of
+ * cutting across the ones that did not fit.
+ *
+ * @note push() is called from the command subscription, update() and reset() from the
+ * cyclic PDO loop.
+ *
+ */
+class SpeedOverride
+{
+    public:
+        //* 2^14 samples, >16s of backlog at the 1kHz cycle (consecutive repeats are not stored)
+        static constexpr size_t RING_SIZE = 1 << 14;
+
+        //* Catch-up speed above 100% per second of lag [1/s]
+        static constexpr double CATCHUP_GAIN = 2.0;
+
+        /**
+         * @brief Queues a command, consecutive identical commands are skipped.
+         *
+         * @return false if the command was rejected, the backlog is full or still being
+         * replayed after it was
+         */
+        bool push(int64_t t_ns, const int32_t counts[NUM_JOINTS])
+        {
+            // Reset since the last command, the commands before it are gone
+            const uint32_t generation = generation_.load(std::memory_order_acquire);
+            if (generation != producer_generation_)
+            {
+                producer_generation_ = generation;
+                has_pushed_ = false;
+                faulted_.store(false, std::memory_order_relaxed);
+            }
+
+            // The stream time runs on while faulted, the consumer's lag stays meaningful
+            if (faulted_.load(std::memory_order_relaxed))
+            {
+                latest_t_ns_.store(std::max(t_ns, last_pushed_t_ns_), std::memory_order_release);
+                if (ring_.size() > 1)
+                    return false;
+
+                // Replayed up to the last accepted command, which the consumer still holds
+                faulted_.store(false, std::memory_order_relaxed);
+                held_t_ns_ = last_pushed_t_ns_;
+            }
+
+            if (has_pushed_ && std::equal(counts, counts + NUM_JOINTS, last_pushed_))
+            {
+                held_t_ns_ = std::max(t_ns, last_pushed_t_ns_);
+                latest_t_ns_.store(held_t_ns_, std::memory_order_release);
+                return true;
+            }
+
+            // Close a skipped hold, so it is replayed as a hold and not as a slow ramp
+            if (has_pushed_ && held_t_ns_ > last_pushed_t_ns_)
+            {
+                if (!push_(held_t_ns_, last_pushed_))
+                    return false;
+            }
+
+            // Stamps must increase, a restarted publisher may start slightly in the past
+            if (has_pushed_ && t_ns <= last_pushed_t_ns_)
+                t_ns = last_pushed_t_ns_ + 1;
+
+            if (!push_(t_ns, counts))
+                return false;
+
+            held_t_ns_ = t_ns;
+            has_pushed_ = true;
+            latest_t_ns_.store(t_ns, std::memory_order_release);
+            return true;
+        }
+
+        //* Last command queued, where the arm stops after a rejected push() (producer only)
+        const int32_t *last_accepted() const { return last_pushed_; }
+
+        /**
+         * @brief Target override [0, 1], reached with the rate/acceleration limits.
+         *
+         */
+        void set_target(double target) { target_.store(std::clamp(target, 0.0, 1.0), std::memory_order_relaxed); }
+        double target() const { return target_.load(std::memory_order_relaxed); }
+
+        /**
+         * @brief Rate [1/s] and acceleration [1/s^2] limits of the override.
+         *
+         */
+        void set_limits(double max_rate, double max_accel)
+        {
+            max_rate_.store(std::max(max_rate, 1e-3), std::memory_order_relaxed);
+            max_accel_.store(std::max(max_accel, 1e-3), std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Fastest replay of a backlog at 100% [1, 2], 1 keeps the lag.
+         *
+         */
+        void set_max_catchup(double max_catchup) { max_catchup_.store(std::clamp(max_catchup, 1.0, 2.0), std::memory_order_relaxed); }
+
+        /**
+         * @brief Drops the backlog and holds the given position (drive enable, resync).
+         *
+         * Commands queued before the reset are dropped even if they arrive during it, the
+         * producer starts a new stream with its next push().
+         *
+         */
+        void reset(const int32_t counts[NUM_JOINTS])
+        {
+            generation_.store(generation_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+            ring_.clear();
+            std::copy(counts, counts + NUM_JOINTS, hold_);
+            tau_valid_ = false;
+            lag_ns_.store(0, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Advances the playback clock by one cycle and interpolates the command.
+         *
+         * @param dt Cycle time [s]
+         * @param out Output joint commands [counts], unchanged while nothing was commanded
+         */
+        void update(double dt, int32_t out[NUM_JOINTS])
+        {
+            // Pushed before the last reset
+            const uint32_t generation = generation_.load(std::memory_order_relaxed);
+            while (ring_.size() > 0 && ring_.at(0).generation != generation)
+                ring_.pop();
+
+            int64_t latest = latest_t_ns_.load(std::memory_order_acquire);
+
+            // At 100%, catch up on the lag. Not while faulted, the arm stops on the queued commands
+            double target = target_.load(std::memory_order_relaxed);
+            if (target >= 1.0 && tau_valid_ && latest > tau_ns_ && !faulted_.load(std::memory_order_relaxed))
+                target += std::min(max_catchup_.load(std::memory_order_relaxed) - 1.0, CATCHUP_GAIN * 1e-9 * (latest - tau_ns_));
+
+            ramp_(dt, target);
+
+            if (ring_.size() == 0)
+            {
+                std::copy(hold_, hold_ + NUM_JOINTS, out);
+                return;
+            }
+
+            // Follow the stream from its first sample
+            if (!tau_valid_)
+            {
+                tau_ns_ = ring_.at(0).t_ns;
+                tau_valid_ = true;
+            }
+
+            tau_ns_ = std::min(tau_ns_ + (int64_t) (scale_ * dt * 1e9), latest);
+
+            // Drop samples the playback clock has passed, keep the one before tau
+            while (ring_.size() >= 2 && ring_.at(1).t_ns <= tau_ns_)
+                ring_.pop();
+
+            // Everything replayed, the rest of the stream is holding still: drop the backlog
+            // so the next motion starts without delay
+            if (ring_.size() == 1)
+                tau_ns_ = latest;
+
+            const auto &a = ring_.at(0);
+            if (ring_.size() == 1 || tau_ns_ <= a.t_ns)
+            {
+                std::copy(a.counts, a.counts + NUM_JOINTS, out);
+            }
+            else
+            {
+                const auto &b = ring_.at(1);
+                double w = (double) (tau_ns_ - a.t_ns) / (double) (b.t_ns - a.t_ns);
+                for (int i = 0; i < NUM_JOINTS; i++)
+                    out[i] = a.counts[i] + (int32_t) std::lround(w * (b.counts[i] - a.counts[i]));
+            }
+
+            std::copy(out, out + NUM_JOINTS, hold_);
+            lag_ns_.store(std::max<int64_t>(latest - tau_ns_, 0), std::memory_order_relaxed);
+        }
+
+        //* Status, readable from any thread
+        double scale() const { return scale_out_.load(std::memory_order_relaxed); }
+        int64_t lag_ns() const { return lag_ns_.load(std::memory_order_relaxed); }
+        uint64_t overflows() const { return overflows_.load(std::memory_order_relaxed); }
+
+
+    private:
+        CommandRing<RING_SIZE> ring_;
+
+        std::atomic<double> target_{1.0};
+        std::atomic<double> max_rate_{4.0};
+        std::atomic<double> max_accel_{40.0};
+        std::atomic<double> max_catchup_{1.2};
+        std::atomic<double> scale_out_{1.0};
+        std::atomic<int64_t> latest_t_ns_{0};
+        std::atomic<int64_t> lag_ns_{0};
+        std::atomic<uint64_t> overflows_{0};
+        // Incremented by reset(), samples and producer state of older generations are stale
+        std::atomic<uint32_t> generation_{0};
+        // Set by the producer on a full ring, until the backlog is replayed
+        std::atomic<bool> faulted_{false};
+
+        // Producer only
+        int32_t last_pushed_[NUM_JOINTS] = {};
+        int64_t last_pushed_t_ns_ = 0;
+        int64_t held_t_ns_ = 0;
+        bool has_pushed_ = false;
+        uint32_t producer_generation_ = 0;
+
+        // Consumer only
+        double scale_ = 1.0;
+        double scale_rate_ = 0.0;
+        int64_t tau_ns_ = 0;
+        bool tau_valid_ = false;
+        int32_t hold_[NUM_JOINTS] = {};
+
+
+        //* Queues one sample, faults the stream if the ring is full
+        bool push_(int64_t t_ns, const int32_t counts[NUM_JOINTS])
+        {
+            if (!ring_.push(t_ns, producer_generation_, counts))
+            {
+                faulted_.store(true, std::memory_order_relaxed);
+                overflows_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+
+            std::copy(counts, counts + NUM_JOINTS, last_pushed_);
+            last_pushed_t_ns_ = t_ns;
+            return true;
+        }
+
+        void ramp_(double dt, double target)
+        {
+            const double max_rate = max_rate_.load(std::memory_order_relaxed);
+            const double max_accel = max_accel_.load(std::memory_order_relaxed);
+
+            // Fastest rate that can still stop on the target, then acceleration limited
+            double err = target - scale_;
+            double rate = std::copysign(std::min(max_rate, std::sqrt(2.0 * max_accel * std::abs(err))), err);
+            scale_rate_ += std::clamp(rate - scale_rate_, -max_accel * dt, max_accel * dt);
+
+            scale_ += scale_rate_ * dt;
+
+            // Arrived, the stopping profile makes the last rate step at most max_accel * dt
+            if ((err >= 0.0 && scale_ >= target) || (err <= 0.0 && scale_ <= target))
+            {
+                scale_ = target;
+                scale_rate_ = 0.0;
+            }
+
+            scale_out_.store(scale_, std::memory_order_relaxed);
+        }
+};
+
+#endif
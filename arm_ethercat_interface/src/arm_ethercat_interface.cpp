@@ -1,9 +1,20 @@
 #include "arm_ethercat_interface/arm_ethercat_interface.h"
 #include "realtime_tools/thread_priority.hpp"
+#include "rclcpp_components/register_node_macro.hpp"
 
+// limits.reaction.* values, indexed by EnvelopeReaction, and names of the envelope's
+// checks, indexed by JointEnvelope::Kind
+static const char *REACTION_NAMES[] = { "warn", "clamp", "stop" };
+static const char *ENVELOPE_KINDS[] = { "position", "velocity", "acceleration" };
 
-ZeroErrInterface::ZeroErrInterface() : Node("arm_ethercat_interface")
+
+ZeroErrInterface::ZeroErrInterface(const rclcpp::NodeOptions &options) : Node("arm_ethercat_interface", options)
 {
+    // Not added to the node's executor, spun by rt_thread_ (see start_rt_thread_)
+    high_prio_cbg_ = this->create_callback_group(
+        rclcpp::CallbackGroupType::MutuallyExclusive,
+        false
+    );
 
     normal_prio_cbg_ = this->create_callback_group(
         rclcpp::CallbackGroupType::MutuallyExclusive
@@ -20,25 +31,67 @@ ZeroErrInterface::ZeroErrInterface() : Node("arm_ethercat_interface")
         joint_states_.name[i] = joint_name;
     }
     joint_states_.position.assign(NUM_JOINTS, 0.0);
-    joint_states_enc_counts_.assign(NUM_JOINTS, 0.0);
     joint_commands_.assign(NUM_JOINTS, 0.0);
 
     arm_state_pub_ = this->create_publisher<sensor_msgs::msg::JointState>("arm/state", 10);
 
-    rclcpp::SubscriptionOptionsWithAllocator<std::allocator<void>> options;
-    options.callback_group = normal_prio_cbg_;
+    // Motion onset events for end-to-end teleop latency measurement (see arm_servo teleop_latency)
+    latency_probe_ = this->declare_parameter("latency_probe", false);
+    onset_rest_counts_.assign(NUM_JOINTS, 0);
+    onset_last_cmd_.assign(NUM_JOINTS, 0);
+    motion_onset_pub_ = this->create_publisher<sensor_msgs::msg::TimeReference>("arm/motion_onset", 10);
+
+    // Execution-level speed override [0-100%]
+    declare_speed_override_params_();
+
+    // Feed-forward gains, filters and deadbands of the RT loop, tunable at runtime
+    // (registers the parameter callback, declare other parameters before)
+    declare_rt_config_params_();
+    following_error_pub_ = this->create_publisher<diagnostic_msgs::msg::DiagnosticArray>("arm/following_error", 10);
+
+    rclcpp::SubscriptionOptionsWithAllocator<std::allocator<void>> sub_options;
+    sub_options.callback_group = normal_prio_cbg_;
 
     arm_cmd_sub_ = this->create_subscription<sensor_msgs::msg::JointState>(
         "arm/command",
         10,
         std::bind(&ZeroErrInterface::arm_cmd_cb_, this, std::placeholders::_1),
-        options);
+        sub_options);
+
+    speed_override_sub_ = this->create_subscription<std_msgs::msg::Float64>(
+        "arm/speed_override",
+        rclcpp::QoS(1).reliable(),
+        std::bind(&ZeroErrInterface::speed_override_cb_, this, std::placeholders::_1),
+        sub_options);
+
+    // Override in effect [%] on every change, latched (e.g. arm_move_group tracking analysis)
+    speed_override_scale_pub_ = this->create_publisher<std_msgs::msg::Float64>(
+        "arm/speed_override/scale", rclcpp::QoS(1).reliable().transient_local());
+
+    // Point-to-point moves profiled by the drives (Profile Position mode), the response is
+    // deferred until the move finished. Afterwards the trajectory controller is sent a
+    // trajectory holding the reached position, so its commands agree with the arm again
+    profile_move_srv_ = this->create_service<arm_msgs::srv::ProfileMove>(
+        "arm/ProfileMove",
+        std::bind(&ZeroErrInterface::profile_move_cb_, this, std::placeholders::_1, std::placeholders::_2),
+        rclcpp::ServicesQoS(),
+        normal_prio_cbg_);
 
+    std::string resync_topic = this->declare_parameter("profile_move.resync_topic", std::string("/arm_group_controller/joint_trajectory"));
+    if (!resync_topic.empty())
+        pp_resync_pub_ = this->create_publisher<trajectory_msgs::msg::JointTrajectory>(resync_topic, 10);
 
+
+    // A half constructed node would load into a container without a cyclic loop, fail the load
+    // instead. The destructor does not run for a throwing constructor, release the master here.
     if (!init_())
     {
-        RCLCPP_ERROR(this->get_logger(), "Exiting");
-        return;
+        if (master)
+        {
+            ecrt_release_master(master);
+            master = NULL;
+        }
+        throw std::runtime_error("EtherCAT initialization failed");
     }
     RCLCPP_INFO(this->get_logger(), "Initialization successful!\n");
 
@@ -61,18 +114,83 @@ ZeroErrInterface::ZeroErrInterface() : Node("arm_ethercat_interface")
         JOINT_STATE_PERIOD,
         std::bind(&ZeroErrInterface::joint_state_pub_, this),
         normal_prio_cbg_);
+
+    // Create following error report timer
+    following_error_timer_ = this->create_wall_timer(
+        FOLLOWING_ERROR_PERIOD,
+        std::bind(&ZeroErrInterface::following_error_report_, this),
+        normal_prio_cbg_);
+
+    // Create profile move completion timer
+    profile_move_timer_ = this->create_wall_timer(
+        PROFILE_MOVE_POLL_PERIOD,
+        std::bind(&ZeroErrInterface::profile_move_poll_, this),
+        normal_prio_cbg_);
+
+    // Create joint envelope stop/resume timer
+    envelope_timer_ = this->create_wall_timer(
+        ENVELOPE_POLL_PERIOD,
+        std::bind(&ZeroErrInterface::envelope_poll_, this),
+        normal_prio_cbg_);
+
+    // Create arm/command latency report timer
+    latency_report_timer_ = this->create_wall_timer(
+        LATENCY_REPORT_PERIOD,
+        std::bind(&ZeroErrInterface::latency_report_, this),
+        normal_prio_cbg_);
     
     clock_gettime(CLOCK_TO_USE, &wakeupTime);
+
+    init_scheduler_();
+    start_rt_thread_();
 }
 
 
 ZeroErrInterface::~ZeroErrInterface()
 {
+    if (rt_executor_)
+    {
+        rt_executor_->cancel();
+        rt_thread_.join();
+    }
+
     RCLCPP_INFO(this->get_logger(), "Releasing master...\n");
     ecrt_release_master(master);
 }
 
 
+/**
+ * @brief Spins the high priority callback group (cyclic PDO exchange) in its own
+ * SCHED_FIFO thread pinned to core 0.
+ * 
+ * @note Owned by the node so the RT loop keeps its priority whether the node runs
+ * standalone or inside a component container.
+ * 
+ */
+void ZeroErrInterface::start_rt_thread_()
+{
+    rt_executor_ = std::make_shared<rclcpp::executors::SingleThreadedExecutor>();
+    rt_executor_->add_callback_group(high_prio_cbg_, this->get_node_base_interface());
+
+    rt_thread_ = std::thread(
+        [this]() {
+
+            //* Set thread priority
+            if (!realtime_tools::configure_sched_fifo(sched_get_priority_max(SCHED_FIFO) - 19))
+                RCLCPP_WARN(this->get_logger(), "Couldnt enable FIFO RT Scheduling!");
+            
+            cpu_set_t mask;
+            CPU_ZERO(&mask);
+            CPU_SET(0, &mask);
+
+            if (sched_setaffinity(0, sizeof(mask), &mask) != 0)
+                RCLCPP_WARN(this->get_logger(), "Couldn't assign to core 0");
+            
+            rt_executor_->spin();
+        });
+}
+
+
 /**
  * @brief Configures PDOs and joint parameters, activates EtherCAT master and 
  * allocates process data domain memory.
@@ -96,15 +214,17 @@ bool ZeroErrInterface::init_()
     if (!configure_pdos_()) return false;
 
 
-    // RCLCPP_INFO(this->get_logger(), "Creating SDO requests...\n");
-    // for (uint i = 0; i < NUM_JOINTS; i++)
-    // {
-    //     if (!(sdo[i] = ecrt_slave_config_create_sdo_request(joint_slave_configs[i], 0x603F, 0, sizeof(uint16_t)))) {
-    //         RCLCPP_ERROR(this->get_logger(), "Failed to create SDO request.\n");
-    //         return false;
-    //     }
-    //     ecrt_sdo_request_timeout(sdo[i], 500); // ms
-    // }
+    // Error code (0x603F) requests, serviced by the RT thread (sdo_task_)
+    RCLCPP_INFO(this->get_logger(), "Creating SDO requests...\n");
+    for (uint i = 0; i < NUM_JOINTS; i++)
+    {
+        if (!(sdo[i] = ecrt_slave_config_create_sdo_request(joint_slave_configs[i], ERROR_CODE, sizeof(uint16_t))))
+        {
+            RCLCPP_WARN(this->get_logger(), "Failed to create SDO request for j%d, error code not monitored", i);
+            continue;
+        }
+        ecrt_sdo_request_timeout(sdo[i], 500); // ms
+    }
 
 
     if (!set_drive_parameters_()) return false;
@@ -124,11 +244,96 @@ bool ZeroErrInterface::init_()
         return false;
     }
 
+    // Domain layout, resolved once for the cyclic loop
+    JointPdoOffsets offsets[NUM_JOINTS];
+    for (uint i = 0; i < NUM_JOINTS; i++)
+    {
+        offsets[i] = {
+            target_pos_offset[i], ctrl_word_offset[i], torque_offset_offset[i], op_mode_offset[i],
+            profile_vel_offset[i], profile_acc_offset[i], profile_dec_offset[i],
+            actual_pos_offset[i], status_word_offset[i], op_mode_disp_offset[i]
+        };
+    }
+
+    if (pdo_.map(domain_pd, offsets))
+        RCLCPP_INFO(this->get_logger(), "Process data accessed through packed per-joint PDO structs");
+    else
+        RCLCPP_WARN(this->get_logger(), "Domain layout does not match the PDO mapping, process data accessed through a copy plan");
+
+    pdo_.read_outputs(pdo_out_);
+
+    // Mode of operation and motion profile are mapped to the RxPDOs, start with the values
+    // set_drive_parameters_() wrote instead of zeros
+    for (uint i = 0; i < NUM_JOINTS; i++)
+    {
+        uint32_t profile_velocity = (i < 3) ? EROB_110H120_MAX_SPEED : EROB_70H100_MAX_SPEED;
+        uint32_t profile_adcel = (i < 3) ? EROB_110H120_MAX_ADCEL : EROB_70H100_MAX_ADCEL;
+
+        pdo_out_[i].op_mode = MODE_CSP;
+        pdo_out_[i].profile_vel = profile_velocity;
+        pdo_out_[i].profile_acc = profile_adcel;
+        pdo_out_[i].profile_dec = profile_adcel;
+    }
+    pdo_.write(pdo_out_);
+
+    benchmark_pdo_access_();
+
 
     return true;
 }
 
 
+/**
+ * @brief Times one cycle's process data access, per-field EC_READ/EC_WRITE through the
+ * offset arrays against PdoOverlay, on the activated domain and logs both.
+ * 
+ * @note Runs before the RT thread starts, writes back the values already in the image.
+ * 
+ */
+void ZeroErrInterface::benchmark_pdo_access_()
+{
+    const int ITERATIONS = 100000;
+    volatile int32_t sink = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int n = 0; n < ITERATIONS; n++)
+    {
+        for (uint i = 0; i < NUM_JOINTS; i++)
+        {
+            sink = sink + EC_READ_S32(domain_pd + actual_pos_offset[i])
+                + EC_READ_U16(domain_pd + status_word_offset[i])
+                + EC_READ_S8(domain_pd + op_mode_disp_offset[i]);
+        }
+        for (uint i = 0; i < NUM_JOINTS; i++)
+        {
+            EC_WRITE_S32(domain_pd + target_pos_offset[i], pdo_out_[i].target_pos);
+            EC_WRITE_U16(domain_pd + ctrl_word_offset[i], pdo_out_[i].ctrl_word);
+            EC_WRITE_S16(domain_pd + torque_offset_offset[i], pdo_out_[i].torque_offset);
+            EC_WRITE_S8(domain_pd + op_mode_offset[i], pdo_out_[i].op_mode);
+            EC_WRITE_U32(domain_pd + profile_vel_offset[i], pdo_out_[i].profile_vel);
+            EC_WRITE_U32(domain_pd + profile_acc_offset[i], pdo_out_[i].profile_acc);
+            EC_WRITE_U32(domain_pd + profile_dec_offset[i], pdo_out_[i].profile_dec);
+        }
+    }
+    auto macros = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    for (int n = 0; n < ITERATIONS; n++)
+    {
+        pdo_.read(pdo_in_);
+        for (uint i = 0; i < NUM_JOINTS; i++)
+            sink = sink + pdo_in_[i].actual_pos + pdo_in_[i].status_word + pdo_in_[i].op_mode_disp;
+        pdo_.write(pdo_out_);
+    }
+    auto overlay = std::chrono::steady_clock::now() - start;
+
+    const double macros_ns = std::chrono::duration<double, std::nano>(macros).count() / ITERATIONS;
+    const double overlay_ns = std::chrono::duration<double, std::nano>(overlay).count() / ITERATIONS;
+    RCLCPP_INFO(this->get_logger(), "PDO access per cycle: offset macros %.1f ns, overlay %.1f ns (%s, %.0f%% less)",
+        macros_ns, overlay_ns, pdo_.direct() ? "packed structs" : "copy plan", 100.0 * (macros_ns - overlay_ns) / macros_ns);
+}
+
+
 /**
  * @brief Configures joints' process data objects (PDOs) and creates 
  * process data domain (see ec_defines.h for domain layout)
@@ -459,7 +664,7 @@ bool ZeroErrInterface::set_drive_parameters_()
 
         //* Set parameters for CSP mode
         // Set mode to CSP (0x8) mode
-        uint8_t mode = 0x08;
+        uint8_t mode = MODE_CSP;
         if (ecrt_master_sdo_download(
                 master,
                 i,
@@ -508,6 +713,27 @@ bool ZeroErrInterface::set_drive_parameters_()
         joint_commands_[i] = current_pos;
 
 
+        // Rated torque, unit of the torque offset (per mille)
+        uint32_t rated_torque = 0;
+        if (ecrt_master_sdo_upload(
+                master,
+                i,
+                RATED_TORQUE,
+                (uint8_t *)&rated_torque,
+                sizeof(rated_torque),
+                &result_size,
+                &abort_code))
+        {
+            RCLCPP_WARN(this->get_logger(), "Failed to read rated torque (0x6076) for j%d, no feed-forward on this joint", i);
+            rated_torque = 0;
+        }
+        else
+        {
+            RCLCPP_INFO(this->get_logger(), "Rated torque: %umNm for j%d", rated_torque, i);
+        }
+        rated_torque_[i] = rated_torque;
+
+
         // Velocity following error window
         uint32_t vel_follow_err_window = 150000;
         if (ecrt_master_sdo_download(
@@ -564,13 +790,13 @@ bool ZeroErrInterface::state_transition_()
 {
     uint16_t status_word;
     uint16_t control_word;
-    int32_t current_pos = EC_READ_S32(domain_pd + actual_pos_offset[joint_no_]);
-    int32_t target_pos = EC_READ_S32(domain_pd + target_pos_offset[joint_no_]);
+    int32_t current_pos = pdo_in_[joint_no_].actual_pos;
+    int32_t target_pos = pdo_out_[joint_no_].target_pos;
     
 
     // Read status + control words
-    status_word = EC_READ_U16(domain_pd + status_word_offset[joint_no_]);
-    control_word = EC_READ_U16(domain_pd + ctrl_word_offset[joint_no_]);
+    status_word = pdo_in_[joint_no_].status_word;
+    control_word = pdo_out_[joint_no_].ctrl_word;
 
 
     //* CiA 402 PDS FSA commissioning
@@ -584,7 +810,7 @@ bool ZeroErrInterface::state_transition_()
     }
     else if ((status_word & 0b01001111) == 0b01000000)
     {
-        EC_WRITE_U16(domain_pd + ctrl_word_offset[joint_no_], (control_word & 0b01111110) | 0b00000110);
+        pdo_out_[joint_no_].ctrl_word = (control_word & 0b01111110) | 0b00000110;
         
         if (driveState[joint_no_] != SWITCH_ON_DISABLED)
         {
@@ -594,7 +820,7 @@ bool ZeroErrInterface::state_transition_()
     }
     else if ((status_word & 0b01101111) == 0b00100001)
     {
-        EC_WRITE_U16(domain_pd + ctrl_word_offset[joint_no_], (control_word & 0b01110111) | 0b00000111);
+        pdo_out_[joint_no_].ctrl_word = (control_word & 0b01110111) | 0b00000111;
         
         if (driveState[joint_no_] != READY)
         {
@@ -604,7 +830,7 @@ bool ZeroErrInterface::state_transition_()
     }
     else if ((status_word & 0b01101111) == 0b00100011)
     {
-        EC_WRITE_U16(domain_pd + ctrl_word_offset[joint_no_], (control_word & 0b01111111) | 0b00001111);
+        pdo_out_[joint_no_].ctrl_word = (control_word & 0b01111111) | 0b00001111;
 
         if (driveState[joint_no_] != SWITCHED_ON)
         {
@@ -614,7 +840,7 @@ bool ZeroErrInterface::state_transition_()
             if (current_pos != target_pos)
             {
                 RCLCPP_ERROR(this->get_logger(), "target pos != current pos, fixing...");
-                EC_WRITE_S32(domain_pd + target_pos_offset[joint_no_], current_pos);
+                pdo_out_[joint_no_].target_pos = current_pos;
                 joint_commands_[joint_no_] = current_pos;
             }
         }
@@ -650,7 +876,7 @@ bool ZeroErrInterface::state_transition_()
             RCLCPP_INFO(this->get_logger(), " J%d State: Fault (0x%x)", joint_no_, status_word);
         }
 
-        EC_WRITE_U16(domain_pd + ctrl_word_offset[joint_no_], (control_word & 0b11111111) | 0b10000000);
+        pdo_out_[joint_no_].ctrl_word = (control_word & 0b11111111) | 0b10000000;
 
         // if (!(joint_no_ == 5 && joints_op_enabled_))
         // {
@@ -688,15 +914,21 @@ void ZeroErrInterface::read_sdos(int joint_no_)
             ecrt_sdo_request_read(sdo[joint_no_]); // trigger first read
             break;
         case EC_REQUEST_BUSY:
-            RCLCPP_INFO(this->get_logger(), "Still busy...\n");
             break;
         case EC_REQUEST_SUCCESS:
-            RCLCPP_INFO(this->get_logger(), "Error (0x603F): 0x%04X\n",
-                    EC_READ_U16(ecrt_sdo_request_data(sdo[joint_no_])));
+        {
+            // Logged on change only, serviced from the RT thread
+            uint16_t error_code = EC_READ_U16(ecrt_sdo_request_data(sdo[joint_no_]));
+            if (error_code != sdo_error_codes_[joint_no_])
+            {
+                RCLCPP_INFO(this->get_logger(), "J%d error code (0x603F): 0x%04X", joint_no_, error_code);
+                sdo_error_codes_[joint_no_] = error_code;
+            }
             ecrt_sdo_request_read(sdo[joint_no_]); // trigger next read
             break;
+        }
         case EC_REQUEST_ERROR:
-            RCLCPP_INFO(this->get_logger(), "Failed to read SDO!\n");
+            RCLCPP_WARN(this->get_logger(), "J%d failed to read SDO!", joint_no_);
             ecrt_sdo_request_read(sdo[joint_no_]); // retry reading
             break;
     }
@@ -765,6 +997,9 @@ void ZeroErrInterface::cyclic_pdo_loop_()
     ecrt_master_receive(master);
     ecrt_domain_process(domain);
 
+    // All joints' inputs in one pass
+    pdo_.read(pdo_in_);
+
 
     // check process data state (optional)
     // check_domain_state_();
@@ -810,16 +1045,66 @@ void ZeroErrInterface::cyclic_pdo_loop_()
     // }
 
 
+    // Tunables for this cycle, one consistent version until the next cycle
+    cfg_ = config_.acquire();
+
+    //* Work between the input and output PDO exchange (see init_scheduler_)
+    scheduler_.run(*this);
+
+    // ecrt_master_sync_reference_clock(master);
+    ecrt_master_sync_slave_clocks(master);
+
+    // All joints' outputs in one pass
+    pdo_.write(pdo_out_);
+
+    // send process data
+    ecrt_domain_queue(domain);
+    ecrt_master_send(master);
+
+    // loop_end_time_ = (unsigned long) this->now().nanoseconds();
+    // wakeup_time_ = loop_end_time_ + PERIOD_NS;
+
+    // clock_gettime(CLOCK_TO_USE, &wakeupTime);
+}
+
+
+/**
+ * @brief Registers the work done inside the RT cycle. Tasks due in the same cycle run in
+ * this order; the slow ones get phases that keep them apart (see RtScheduler).
+ * 
+ */
+void ZeroErrInterface::init_scheduler_()
+{
+    scheduler_.add("drive_state", &ZeroErrInterface::drive_state_task_, 1, 0);
+    scheduler_.add("commands", &ZeroErrInterface::command_task_, 1, 0);
+    scheduler_.add("feed_forward", &ZeroErrInterface::feed_forward_task_, 1, 0);
+    scheduler_.add("dc_sync_reference", &ZeroErrInterface::dc_sync_reference_task_, DC_SYNC_REF_CYCLES);
+    scheduler_.add("domain_state", &ZeroErrInterface::check_domain_state_, DOMAIN_STATE_CYCLES);
+    scheduler_.add("master_state", &ZeroErrInterface::check_master_state_, MASTER_STATE_CYCLES);
+    scheduler_.add("sdo_error_codes", &ZeroErrInterface::sdo_task_, SDO_CYCLES);
+
+    for (size_t k = 0; k < scheduler_.size(); k++)
+        RCLCPP_INFO(this->get_logger(), "RT task %-18s every %4u cycles, phase %u",
+            scheduler_.name(k), scheduler_.period(k), scheduler_.phase(k));
+}
+
+
+/**
+ * @brief Steps the EtherCAT OP check or the CiA402 state machine by one joint, and tracks
+ * whether all drives are Operation Enabled.
+ * 
+ * @note RT task, every cycle.
+ * 
+ */
+void ZeroErrInterface::drive_state_task_()
+{
     // If all joints reached EtherCAT OP state
     if (joints_OP_)
     {
         // Transit joints through CiA402 PDS FSA
         joints_op_enabled_ = state_transition_();
 
-        // for (uint i = 0; i < NUM_JOINTS; i++)
-            // joint_states_enc_counts_[i] = EC_READ_S32(domain_pd + actual_pos_offset[i]);
-        
-        joint_states_enc_counts_[joint_no_] = EC_READ_S32(domain_pd + actual_pos_offset[joint_no_]);
+        joint_states_enc_counts_[joint_no_].store(pdo_in_[joint_no_].actual_pos, std::memory_order_relaxed);
     }        
     else
     {
@@ -836,281 +1121,1596 @@ void ZeroErrInterface::cyclic_pdo_loop_()
             // receive process data
             ecrt_master_receive(master);
             ecrt_domain_process(domain);
+            pdo_.read(pdo_in_);
 
             stamp_ = this->now().seconds();
         }
     }
 
+    // state_transition_() checks one joint per cycle, a pass over all joints completes
+    // every NUM_JOINTS cycles while they stay Operation Enabled
+    enabled_cycles_++;
 
-    // If all joints reached CiA402 Drive State Operation Enabled
     if (joints_op_enabled_)
     {
-        //* Write target positions in TxPDOs from MoveIt joint commands
-        for (uint i = 0; i < NUM_JOINTS; i++)
+        enabled_cycles_ = 0;
+        drives_op_ = true;
+        drives_enabled_.store(true, std::memory_order_relaxed);
+    }
+    else if (drives_op_ && enabled_cycles_ > NUM_JOINTS)
+    {
+        // No completed pass over the joints, a drive left Operation Enabled
+        drives_op_ = false;
+        override_was_enabled_ = false;
+        drives_enabled_.store(false, std::memory_order_relaxed);
+
+        // A running or requested profile move ends right away, disabled drives do not switch
+        // back to CSP. arm/command stays gated until it agrees with the position they stopped at.
+        // A move quick stopped after a failed halt keeps its result.
+        uint32_t request_seq = pp_request_seq_.load(std::memory_order_acquire);
+        if (pp_state_ != ProfileMoveState::IDLE || request_seq != pp_done_seq_.load(std::memory_order_relaxed))
         {
-            EC_WRITE_S32(domain_pd + target_pos_offset[i], joint_commands_[i]);
-        }   
-
+            int32_t actual[NUM_JOINTS];
+            for (uint i = 0; i < NUM_JOINTS; i++)
+                actual[i] = pdo_in_[i].actual_pos;
+            leave_profile_move_(pp_state_ == ProfileMoveState::QUICK_STOP ? PP_HALT_TIMEOUT : PP_DRIVES_DISABLED, actual);
+
+            std::copy(actual, actual + NUM_JOINTS, pp_final_);
+            pp_done_seq_.store(request_seq, std::memory_order_release);
+            pp_state_ = ProfileMoveState::IDLE;
+        }
+    }
+}
 
-        //* Uncomment to zero actuator
-        // uint joint_index = 4; // Change index to choose which joint to zero
-        // int32_t current_pos = EC_READ_S32(domain_pd + actual_pos_offset[joint_index]);
-        // int32_t target_pos = current_pos;
-        // uint32_t delta = 250;
-        // if (abs(current_pos) > delta)
-        // {
-        //     if (current_pos < 0)
-        //         target_pos += delta;
-        //     else if (current_pos > 0)
-        //         target_pos -= delta;
-        //     EC_WRITE_S32(domain_pd + target_pos_offset[joint_index], target_pos);
-        // }
 
+/**
+ * @brief Writes the target positions of all joints while the drives are Operation Enabled:
+ * the running profile move's, or arm/command replayed on the speed override clock.
+ * 
+ * @note RT task, every cycle.
+ * 
+ */
+void ZeroErrInterface::command_task_()
+{
+    if (!drives_op_)
+        return;
 
-        //* Uncomment to jog J6 between [-180, 180]
-        // int32_t current_pos = EC_READ_S32(domain_pd + actual_pos_offset[5]);
-        // int32_t target_pos = current_pos;
-        // if (!toggle)
-        // {
-        //     if (current_pos < 262144)
-        //     {
-        //         target_pos += 8000;
-        //         EC_WRITE_S32(domain_pd + target_pos_offset[5], target_pos);
-        //     }
-        //     else
-        //         toggle = true;
-        // }
-        // else
-        // {
-        //     if (current_pos > -262144)
-        //     {
-        //         target_pos -= 8000;
-        //         EC_WRITE_S32(domain_pd + target_pos_offset[5], target_pos);
-        //     }
-        //     else
-        //         toggle = false;
-        // }
+    // Drop commands queued while the drives were disabled, start from the held position
+    if (!override_was_enabled_)
+    {
+        speed_override_.reset(joint_commands_.data());
+        override_was_enabled_ = true;
+        envelope_reset_ = true;
+    }
 
+    //* Profile moves own the target positions while they run (limited by the drives)
+    if (profile_move_())
+    {
+        envelope_reset_ = true;
     }
+    else
+    {
+        //* Replay arm/command on the speed override clock
+        speed_override_.update(CYCLE_TIME, joint_commands_.data());
 
+        //* Position, velocity and acceleration envelope
+        enforce_envelope_();
 
+        //* Write target positions in TxPDOs from MoveIt joint commands
+        for (uint i = 0; i < NUM_JOINTS; i++)
+            pdo_out_[i].target_pos = joint_commands_[i];
+    }
 
+    // Measure latency of newly latched arm/command
+    int64_t cmd_stamp_ns = cmd_stamp_ns_.load(std::memory_order_acquire);
+    if (cmd_stamp_ns != latched_stamp_ns_)
+    {
+        struct timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+        int64_t now_ns = TIMESPEC2NS(now);
+        int64_t recv_ns = cmd_recv_ns_.load(std::memory_order_relaxed);
 
-    // Sync every cycle
-    // Write application time to master
-    //
-    // It is a good idea to use the target time (not the measured time) as
-    // application time, because it is more stable.
-    //
-    // ecrt_master_application_time(master, TIMESPEC2NS(wakeupTime));
+        if (now_ns > recv_ns) cmd_latch_latency_.add(now_ns - recv_ns);
+        if (now_ns > cmd_stamp_ns) cmd_total_latency_.add(now_ns - cmd_stamp_ns);
 
-    if (sync_ref_counter)
-    {
-        sync_ref_counter--;
-    }
-    else
-    {
-        sync_ref_counter = 1;
-        clock_gettime(CLOCK_MONOTONIC, &time_ns);
-        ecrt_master_sync_reference_clock_to(master, TIMESPEC2NS(time_ns));
+        latched_stamp_ns_ = cmd_stamp_ns;
     }
-    // ecrt_master_sync_reference_clock(master);
-    ecrt_master_sync_slave_clocks(master);
 
-    // send process data
-    ecrt_domain_queue(domain);
-    ecrt_master_send(master);
+    if (latency_probe_)
+        detect_motion_onset_();
 
-    // loop_end_time_ = (unsigned long) this->now().nanoseconds();
-    // wakeup_time_ = loop_end_time_ + PERIOD_NS;
+    track_following_error_();
 
-    // clock_gettime(CLOCK_TO_USE, &wakeupTime);
+
+    //* Uncomment to zero actuator
+    // uint joint_index = 4; // Change index to choose which joint to zero
+    // int32_t current_pos = EC_READ_S32(domain_pd + actual_pos_offset[joint_index]);
+    // int32_t target_pos = current_pos;
+    // uint32_t delta = 250;
+    // if (abs(current_pos) > delta)
+    // {
+    //     if (current_pos < 0)
+    //         target_pos += delta;
+    //     else if (current_pos > 0)
+    //         target_pos -= delta;
+    //     EC_WRITE_S32(domain_pd + target_pos_offset[joint_index], target_pos);
+    // }
+
+
+    //* Uncomment to jog J6 between [-180, 180]
+    // int32_t current_pos = EC_READ_S32(domain_pd + actual_pos_offset[5]);
+    // int32_t target_pos = current_pos;
+    // if (!toggle)
+    // {
+    //     if (current_pos < 262144)
+    //     {
+    //         target_pos += 8000;
+    //         EC_WRITE_S32(domain_pd + target_pos_offset[5], target_pos);
+    //     }
+    //     else
+    //         toggle = true;
+    // }
+    // else
+    // {
+    //     if (current_pos > -262144)
+    //     {
+    //         target_pos -= 8000;
+    //         EC_WRITE_S32(domain_pd + target_pos_offset[5], target_pos);
+    //     }
+    //     else
+    //         toggle = false;
+    // }
 }
 
 
 /**
- * @brief Joint state publisher callback.
+ * @brief Gravity and friction feed-forward (see torque_feed_forward_()).
  * 
- * @note Frequency is controlled through JOINT_STATE_PERIOD member.
+ * @note RT task, every cycle.
  * 
  */
-void ZeroErrInterface::joint_state_pub_()
+void ZeroErrInterface::feed_forward_task_()
 {
-    joint_states_.header.stamp = this->now();
-
-    for (uint i = 0; i < NUM_JOINTS; i++)
-    {
-        joint_states_.position[i] = COUNT_TO_RAD(joint_states_enc_counts_[i]);
-    }
-
-    arm_state_pub_->publish(joint_states_);
+    if (drives_op_)
+        torque_feed_forward_(CYCLE_TIME);
 }
 
 
 /**
- * @brief Outputs state of EtherCAT master.
+ * @brief Sets the DC reference clock to the application time.
+ * 
+ * @note RT task, every DC_SYNC_REF_CYCLES.
  * 
  */
-void ZeroErrInterface::check_master_state_()
+void ZeroErrInterface::dc_sync_reference_task_()
 {
-    ec_master_state_t ms;
-
-    ecrt_master_state(master, &ms);
-
-    if (ms.slaves_responding != master_state.slaves_responding)
-        RCLCPP_INFO(this->get_logger(), "%u slave(s).\n", ms.slaves_responding);
-    if (ms.al_states != master_state.al_states)
-        RCLCPP_INFO(this->get_logger(), "AL states: 0x%02X.\n", ms.al_states);
-    if (ms.link_up != master_state.link_up)
-        RCLCPP_INFO(this->get_logger(), "Link is %s.\n", ms.link_up ? "up" : "down");
-
-    master_state = ms;
+    clock_gettime(CLOCK_MONOTONIC, &time_ns);
+    ecrt_master_sync_reference_clock_to(master, TIMESPEC2NS(time_ns));
 }
 
 
 /**
- * @brief Outputs process data domain state.
+ * @brief Services the error code (0x603F) SDO request of one joint, round robin.
+ * 
+ * @note RT task, every SDO_CYCLES.
  * 
  */
-void ZeroErrInterface::check_domain_state_()
+void ZeroErrInterface::sdo_task_()
 {
-    ec_domain_state_t ds;
-
-    ecrt_domain_state(domain, &ds);
+    if (sdo[sdo_joint_])
+        read_sdos(sdo_joint_);
 
-    if (ds.working_counter != domain_state.working_counter)
-        RCLCPP_INFO(this->get_logger(), "Domain: WC %u.\n", ds.working_counter);
-    if (ds.wc_state != domain_state.wc_state)
-        RCLCPP_INFO(this->get_logger(), "Domain: State %u.\n", ds.wc_state);
-
-    domain_state = ds;
+    sdo_joint_ = (sdo_joint_ + 1) % NUM_JOINTS;
 }
 
 
 /**
- * @brief Check the EtherCAT slave state of each joint sequentially.
+ * @brief Writes gravity and friction feed-forward torques to the torque offset RxPDO
+ * (0x60B2) of every joint.
+ * 
+ * Gravity from GravityModel at the commanded positions, Coulomb (smoothed with tanh) and
+ * viscous friction from the low-pass filtered commanded velocity. The feed-forward gain
+ * ramps towards gravity_ff.scale when gravity_ff is set, and towards 0 when it is cleared,
+ * to avoid torque steps.
+ * 
+ * @param dt Time since the last call [s]
+ * 
+ * @note Called from the cyclic PDO loop, allocation-free and non-blocking.
  * 
- * @return true when all joints reach OP state,
- * @return false when joints havent reached OP state yet
  */
-bool ZeroErrInterface::check_slave_config_states_()
+void ZeroErrInterface::torque_feed_forward_(double dt)
 {
-    ec_slave_config_state_t s;
-
-    ecrt_slave_config_state(joint_slave_configs[joint_no_], &s);
-    
-    // if (s.al_state != joint_ec_states[joint_no_].al_state)
-    //     RCLCPP_INFO(this->get_logger(), "J%d: State 0x%02X.\n", joint_no_, s.al_state);
-    // if (s.online != joint_ec_states[joint_no_].online)
-    //     RCLCPP_INFO(this->get_logger(), "J%d: %s.\n", joint_no_, s.online ? "online" : "offline");
-    if (s.operational != joint_ec_states[joint_no_].operational)
-        RCLCPP_INFO(this->get_logger(), "J%d: %soperational.", joint_no_, 
-            s.operational ? "" : "Not ");    
-
-    joint_ec_states[joint_no_] = s;
-
+    if (!ff_init_)
+    {
+        for (uint i = 0; i < NUM_JOINTS; i++)
+        {
+            ff_last_cmd_[i] = joint_commands_[i];
+            ff_qd_[i] = 0.0;
+        }
+        ff_init_ = true;
+    }
 
-    // Current joint is operational -- check next joint
-    if (joint_ec_states[joint_no_].operational)
-        joint_no_++; 
+    const RtConfig &cfg = *cfg_;
 
+    double target_gain = cfg.gravity_ff ? cfg.gravity_ff_scale : 0.0;
+    const double ramp_step = dt / cfg.ff_ramp_time;
+    ff_gain_ += std::clamp(target_gain - ff_gain_, -ramp_step, ramp_step);
 
-    if (joint_no_ == 6) // All joints operational
+    for (uint i = 0; i < NUM_JOINTS; i++)
     {
-        // Reset joint tracker
-        joint_no_ = 0;
-        return true;
+        int32_t cmd = joint_commands_[i];
+        ff_q_[i] = COUNT_TO_RAD((double) cmd);
+        ff_qd_[i] += dt / (cfg.ff_vel_time_constant + dt) * (COUNT_TO_RAD((double) (cmd - ff_last_cmd_[i])) / dt - ff_qd_[i]);
+        ff_last_cmd_[i] = cmd;
     }
+
+    if (ff_gain_ == 0.0)
+    {
+        for (uint i = 0; i < NUM_JOINTS; i++)
+        {
+            pdo_out_[i].torque_offset = 0;
+            ff_offset_[i].store(0, std::memory_order_relaxed);
+        }
+        return;
+    }
+
+    gravity_model_.compute(ff_q_, ff_tau_);
+
+    for (uint i = 0; i < NUM_JOINTS; i++)
+    {
+        int16_t offset = 0;
+
+        if (rated_torque_[i])
+        {
+            double tau = ff_tau_[i]
+                + cfg.friction_coulomb[i] * std::tanh(ff_qd_[i] / cfg.friction_vel_eps)
+                + cfg.friction_viscous[i] * ff_qd_[i];
+
+            // Nm -> per mille of rated torque (mNm)
+            double permille = ff_gain_ * tau * 1e6 / rated_torque_[i];
+            offset = (int16_t) std::lround(std::clamp(permille, -cfg.max_torque_offset, cfg.max_torque_offset));
+        }
+
+        pdo_out_[i].torque_offset = offset;
+        ff_offset_[i].store(offset, std::memory_order_relaxed);
+    }
+}
+
+
+/**
+ * @brief Accumulates the position following error of every joint, target written in the
+ * previous cycle minus the actual position read this cycle.
+ * 
+ * @note Called from the cyclic PDO loop, allocation-free and non-blocking.
+ * 
+ */
+void ZeroErrInterface::track_following_error_()
+{
+    for (uint i = 0; i < NUM_JOINTS; i++)
+    {
+        if (fe_valid_)
+            following_error_[i].add(fe_last_target_[i] - pdo_in_[i].actual_pos);
+
+        fe_last_target_[i] = joint_commands_[i];
+    }
+    fe_valid_ = true;
+}
+
+
+/**
+ * @brief Applies the joint envelope (see JointEnvelope) to this cycle's joint commands,
+ * records violations and hands stops over to envelope_poll_().
+ * 
+ * @note Called from the cyclic PDO loop, allocation-free and non-blocking.
+ * 
+ */
+void ZeroErrInterface::enforce_envelope_()
+{
+    // Drive enable or end of a profile move, the commands restart from the held position
+    if (envelope_reset_)
+    {
+        envelope_.reset(joint_commands_.data());
+        envelope_reset_ = false;
+
+        if (envelope_stopped_.exchange(false, std::memory_order_relaxed))
+            envelope_resume_seq_.fetch_add(1, std::memory_order_release);
+    }
+
+    const JointEnvelope::Limits &limits = cfg_->envelope;
+    const JointEnvelope::State before = envelope_.state();
+
+    uint32_t violated = envelope_.apply(limits, joint_commands_.data());
+
+    for (int k = 0; violated && k < JointEnvelope::KINDS; k++)
+    {
+        if (!(violated & (1u << k)))
+            continue;
+
+        for (uint i = 0; i < NUM_JOINTS; i++)
+        {
+            double excess = envelope_.excess((JointEnvelope::Kind) k, i);
+            if (excess > 0.0)
+                envelope_stats_[k][i].add(excess);
+        }
+    }
+
+    const JointEnvelope::State after = envelope_.state();
+    if (after == before)
+        return;
+
+    if (before == JointEnvelope::TRACKING)
+    {
+        envelope_stop_kinds_ = 0;
+        for (int k = 0; k < JointEnvelope::KINDS; k++)
+        {
+            if ((violated & (1u << k)) && limits.reaction[k] == EnvelopeReaction::STOP)
+                envelope_stop_kinds_ |= 1u << k;
+        }
+        envelope_stopped_.store(true, std::memory_order_relaxed);
+    }
+
+    if (after == JointEnvelope::STOPPED)
+    {
+        std::copy(joint_commands_.begin(), joint_commands_.end(), envelope_hold_);
+        envelope_stop_seq_.fetch_add(1, std::memory_order_release);
+    }
+    else if (after == JointEnvelope::TRACKING)
+    {
+        envelope_stopped_.store(false, std::memory_order_relaxed);
+        envelope_resume_seq_.fetch_add(1, std::memory_order_release);
+    }
+}
+
+
+/**
+ * @brief Runs a Profile Position (PP) move requested through arm/ProfileMove.
+ * 
+ * The drives generate the motion profile themselves, the host only hands over the set-point:
+ *  IDLE -> SWITCH_TO_PP        mode of operation PP, targets hold the actual positions
+ *  SWITCH_TO_PP -> SET_POINT   all drives display PP, targets, profile and new set-point
+ *                              (control word bit 4) written
+ *  SET_POINT -> MOVING         all drives acknowledged the set-point (status word bit 12),
+ *                              bit 4 cleared
+ *  MOVING -> SWITCH_TO_CSP     all drives reached the target (status word bit 10)
+ *  MOVING -> HALTING           abort requested or following error, halt (control word bit 8)
+ *  HALTING -> SWITCH_TO_CSP    all axes at standstill
+ *  HALTING -> QUICK_STOP       still moving after PP_HANDSHAKE_CYCLES, quick stop (control
+ *                              word bits 1/2 = 1/0); the drives leave Operation Enabled and
+ *                              the drive loss check in drive_state_task_() ends the move
+ *  SWITCH_TO_CSP -> IDLE       all drives display CSP, the speed override restarts from the
+ *                              actual positions and the result is handed to profile_move_poll_()
+ * 
+ * joint_commands_ follow the actual positions during the move, so the feed-forward and the
+ * following error statistics see the drives' profile.
+ * 
+ * @return true while a move owns the target positions, false in CSP
+ * 
+ * @note Called from the cyclic PDO loop, allocation-free and non-blocking.
+ * 
+ */
+bool ZeroErrInterface::profile_move_()
+{
+    uint32_t request_seq = pp_request_seq_.load(std::memory_order_acquire);
+    if (pp_state_ == ProfileMoveState::IDLE && request_seq == pp_done_seq_.load(std::memory_order_relaxed))
+        return false;
+
+    int32_t actual[NUM_JOINTS];
+    uint16_t status_all = 0xFFFF;
+    bool following_error = false;
+    bool modes_pp = true;
+    bool modes_csp = true;
+
+    for (uint i = 0; i < NUM_JOINTS; i++)
+    {
+        actual[i] = pdo_in_[i].actual_pos;
+
+        uint16_t status_word = pdo_in_[i].status_word;
+        status_all &= status_word;
+        following_error |= (status_word & SW_FOLLOWING_ERROR) != 0;
+
+        int8_t mode = pdo_in_[i].op_mode_disp;
+        modes_pp &= (mode == MODE_PP);
+        modes_csp &= (mode == MODE_CSP);
+    }
+
+    pp_cycles_++;
+
+    switch (pp_state_)
+    {
+        case ProfileMoveState::IDLE:
+            for (uint i = 0; i < NUM_JOINTS; i++)
+            {
+                pdo_out_[i].target_pos = actual[i];
+                pdo_out_[i].op_mode = MODE_PP;
+            }
+            pp_abort_.store(false, std::memory_order_relaxed);
+            pp_state_ = ProfileMoveState::SWITCH_TO_PP;
+            pp_cycles_ = 0;
+            break;
+
+        case ProfileMoveState::SWITCH_TO_PP:
+            if (!modes_pp)
+            {
+                if (pp_cycles_ > PP_HANDSHAKE_CYCLES)
+                    leave_profile_move_(PP_MODE_TIMEOUT, actual);
+                break;
+            }
+
+            // Absolute target, replacing any set-point right away
+            for (uint i = 0; i < NUM_JOINTS; i++)
+            {
+                uint16_t control_word = pdo_out_[i].ctrl_word;
+
+                pdo_out_[i].profile_vel = pp_velocity_[i];
+                pdo_out_[i].profile_acc = pp_accel_[i];
+                pdo_out_[i].profile_dec = pp_accel_[i];
+                pdo_out_[i].target_pos = pp_target_[i];
+                pdo_out_[i].ctrl_word = (control_word & ~(CW_RELATIVE | CW_HALT)) | CW_NEW_SET_POINT | CW_CHANGE_IMMEDIATELY;
+            }
+            pp_state_ = ProfileMoveState::SET_POINT;
+            pp_cycles_ = 0;
+            break;
+
+        case ProfileMoveState::SET_POINT:
+            if (!(status_all & SW_SET_POINT_ACK))
+            {
+                if (pp_cycles_ > PP_HANDSHAKE_CYCLES)
+                    leave_profile_move_(PP_ACK_TIMEOUT, actual);
+                break;
+            }
+
+            for (uint i = 0; i < NUM_JOINTS; i++)
+            {
+                uint16_t control_word = pdo_out_[i].ctrl_word;
+                pdo_out_[i].ctrl_word = control_word & ~CW_NEW_SET_POINT;
+            }
+            pp_state_ = ProfileMoveState::MOVING;
+            pp_cycles_ = 0;
+            break;
+
+        case ProfileMoveState::MOVING:
+        {
+            bool stop = pp_abort_.load(std::memory_order_relaxed);
+            if (following_error || stop)
+            {
+                for (uint i = 0; i < NUM_JOINTS; i++)
+                {
+                    uint16_t control_word = pdo_out_[i].ctrl_word;
+                    pdo_out_[i].ctrl_word = control_word | CW_HALT;
+                }
+                pp_result_ = following_error ? PP_FOLLOWING_ERROR : PP_STOPPED;
+                pp_state_ = ProfileMoveState::HALTING;
+                pp_cycles_ = 0;
+                pp_still_cycles_ = 0;
+                std::copy(actual, actual + NUM_JOINTS, pp_last_actual_);
+                break;
+            }
+
+            // Target reached may still be set from before the set-point on the first pass
+            bool reached = (pp_cycles_ > PP_STALE_CYCLES) && (status_all & SW_TARGET_REACHED);
+            for (uint i = 0; i < NUM_JOINTS && reached; i++)
+                reached = std::abs(actual[i] - pp_target_[i]) <= cfg_->pp_target_tolerance;
+
+            if (reached)
+                leave_profile_move_(PP_REACHED, actual);
+            break;
+        }
+
+        // Switching to CSP holds the actual position, an axis still decelerating on its
+        // profile would be stopped from speed. Wait for standstill, target reached alone is
+        // no proof with the wide position window and may be stale right after the halt.
+        case ProfileMoveState::HALTING:
+        {
+            bool still = true;
+            for (uint i = 0; i < NUM_JOINTS; i++)
+            {
+                still &= std::abs(actual[i] - pp_last_actual_[i]) <= PP_STANDSTILL_COUNTS;
+                pp_last_actual_[i] = actual[i];
+            }
+            pp_still_cycles_ = still ? pp_still_cycles_ + 1 : 0;
+
+            if (pp_cycles_ > PP_STALE_CYCLES && (status_all & SW_TARGET_REACHED) && pp_still_cycles_ >= PP_STANDSTILL_CYCLES)
+                leave_profile_move_(pp_result_, actual);
+            else if (pp_cycles_ > PP_HANDSHAKE_CYCLES)
+            {
+                // Not stopped by the halt, the drives' quick stop ramp takes over
+                for (uint i = 0; i < NUM_JOINTS; i++)
+                {
+                    uint16_t control_word = pdo_out_[i].ctrl_word;
+                    pdo_out_[i].ctrl_word = (control_word & ~0b0100) | 0b0010;
+                }
+                pp_result_ = PP_HALT_TIMEOUT;
+                pp_state_ = ProfileMoveState::QUICK_STOP;
+                pp_cycles_ = 0;
+            }
+            break;
+        }
+
+        // Ended by the drive loss check once the drives left Operation Enabled
+        case ProfileMoveState::QUICK_STOP:
+            break;
+
+        case ProfileMoveState::SWITCH_TO_CSP:
+            if (!modes_csp)
+                break;
+
+            speed_override_.reset(actual);
+            std::copy(actual, actual + NUM_JOINTS, pp_final_);
+            pp_done_seq_.store(request_seq, std::memory_order_release);
+            pp_state_ = ProfileMoveState::IDLE;
+            break;
+    }
+
+    for (uint i = 0; i < NUM_JOINTS; i++)
+        joint_commands_[i] = actual[i];
+
+    return true;
+}
+
+
+/**
+ * @brief Ends a profile move: clears the PP control word bits and switches back to CSP,
+ * holding the actual positions.
+ * 
+ * @param result Outcome reported once the drives display CSP
+ * @param actual Actual positions [counts]
+ * 
+ * @note Called from the cyclic PDO loop, allocation-free and non-blocking.
+ * 
+ */
+void ZeroErrInterface::leave_profile_move_(ProfileMoveResult result, const int32_t actual[NUM_JOINTS])
+{
+    for (uint i = 0; i < NUM_JOINTS; i++)
+    {
+        uint16_t control_word = pdo_out_[i].ctrl_word;
+
+        pdo_out_[i].target_pos = actual[i];
+        pdo_out_[i].ctrl_word = control_word & ~(CW_NEW_SET_POINT | CW_CHANGE_IMMEDIATELY | CW_HALT);
+        pdo_out_[i].op_mode = MODE_CSP;
+        joint_commands_[i] = actual[i];
+    }
+
+    pp_result_ = result;
+    pp_state_ = ProfileMoveState::SWITCH_TO_CSP;
+    pp_cycles_ = 0;
+}
+
+
+/**
+ * @brief Publishes per-joint following error RMS/max (rad) since the last report on
+ * arm/following_error, tagged with the feed-forward state for before/after comparison.
+ * 
+ * @note Frequency is controlled through FOLLOWING_ERROR_PERIOD member.
+ * 
+ */
+void ZeroErrInterface::following_error_report_()
+{
+    diagnostic_msgs::msg::DiagnosticArray report;
+    report.header.stamp = this->now();
+
+    RtConfig config = config_.snapshot();
+    bool ff_on = config.gravity_ff;
+
+    for (uint i = 0; i < NUM_JOINTS; i++)
+    {
+        uint64_t count = following_error_[i].count.exchange(0, std::memory_order_relaxed);
+        uint64_t sum_sq = following_error_[i].sum_sq.exchange(0, std::memory_order_relaxed);
+        uint32_t max_abs = following_error_[i].max_abs.exchange(0, std::memory_order_relaxed);
+
+        if (count == 0) continue;
+
+        diagnostic_msgs::msg::DiagnosticStatus status;
+        status.level = diagnostic_msgs::msg::DiagnosticStatus::OK;
+        status.name = "arm_ethercat_interface: " + joint_states_.name[i] + " following error";
+        status.hardware_id = joint_states_.name[i];
+        status.message = ff_on ? "gravity_ff on" : "gravity_ff off";
+
+        auto add_value = [&status](const std::string &key, const std::string &value) {
+            diagnostic_msgs::msg::KeyValue kv;
+            kv.key = key;
+            kv.value = value;
+            status.values.push_back(kv);
+        };
+        add_value("rms_rad", std::to_string(COUNT_TO_RAD(std::sqrt((double) sum_sq / count))));
+        add_value("max_rad", std::to_string(COUNT_TO_RAD((double) max_abs)));
+        add_value("samples", std::to_string(count));
+        add_value("torque_offset_permille", std::to_string(ff_offset_[i].load(std::memory_order_relaxed)));
+
+        // Joint envelope violations: overshoot of the stopping position [rad], velocity and
+        // acceleration beyond the limit [%]
+        for (int k = 0; k < JointEnvelope::KINDS; k++)
+        {
+            uint64_t violations = envelope_stats_[k][i].count.exchange(0, std::memory_order_relaxed);
+            double excess = envelope_stats_[k][i].max_excess.exchange(0.0, std::memory_order_relaxed);
+            if (violations == 0) continue;
+
+            std::string worst = (k == JointEnvelope::POSITION) ?
+                std::to_string(COUNT_TO_RAD(excess)) + " rad" : std::to_string(100.0 * excess) + " %";
+
+            status.level = diagnostic_msgs::msg::DiagnosticStatus::WARN;
+            add_value("envelope_" + std::string(ENVELOPE_KINDS[k]) + "_violations", std::to_string(violations));
+            add_value("envelope_" + std::string(ENVELOPE_KINDS[k]) + "_max_excess", worst);
+
+            RCLCPP_WARN(this->get_logger(), "%s: %lu cycles beyond the %s limit (max %s beyond, %s)",
+                joint_states_.name[i].c_str(), violations, ENVELOPE_KINDS[k], worst.c_str(),
+                REACTION_NAMES[(int) config.envelope.reaction[k]]);
+        }
+
+        report.status.push_back(status);
+    }
+
+    if (!report.status.empty())
+        following_error_pub_->publish(report);
+}
+
+
+// Parameters backed by RtConfig, see apply_rt_config_param_()
+static const std::vector<std::string> RT_CONFIG_PARAMS = {
+    "gravity_ff", "gravity_ff.scale", "gravity_ff.max_offset", "gravity_ff.ramp_time", "gravity_ff.velocity_filter",
+    "friction.coulomb", "friction.viscous", "friction.velocity_eps",
+    "latency_probe.onset_threshold", "profile_move.target_tolerance",
+    "limits.position_min", "limits.position_max", "limits.velocity", "limits.acceleration",
+    "limits.reaction.position", "limits.reaction.velocity", "limits.reaction.acceleration", "limits.resync_tolerance"
+};
+
+
+/**
+ * @brief Declares the parameters of the RT loop's tunables (feed-forward gains and filters,
+ * deadbands, joint envelope) and publishes the first RtConfig. All of them can be changed
+ * at runtime, e.g. to compare following error with and without feed-forward under motion.
+ * 
+ * The joint envelope defaults to the drives' maximum speed (ec_defines.h) and the
+ * acceleration and (absent) position limits of arm_config/config/joint_limits.yaml.
+ * 
+ */
+void ZeroErrInterface::declare_rt_config_params_()
+{
+    const RtConfig defaults;
+
+    this->declare_parameter("gravity_ff", defaults.gravity_ff);
+    this->declare_parameter("gravity_ff.scale", defaults.gravity_ff_scale);
+    this->declare_parameter("gravity_ff.max_offset", defaults.max_torque_offset);
+    this->declare_parameter("gravity_ff.ramp_time", defaults.ff_ramp_time);
+    this->declare_parameter("gravity_ff.velocity_filter", defaults.ff_vel_time_constant);
+    this->declare_parameter("friction.coulomb", std::vector<double>(NUM_JOINTS, 0.0));
+    this->declare_parameter("friction.viscous", std::vector<double>(NUM_JOINTS, 0.0));
+    this->declare_parameter("friction.velocity_eps", defaults.friction_vel_eps);
+    this->declare_parameter("latency_probe.onset_threshold", (int64_t) defaults.onset_threshold);
+    this->declare_parameter("profile_move.target_tolerance", (int64_t) defaults.pp_target_tolerance);
+
+    std::vector<double> max_velocity;
+    for (uint i = 0; i < NUM_JOINTS; i++)
+        max_velocity.push_back(COUNT_TO_RAD((double) ((i < 3) ? EROB_110H120_MAX_SPEED : EROB_70H100_MAX_SPEED)));
+
+    this->declare_parameter("limits.position_min", std::vector<double>(NUM_JOINTS, -51471.85));
+    this->declare_parameter("limits.position_max", std::vector<double>(NUM_JOINTS, 51471.85));
+    this->declare_parameter("limits.velocity", max_velocity);
+    this->declare_parameter("limits.acceleration", std::vector<double>(NUM_JOINTS, 20.94));
+    this->declare_parameter("limits.reaction.position", std::string("stop"));
+    this->declare_parameter("limits.reaction.velocity", std::string("clamp"));
+    this->declare_parameter("limits.reaction.acceleration", std::string("warn"));
+    this->declare_parameter("limits.resync_tolerance", (int64_t) defaults.envelope.resync_tolerance);
+
+    // Invalid startup values keep their default
+    config_.update(
+        [this](RtConfig &config) {
+            std::string reason;
+            for (const auto &param : this->get_parameters(RT_CONFIG_PARAMS))
+            {
+                if (!apply_rt_config_param_(param, config, reason))
+                    RCLCPP_ERROR(this->get_logger(), "%s, using the default", reason.c_str());
+            }
+
+            if (!check_envelope_(config.envelope, reason))
+            {
+                RCLCPP_ERROR(this->get_logger(), "%s, position limits disabled", reason.c_str());
+                const JointEnvelope::Limits unlimited;
+                std::copy(unlimited.pos_min, unlimited.pos_min + JointEnvelope::LANES, config.envelope.pos_min);
+                std::copy(unlimited.pos_max, unlimited.pos_max + JointEnvelope::LANES, config.envelope.pos_max);
+            }
+            return true;
+        });
+
+    param_cb_handle_ = this->add_on_set_parameters_callback(
+        std::bind(&ZeroErrInterface::param_cb_, this, std::placeholders::_1));
+
+    RtConfig config = config_.snapshot();
+    RCLCPP_INFO(this->get_logger(), "Gravity/friction feed-forward %s", config.gravity_ff ? "enabled" : "disabled");
+    RCLCPP_INFO(this->get_logger(), "Joint envelope reactions: position %s, velocity %s, acceleration %s",
+        REACTION_NAMES[(int) config.envelope.reaction[JointEnvelope::POSITION]],
+        REACTION_NAMES[(int) config.envelope.reaction[JointEnvelope::VELOCITY]],
+        REACTION_NAMES[(int) config.envelope.reaction[JointEnvelope::ACCELERATION]]);
+}
+
+
+/**
+ * @brief Validates an RtConfig parameter and sets it in config.
+ * 
+ * @return false with the reason if the value is invalid, config is left unchanged
+ */
+bool ZeroErrInterface::apply_rt_config_param_(const rclcpp::Parameter &param, RtConfig &config, std::string &reason) const
+{
+    const std::string &name = param.get_name();
+
+    if (name == "gravity_ff")
+    {
+        config.gravity_ff = param.as_bool();
+    }
+    else if (name == "friction.coulomb" || name == "friction.viscous")
+    {
+        auto values = param.as_double_array();
+        if (values.size() != NUM_JOINTS)
+        {
+            reason = name + " needs " + std::to_string(NUM_JOINTS) + " values";
+            return false;
+        }
+        std::copy(values.begin(), values.end(), (name == "friction.coulomb") ? config.friction_coulomb : config.friction_viscous);
+    }
+    else if (name.rfind("limits.reaction.", 0) == 0)
+    {
+        const std::string value = param.as_string();
+        const JointEnvelope::Kind kind =
+            (name == "limits.reaction.position") ? JointEnvelope::POSITION :
+            (name == "limits.reaction.velocity") ? JointEnvelope::VELOCITY : JointEnvelope::ACCELERATION;
+
+        if (value == "warn")
+            config.envelope.reaction[kind] = EnvelopeReaction::WARN;
+        else if (value == "clamp" && kind != JointEnvelope::ACCELERATION)
+            config.envelope.reaction[kind] = EnvelopeReaction::CLAMP;
+        else if (value == "stop")
+            config.envelope.reaction[kind] = EnvelopeReaction::STOP;
+        else
+        {
+            reason = name + ((kind == JointEnvelope::ACCELERATION) ? " must be warn or stop" : " must be warn, clamp or stop");
+            return false;
+        }
+    }
+    else if (name.rfind("limits.", 0) == 0 && name != "limits.resync_tolerance")
+    {
+        auto values = param.as_double_array();
+        if (values.size() != NUM_JOINTS)
+        {
+            reason = name + " needs " + std::to_string(NUM_JOINTS) + " values";
+            return false;
+        }
+
+        // rad, rad/s, rad/s^2 -> counts per cycle
+        const bool is_position = (name == "limits.position_min" || name == "limits.position_max");
+        const double scale = RAD_TO_COUNT(1.0) * ((name == "limits.velocity") ? CYCLE_TIME :
+                                                  (name == "limits.acceleration") ? CYCLE_TIME * CYCLE_TIME : 1.0);
+        for (uint i = 0; i < NUM_JOINTS; i++)
+        {
+            if (!std::isfinite(values[i]) || (!is_position && values[i] <= 0.0))
+            {
+                reason = name + (is_position ? " must be finite" : " must be positive");
+                return false;
+            }
+        }
+
+        double *limit = (name == "limits.position_min") ? config.envelope.pos_min :
+                        (name == "limits.position_max") ? config.envelope.pos_max :
+                        (name == "limits.velocity") ? config.envelope.vel : config.envelope.acc;
+        for (uint i = 0; i < NUM_JOINTS; i++)
+            limit[i] = values[i] * scale;
+    }
+    else if (name == "latency_probe.onset_threshold" || name == "profile_move.target_tolerance" || name == "limits.resync_tolerance")
+    {
+        if (param.as_int() <= 0 || param.as_int() > MAX_COUNT)
+        {
+            reason = name + " must be in [1, " + std::to_string(MAX_COUNT) + "] counts";
+            return false;
+        }
+        if (name == "limits.resync_tolerance")
+            config.envelope.resync_tolerance = (double) param.as_int();
+        else
+            ((name == "latency_probe.onset_threshold") ? config.onset_threshold : config.pp_target_tolerance) = (int32_t) param.as_int();
+    }
+    else if (name == "gravity_ff.scale")
+    {
+        if (param.as_double() < 0.0 || param.as_double() > 1.5)
+        {
+            reason = "gravity_ff.scale must be in [0, 1.5]";
+            return false;
+        }
+        config.gravity_ff_scale = param.as_double();
+    }
+    else if (name == "gravity_ff.max_offset")
+    {
+        if (param.as_double() < 0.0 || param.as_double() > 1000.0)
+        {
+            reason = "gravity_ff.max_offset must be in [0, 1000] per mille";
+            return false;
+        }
+        config.max_torque_offset = param.as_double();
+    }
+    else
+    {
+        // Time constants and smoothing velocity, divisors in the RT loop
+        if (param.as_double() <= 0.0)
+        {
+            reason = name + " must be positive";
+            return false;
+        }
+
+        if (name == "gravity_ff.ramp_time")
+            config.ff_ramp_time = param.as_double();
+        else if (name == "gravity_ff.velocity_filter")
+            config.ff_vel_time_constant = param.as_double();
+        else
+            config.friction_vel_eps = param.as_double();
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief Checks the position limits of every joint are ordered.
+ * 
+ * @return false with the reason otherwise
+ */
+bool ZeroErrInterface::check_envelope_(const JointEnvelope::Limits &limits, std::string &reason) const
+{
+    for (uint i = 0; i < NUM_JOINTS; i++)
+    {
+        if (limits.pos_min[i] >= limits.pos_max[i])
+        {
+            reason = "limits.position_min must be below limits.position_max (j" + std::to_string(i + 1) + ")";
+            return false;
+        }
+    }
+    return true;
+}
+
+
+/**
+ * @brief Validates all parameters first, then applies them. RtConfig parameters set together
+ * are published as one version, the RT loop never sees part of the change.
+ * 
+ */
+rcl_interfaces::msg::SetParametersResult ZeroErrInterface::param_cb_(const std::vector<rclcpp::Parameter> &params)
+{
+    rcl_interfaces::msg::SetParametersResult result;
+    result.successful = true;
+
+    for (const auto &param : params)
+    {
+        if ((param.get_name() == "speed_override.max_rate" || param.get_name() == "speed_override.max_accel") &&
+            param.as_double() <= 0.0)
+        {
+            result.successful = false;
+            result.reason = param.get_name() + " must be positive";
+            return result;
+        }
+        if (param.get_name() == "speed_override.max_catchup" && !(param.as_double() >= 1.0 && param.as_double() <= 2.0))
+        {
+            result.successful = false;
+            result.reason = param.get_name() + " must be in [1, 2]";
+            return result;
+        }
+    }
+
+    bool config_changed = false;
+    bool ff_changed = false;
+    uint64_t version = config_.update(
+        [&](RtConfig &config) {
+            for (const auto &param : params)
+            {
+                if (std::find(RT_CONFIG_PARAMS.begin(), RT_CONFIG_PARAMS.end(), param.get_name()) == RT_CONFIG_PARAMS.end())
+                    continue;
+
+                if (!apply_rt_config_param_(param, config, result.reason))
+                {
+                    result.successful = false;
+                    return false;
+                }
+                ff_changed |= (param.get_name() == "gravity_ff");
+                config_changed = true;
+            }
+
+            if (config_changed && !check_envelope_(config.envelope, result.reason))
+            {
+                result.successful = false;
+                return false;
+            }
+            return config_changed;
+        });
+
+    if (!result.successful)
+        return result;
+
+    // The parameters still hold their old values here, limits not in the request keep them
+    double max_rate = this->get_parameter("speed_override.max_rate").as_double();
+    double max_accel = this->get_parameter("speed_override.max_accel").as_double();
+    bool limits_changed = false;
+
+    for (const auto &param : params)
+    {
+        if (param.get_name() == "speed_override")
+        {
+            set_speed_override_(param.as_double());
+        }
+        else if (param.get_name() == "speed_override.max_rate")
+        {
+            max_rate = param.as_double();
+            limits_changed = true;
+        }
+        else if (param.get_name() == "speed_override.max_accel")
+        {
+            max_accel = param.as_double();
+            limits_changed = true;
+        }
+        else if (param.get_name() == "speed_override.max_catchup")
+        {
+            speed_override_.set_max_catchup(param.as_double());
+        }
+    }
+
+    if (limits_changed)
+        speed_override_.set_limits(max_rate, max_accel);
+
+    if (ff_changed)
+        RCLCPP_INFO(this->get_logger(), "Gravity/friction feed-forward %s (config v%lu)",
+            config_.snapshot().gravity_ff ? "enabled" : "disabled", version);
+    else if (config_changed)
+        RCLCPP_DEBUG(this->get_logger(), "RT config v%lu", version);
+
+    return result;
+}
+
+
+void ZeroErrInterface::declare_speed_override_params_()
+{
+    double percent = this->declare_parameter("speed_override", 100.0);
+    double max_rate = this->declare_parameter("speed_override.max_rate", 4.0);
+    double max_accel = this->declare_parameter("speed_override.max_accel", 40.0);
+    double max_catchup = this->declare_parameter("speed_override.max_catchup", 1.2);
+
+    speed_override_.set_limits(max_rate, max_accel);
+    speed_override_.set_max_catchup(max_catchup);
+    set_speed_override_(percent);
+}
+
+
+/**
+ * @brief Sets the speed override target, reached with the speed_override.max_rate and
+ * max_accel limits.
+ * 
+ * @param percent Override [0-100%], 0 holds the arm on the current trajectory
+ */
+void ZeroErrInterface::set_speed_override_(double percent)
+{
+    percent = std::clamp(percent, 0.0, 100.0);
+    if (percent / 100.0 == speed_override_.target()) return;
+
+    speed_override_.set_target(percent / 100.0);
+    RCLCPP_INFO(this->get_logger(), "Speed override %.0f%% (was %.0f%%, %.2fs behind the commands)",
+        percent, 100.0 * speed_override_.scale(), 1e-9 * speed_override_.lag_ns());
+}
+
+
+/**
+ * @brief Speed override topic callback, e.g. from a safety scanner zone.
+ * 
+ * @param msg Override [0-100%]
+ */
+void ZeroErrInterface::speed_override_cb_(const std_msgs::msg::Float64::SharedPtr msg)
+{
+    set_speed_override_(msg->data);
+}
+
+
+/**
+ * @brief Profile move service callback, starts a synchronized point-to-point move profiled
+ * by the drives.
+ * 
+ * Every joint gets a trapezoidal profile (speed x max velocity/acceleration of its drive);
+ * the profiles are scaled to the duration of the slowest joint, so all joints arrive
+ * together. Rejected while arm/command is moving the arm. The response is sent by
+ * profile_move_poll_() once the drives finished.
+ * 
+ * @note The move is a straight line in joint space and not collision checked.
+ * 
+ * @param header Request header for the deferred response
+ * @param request Target joint positions and speed
+ */
+void ZeroErrInterface::profile_move_cb_(const std::shared_ptr<rmw_request_id_t> header, const std::shared_ptr<arm_msgs::srv::ProfileMove::Request> request)
+{
+    arm_msgs::srv::ProfileMove::Response response;
+    response.success = false;
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    if (request->positions.size() != NUM_JOINTS)
+        response.msg = "Expected " + std::to_string(NUM_JOINTS) + " joint positions";
+    else if (!(request->speed > 0.0 && request->speed <= 1.0))
+        response.msg = "Speed must be in (0, 1]";
+    else if (!drives_enabled_.load(std::memory_order_relaxed))
+        response.msg = "Drives are not in Operation Enabled";
+    else if (pp_waiting_)
+        response.msg = "A profile move is running";
+    else if (envelope_stopped_.load(std::memory_order_relaxed))
+        response.msg = "Joint envelope stop, waiting for arm/command to resync";
+    else if (TIMESPEC2NS(now) - last_cmd_change_ns_ < PP_CMD_QUIET_NS || speed_override_.lag_ns() > 0)
+        response.msg = "arm/command is moving the arm";
+
+    // The drives profile the move, the RT loop's envelope does not see it
+    if (response.msg.empty())
+    {
+        const RtConfig config = config_.snapshot();
+        for (uint i = 0; i < NUM_JOINTS; i++)
+        {
+            double target = RAD_TO_COUNT(request->positions[i]);
+            if (target < config.envelope.pos_min[i] || target > config.envelope.pos_max[i])
+            {
+                response.msg = "j" + std::to_string(i + 1) + " target is outside limits.position_min/max";
+                break;
+            }
+        }
+    }
+
+    if (!response.msg.empty())
+    {
+        RCLCPP_WARN(this->get_logger(), "Profile move rejected: %s", response.msg.c_str());
+        profile_move_srv_->send_response(*header, response);
+        return;
+    }
+
+    // Trapezoidal profile duration of every joint, the slowest one leads
+    double distance[NUM_JOINTS];
+    double duration = 0.0;
+    int lead = -1;
+
+    for (uint i = 0; i < NUM_JOINTS; i++)
+    {
+        double max_velocity = request->speed * ((i < 3) ? EROB_110H120_MAX_SPEED : EROB_70H100_MAX_SPEED);
+        double max_accel = request->speed * ((i < 3) ? EROB_110H120_MAX_ADCEL : EROB_70H100_MAX_ADCEL);
+
+        pp_target_[i] = (int32_t) std::lround(RAD_TO_COUNT(request->positions[i]));
+        distance[i] = std::abs((double) pp_target_[i] - joint_states_enc_counts_[i].load(std::memory_order_relaxed));
+
+        double t = (distance[i] * max_accel >= max_velocity * max_velocity) ?
+            distance[i] / max_velocity + max_velocity / max_accel :
+            2.0 * std::sqrt(distance[i] / max_accel);
+
+        if (t > duration)
+        {
+            duration = t;
+            lead = i;
+        }
+    }
+
+    if (lead < 0)
+    {
+        response.success = true;
+        response.msg = "Already at the target";
+        profile_move_srv_->send_response(*header, response);
+        return;
+    }
+
+    // Same profile shape scaled by distance, so every joint takes the lead's duration
+    const double lead_velocity = request->speed * ((lead < 3) ? EROB_110H120_MAX_SPEED : EROB_70H100_MAX_SPEED);
+    const double lead_accel = request->speed * ((lead < 3) ? EROB_110H120_MAX_ADCEL : EROB_70H100_MAX_ADCEL);
+
+    for (uint i = 0; i < NUM_JOINTS; i++)
+    {
+        double ratio = distance[i] / distance[lead];
+        uint32_t max_velocity = (i < 3) ? EROB_110H120_MAX_SPEED : EROB_70H100_MAX_SPEED;
+        uint32_t max_accel = (i < 3) ? EROB_110H120_MAX_ADCEL : EROB_70H100_MAX_ADCEL;
+
+        pp_velocity_[i] = std::clamp((uint32_t) std::lround(ratio * lead_velocity), (uint32_t) 1, max_velocity);
+        pp_accel_[i] = std::clamp((uint32_t) std::lround(ratio * lead_accel), (uint32_t) 1, max_accel);
+    }
+
+    // Dropped from now on, and after the move until they agree with the reached position
+    cmd_gated_ = true;
+
+    pp_header_ = header;
+    pp_waiting_ = true;
+    pp_start_ = std::chrono::steady_clock::now();
+    pp_deadline_ = pp_start_ + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(duration + PP_DEADLINE_MARGIN));
+
+    pp_request_seq_.store(pp_request_seq_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+
+    RCLCPP_INFO(this->get_logger(), "Profile move started, %.2fs at %.0f%% (j%d leading)", duration, 100.0 * request->speed, lead + 1);
+}
+
+
+/**
+ * @brief Checks for the end of a profile move, responds to the request and sends the
+ * trajectory controller a trajectory holding the reached position.
+ * 
+ * A move overrunning its planned duration is halted, and the response fails if the drives
+ * do not finish within PP_RESPONSE_GRACE after that. arm/command stays gated until the
+ * drives are back in CSP.
+ * 
+ * @note Frequency is controlled through PROFILE_MOVE_POLL_PERIOD member.
+ * 
+ */
+void ZeroErrInterface::profile_move_poll_()
+{
+    if (!pp_waiting_)
+        return;
+
+    auto now = std::chrono::steady_clock::now();
+    arm_msgs::srv::ProfileMove::Response response;
+    response.duration_ms = std::chrono::duration<double, std::milli>(now - pp_start_).count();
+
+    if (pp_done_seq_.load(std::memory_order_acquire) != pp_request_seq_.load(std::memory_order_relaxed))
+    {
+        if (now > pp_deadline_ && !pp_abort_.exchange(true, std::memory_order_relaxed))
+            RCLCPP_WARN(this->get_logger(), "Profile move overran its duration, halting");
+
+        if (pp_header_ && now > pp_deadline_ + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>(PP_RESPONSE_GRACE)))
+        {
+            response.success = false;
+            response.msg = "Drives did not finish the move";
+            RCLCPP_ERROR(this->get_logger(), "Profile move failed: %s", response.msg.c_str());
+            profile_move_srv_->send_response(*pp_header_, response);
+            pp_header_.reset();
+        }
+        return;
+    }
+
+    pp_waiting_ = false;
+    std::copy(pp_final_, pp_final_ + NUM_JOINTS, pp_hold_);
+
+    switch (pp_result_)
+    {
+        case PP_REACHED:            response.msg = "Target reached"; break;
+        case PP_STOPPED:            response.msg = "Halted, the move overran its duration"; break;
+        case PP_FOLLOWING_ERROR:    response.msg = "Halted on a following error"; break;
+        case PP_MODE_TIMEOUT:       response.msg = "Drives did not switch to Profile Position mode"; break;
+        case PP_ACK_TIMEOUT:        response.msg = "Drives did not acknowledge the set-point"; break;
+        case PP_DRIVES_DISABLED:    response.msg = "Drives left Operation Enabled"; break;
+        case PP_HALT_TIMEOUT:       response.msg = "Drives did not stop on the halt, quick stopped"; break;
+    }
+    response.success = (pp_result_ == PP_REACHED);
+
+    if (response.success)
+        RCLCPP_INFO(this->get_logger(), "Profile move: %s in %.0f ms", response.msg.c_str(), response.duration_ms);
     else
+        RCLCPP_ERROR(this->get_logger(), "Profile move failed: %s", response.msg.c_str());
+
+    // The trajectory controller still commands where the arm was before the move
+    publish_resync_(pp_hold_);
+
+    if (pp_header_)
     {
-        return false;
+        profile_move_srv_->send_response(*pp_header_, response);
+        pp_header_.reset();
     }
 }
 
 
 /**
- * @brief Updates joint commands via arm command topic.
+ * @brief Sends the trajectory controller a trajectory holding the given position, so its
+ * commands agree with the arm again after the RT loop took over the targets.
  * 
- * @param arm_cmd arm command JointState message 
+ * @param position Encoder counts
  */
-void ZeroErrInterface::arm_cmd_cb_(sensor_msgs::msg::JointState::UniquePtr arm_cmd)
+void ZeroErrInterface::publish_resync_(const int32_t position[NUM_JOINTS])
 {
-    // RCLCPP_INFO(this->get_logger(), "arm_cmd_cb fired");
+    if (!pp_resync_pub_)
+        return;
+
+    trajectory_msgs::msg::JointTrajectory hold;
+    hold.joint_names = joint_states_.name;
+    hold.points.resize(1);
+    hold.points[0].time_from_start = rclcpp::Duration::from_seconds(PP_RESYNC_TIME);
+    for (uint i = 0; i < NUM_JOINTS; i++)
+        hold.points[0].positions.push_back(COUNT_TO_RAD((double) position[i]));
+
+    pp_resync_pub_->publish(hold);
+}
+
+
+/**
+ * @brief Reports joint envelope stops handed over by enforce_envelope_(). Once the arm
+ * stands still, the trajectory controller is sent the held position; the RT loop resumes
+ * following arm/command when it arrives there.
+ * 
+ * @note Frequency is controlled through ENVELOPE_POLL_PERIOD member.
+ * 
+ */
+void ZeroErrInterface::envelope_poll_()
+{
+    uint32_t stop_seq = envelope_stop_seq_.load(std::memory_order_acquire);
+    if (stop_seq != envelope_stop_seen_)
+    {
+        envelope_stop_seen_ = stop_seq;
+
+        std::string kinds;
+        for (int k = 0; k < JointEnvelope::KINDS; k++)
+        {
+            if (envelope_stop_kinds_ & (1u << k))
+                kinds += (kinds.empty() ? "" : ", ") + std::string(ENVELOPE_KINDS[k]);
+        }
+        RCLCPP_ERROR(this->get_logger(), "Joint envelope stop (%s limit), holding until arm/command returns to the stop position",
+            kinds.c_str());
+
+        publish_resync_(envelope_hold_);
+    }
 
-    for (uint i = 0; i < arm_cmd->position.size(); i++) {
-        joint_commands_[i] = RAD_TO_COUNT( arm_cmd->position[i] );
+    uint32_t resume_seq = envelope_resume_seq_.load(std::memory_order_acquire);
+    if (resume_seq != envelope_resume_seen_)
+    {
+        envelope_resume_seen_ = resume_seq;
+        RCLCPP_INFO(this->get_logger(), "Joint envelope: arm/command resynced, following again");
     }
 }
 
-rclcpp::CallbackGroup::SharedPtr ZeroErrInterface::get_high_prio_callback_group()
+
+/**
+ * @brief Detects the first encoder motion caused by a new command after the arm has been
+ * at rest, for end-to-end teleop latency probes.
+ * 
+ * Arms once joint commands have been unchanged for ONSET_IDLE_CYCLES, then records the
+ * cycle the first new command is latched into the RxPDOs and the cycle any joint moves
+ * more than latency_probe.onset_threshold from its rest position. The pair is handed to
+ * publish_motion_onset_() on the normal priority thread.
+ * 
+ * @note Called from the cyclic PDO loop, allocation-free and non-blocking.
+ * 
+ */
+void ZeroErrInterface::detect_motion_onset_()
 {
-    high_prio_cbg_ = get_node_base_interface()->get_default_callback_group();
-    return high_prio_cbg_;  // the default callback group.
+    bool cmd_changed = false;
+    for (uint i = 0; i < NUM_JOINTS; i++)
+    {
+        if (joint_commands_[i] != onset_last_cmd_[i])
+        {
+            onset_last_cmd_[i] = joint_commands_[i];
+            cmd_changed = true;
+        }
+    }
+
+    if (!onset_armed_)
+    {
+        if (cmd_changed)
+            onset_idle_cycles_ = 0;
+        else if (++onset_idle_cycles_ >= ONSET_IDLE_CYCLES)
+        {
+            for (uint i = 0; i < NUM_JOINTS; i++)
+                onset_rest_counts_[i] = pdo_in_[i].actual_pos;
+
+            onset_latch_ns_ = 0;
+            onset_armed_ = true;
+        }
+        return;
+    }
+
+    struct timespec now;
+
+    if (cmd_changed && onset_latch_ns_ == 0)
+    {
+        clock_gettime(CLOCK_REALTIME, &now);
+        onset_latch_ns_ = TIMESPEC2NS(now);
+    }
+
+    for (uint i = 0; i < NUM_JOINTS; i++)
+    {
+        int32_t delta = pdo_in_[i].actual_pos - onset_rest_counts_[i];
+        if (std::abs(delta) <= cfg_->onset_threshold)
+            continue;
+
+        // Drift without a new command, take it as the new rest position
+        if (onset_latch_ns_ == 0)
+        {
+            onset_rest_counts_[i] += delta;
+            continue;
+        }
+
+        clock_gettime(CLOCK_REALTIME, &now);
+        int64_t onset_ns = TIMESPEC2NS(now);
+        cmd_onset_latency_.add(onset_ns - onset_latch_ns_);
+
+        onset_stamp_ns_.store(onset_ns, std::memory_order_relaxed);
+        onset_cmd_latch_ns_.store(onset_latch_ns_, std::memory_order_relaxed);
+        onset_joint_.store(i, std::memory_order_relaxed);
+        onset_seq_.fetch_add(1, std::memory_order_release);
+
+        onset_armed_ = false;
+        onset_idle_cycles_ = 0;
+        return;
+    }
 }
 
-rclcpp::CallbackGroup::SharedPtr ZeroErrInterface::get_normal_prio_callback_group()
+
+/**
+ * @brief Publishes the latest motion onset on arm/motion_onset, header stamp is the onset
+ * cycle and time_ref the cycle the causing command was latched.
+ * 
+ */
+void ZeroErrInterface::publish_motion_onset_()
 {
-    return normal_prio_cbg_;
+    uint32_t seq = onset_seq_.load(std::memory_order_acquire);
+    if (seq == onset_published_seq_) return;
+    onset_published_seq_ = seq;
+
+    sensor_msgs::msg::TimeReference onset;
+    onset.header.stamp = rclcpp::Time(onset_stamp_ns_.load(std::memory_order_relaxed));
+    onset.time_ref = rclcpp::Time(onset_cmd_latch_ns_.load(std::memory_order_relaxed));
+    onset.source = "j" + std::to_string(onset_joint_.load(std::memory_order_relaxed) + 1);
+
+    motion_onset_pub_->publish(onset);
 }
 
 
-int main(int argc, char **argv)
+/**
+ * @brief Joint state publisher callback.
+ * 
+ * @note Frequency is controlled through JOINT_STATE_PERIOD member.
+ * 
+ */
+void ZeroErrInterface::joint_state_pub_()
 {
-    rclcpp::init(argc, argv);
+    joint_states_.header.stamp = this->now();
 
-    rclcpp::executors::SingleThreadedExecutor high_prio_exec_;
-    rclcpp::executors::SingleThreadedExecutor normal_prio_exec_;
+    for (uint i = 0; i < NUM_JOINTS; i++)
+    {
+        joint_states_.position[i] = COUNT_TO_RAD(joint_states_enc_counts_[i].load(std::memory_order_relaxed));
+    }
 
-    auto node = std::make_shared<ZeroErrInterface>();
+    arm_state_pub_->publish(joint_states_);
 
-    high_prio_exec_.add_callback_group(
-        node->get_high_prio_callback_group(), node->get_node_base_interface()
-    );
+    const double scale = std::round(1000.0 * speed_override_.scale()) / 10.0;
+    if (scale != override_published_)
+    {
+        std_msgs::msg::Float64 msg;
+        msg.data = scale;
+        speed_override_scale_pub_->publish(msg);
+        override_published_ = scale;
+    }
 
-    normal_prio_exec_.add_callback_group(
-        node->get_normal_prio_callback_group(), node->get_node_base_interface()
-    );
+    if (latency_probe_)
+        publish_motion_onset_();
+}
 
-    // Create a thread for each of the two executors ...
-    auto high_prio_thread = std::thread(
-        [&]() {
 
-            //* Set thread priority
-            if (!realtime_tools::configure_sched_fifo(sched_get_priority_max(SCHED_FIFO) - 19))
-                RCLCPP_WARN(node->get_logger(), "Couldnt enable FIFO RT Scheduling!");
-            
-            cpu_set_t mask;
-            int ret;
-            CPU_ZERO(&mask);
-            CPU_SET(0, &mask);
-            ret = sched_setaffinity(0, sizeof(mask), &mask);
+/**
+ * @brief Outputs state of EtherCAT master.
+ * 
+ */
+void ZeroErrInterface::check_master_state_()
+{
+    ec_master_state_t ms;
+
+    ecrt_master_state(master, &ms);
+
+    if (ms.slaves_responding != master_state.slaves_responding)
+        RCLCPP_INFO(this->get_logger(), "%u slave(s).\n", ms.slaves_responding);
+    if (ms.al_states != master_state.al_states)
+        RCLCPP_INFO(this->get_logger(), "AL states: 0x%02X.\n", ms.al_states);
+    if (ms.link_up != master_state.link_up)
+        RCLCPP_INFO(this->get_logger(), "Link is %s.\n", ms.link_up ? "up" : "down");
+
+    master_state = ms;
+}
+
+
+/**
+ * @brief Outputs process data domain state.
+ * 
+ */
+void ZeroErrInterface::check_domain_state_()
+{
+    ec_domain_state_t ds;
+
+    ecrt_domain_state(domain, &ds);
+
+    if (ds.working_counter != domain_state.working_counter)
+        RCLCPP_INFO(this->get_logger(), "Domain: WC %u.\n", ds.working_counter);
+    if (ds.wc_state != domain_state.wc_state)
+        RCLCPP_INFO(this->get_logger(), "Domain: State %u.\n", ds.wc_state);
+
+    domain_state = ds;
+}
+
+
+/**
+ * @brief Check the EtherCAT slave state of each joint sequentially.
+ * 
+ * @return true when all joints reach OP state,
+ * @return false when joints havent reached OP state yet
+ */
+bool ZeroErrInterface::check_slave_config_states_()
+{
+    ec_slave_config_state_t s;
+
+    ecrt_slave_config_state(joint_slave_configs[joint_no_], &s);
+    
+    // if (s.al_state != joint_ec_states[joint_no_].al_state)
+    //     RCLCPP_INFO(this->get_logger(), "J%d: State 0x%02X.\n", joint_no_, s.al_state);
+    // if (s.online != joint_ec_states[joint_no_].online)
+    //     RCLCPP_INFO(this->get_logger(), "J%d: %s.\n", joint_no_, s.online ? "online" : "offline");
+    if (s.operational != joint_ec_states[joint_no_].operational)
+        RCLCPP_INFO(this->get_logger(), "J%d: %soperational.", joint_no_, 
+            s.operational ? "" : "Not ");    
+
+    joint_ec_states[joint_no_] = s;
+
+
+    // Current joint is operational -- check next joint
+    if (joint_ec_states[joint_no_].operational)
+        joint_no_++; 
+
+
+    if (joint_no_ == 6) // All joints operational
+    {
+        // Reset joint tracker
+        joint_no_ = 0;
+        return true;
+    }
+    else
+    {
+        return false;
+    }
+}
+
+
+/**
+ * @brief Updates joint commands via arm command topic.
+ * 
+ * @param arm_cmd arm command JointState message 
+ */
+void ZeroErrInterface::arm_cmd_cb_(sensor_msgs::msg::JointState::UniquePtr arm_cmd)
+{
+    // RCLCPP_INFO(this->get_logger(), "arm_cmd_cb fired");
+
+    if (arm_cmd->position.size() < NUM_JOINTS)
+        return;
+
+    int32_t counts[NUM_JOINTS];
+    for (uint i = 0; i < NUM_JOINTS; i++) {
+        counts[i] = RAD_TO_COUNT( arm_cmd->position[i] );
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    int64_t now_ns = TIMESPEC2NS(now);
+    int64_t stamp_ns = rclcpp::Time(arm_cmd->header.stamp).nanoseconds();
+
+    if (now_ns > stamp_ns) cmd_transport_latency_.add(now_ns - stamp_ns);
+
+    // Time the stream last moved the arm, profile moves start only while it is still
+    if (!std::equal(counts, counts + NUM_JOINTS, last_cmd_counts_))
+    {
+        std::copy(counts, counts + NUM_JOINTS, last_cmd_counts_);
+        last_cmd_change_ns_ = now_ns;
+    }
+
+    // Dropped during a profile move or after a full speed override backlog, and afterwards
+    // until the stream agrees with the held position: a stale command would pull the arm back
+    if (cmd_gated_)
+    {
+        if (pp_waiting_)
+        {
+            RCLCPP_WARN_THROTTLE(this->get_logger(), *this->get_clock(), 2000,
+                "arm/command ignored, waiting for the drives to finish the profile move");
+            return;
+        }
 
-            if (ret != 0){
-                RCLCPP_WARN(node->get_logger(), "Couldn't assign to core 0");
+        for (uint i = 0; i < NUM_JOINTS; i++)
+        {
+            if (std::abs(counts[i] - pp_hold_[i]) > PP_RESYNC_TOLERANCE)
+            {
+                RCLCPP_WARN_THROTTLE(this->get_logger(), *this->get_clock(), 2000,
+                    "arm/command is %.4f rad from the held position on j%d, ignored until it resyncs",
+                    COUNT_TO_RAD((double) (counts[i] - pp_hold_[i])), i + 1);
+                return;
             }
-            
-            high_prio_exec_.spin();
-            
-        });
+        }
 
-    auto low_prio_thread = std::thread(
-        [&]() {
-            normal_prio_exec_.spin();
-        });
+        cmd_gated_ = false;
+        RCLCPP_INFO(this->get_logger(), "arm/command resynced");
+    }
 
-    //* Set main thread priority
-    // struct sched_param param = {};
-    // param.sched_priority = sched_get_priority_max(SCHED_FIFO) - 20;
-    // RCLCPP_INFO(node->get_logger(), "Using priority %i.\n", param.sched_priority);
-    // if (sched_setscheduler(0, SCHED_FIFO, &param) == -1) {
-    //     RCLCPP_ERROR(node->get_logger(), "sched_setscheduler failed\n");
-    // }
+    // Queued for the RT loop, which replays it on the speed override clock. The stamp is
+    // the time the command was generated, unstamped commands use the receive time
+    if (!speed_override_.push(stamp_ns ? stamp_ns : now_ns, counts))
+    {
+        // Backlog full, the arm stops on the last queued command. Resynced like after a
+        // profile move: the trajectory controller is sent that position, arm/command is
+        // queued again once the backlog is replayed and the stream agrees with it
+        const int32_t *accepted = speed_override_.last_accepted();
+        const bool new_hold = !std::equal(accepted, accepted + NUM_JOINTS, pp_hold_);
+        std::copy(accepted, accepted + NUM_JOINTS, pp_hold_);
+        cmd_gated_ = true;
+
+        if (new_hold)
+        {
+            RCLCPP_ERROR(this->get_logger(), "Speed override backlog full (%.2fs behind), arm/command stopped until it resyncs",
+                1e-9 * speed_override_.lag_ns());
+            publish_resync_(pp_hold_);
+        }
+        return;
+    }
+
+    cmd_recv_ns_.store(now_ns, std::memory_order_relaxed);
+    cmd_stamp_ns_.store(stamp_ns, std::memory_order_release);
+}
+
+
+/**
+ * @brief Logs min/mean/max of one latency stage and resets it.
+ * 
+ * @param stage Stage name
+ * @param stats Stage accumulator
+ */
+void ZeroErrInterface::report_stage_(const char *stage, LatencyStats &stats)
+{
+    uint64_t count = stats.count.exchange(0, std::memory_order_relaxed);
+    uint64_t sum_ns = stats.sum_ns.exchange(0, std::memory_order_relaxed);
+    uint64_t max_ns = stats.max_ns.exchange(0, std::memory_order_relaxed);
+    uint64_t min_ns = stats.min_ns.exchange(UINT64_MAX, std::memory_order_relaxed);
+
+    if (count == 0) return;
+
+    RCLCPP_INFO(this->get_logger(), "%-22s min %7.1fus  mean %7.1fus  max %7.1fus  (%lu cmds)",
+        stage, min_ns / 1e3, (sum_ns / count) / 1e3, max_ns / 1e3, count);
+}
+
+
+/**
+ * @brief Reports arm/command latency from ArmHardwareInterface::write (header stamp)
+ * until the command is latched into the RxPDOs, split into DDS transport and the wait
+ * for the next cyclic PDO exchange. With latency_probe set, also the time from latching
+ * a command after rest until the first encoder motion.
+ * 
+ * @note Silent while no commands are streamed. Frequency is controlled through
+ * LATENCY_REPORT_PERIOD member.
+ * 
+ */
+void ZeroErrInterface::latency_report_()
+{
+    report_stage_("arm/command transport", cmd_transport_latency_);
+    report_stage_("PDO latch wait", cmd_latch_latency_);
+    report_stage_("write -> PDO latch", cmd_total_latency_);
+    report_stage_("PDO latch -> onset", cmd_onset_latency_);
+
+    // Worst case of every RT task, a warning once together they take half the cycle
+    uint64_t total_ns = 0;
+    std::string tasks;
+    for (size_t k = 0; k < scheduler_.size(); k++)
+    {
+        uint64_t max_ns = scheduler_.take_max_ns(k);
+        total_ns += max_ns;
+
+        char task[64];
+        snprintf(task, sizeof(task), " %s %.1fus", scheduler_.name(k), max_ns / 1e3);
+        tasks += task;
+    }
+    if (total_ns > PERIOD_NS / 2)
+        RCLCPP_WARN(this->get_logger(), "RT tasks max:%s", tasks.c_str());
+    else
+        RCLCPP_DEBUG(this->get_logger(), "RT tasks max:%s", tasks.c_str());
 
-    // rclcpp::spin(node);
+    uint64_t overflows = speed_override_.overflows();
+    if (overflows != override_overflows_)
+    {
+        RCLCPP_WARN(this->get_logger(), "Speed override backlog full, %lu commands rejected",
+            overflows - override_overflows_);
+        override_overflows_ = overflows;
+    }
 
-    while (rclcpp::ok());
+    // Free RT config versions the RT thread has moved past since the last update
+    config_.reclaim();
+}
 
-    rclcpp::shutdown();
+rclcpp::CallbackGroup::SharedPtr ZeroErrInterface::get_high_prio_callback_group()
+{
+    return high_prio_cbg_;
+}
 
-    return 0;
+rclcpp::CallbackGroup::SharedPtr ZeroErrInterface::get_normal_prio_callback_group()
+{
+    return normal_prio_cbg_;
 }
+
+
+// Standalone executable generated by rclcpp_components_register_node (see CMakeLists.txt)
+RCLCPP_COMPONENTS_REGISTER_NODE(ZeroErrInterface)
@@ -0,0 +1,129 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "arm_ethercat_interface/joint_envelope.h"
+
+
+namespace
+{
+
+// Same position on all joints
+struct Command
+{
+    int32_t counts[NUM_JOINTS];
+
+    explicit Command(int32_t count) { std::fill(counts, counts + NUM_JOINTS, count); }
+};
+
+JointEnvelope::Limits limits(EnvelopeReaction reaction)
+{
+    JointEnvelope::Limits limits;
+    std::fill(limits.pos_min, limits.pos_min + NUM_JOINTS, -100000.0);
+    std::fill(limits.pos_max, limits.pos_max + NUM_JOINTS, 100000.0);
+    std::fill(limits.vel, limits.vel + NUM_JOINTS, 100.0);
+    std::fill(limits.acc, limits.acc + NUM_JOINTS, 5.0);
+    std::fill(limits.reaction, limits.reaction + JointEnvelope::KINDS, reaction);
+    return limits;
+}
+
+}  // namespace
+
+
+TEST(JointEnvelope, PassesCommandsInsideTheLimits)
+{
+    JointEnvelope envelope;
+    const JointEnvelope::Limits l = limits(EnvelopeReaction::STOP);
+    envelope.reset(Command(0).counts);
+
+    // Ramp up at 1 count/cycle^2 to 50 counts/cycle
+    int32_t position = 0;
+    for (int32_t v = 1; v <= 50; v++)
+    {
+        position += v;
+        Command target(position);
+        ASSERT_EQ(envelope.apply(l, target.counts), 0u);
+        ASSERT_EQ(target.counts[0], position);
+    }
+    EXPECT_EQ(envelope.state(), JointEnvelope::TRACKING);
+}
+
+
+TEST(JointEnvelope, ClampsVelocityAndPosition)
+{
+    JointEnvelope envelope;
+    JointEnvelope::Limits l = limits(EnvelopeReaction::CLAMP);
+    l.acc[0] = 1e9;
+    envelope.reset(Command(0).counts);
+
+    // A jump is written at most vel per cycle
+    Command target(1000);
+    EXPECT_TRUE(envelope.apply(l, target.counts) & (1u << JointEnvelope::VELOCITY));
+    EXPECT_EQ(target.counts[0], 100);
+
+    // Beyond the position limit the target stays at the limit
+    for (int i = 0; i < 2000; i++)
+    {
+        Command beyond(200000);
+        envelope.apply(l, beyond.counts);
+        target = beyond;
+    }
+    EXPECT_EQ(target.counts[0], 100000);
+}
+
+
+TEST(JointEnvelope, StopsOnThePathAndResyncs)
+{
+    JointEnvelope envelope;
+    const JointEnvelope::Limits l = limits(EnvelopeReaction::STOP);
+    envelope.reset(Command(0).counts);
+
+    // Cruise at 40 counts/cycle
+    int32_t position = 0;
+    for (int32_t v = 1; v <= 40; v++)
+    {
+        position += v;
+        Command target(position);
+        envelope.apply(l, target.counts);
+    }
+    int32_t last = 0;
+    for (int i = 0; i < 20; i++)
+    {
+        position += 40;
+        Command target(position);
+        ASSERT_EQ(envelope.apply(l, target.counts), 0u);
+        last = target.counts[0];
+    }
+
+    // A jump triggers the stop, the targets then decelerate at no more than acc
+    position += 5000;
+    Command jump(position);
+    EXPECT_TRUE(envelope.apply(l, jump.counts) & (1u << JointEnvelope::VELOCITY));
+    EXPECT_EQ(envelope.state(), JointEnvelope::STOPPING);
+
+    int32_t last_v = jump.counts[0] - last;
+    ASSERT_EQ(last_v, 35);
+    last = jump.counts[0];
+    while (envelope.state() == JointEnvelope::STOPPING)
+    {
+        Command target(position);
+        envelope.apply(l, target.counts);
+        const int32_t v = target.counts[0] - last;
+        ASSERT_GE(v, 0);
+        ASSERT_LE(std::abs(v - last_v), 5);
+        last_v = v;
+        last = target.counts[0];
+    }
+    EXPECT_EQ(envelope.state(), JointEnvelope::STOPPED);
+
+    // Held until the commands come back to the held position
+    Command away(position);
+    envelope.apply(l, away.counts);
+    EXPECT_EQ(away.counts[0], last);
+    EXPECT_EQ(envelope.state(), JointEnvelope::STOPPED);
+
+    Command back(last);
+    envelope.apply(l, back.counts);
+    EXPECT_EQ(envelope.state(), JointEnvelope::TRACKING);
+}
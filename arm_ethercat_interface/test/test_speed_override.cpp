@@ -0,0 +1,166 @@
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <memory>
+
+#include "arm_ethercat_interface/speed_override.h"
+
+
+namespace
+{
+
+constexpr double DT = 1e-3;
+constexpr int64_t DT_NS = 1000000;
+
+// Command with all joints at the given count
+struct Command
+{
+    int32_t counts[NUM_JOINTS];
+
+    explicit Command(int32_t count) { std::fill(counts, counts + NUM_JOINTS, count); }
+};
+
+bool push(SpeedOverride &speed_override, int64_t step, int32_t count)
+{
+    return speed_override.push(step * DT_NS, Command(count).counts);
+}
+
+int32_t update(SpeedOverride &speed_override)
+{
+    int32_t out[NUM_JOINTS] = {};
+    speed_override.update(DT, out);
+    return out[0];
+}
+
+}  // namespace
+
+
+TEST(SpeedOverride, PassesThroughAtFullSpeed)
+{
+    auto speed_override = std::make_unique<SpeedOverride>();
+    speed_override->reset(Command(0).counts);
+
+    // Several times around the ring
+    for (int64_t step = 0; step < 3 * (int64_t) SpeedOverride::RING_SIZE; step++)
+    {
+        ASSERT_TRUE(push(*speed_override, step, (int32_t) step));
+        ASSERT_EQ(update(*speed_override), step);
+    }
+    EXPECT_EQ(speed_override->lag_ns(), 0);
+    EXPECT_EQ(speed_override->overflows(), 0u);
+}
+
+
+TEST(SpeedOverride, ResetDropsTheProducerState)
+{
+    auto speed_override = std::make_unique<SpeedOverride>();
+    speed_override->reset(Command(0).counts);
+
+    // A move to 1000, then holding still (consecutive repeats are not queued)
+    for (int64_t step = 0; step <= 1000; step++)
+    {
+        push(*speed_override, step, (int32_t) step);
+        update(*speed_override);
+    }
+    for (int64_t step = 1001; step < 1100; step++)
+        push(*speed_override, step, 1000);
+
+    // Queued before the reset, never replayed
+    push(*speed_override, 1100, 1200);
+    speed_override->reset(Command(-500).counts);
+    EXPECT_EQ(update(*speed_override), -500);
+
+    // The stream restarts at the reset position, the old hold must not be queued again
+    for (int64_t step = 1101; step < 1200; step++)
+    {
+        push(*speed_override, step, -500 + (int32_t) (step - 1101));
+        int32_t out = update(*speed_override);
+        ASSERT_GE(out, -500);
+        ASSERT_LT(out, 0);
+    }
+}
+
+
+TEST(SpeedOverride, CatchesUpAfterASlowPhase)
+{
+    for (double max_catchup : { 1.0, 1.2 })
+    {
+        auto speed_override = std::make_unique<SpeedOverride>();
+        speed_override->reset(Command(0).counts);
+        speed_override->set_max_catchup(max_catchup);
+
+        // 1s at 50%, then 100% while the stream goes on for 10s
+        int64_t step = 0;
+        speed_override->set_target(0.5);
+        for (; step < 1000; step++)
+        {
+            push(*speed_override, step, (int32_t) step);
+            update(*speed_override);
+        }
+        EXPECT_GT(speed_override->lag_ns(), 400 * DT_NS);
+
+        speed_override->set_target(1.0);
+        int32_t last = update(*speed_override);
+        for (; step < 11000; step++)
+        {
+            push(*speed_override, step, (int32_t) step);
+            int32_t out = update(*speed_override);
+
+            // Never faster than max_catchup (and the sample spacing)
+            ASSERT_LE(out - last, (int32_t) std::ceil(max_catchup) + 1);
+            last = out;
+        }
+
+        if (max_catchup > 1.0)
+            EXPECT_LE(speed_override->lag_ns(), 2 * DT_NS);
+        else
+            EXPECT_GT(speed_override->lag_ns(), 400 * DT_NS);
+    }
+}
+
+
+TEST(SpeedOverride, FullBacklogFaultsTheStream)
+{
+    auto speed_override = std::make_unique<SpeedOverride>();
+    speed_override->reset(Command(0).counts);
+
+    // Feed hold while the stream goes on past the ring size
+    speed_override->set_target(0.0);
+    int64_t step = 0;
+    int64_t rejected = -1;
+    for (; step < 2 * (int64_t) SpeedOverride::RING_SIZE; step++)
+    {
+        if (!push(*speed_override, step, (int32_t) step) && rejected < 0)
+            rejected = step;
+        update(*speed_override);
+    }
+    ASSERT_GT(rejected, 0);
+    EXPECT_GT(speed_override->overflows(), 0u);
+
+    // Everything after the first rejected command is rejected too
+    const int32_t accepted = speed_override->last_accepted()[0];
+    EXPECT_EQ(accepted, rejected - 1);
+
+    // Resumed: the queued commands are replayed without a gap, up to the last accepted one
+    speed_override->set_target(1.0);
+    int32_t last = update(*speed_override);
+    for (int i = 0; i < 2 * (int) SpeedOverride::RING_SIZE; i++, step++)
+    {
+        bool queued = push(*speed_override, step, (int32_t) step);
+        int32_t out = update(*speed_override);
+
+        if (!queued)
+        {
+            ASSERT_LE(out - last, 2);
+            ASSERT_LE(out, accepted);
+        }
+        else
+        {
+            // Replayed, the stream is accepted again
+            EXPECT_EQ(last, accepted);
+            break;
+        }
+        last = out;
+    }
+    EXPECT_EQ(speed_override->last_accepted()[0], step);
+}
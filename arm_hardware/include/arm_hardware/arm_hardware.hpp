@@ -6,6 +6,7 @@
 #ifndef __ARM_HARDWARE_H__
 #define __ARM_HARDWARE_H__
 
+#include <chrono>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -21,10 +22,13 @@
 #include <rclcpp/publisher.hpp>
 #include <rclcpp/subscription.hpp>
 
+#include <diagnostic_msgs/msg/diagnostic_array.hpp>
 #include <sensor_msgs/msg/joint_state.hpp>
 #include <std_msgs/msg/bool.hpp>
 #include <std_srvs/srv/set_bool.hpp>
 
+#include "cycle_timing.hpp"
+
 namespace arm_hardware
 {
 
@@ -120,6 +124,27 @@ namespace arm_hardware
                     return default_value; // return default_value as topic
             }
 
+            /**
+             * @brief Sends the joint commands on arm/command once they are valid, the body
+             * of write() without the timing.
+             * 
+             * @return true if arm_commands was published
+             */
+            bool publish_commands_();
+
+            /**
+             * @brief Publishes the cycle timing histograms since the last report on the
+             * diagnostics topic, then starts a new window.
+             * 
+             */
+            void timing_report_();
+
+            inline void record_timing_(CycleTiming::Metric metric, int64_t ns)
+            {
+                timing_.histograms[metric].add(ns);
+                timing_state_[metric] = ns * 1e-9;
+            }
+
             void switchControlMode(
                 const std::shared_ptr<std_srvs::srv::SetBool::Request> request,
                 std::shared_ptr<std_srvs::srv::SetBool::Response> response);
@@ -132,7 +157,6 @@ namespace arm_hardware
             rclcpp::Subscription<std_msgs::msg::Bool>::SharedPtr restart_pos_sub_;
             rclcpp::Publisher<sensor_msgs::msg::JointState>::SharedPtr joint_commands_pub_;
             rclcpp::Service<std_srvs::srv::SetBool>::SharedPtr sw_hw_ctrl_mode_srv_;
-            rclcpp::Client<std_srvs::srv::SetBool>::SharedPtr pause_servo_cli_;
 
             sensor_msgs::msg::JointState latest_arm_state_;
 
@@ -147,6 +171,22 @@ namespace arm_hardware
 
             static const uint NUM_JOINTS = 6;
 
+            //* Cycle timing (controller manager thread only)
+            using SteadyClock = std::chrono::steady_clock;
+
+            rclcpp::Publisher<diagnostic_msgs::msg::DiagnosticArray>::SharedPtr diagnostics_pub_;
+            CycleTiming timing_;
+            // Latest sample per metric [s] and total overruns, exported as the state
+            // interfaces of the `timing` gpio
+            double timing_state_[CycleTiming::METRICS + 1] = {};
+            int64_t cycle_budget_ns_ = 1333333;  // 1 / update_rate
+            SteadyClock::time_point read_start_;
+            SteadyClock::time_point report_start_;
+            bool cycle_started_ = false;
+            // arm/state stamp of the positions read this cycle, 0 before the first state
+            int64_t state_stamp_ns_ = 0;
+            const std::chrono::seconds TIMING_REPORT_PERIOD{1};
+
             const double PI = 3.141592654;
             const double COUNT_THRESHOLD = 0.001198422; // 100 enc counts to rad
 
@@ -161,7 +201,6 @@ namespace arm_hardware
             /// Flag indicating start pose was stored
             bool start_pose_recv_ = false;
 
-            bool servo_paused_ = false;
             bool servo_init_ = false;
 
             /**
@@ -0,0 +1,117 @@
+#ifndef __ARM_SIM_HARDWARE_H__
+#define __ARM_SIM_HARDWARE_H__
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "hardware_interface/handle.hpp"
+#include "hardware_interface/hardware_info.hpp"
+#include "hardware_interface/system_interface.hpp"
+#include "hardware_interface/types/hardware_interface_return_values.hpp"
+#include "hardware_interface/types/hardware_interface_type_values.hpp"
+
+#include <rclcpp/rclcpp.hpp>
+#include <rosgraph_msgs/msg/clock.hpp>
+
+namespace arm_hardware
+{
+
+    using CallbackReturn = rclcpp_lifecycle::node_interfaces::LifecycleNodeInterface::CallbackReturn;
+
+    /**
+     * @brief Simulated arm with the dynamics of the eRob drives in CSP mode, for evaluating
+     * tracking and cycle times without the arm.
+     *
+     * Every cycle the position commands go through
+     *   delay          transport delay (controller -> EtherCAT -> drive), whole cycles
+     *   position loop  first order with the given bandwidth, optional velocity feed-forward
+     *   saturation     joint velocity and acceleration limits of the drives
+     *   encoder        positions reported at MAX_COUNT (2^19 counts/rev) resolution
+     * integrated with `substeps` steps per cycle. The step is the fixed cycle time 1/update_rate,
+     * so results do not depend on the host's timing.
+     *
+     * With publish_clock the simulated time is published on /clock, one cycle per write(). A
+     * controller manager with use_sim_time runs in lockstep with it, as fast as the host allows
+     * or paced to real_time_factor, so whole task sequences can be run faster than real time.
+     *
+     * Hardware parameters (ros2_control URDF):
+     *   update_rate           [Hz] controller_manager update rate
+     *   bandwidth             [Hz] position loop bandwidth
+     *   velocity_feedforward  share of the command velocity fed forward (0..1)
+     *   delay                 [s] transport delay, rounded to whole cycles
+     *   substeps              integration steps per cycle
+     *   max_velocity          [rad/s] comma separated, in joint order
+     *   max_acceleration      [rad/s^2] comma separated, in joint order
+     *   publish_clock         publish the simulated time on /clock
+     *   real_time_factor      simulated / wall time, 0 for as fast as possible
+     *
+     */
+    class ArmSimHardwareInterface : public hardware_interface::SystemInterface
+    {
+        public:
+            CallbackReturn on_init(const hardware_interface::HardwareInfo &info) override;
+
+            std::vector<hardware_interface::StateInterface> export_state_interfaces() override;
+
+            std::vector<hardware_interface::CommandInterface> export_command_interfaces() override;
+
+            /**
+             * @brief Commands start at the simulated positions, the arm does not move.
+             *
+             */
+            hardware_interface::CallbackReturn on_activate(const rclcpp_lifecycle::State &previous_state) override;
+
+            hardware_interface::return_type read(const rclcpp::Time &time, const rclcpp::Duration &period) override;
+
+            /**
+             * @brief Advances the drives by one cycle, then the simulated time.
+             *
+             */
+            hardware_interface::return_type write(const rclcpp::Time &time, const rclcpp::Duration &period) override;
+
+
+        private:
+            static constexpr double TWO_PI = 6.283185307179586;
+            static constexpr double MAX_COUNT = 524288.0;
+
+            std::string get_param_(const std::string &name, const std::string &default_value) const;
+            std::vector<double> get_list_param_(const std::string &name, const std::vector<double> &default_value) const;
+
+            size_t joints_ = 0;
+
+            double cycle_ = 1.0 / 750.0;
+            double omega_ = 0.0;    // [rad/s] position loop bandwidth
+            double feedforward_ = 0.0;
+            int substeps_ = 4;
+            std::vector<double> max_velocity_;
+            std::vector<double> max_acceleration_;
+
+            // Interfaces
+            std::vector<double> position_command_;
+            std::vector<double> position_state_;
+            std::vector<double> velocity_state_;
+
+            // Drive model
+            std::vector<double> position_;
+            std::vector<double> velocity_;
+            std::vector<double> last_target_;
+
+            // Delay line, delay_cycles_ + 1 commands per joint, preallocated
+            size_t delay_cycles_ = 0;
+            std::vector<double> delay_line_;
+            size_t delay_head_ = 0;
+
+            // Simulated time
+            rclcpp::Node::SharedPtr sim_node_;
+            rclcpp::Publisher<rosgraph_msgs::msg::Clock>::SharedPtr clock_pub_;
+            bool publish_clock_ = true;
+            double real_time_factor_ = 1.0;
+            int64_t sim_time_ns_ = 0;
+            std::chrono::steady_clock::time_point wall_start_;
+            int64_t sim_start_ns_ = 0;  // sim time at wall_start_
+    };
+
+}
+
+#endif // __ARM_SIM_HARDWARE_H__
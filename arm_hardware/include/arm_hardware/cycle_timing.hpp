@@ -0,0 +1,55 @@
+#ifndef __CYCLE_TIMING_H__
+#define __CYCLE_TIMING_H__
+
+#include <cstdint>
+
+#include "arm_hardware/latency_histogram.hpp"
+
+
+namespace arm_hardware
+{
+
+    /**
+     * @brief Timing of the hardware interface within the controller manager's update cycle.
+     *
+     *   read         read(), including spin_some (arm/state, services)
+     *   write        write(), including the arm/command publish
+     *   update       read() start to write() end, i.e. plugin and controllers
+     *   period       read() start to the next read() start
+     *   state_age    arm/state stamp to read(), age of the positions the controllers get
+     *   command_age  arm/state stamp to the arm/command publish, age of the positions a
+     *                command was computed from when it leaves the plugin
+     *
+     * The controllers' share of a cycle is update - read - write.
+     *
+     */
+    struct CycleTiming
+    {
+        enum Metric { READ, WRITE, UPDATE, PERIOD, STATE_AGE, COMMAND_AGE, METRICS };
+
+        static constexpr const char *NAMES[METRICS] = {
+            "read", "write", "update", "period", "state_age", "command_age"
+        };
+
+        // Durations in 5us bins up to 2ms, ages (arm/state is published at 100Hz) in 100us
+        // bins up to 50ms
+        LatencyHistogram histograms[METRICS] = {
+            { 5000, 400 }, { 5000, 400 }, { 5000, 400 }, { 5000, 400 },
+            { 100000, 500 }, { 100000, 500 }
+        };
+
+        // Cycles where update exceeded the cycle time, since the last reset / in total
+        uint64_t overruns = 0;
+        uint64_t total_overruns = 0;
+
+        void reset()
+        {
+            for (LatencyHistogram &h : histograms)
+                h.reset();
+            overruns = 0;
+        }
+    };
+
+}
+
+#endif // __CYCLE_TIMING_H__
@@ -0,0 +1,122 @@
+#ifndef __LATENCY_HISTOGRAM_H__
+#define __LATENCY_HISTOGRAM_H__
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+
+namespace arm_hardware
+{
+
+    /**
+     * @brief Fixed bin histogram of durations [ns], values past the last bin land in the
+     * last bin (the max is kept exactly).
+     *
+     * Used for the hardware interface's cycle timing and by arm_servo's teleop_latency.
+     *
+     * @note The bins are allocated by the constructor, add() and reset() do not allocate.
+     *
+     */
+    class LatencyHistogram
+    {
+        public:
+            LatencyHistogram(int64_t bin_ns, size_t num_bins) :
+                bin_ns_(bin_ns), bins_(num_bins, 0)
+            {}
+
+            void add(int64_t ns)
+            {
+                size_t bin = ns <= 0 ? 0 : std::min(bins_.size() - 1, static_cast<size_t>(ns / bin_ns_));
+                bins_[bin]++;
+                count_++;
+                sum_ns_ += std::max<int64_t>(ns, 0);
+                max_ns_ = std::max(max_ns_, ns);
+                last_ns_ = ns;
+            }
+
+            void reset()
+            {
+                std::fill(bins_.begin(), bins_.end(), 0);
+                count_ = 0;
+                sum_ns_ = 0;
+                max_ns_ = 0;
+            }
+
+            uint64_t count() const { return count_; }
+            int64_t max() const { return max_ns_; }
+            int64_t last() const { return last_ns_; }
+            int64_t mean() const { return count_ ? static_cast<int64_t>(sum_ns_ / count_) : 0; }
+
+            /**
+             * @brief Upper edge of the bin holding the p-th percentile [ns].
+             *
+             * @param p Percentile [0, 100]
+             */
+            int64_t percentile(double p) const
+            {
+                if (count_ == 0) return 0;
+
+                uint64_t rank = std::max<uint64_t>(static_cast<uint64_t>(std::ceil(p / 100.0 * count_)), 1);
+                uint64_t seen = 0;
+                for (size_t i = 0; i < bins_.size(); i++)
+                {
+                    seen += bins_[i];
+                    if (seen >= rank)
+                        return (i + 1) * bin_ns_;
+                }
+                return bins_.size() * bin_ns_;
+            }
+
+            /**
+             * @brief Text bars of the occupied bin range in ms, merged into at most max_rows rows.
+             *
+             * @note Allocates, not for the control loop.
+             */
+            std::vector<std::string> bars(size_t max_rows = 20, size_t width = 40) const
+            {
+                std::vector<std::string> rows;
+                if (count_ == 0) return rows;
+
+                size_t first = 0, last = bins_.size() - 1;
+                while (bins_[first] == 0) first++;
+                while (bins_[last] == 0) last--;
+
+                size_t merge = (last - first) / max_rows + 1;
+                std::vector<uint64_t> merged;
+                for (size_t i = first; i <= last; i += merge)
+                {
+                    uint64_t sum = 0;
+                    for (size_t j = i; j < std::min(i + merge, last + 1); j++) sum += bins_[j];
+                    merged.push_back(sum);
+                }
+
+                const double bin_ms = bin_ns_ / 1e6;
+                uint64_t peak = *std::max_element(merged.begin(), merged.end());
+                for (size_t k = 0; k < merged.size(); k++)
+                {
+                    char label[48];
+                    snprintf(label, sizeof(label), "%6.1f-%6.1fms %5llu ",
+                        (first + k * merge) * bin_ms, (first + (k + 1) * merge) * bin_ms,
+                        static_cast<unsigned long long>(merged[k]));
+                    rows.push_back(std::string(label) + std::string(merged[k] * width / peak, '#'));
+                }
+                return rows;
+            }
+
+
+        private:
+            int64_t bin_ns_;
+            std::vector<uint64_t> bins_;
+            uint64_t count_ = 0;
+            uint64_t sum_ns_ = 0;
+            int64_t max_ns_ = 0;
+            int64_t last_ns_ = 0;
+    };
+
+}
+
+#endif // __LATENCY_HISTOGRAM_H__
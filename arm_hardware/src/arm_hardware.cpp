@@ -86,6 +86,23 @@ namespace arm_hardware
         );
 
 
+        //* Make cycle timing diagnostics publisher
+        LOG_INFO("[on_init] Making cycle timing diagnostics publisher");
+        diagnostics_pub_ = hw_node_->create_publisher<diagnostic_msgs::msg::DiagnosticArray>(
+            get_hw_topic_param("diagnostics_topic", "/diagnostics"),
+            rclcpp::QoS(10)
+        );
+
+        // Cycle time of the controller manager, an update taking longer is an overrun
+        const double update_rate = std::atof(get_hw_topic_param("update_rate", "750").c_str());
+        if (update_rate <= 0.0)
+        {
+            LOG_ERR("[on_init] update_rate must be a positive rate [Hz]");
+            return CallbackReturn::ERROR;
+        }
+        cycle_budget_ns_ = static_cast<int64_t>(1e9 / update_rate);
+        report_start_ = SteadyClock::now();
+
 
         sw_hw_ctrl_mode_srv_ = hw_node_->create_service<std_srvs::srv::SetBool>(
             "arm_hw_node/toggle_servo_mode",
@@ -102,11 +119,8 @@ namespace arm_hardware
         {
             // LOG_INFO("Servo mode");
             ctrl_mode = SERVO;
-            servo_paused_ = true;
             servo_init_ = true;
             track_start_pose_ = true;
-
-            pause_servo_cli_ = hw_node_->create_client<std_srvs::srv::SetBool>("servo_node/pause_servo");
         }
         else if (strcmp(ctrl_mode_param.c_str(), "plan") == 0)
         {
@@ -129,13 +143,37 @@ namespace arm_hardware
         const std::shared_ptr<std_srvs::srv::SetBool::Request> request,
         std::shared_ptr<std_srvs::srv::SetBool::Response> response)
     {
+        /**
+         * Runs from spin_some in read(), i.e. in the control loop between two cycles. The new
+         * mode starts from the measured joint positions: the next write() sends them as the
+         * command and a controller activated after the switch picks them up from the command
+         * interfaces, so switching does not move the arm.
+         */
+        bool state_valid = true;
+        for (uint i = 0; i < NUM_JOINTS; i++)
+        {
+            if (latest_arm_state_.position[i] == 0.0)
+                state_valid = false;
+        }
+
+        if (state_valid)
+        {
+            for (uint i = 0; i < NUM_JOINTS; i++)
+            {
+                starting_pos_[i] = latest_arm_state_.position[i];
+                arm_position_commands_[i] = latest_arm_state_.position[i];
+            }
+        }
+
         bool servo_mode = request->data;
         if (servo_mode)
         {
             ctrl_mode = SERVO;
 
-            start_pose_recv_ = false;
+            // Without a measured state read() waits for one before servo commands are sent
+            start_pose_recv_ = state_valid;
             track_start_pose_ = true;
+            servo_init_ = true;
 
             response->success = true;
             response->message = "Switched to servo mode";
@@ -182,6 +220,35 @@ namespace arm_hardware
             }
         }
 
+        //* Cycle timing, read-only state interfaces of the `timing` gpio (latest sample [s])
+        for (const auto &gpio : info_.gpios)
+        {
+            if (gpio.name != "timing")
+                continue;
+
+            for (const auto &interface : gpio.state_interfaces)
+            {
+                int metric = -1;
+                for (int m = 0; m < CycleTiming::METRICS; m++)
+                {
+                    if (interface.name == CycleTiming::NAMES[m])
+                        metric = m;
+                }
+                if (interface.name == "overruns")
+                    metric = CycleTiming::METRICS;
+
+                if (metric < 0)
+                {
+                    RCLCPP_WARN(rclcpp::get_logger(LOGGER), "Unknown timing state interface '%s'", interface.name.c_str());
+                    continue;
+                }
+
+                state_interfaces.emplace_back(
+                    hardware_interface::StateInterface(gpio.name, interface.name, &timing_state_[metric])
+                );
+            }
+        }
+
         return state_interfaces;
     }
 
@@ -211,6 +278,13 @@ namespace arm_hardware
 
     hardware_interface::return_type ArmHardwareInterface::read(const rclcpp::Time & /*time*/, const rclcpp::Duration & /*period*/)
     {
+        //* Cycle timing, the last period ends and the update begins here
+        const auto read_start = SteadyClock::now();
+        if (cycle_started_)
+            record_timing_(CycleTiming::PERIOD, std::chrono::nanoseconds(read_start - read_start_).count());
+        read_start_ = read_start;
+        cycle_started_ = true;
+
         uint count = 0;
 
         // Spin node to read and update arm state
@@ -228,6 +302,11 @@ namespace arm_hardware
                 count++;
         }
 
+        // Age of the positions handed to the controllers, stamped by the EtherCAT interface
+        state_stamp_ns_ = rclcpp::Time(latest_arm_state_.header.stamp).nanoseconds();
+        if (state_stamp_ns_ != 0)
+            record_timing_(CycleTiming::STATE_AGE, hw_node_->now().nanoseconds() - state_stamp_ns_);
+
         // Store starting position
         if (track_start_pose_)
         {
@@ -237,35 +316,55 @@ namespace arm_hardware
                     starting_pos_[i] = latest_arm_state_.position[i];
             
 
-                // Signal start pose received
+                // Signal start pose received, servo_node is resumed by the mode manager
                 start_pose_recv_ = true;
 
-                // Resume servo_node
-                auto req = std::make_shared<std_srvs::srv::SetBool::Request>();
-                req->data = false;
+                RCLCPP_INFO(hw_node_->get_logger(), "Reference starting pose updated!");
+            }
+        }
 
-                auto future = pause_servo_cli_->async_send_request(req);
+        record_timing_(CycleTiming::READ, std::chrono::nanoseconds(SteadyClock::now() - read_start).count());
 
-                if (rclcpp::spin_until_future_complete(hw_node_, future) == rclcpp::FutureReturnCode::SUCCESS)
-                {
-                    RCLCPP_INFO(hw_node_->get_logger(), "pause_servo service call response: %s", future.get()->message.c_str());
-                }
-                else
-                {
-                    LOG_ERR("[read] Failed to pause servo_node!");
-                }
+        return hardware_interface::return_type::OK;
+    }
 
 
-                RCLCPP_INFO(hw_node_->get_logger(), "Reference starting pose updated!");
+    hardware_interface::return_type ArmHardwareInterface::write(const rclcpp::Time & /*time*/, const rclcpp::Duration & /*period*/)
+    {
+        const auto write_start = SteadyClock::now();
+
+        if (publish_commands_() && state_stamp_ns_ != 0)
+            record_timing_(CycleTiming::COMMAND_AGE, rclcpp::Time(arm_commands.header.stamp).nanoseconds() - state_stamp_ns_);
+
+        //* Cycle timing, the update ends here
+        const auto write_end = SteadyClock::now();
+        record_timing_(CycleTiming::WRITE, std::chrono::nanoseconds(write_end - write_start).count());
+
+        if (cycle_started_)
+        {
+            const int64_t update_ns = std::chrono::nanoseconds(write_end - read_start_).count();
+            record_timing_(CycleTiming::UPDATE, update_ns);
+
+            if (update_ns > cycle_budget_ns_)
+            {
+                timing_.overruns++;
+                timing_.total_overruns++;
+                timing_state_[CycleTiming::METRICS] = (double) timing_.total_overruns;
             }
         }
 
+        // After the update's timing, so the report's own cost is not attributed to write()
+        if (write_end - report_start_ >= TIMING_REPORT_PERIOD)
+        {
+            timing_report_();
+            report_start_ = write_end;
+        }
 
         return hardware_interface::return_type::OK;
     }
 
 
-    hardware_interface::return_type ArmHardwareInterface::write(const rclcpp::Time & /*time*/, const rclcpp::Duration & /*period*/)
+    bool ArmHardwareInterface::publish_commands_()
     {
         /**
          * The initial joint commands are all 0, i.e. the joint trajectory controller commands
@@ -317,11 +416,11 @@ namespace arm_hardware
             if (count == NUM_JOINTS)
                 commands_ready_ = true;
             else
-                return hardware_interface::return_type::OK;
+                return false;
         }
         else if ((ctrl_mode == SERVO) && !(start_pose_recv_ && servo_init_))
         {
-            return hardware_interface::return_type::OK;
+            return false;
         }
 
         // RCLCPP_INFO(rclcpp::get_logger(LOGGER), "arm_position_commands_: [%f, %f, %f, %f, %f, %f]", 
@@ -347,7 +446,7 @@ namespace arm_hardware
                 if ((ctrl_mode == SERVO) && start_pose_recv_)
                     arm_commands.position[i] = starting_pos_[i];
                 else
-                    return hardware_interface::return_type::OK;
+                    return false;
             }
             else
                 arm_commands.position[i] = arm_position_commands_[i];
@@ -360,10 +459,59 @@ namespace arm_hardware
                 (ctrl_mode == PLAN))
             {
                 joint_commands_pub_->publish(arm_commands);
+                return true;
             }
         }
 
-        return hardware_interface::return_type::OK;
+        return false;
+    }
+
+
+    void ArmHardwareInterface::timing_report_()
+    {
+        /**
+         * One status per window (TIMING_REPORT_PERIOD), durations in us. Runs in write() after
+         * the cycle was timed, an overrun from the report itself shows up as a long period.
+         */
+        if (timing_.histograms[CycleTiming::UPDATE].count() == 0)
+            return;
+
+        diagnostic_msgs::msg::DiagnosticArray report;
+        report.header.stamp = hw_node_->now();
+
+        diagnostic_msgs::msg::DiagnosticStatus status;
+        status.name = "arm_hardware: cycle timing";
+        status.hardware_id = info_.name;
+        status.level = timing_.overruns ? diagnostic_msgs::msg::DiagnosticStatus::WARN : diagnostic_msgs::msg::DiagnosticStatus::OK;
+        status.message = std::to_string(timing_.overruns) + " overruns of " + std::to_string(cycle_budget_ns_ / 1000) + "us";
+
+        auto add_value = [&status](const std::string &key, const std::string &value) {
+            diagnostic_msgs::msg::KeyValue kv;
+            kv.key = key;
+            kv.value = value;
+            status.values.push_back(kv);
+        };
+
+        for (int m = 0; m < CycleTiming::METRICS; m++)
+        {
+            const LatencyHistogram &h = timing_.histograms[m];
+            if (h.count() == 0)
+                continue;
+
+            const std::string name = CycleTiming::NAMES[m];
+            add_value(name + "_mean_us", std::to_string(h.mean() / 1000.0));
+            add_value(name + "_p50_us", std::to_string(h.percentile(50) / 1000.0));
+            add_value(name + "_p99_us", std::to_string(h.percentile(99) / 1000.0));
+            add_value(name + "_max_us", std::to_string(h.max() / 1000.0));
+        }
+        add_value("cycles", std::to_string(timing_.histograms[CycleTiming::UPDATE].count()));
+        add_value("overruns", std::to_string(timing_.overruns));
+        add_value("total_overruns", std::to_string(timing_.total_overruns));
+
+        report.status.push_back(status);
+        diagnostics_pub_->publish(report);
+
+        timing_.reset();
     }
 
 
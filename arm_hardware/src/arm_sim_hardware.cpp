@@ -0,0 +1,261 @@
+#include "../include/arm_hardware/arm_sim_hardware.hpp"
+#include "pluginlib/class_list_macros.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <thread>
+
+#define LOGGER "ArmSimHardwareInterface"
+
+namespace arm_hardware
+{
+    // eRob limits in ec_defines.h: j1-j3 eRob110H120, j4-j6 eRob70H100
+    static const std::vector<double> DEFAULT_MAX_VELOCITY = { 1.7488, 1.7488, 1.7488, 3.1416, 3.1416, 3.1416 };
+    static const std::vector<double> DEFAULT_MAX_ACCELERATION = { 5.8294, 5.8294, 5.8294, 10.4720, 10.4720, 10.4720 };
+
+
+    hardware_interface::CallbackReturn ArmSimHardwareInterface::on_init(const hardware_interface::HardwareInfo &info)
+    {
+        if (hardware_interface::SystemInterface::on_init(info) != CallbackReturn::SUCCESS)
+        {
+            RCLCPP_FATAL(rclcpp::get_logger(LOGGER), "[on_init] failed to load/parse URDF");
+            return CallbackReturn::ERROR;
+        }
+
+        joints_ = info_.joints.size();
+
+        try
+        {
+            cycle_ = 1.0 / std::stod(get_param_("update_rate", "750"));
+            omega_ = TWO_PI * std::stod(get_param_("bandwidth", "30"));
+            feedforward_ = std::clamp(std::stod(get_param_("velocity_feedforward", "0.0")), 0.0, 1.0);
+            substeps_ = std::max(1, std::stoi(get_param_("substeps", "4")));
+            delay_cycles_ = (size_t) std::max(0L, std::lround(std::stod(get_param_("delay", "0.002")) / cycle_));
+            real_time_factor_ = std::max(0.0, std::stod(get_param_("real_time_factor", "1.0")));
+            publish_clock_ = get_param_("publish_clock", "true") == "true";
+            max_velocity_ = get_list_param_("max_velocity", DEFAULT_MAX_VELOCITY);
+            max_acceleration_ = get_list_param_("max_acceleration", DEFAULT_MAX_ACCELERATION);
+        }
+        catch (const std::exception &e)
+        {
+            RCLCPP_FATAL(rclcpp::get_logger(LOGGER), "[on_init] invalid hardware parameter: %s", e.what());
+            return CallbackReturn::ERROR;
+        }
+
+        if (max_velocity_.size() != joints_ || max_acceleration_.size() != joints_)
+        {
+            RCLCPP_FATAL(rclcpp::get_logger(LOGGER), "[on_init] max_velocity and max_acceleration need %lu values", joints_);
+            return CallbackReturn::ERROR;
+        }
+
+        position_command_.assign(joints_, 0.0);
+        position_state_.assign(joints_, 0.0);
+        velocity_state_.assign(joints_, 0.0);
+        position_.assign(joints_, 0.0);
+        velocity_.assign(joints_, 0.0);
+        last_target_.assign(joints_, 0.0);
+        delay_line_.assign((delay_cycles_ + 1) * joints_, 0.0);
+
+        for (size_t i = 0; i < joints_; i++)
+        {
+            for (const auto &interface : info_.joints[i].state_interfaces)
+            {
+                if (interface.name != hardware_interface::HW_IF_POSITION && interface.name != hardware_interface::HW_IF_VELOCITY)
+                {
+                    RCLCPP_FATAL(rclcpp::get_logger(LOGGER), "[on_init] %s: unsupported state interface %s", info_.joints[i].name.c_str(), interface.name.c_str());
+                    return CallbackReturn::ERROR;
+                }
+
+                // Start pose from the URDF, like mock_components
+                if (interface.name == hardware_interface::HW_IF_POSITION && !interface.initial_value.empty())
+                    position_[i] = std::stod(interface.initial_value);
+            }
+
+            for (const auto &interface : info_.joints[i].command_interfaces)
+            {
+                if (interface.name != hardware_interface::HW_IF_POSITION)
+                {
+                    RCLCPP_FATAL(rclcpp::get_logger(LOGGER), "[on_init] %s: unsupported command interface %s", info_.joints[i].name.c_str(), interface.name.c_str());
+                    return CallbackReturn::ERROR;
+                }
+            }
+        }
+
+        if (publish_clock_)
+        {
+            rclcpp::NodeOptions options;
+            options.arguments({ "--ros-args", "-r", "__node:=arm_sim_hw_node" });
+            sim_node_ = rclcpp::Node::make_shared("_", options);
+            clock_pub_ = sim_node_->create_publisher<rosgraph_msgs::msg::Clock>("/clock", rclcpp::ClockQoS());
+        }
+
+        RCLCPP_INFO(rclcpp::get_logger(LOGGER), "[on_init] %lu joints, %.0f Hz position loop, %lu cycle delay, %s",
+            joints_, omega_ / TWO_PI, delay_cycles_, publish_clock_ ? "publishing /clock" : "wall clock");
+
+        return CallbackReturn::SUCCESS;
+    }
+
+
+    std::vector<hardware_interface::StateInterface> ArmSimHardwareInterface::export_state_interfaces()
+    {
+        std::vector<hardware_interface::StateInterface> state_interfaces;
+
+        for (size_t i = 0; i < joints_; i++)
+        {
+            for (const auto &interface : info_.joints[i].state_interfaces)
+            {
+                double *value = (interface.name == hardware_interface::HW_IF_POSITION) ? &position_state_[i] : &velocity_state_[i];
+                state_interfaces.emplace_back(info_.joints[i].name, interface.name, value);
+            }
+        }
+
+        return state_interfaces;
+    }
+
+
+    std::vector<hardware_interface::CommandInterface> ArmSimHardwareInterface::export_command_interfaces()
+    {
+        std::vector<hardware_interface::CommandInterface> command_interfaces;
+
+        for (size_t i = 0; i < joints_; i++)
+        {
+            for (const auto &interface : info_.joints[i].command_interfaces)
+                command_interfaces.emplace_back(info_.joints[i].name, interface.name, &position_command_[i]);
+        }
+
+        return command_interfaces;
+    }
+
+
+    hardware_interface::CallbackReturn ArmSimHardwareInterface::on_activate(const rclcpp_lifecycle::State & /*previous_state*/)
+    {
+        for (size_t i = 0; i < joints_; i++)
+        {
+            velocity_[i] = 0.0;
+            position_command_[i] = position_[i];
+            last_target_[i] = position_[i];
+            for (size_t k = 0; k <= delay_cycles_; k++)
+                delay_line_[k * joints_ + i] = position_[i];
+        }
+        delay_head_ = 0;
+
+        read(rclcpp::Time(), rclcpp::Duration(0, 0));
+
+        // Sim time keeps running across deactivation, pace from where it is now
+        wall_start_ = std::chrono::steady_clock::now();
+        sim_start_ns_ = sim_time_ns_;
+
+        // A controller manager on sim time may already be waiting for the next tick, with
+        // no hardware to write() it has to come from here
+        if (publish_clock_)
+        {
+            sim_time_ns_ += (int64_t) std::llround(cycle_ * 1e9);
+
+            rosgraph_msgs::msg::Clock clock;
+            clock.clock = rclcpp::Time(sim_time_ns_, RCL_ROS_TIME);
+            clock_pub_->publish(clock);
+        }
+
+        return CallbackReturn::SUCCESS;
+    }
+
+
+    hardware_interface::return_type ArmSimHardwareInterface::read(const rclcpp::Time & /*time*/, const rclcpp::Duration & /*period*/)
+    {
+        // Encoder resolution
+        for (size_t i = 0; i < joints_; i++)
+        {
+            position_state_[i] = std::round(position_[i] * MAX_COUNT / TWO_PI) * TWO_PI / MAX_COUNT;
+            velocity_state_[i] = velocity_[i];
+        }
+
+        return hardware_interface::return_type::OK;
+    }
+
+
+    hardware_interface::return_type ArmSimHardwareInterface::write(const rclcpp::Time & /*time*/, const rclcpp::Duration & /*period*/)
+    {
+        //* Transport delay, the oldest command in the line reaches the drives
+        double *in = &delay_line_[delay_head_ * joints_];
+        for (size_t i = 0; i < joints_; i++)
+        {
+            // No command yet (e.g. controller inactive), hold the last one
+            if (std::isfinite(position_command_[i]))
+                in[i] = position_command_[i];
+            else
+                in[i] = delay_line_[((delay_head_ + delay_cycles_) % (delay_cycles_ + 1)) * joints_ + i];
+        }
+        delay_head_ = (delay_head_ + 1) % (delay_cycles_ + 1);
+        const double *target = &delay_line_[delay_head_ * joints_];
+
+        //* Drive position loop
+        const double h = cycle_ / substeps_;
+        for (size_t i = 0; i < joints_; i++)
+        {
+            const double target_velocity = (target[i] - last_target_[i]) / cycle_;
+            last_target_[i] = target[i];
+
+            double p = position_[i];
+            double v = velocity_[i];
+            for (int s = 0; s < substeps_; s++)
+            {
+                const double v_des = std::clamp(feedforward_ * target_velocity + omega_ * (target[i] - p), -max_velocity_[i], max_velocity_[i]);
+                const double a = std::clamp((v_des - v) / h, -max_acceleration_[i], max_acceleration_[i]);
+                v += a * h;
+                p += v * h;
+            }
+            position_[i] = p;
+            velocity_[i] = v;
+        }
+
+        //* Simulated time
+        if (publish_clock_)
+        {
+            sim_time_ns_ += (int64_t) std::llround(cycle_ * 1e9);
+
+            rosgraph_msgs::msg::Clock clock;
+            clock.clock = rclcpp::Time(sim_time_ns_, RCL_ROS_TIME);
+            clock_pub_->publish(clock);
+
+            if (real_time_factor_ > 0.0)
+            {
+                auto due = wall_start_ + std::chrono::nanoseconds((int64_t) ((sim_time_ns_ - sim_start_ns_) / real_time_factor_));
+                auto now = std::chrono::steady_clock::now();
+
+                // Fell behind (slow host, debugger), pace from here instead of catching up
+                if (now - due > std::chrono::milliseconds(100))
+                    wall_start_ += now - due;
+                else
+                    std::this_thread::sleep_until(due);
+            }
+        }
+
+        return hardware_interface::return_type::OK;
+    }
+
+
+    std::string ArmSimHardwareInterface::get_param_(const std::string &name, const std::string &default_value) const
+    {
+        auto it = info_.hardware_parameters.find(name);
+        return (it != info_.hardware_parameters.end()) ? it->second : default_value;
+    }
+
+
+    std::vector<double> ArmSimHardwareInterface::get_list_param_(const std::string &name, const std::vector<double> &default_value) const
+    {
+        auto it = info_.hardware_parameters.find(name);
+        if (it == info_.hardware_parameters.end())
+            return default_value;
+
+        std::vector<double> values;
+        std::stringstream ss(it->second);
+        std::string item;
+        while (std::getline(ss, item, ','))
+            values.push_back(std::stod(item));
+        return values;
+    }
+
+}
+
+PLUGINLIB_EXPORT_CLASS(arm_hardware::ArmSimHardwareInterface, hardware_interface::SystemInterface);
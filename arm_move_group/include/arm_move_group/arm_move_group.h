@@ -3,6 +3,7 @@
 #include <sys/stat.h>
 
 #include <fstream>
+#include <sstream>
 #include <filesystem>
 #include <cereal/archives/binary.hpp>
 #include <cereal/archives/json.hpp>
@@ -32,18 +33,30 @@
 #include "arm_msgs/srv/save.hpp"
 #include "arm_msgs/srv/move_to_saved.hpp"
 #include "arm_msgs/srv/get_state.hpp"
+#include "arm_msgs/srv/set_control_mode.hpp"
+#include "arm_msgs/srv/record.hpp"
 
 #include <moveit_msgs/action/execute_trajectory.hpp>
 
+#include <arm_move_group/pose_roadmap.h>
+#include <arm_move_group/tracking_monitor.h>
+#include <arm_move_group/demo_recorder.h>
+#include <arm_move_group/save_writer.h>
+#include <arm_move_group/shared_robot_model.h>
+#include <arm_move_group/path_constraints.h>
+
 
 using namespace std::chrono_literals;
 
 class ArmMoveGroup
 {
     public:
-        ArmMoveGroup();
+        explicit ArmMoveGroup(const rclcpp::NodeOptions &options = rclcpp::NodeOptions());
         ~ArmMoveGroup();
 
+        // Component interface, node_ is the node loaded into a container
+        rclcpp::node_interfaces::NodeBaseInterface::SharedPtr get_node_base_interface() const;
+
         rclcpp::Node::SharedPtr node_;
         rclcpp::Node::SharedPtr mg_node_;
 
@@ -52,13 +65,26 @@ class ArmMoveGroup
     private:
         const uint NUM_JOINTS = 6;
         const float PI = 3.141592654;
-        const std::string PLANNING_GROUP = "arm_group";
         const std::string NODE_NAME = "arm_move_group";
 
         const std::string WS_DIR = rcpputils::fs::current_path().string();
         const std::string PKG_DIR = WS_DIR + "/src/arm-project/" + NODE_NAME;
-        const std::string POSE_DIR = PKG_DIR + "/poses/";
-        const std::string TRAJ_DIR = PKG_DIR + "/trajectories/";
+
+        // Save folders of this arm, in PKG_DIR/<namespace> for a namespaced arm
+        std::string POSE_DIR;
+        std::string TRAJ_DIR;
+        std::string ROADMAP_FILE;
+        std::string TRACKING_DIR;
+        std::string JOURNAL_FILE;
+
+        //* Arm served by this instance (planning_group, move_group_namespace parameters)
+        std::string planning_group_ = "arm_group";
+        std::string move_group_namespace_ = "/";
+
+        // Robot model shared by all arms of the process, see shared_robot_model.h
+        robot_model_loader::RobotModelLoaderPtr robot_model_loader_;
+
+        moveit::planning_interface::MoveGroupInterface::Options move_group_options_() const;
 
         //* ROS2 Parameters
         bool visualize_trajectories_ = true;
@@ -91,6 +117,7 @@ class ArmMoveGroup
         using MoveToSaved = arm_msgs::srv::MoveToSaved;
         using GetState = arm_msgs::srv::GetState;
         using SetBool = std_srvs::srv::SetBool;
+        using Record = arm_msgs::srv::Record;
 
         rclcpp::Service<Trigger>::SharedPtr execute_srv_;
         rclcpp::Service<Trigger>::SharedPtr stop_srv_;
@@ -100,9 +127,20 @@ class ArmMoveGroup
         rclcpp::Service<Save>::SharedPtr save_srv_;
         rclcpp::Service<MoveToSaved>::SharedPtr move_to_saved_srv_;  
         rclcpp::Service<GetState>::SharedPtr get_state_srv_;
+        rclcpp::Service<Record>::SharedPtr record_srv_;
 
         rclcpp::Client<SetBool>::SharedPtr pause_servo_input_cli_;
 
+        // Persistent client of the plan/servo mode manager (arm_servo), spun by its own thread
+        // so service callbacks can wait for a switch to complete
+        using SetControlMode = arm_msgs::srv::SetControlMode;
+        rclcpp::Node::SharedPtr mode_node_;
+        rclcpp::executors::SingleThreadedExecutor mode_executor_;
+        std::thread mode_thread_;
+        rclcpp::Client<SetControlMode>::SharedPtr mode_cli_;
+
+        bool set_control_mode_(const std::string &mode, bool wait);
+
 
         // Service callbacks
         void save_cb_(const std::shared_ptr<Save::Request> request, std::shared_ptr<Save::Response> response);
@@ -113,9 +151,29 @@ class ArmMoveGroup
         void pose_goal_cb_(const std::shared_ptr<PoseGoal::Request> request, std::shared_ptr<PoseGoal::Response> response);
         void pose_goal_array_cb_(const std::shared_ptr<PoseGoalArray::Request> request, std::shared_ptr<PoseGoalArray::Response> response);
         void get_state_cb_(const std::shared_ptr<GetState::Request> request, std::shared_ptr<GetState::Response> response);
+        void record_cb_(const std::shared_ptr<Record::Request> request, std::shared_ptr<Record::Response> response);
+
+        bool save_file_(const std::string &file_name, std::string data, std::string &msg);
+        bool save_trajectory_(const std::string &file_name, const trajectory_msgs::msg::JointTrajectory &trajectory, const std::string &frame_id, const std::string &model_id);
 
 
         moveit::planning_interface::MoveGroupInterface::Plan plan_;
+
+        // What plan_ was made for, names the tracking summary of its executions
+        std::string plan_label_ = "plan";
+
+        // Journaled writes of the saved pose and trajectory files
+        std::unique_ptr<SaveWriter> saves_;
+
+        // Precomputed trajectories between saved poses
+        std::unique_ptr<PoseRoadmap> roadmap_;
+
+        // Commanded vs actual joint positions of every execution
+        std::unique_ptr<TrackingMonitor> tracking_;
+
+        // Teach by demonstration, saved as a trajectory under record_label_
+        std::unique_ptr<DemoRecorder> recorder_;
+        std::string record_label_;
         // moveit::planning_interface::PlanningSceneInterface planning_scene_interface_;
 
 
@@ -0,0 +1,111 @@
+#ifndef __DEMO_RECORDER_H__
+#define __DEMO_RECORDER_H__
+
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <rclcpp/rclcpp.hpp>
+
+#include <moveit/robot_model/robot_model.h>
+#include <sensor_msgs/msg/joint_state.hpp>
+#include <trajectory_msgs/msg/joint_trajectory.hpp>
+
+
+/**
+ * @brief Teach by demonstration, records the arm's measured motion (e.g. while jogging
+ * with servo) and turns it into a replayable trajectory.
+ *
+ * Joint states are captured at the rate they are published (every controller cycle) into
+ * a buffer reserved for max_duration when the recording starts, so the state callback only
+ * copies numbers. The subscription is spun by its own thread. When the recording stops it is
+ *   trimmed     still start and end removed
+ *   smoothed    centred moving average, removes encoder and hand jitter
+ *   compressed  Ramer-Douglas-Peucker, only the waypoints needed to stay within tolerance
+ *   timed       time-optimal within the joint limits, slowed down to the demonstrated
+ *               pace if that was slower
+ *
+ * Parameters (demo.*):
+ *   state_topic     Joint state topic
+ *   max_duration    Longest recording [s]
+ *   max_rate        Upper bound of the joint state rate, for the buffer size [Hz]
+ *   smoothing_time  Moving average window [s]
+ *   tolerance       Max deviation of the trajectory from the smoothed recording [rad]
+ *   still_tolerance Motion below this at the start and end is trimmed [rad]
+ *   keep_pace       Replay no faster than demonstrated
+ *
+ */
+class DemoRecorder
+{
+	public:
+		struct Result
+		{
+			size_t samples = 0;		// recorded
+			size_t waypoints = 0;	// after compression
+			double demo_duration = 0.0;
+			trajectory_msgs::msg::JointTrajectory trajectory;
+		};
+
+		DemoRecorder(const rclcpp::NodeOptions &options, const std::string &ns = "/");
+		~DemoRecorder();
+
+		/**
+		 * @brief Starts recording the given joints, an unfinished recording is discarded.
+		 *
+		 */
+		void start(const std::vector<std::string> &joint_names);
+
+		/**
+		 * @brief Discards the recording.
+		 *
+		 */
+		void cancel();
+
+		bool recording();
+
+		/**
+		 * @brief Stops recording and turns the recording into a trajectory.
+		 *
+		 * @param model Robot model with the joint limits
+		 * @param group Planning group of the recorded joints
+		 * @param result Trajectory and statistics
+		 * @param msg Reason for failure
+		 * @return true if a trajectory was made
+		 */
+		bool stop(const moveit::core::RobotModelConstPtr &model, const std::string &group, Result &result, std::string &msg);
+
+
+	private:
+		rclcpp::Node::SharedPtr node_;
+		rclcpp::executors::SingleThreadedExecutor executor_;
+		std::thread spin_thread_;
+		rclcpp::Subscription<sensor_msgs::msg::JointState>::SharedPtr state_sub_;
+
+		double max_duration_ = 120.0;
+		double max_rate_ = 1000.0;
+		double smoothing_time_ = 0.05;
+		double tolerance_ = 0.002;
+		double still_tolerance_ = 0.002;
+		bool keep_pace_ = true;
+
+		// Recording, guarded by mtx_
+		std::mutex mtx_;
+		bool recording_ = false;
+		bool truncated_ = false;
+		std::vector<std::string> joint_names_;
+		std::vector<int> index_;	// joint state index of every recorded joint
+
+		size_t capacity_ = 0;
+		std::vector<double> t_;		// [s] since the first sample
+		std::vector<double> q_;		// samples x joints
+		double t0_ = 0.0;
+
+
+		void state_cb_(const sensor_msgs::msg::JointState::SharedPtr state);
+
+		void smooth_(std::vector<double> &q, size_t joints, size_t first, size_t last, size_t half_window) const;
+		std::vector<size_t> compress_(const std::vector<double> &t, const std::vector<double> &q, size_t joints, size_t first, size_t last) const;
+};
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef __PATH_CONSTRAINTS_H__
+#define __PATH_CONSTRAINTS_H__
+
+#include <string>
+#include <vector>
+
+#include <rclcpp/rclcpp.hpp>
+
+#include <moveit/robot_model/robot_model.h>
+#include <moveit_msgs/msg/constraints.hpp>
+#include <moveit_msgs/msg/robot_trajectory.hpp>
+
+
+/**
+ * @brief Standard path constraints of the arm, e.g. keeping the tool upright.
+ *
+ * Defined once by parameters (arm_config/config/path_constraints.yaml), so the planning
+ * requests and the constraint approximation database (generate_constraint_database) use
+ * identical constraints. OMPL looks the database entry up by the constraint name.
+ *
+ * Parameters (path_constraints.*):
+ *   names                 Standard constraints
+ *   <name>.link           Constrained link
+ *   <name>.frame          Reference frame
+ *   <name>.orientation    Orientation of the link in the frame (x, y, z, w)
+ *   <name>.tolerance      Absolute tolerance about the x, y, z axes [rad], pi leaves an
+ *                         axis free
+ *
+ * @param node Node holding the parameters
+ * @param name Constraint name
+ * @param constraints Filled with the orientation constraint, named name
+ * @return False if the constraint is not defined or its parameters are malformed
+ */
+bool load_path_constraint(
+	const rclcpp::Node::SharedPtr &node,
+	const std::string &name,
+	moveit_msgs::msg::Constraints &constraints);
+
+//* Names of the standard path constraints (path_constraints.names)
+std::vector<std::string> path_constraint_names(const rclcpp::Node::SharedPtr &node);
+
+/**
+ * @brief Checks every waypoint of a trajectory against path constraints.
+ *
+ * @return Index of the first waypoint violating them, -1 if all satisfy them
+ */
+long first_path_constraint_violation(
+	const moveit::core::RobotModelConstPtr &robot_model,
+	const moveit_msgs::msg::RobotTrajectory &trajectory,
+	const moveit_msgs::msg::Constraints &constraints);
+
+#endif
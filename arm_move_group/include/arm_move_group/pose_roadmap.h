@@ -0,0 +1,175 @@
+#ifndef __POSE_ROADMAP_H__
+#define __POSE_ROADMAP_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <cereal/access.hpp>
+#include <cereal/types/string.hpp>
+#include <cereal/types/vector.hpp>
+
+#include <rclcpp/rclcpp.hpp>
+
+#include <moveit/planning_pipeline/planning_pipeline.h>
+#include <moveit/planning_scene_monitor/planning_scene_monitor.h>
+#include <moveit_msgs/msg/robot_trajectory.hpp>
+
+#include <arm_move_group/shared_robot_model.h>
+
+
+/**
+ * @brief Precomputed trajectories between every pair of saved poses.
+ *
+ * Saved poses are the nodes of a graph and the edges are collision-free, time
+ * parameterized trajectories planned offline by a pool of worker threads (one planning
+ * pipeline per worker, all cores but core 0 by default, which is left to the EtherCAT
+ * loop). The shortcut adapter of the workers' pipelines runs single threaded. Each pair
+ * is planned a few times across the configured pipelines and the fastest trajectory is
+ * kept; the reverse edge is the same trajectory played backwards.
+ *
+ * MoveToSaved then becomes a shortest path query: edges on the path are checked against
+ * the current planning scene and invalid ones are skipped, so a blocked direct edge is
+ * routed around through other saved poses. Saving a pose only queues the edges to and
+ * from the new pose. The roadmap is persisted next to the saved poses and reloaded on
+ * startup; edges whose end poses changed on disk are replanned.
+ *
+ * Parameters (roadmap.*):
+ *   enabled          Build and use the roadmap
+ *   threads          Worker threads, 0 for all cores but one
+ *   pipelines        Planning pipelines tried for every edge
+ *   attempts         Plans per pipeline and edge, the fastest is kept
+ *   planning_time    Allowed planning time per attempt [s]
+ *   start_tolerance  Max joint distance [rad] from a saved pose for a query to start there
+ *
+ */
+class PoseRoadmap
+{
+	public:
+		PoseRoadmap(const rclcpp::NodeOptions &options, const std::string &ns, const std::string &group, const std::string &pose_dir, const std::string &roadmap_file);
+		~PoseRoadmap();
+
+		/**
+		 * @brief Loads the saved poses and the stored roadmap, then queues the missing edges.
+		 *
+		 */
+		void start();
+
+		/**
+		 * @brief Adds a newly saved pose and queues only its edges.
+		 *
+		 */
+		void add_pose(const std::string &label, const std::vector<double> &joint_positions);
+
+		/**
+		 * @brief Looks up a trajectory from the current state to a saved pose.
+		 *
+		 * @param current_positions Current joint positions, must be at a saved pose
+		 * @param goal Label of the goal pose
+		 * @param speed_factor Velocity scaling [0-1], edges are stored at full speed
+		 * @param trajectory Output, starts at current_positions
+		 * @return false if the current state is not at a saved pose or no valid route exists
+		 */
+		bool lookup(
+			const std::vector<double> &current_positions,
+			const std::string &goal,
+			double speed_factor,
+			moveit_msgs::msg::RobotTrajectory &trajectory);
+
+		bool enabled() const { return enabled_; }
+
+
+	private:
+		struct Edge
+		{
+			std::string from;
+			std::string to;
+
+			// End poses the edge was planned between, to detect edited pose files
+			std::vector<double> from_positions;
+			std::vector<double> to_positions;
+
+			std::vector<std::string> joint_names;
+			std::vector<std::vector<double>> positions;
+			std::vector<std::vector<double>> velocities;
+			std::vector<std::vector<double>> accelerations;
+			std::vector<double> time_from_start;
+
+			double duration() const { return time_from_start.empty() ? 0.0 : time_from_start.back(); }
+
+			template <class Archive>
+			void serialize(Archive &archive)
+			{
+				archive( from, to, from_positions, to_positions, joint_names, positions, velocities, accelerations, time_from_start );
+			}
+		};
+
+		// Edges keyed by (from, to)
+		using EdgeKey = std::pair<std::string, std::string>;
+
+		static constexpr uint32_t ROADMAP_VERSION = 1;
+
+		rclcpp::Node::SharedPtr node_;
+		rclcpp::executors::SingleThreadedExecutor executor_;
+		std::thread spin_thread_;
+
+		const std::string group_;
+		const std::string pose_dir_;
+		const std::string roadmap_file_;
+
+		bool enabled_ = true;
+		size_t num_threads_ = 0;
+		std::vector<std::string> pipelines_;
+		int attempts_ = 2;
+		double planning_time_ = 5.0;
+		double start_tolerance_ = 0.01;
+
+		planning_scene_monitor::PlanningSceneMonitorPtr psm_;
+
+		// Graph, guarded by graph_mtx_
+		std::mutex graph_mtx_;
+		std::map<std::string, std::vector<double>> poses_;
+		std::map<EdgeKey, Edge> edges_;
+
+		// Edge planning jobs (unordered pairs), guarded by jobs_mtx_
+		std::mutex jobs_mtx_;
+		std::condition_variable jobs_cv_;
+		std::deque<EdgeKey> jobs_;
+		size_t jobs_in_progress_ = 0;
+		size_t edges_since_save_ = 0;
+		std::atomic<bool> stop_ = false;
+		std::vector<std::thread> workers_;
+
+		std::mutex file_mtx_;
+
+
+		void worker_();
+		bool plan_edge_(
+			const std::map<std::string, std::shared_ptr<planning_pipeline::PlanningPipeline>> &pipelines,
+			const std::string &from,
+			const std::string &to,
+			Edge &edge);
+
+		void queue_edges_(const std::string &label);
+		void load_poses_();
+		void load_();
+		void save_();
+
+		bool edge_valid_(const planning_scene::PlanningSceneConstPtr &scene, const Edge &edge) const;
+		bool shortest_path_(const std::string &start, const std::string &goal, const std::map<EdgeKey, bool> &validity, std::vector<EdgeKey> &path) const;
+
+		static Edge reversed_(const Edge &edge);
+		static double distance_(const std::vector<double> &a, const std::vector<double> &b);
+
+		template <typename T>
+		T param_(const std::string &name, const T &default_value);
+};
+
+#endif
@@ -0,0 +1,105 @@
+#ifndef __SAVE_WRITER_H__
+#define __SAVE_WRITER_H__
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <rclcpp/rclcpp.hpp>
+
+
+/**
+ * @brief Crash-safe background writer of the saved pose and trajectory files.
+ *
+ * A save is serialized by the caller and handed over as bytes. The writer thread appends
+ * every queued save to a journal as a record with a CRC-32 and makes the whole batch durable
+ * with a single fdatasync, so saves arriving together share one flush. Once the journal is
+ * durable the caller's future is resolved, then the files are materialized: written aside,
+ * checked against the record's CRC, fsynced and renamed into place, with one fsync per
+ * directory and batch. When all saves are in place the journal is truncated.
+ *
+ * After a crash, recover() replays the journal up to the first torn or corrupt record, so a
+ * save is either complete in its file or absent, never truncated.
+ *
+ * @note submit(), exists() and wait() are thread-safe; recover() before the first submit().
+ *
+ */
+class SaveWriter
+{
+	public:
+		struct Result
+		{
+			bool durable = false;
+			std::string msg;
+		};
+
+		SaveWriter(const std::string &journal_file, const rclcpp::Logger &logger);
+
+		//* Writes out everything submitted before returning
+		~SaveWriter();
+
+		/**
+		 * @brief Replays the journal left by a crash.
+		 *
+		 * @return Number of saves restored
+		 */
+		size_t recover();
+
+		/**
+		 * @brief Queues a file for writing.
+		 *
+		 * @param path File the data goes to, replaced atomically
+		 * @param data File contents
+		 * @return Resolved once the data is durable in the journal
+		 */
+		std::future<Result> submit(const std::string &path, std::string data);
+
+		//* The file exists or is queued
+		bool exists(const std::string &path);
+
+		//* Blocks until the queued saves of the file are in place
+		void wait(const std::string &path);
+
+		static uint32_t crc32(const void *data, size_t size, uint32_t crc = 0);
+
+
+	private:
+		struct Entry
+		{
+			std::string path;
+			std::string data;
+			uint32_t crc = 0;
+			std::promise<Result> done;
+		};
+
+		const std::string journal_file_;
+		rclcpp::Logger logger_;
+
+		int journal_fd_ = -1;
+		off_t journal_size_ = 0;
+		// A save that could not be materialized keeps the journal for the next recover()
+		bool keep_journal_ = false;
+
+		std::mutex mtx_;
+		std::condition_variable queue_cv_;
+		std::condition_variable done_cv_;
+		std::deque<Entry> queue_;
+		std::map<std::string, size_t> pending_;
+		bool stop_ = false;
+		std::thread worker_;
+
+		void worker_loop_();
+		bool append_(const std::vector<Entry> &batch, std::string &error);
+		bool materialize_(const std::string &path, const std::string &data, uint32_t crc, std::set<std::string> &dirs);
+		void sync_dirs_(const std::set<std::string> &dirs);
+		void truncate_journal_();
+};
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef __SHARED_ROBOT_MODEL_H__
+#define __SHARED_ROBOT_MODEL_H__
+
+#include <string>
+
+#include <rclcpp/rclcpp.hpp>
+
+#include <moveit/robot_model_loader/robot_model_loader.h>
+
+
+/**
+ * @brief Robot model of the process, loaded on first use and shared by every arm served
+ * from it.
+ *
+ * Parsing the URDF and SRDF, loading the meshes' collision geometry and the kinematics
+ * plugins happens once per robot description and process. The model is immutable after
+ * loading, so arms, request handlers and the roadmap planners all use the same instance
+ * concurrently without locking. It stays loaded for the lifetime of the process, instead
+ * of being reloaded whenever no MoveGroupInterface happens to hold it.
+ *
+ * @param node Node whose parameters hold the robot description (first call only)
+ * @param description Robot description parameter
+ * @return Loader holding the model and its kinematics solvers, never null
+ */
+robot_model_loader::RobotModelLoaderPtr shared_robot_model_loader(
+	const rclcpp::Node::SharedPtr &node,
+	const std::string &description = "robot_description");
+
+#endif
@@ -0,0 +1,136 @@
+#ifndef __TRACKING_MONITOR_H__
+#define __TRACKING_MONITOR_H__
+
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <rclcpp/rclcpp.hpp>
+
+#include <control_msgs/msg/joint_trajectory_controller_state.hpp>
+#include <std_msgs/msg/float64.hpp>
+#include <trajectory_msgs/msg/joint_trajectory.hpp>
+
+
+/**
+ * @brief Trajectory tracking analysis of every execution.
+ *
+ * Records the reference and measured joint positions of the joint trajectory controller
+ * state, published at its state_publish_rate (the controller rate in ros2_controllers.yaml)
+ * through its realtime publisher, from the start of an execution until the arm has settled at the end of the trajectory. The
+ * The measured positions only change as often as the hardware reports them: on the arm
+ * that is arm/state of arm_ethercat_interface every 10 ms, the state in between repeats
+ * them. Lag and peak error resolve to the longer of the state and feedback periods, which
+ * is stored with every line.
+ *
+ * The recording goes into a buffer sized for the trajectory when the execution starts, so the
+ * state callback only copies numbers. The subscription is spun by its own thread, so long
+ * service callbacks of the move group node never hold up the recording.
+ *
+ * Per joint the summary holds:
+ *   rms        RMS tracking error [rad]
+ *   max        Max absolute tracking error [rad]
+ *   lag        Time shift of the reference that best matches the measured motion [ms]
+ *   overshoot  Max travel past the goal in the direction of motion, after the reference
+ *              arrived [rad]
+ *
+ * One CSV line per execution is appended to <summary_dir>/<label>.csv, so worn gearboxes or
+ * detuned gains show up as a trend of the same motion over time.
+ *
+ * The controller's reference runs on nominal time, while a speed override other than 100%
+ * (arm_ethercat_interface) re-times the motion after it; error, lag and overshoot of such
+ * an execution measure the override, not the tracking. The override range in effect is
+ * stored with every line and those executions are flagged (nominal = 0) for the trends to
+ * skip.
+ *
+ * Parameters (tracking.*):
+ *   enabled         Record and analyse executions
+ *   state_topic     Controller state topic
+ *   override_topic  Speed override in effect [%], 100% while nothing is published
+ *   settle_time     Time recorded after the reference arrived at the goal [s]
+ *   max_lag         Largest lag searched [s]
+ *   feedback_period Period of the measured positions behind the controller state [s]
+ *
+ */
+class TrackingMonitor
+{
+	public:
+		TrackingMonitor(const rclcpp::NodeOptions &options, const std::string &ns, const std::string &summary_dir);
+		~TrackingMonitor();
+
+		/**
+		 * @brief Starts recording an execution of the given trajectory.
+		 *
+		 * An unfinished recording is discarded.
+		 *
+		 * @param label Summary file the results are appended to
+		 * @param trajectory Executed trajectory, for the goal and the buffer size
+		 */
+		void start(const std::string &label, const trajectory_msgs::msg::JointTrajectory &trajectory);
+
+		/**
+		 * @brief Discards the current recording (stopped execution).
+		 *
+		 */
+		void cancel();
+
+
+	private:
+		using ControllerState = control_msgs::msg::JointTrajectoryControllerState;
+
+		struct Summary
+		{
+			double duration = 0.0;
+			size_t samples = 0;
+			double state_rate = 0.0;
+			double resolution_ms = 0.0;
+			double override_min = 100.0;
+			double override_max = 100.0;
+			std::vector<double> rms;
+			std::vector<double> max;
+			std::vector<double> lag_ms;
+			std::vector<double> overshoot;
+		};
+
+		rclcpp::Node::SharedPtr node_;
+		rclcpp::executors::SingleThreadedExecutor executor_;
+		std::thread spin_thread_;
+		rclcpp::Subscription<ControllerState>::SharedPtr state_sub_;
+		rclcpp::Subscription<std_msgs::msg::Float64>::SharedPtr override_sub_;
+
+		const std::string summary_dir_;
+
+		bool enabled_ = true;
+		double settle_time_ = 0.5;
+		double max_lag_ = 0.2;
+		double feedback_period_ = 0.01;
+
+		// Recording, guarded by mtx_
+		std::mutex mtx_;
+		bool recording_ = false;
+		std::string label_;
+		std::vector<std::string> joint_names_;
+		std::vector<double> goal_;
+		std::vector<int> index_;	// controller joint index of every trajectory joint
+
+		size_t capacity_ = 0;
+		std::vector<double> t_;		// [s] since the first sample
+		std::vector<double> ref_;	// samples x joints
+		std::vector<double> act_;
+		double t0_ = 0.0;
+		double t_arrived_ = -1.0;	// reference at the goal since
+		bool moved_ = false;
+		double override_ = 100.0;	// [%], also while not recording
+		double override_min_ = 100.0;
+		double override_max_ = 100.0;
+
+
+		void state_cb_(const ControllerState::SharedPtr state);
+		void override_cb_(const std_msgs::msg::Float64::SharedPtr msg);
+
+		Summary analyse_() const;
+		void store_(const std::string &label, const Summary &summary) const;
+};
+
+#endif
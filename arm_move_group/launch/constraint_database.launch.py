@@ -0,0 +1,52 @@
+from launch import LaunchDescription
+from launch_ros.actions import Node
+from launch.actions import DeclareLaunchArgument
+from launch.substitutions import LaunchConfiguration, PathJoinSubstitution
+from launch_ros.substitutions import FindPackageShare
+from moveit_configs_utils import MoveItConfigsBuilder
+
+
+def generate_launch_description():
+    moveit_config = (
+        MoveItConfigsBuilder("zeroerr_arm", package_name="arm_config")
+        .planning_pipelines(pipelines=["ompl"])
+        .to_moveit_configs()
+    )
+
+    samples_param = DeclareLaunchArgument(
+        "samples",
+        default_value="10000",
+        description="States per path constraint."
+    )
+
+    threads_param = DeclareLaunchArgument(
+        "threads",
+        default_value="0",
+        description="Constraints built at once, 0 for all cores."
+    )
+
+
+    # Builds the constraint approximation database of arm_config/config/path_constraints.yaml
+    generate_constraint_database = Node(
+        package="arm_move_group",
+        executable="generate_constraint_database",
+        output="screen",
+        parameters=[
+            moveit_config.robot_description,
+            moveit_config.robot_description_semantic,
+            moveit_config.robot_description_kinematics,
+            moveit_config.planning_pipelines,
+            moveit_config.joint_limits,
+            PathJoinSubstitution([FindPackageShare("arm_config"), "config", "path_constraints.yaml"]),
+            {"constraint_database.samples": LaunchConfiguration("samples")},
+            {"constraint_database.threads": LaunchConfiguration("threads")},
+        ],
+    )
+
+    return LaunchDescription(
+        [
+            samples_param,
+            threads_param,
+            generate_constraint_database
+        ]
+    )
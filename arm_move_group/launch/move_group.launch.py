@@ -1,7 +1,8 @@
 from launch import LaunchDescription
 from launch_ros.actions import Node
 from launch.actions import DeclareLaunchArgument
-from launch.substitutions import LaunchConfiguration
+from launch.substitutions import LaunchConfiguration, PathJoinSubstitution
+from launch_ros.substitutions import FindPackageShare
 from moveit_configs_utils import MoveItConfigsBuilder
 
 
@@ -21,6 +22,13 @@ def generate_launch_description():
     )
 
 
+    roadmap_param = DeclareLaunchArgument(
+        "roadmap",
+        default_value="True",
+        description="Precompute trajectories between saved poses in the background and use them for arm/ExecuteSaved."
+    )
+
+
     # MoveGroupInterface demo executable
     move_group = Node(
         # name="arm_move_group",
@@ -31,6 +39,10 @@ def generate_launch_description():
             moveit_config.robot_description,
             moveit_config.robot_description_semantic,
             moveit_config.robot_description_kinematics,
+            moveit_config.planning_pipelines,
+            moveit_config.joint_limits,
+            PathJoinSubstitution([FindPackageShare("arm_config"), "config", "path_constraints.yaml"]),
+            {"roadmap.enabled": LaunchConfiguration("roadmap")},
             {"use_sim_time": True}, #! Will not receive joint_states if False
             {"visualize_trajectory": LaunchConfiguration("visualize_trajectories")},
             {"servoing": LaunchConfiguration("servoing")}
@@ -41,6 +53,7 @@ def generate_launch_description():
         [
             visualization_param,
             servo_param,
+            roadmap_param,
             move_group
         ]
     )
\ No newline at end of file
@@ -0,0 +1,73 @@
+from launch import LaunchDescription
+from launch_ros.actions import Node
+from launch.actions import DeclareLaunchArgument
+from launch.substitutions import LaunchConfiguration, PathJoinSubstitution
+from launch_ros.substitutions import FindPackageShare
+from moveit_configs_utils import MoveItConfigsBuilder
+
+
+def generate_launch_description():
+    moveit_config = MoveItConfigsBuilder("zeroerr_arm", package_name="arm_config").to_moveit_configs()
+
+    arms_param = DeclareLaunchArgument(
+        "arms",
+        default_value="['arm:arm_group']",
+        description="Arms served by the process, '<namespace>:<planning group>' each."
+    )
+
+    move_group_namespace_param = DeclareLaunchArgument(
+        "move_group_namespace",
+        default_value="/",
+        description="Namespace of the move_group server planning for all arms."
+    )
+
+    visualization_param = DeclareLaunchArgument(
+        "visualize_trajectories",
+        default_value="True",
+        description="Visualize trajectories in RVIZ2. Make 'false' if not launching RVIZ2."
+    )
+
+    use_sim_time_param = DeclareLaunchArgument(
+        "use_sim_time",
+        default_value="True",
+        description="Follow /clock. The launch files publishing joint_states run on sim time, set 'false' for a wall clock setup."
+    )
+
+    roadmap_param = DeclareLaunchArgument(
+        "roadmap",
+        default_value="True",
+        description="Precompute trajectories between saved poses in the background and use them for arm/ExecuteSaved."
+    )
+
+
+    # All arms in one process, sharing one robot model
+    move_group = Node(
+        package="arm_move_group",
+        executable="arm_move_group_multi",
+        output="screen",
+        parameters=[
+            moveit_config.robot_description,
+            moveit_config.robot_description_semantic,
+            moveit_config.robot_description_kinematics,
+            moveit_config.planning_pipelines,
+            moveit_config.joint_limits,
+            PathJoinSubstitution([FindPackageShare("arm_config"), "config", "path_constraints.yaml"]),
+            {"arms": LaunchConfiguration("arms")},
+            {"move_group_namespace": LaunchConfiguration("move_group_namespace")},
+            {"roadmap.enabled": LaunchConfiguration("roadmap")},
+            {"use_sim_time": LaunchConfiguration("use_sim_time")},
+            {"visualize_trajectory": LaunchConfiguration("visualize_trajectories")},
+            {"servoing": False}
+        ],
+    )
+
+    return LaunchDescription(
+        [
+            arms_param,
+            move_group_namespace_param,
+            visualization_param,
+            use_sim_time_param,
+            roadmap_param,
+            move_group
+        ]
+    )
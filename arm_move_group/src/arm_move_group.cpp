@@ -1,12 +1,39 @@
 #include <arm_move_group/arm_move_group.h>
+#include <rclcpp_components/register_node_macro.hpp>
+#include <moveit/robot_state/conversions.h>
 
-ArmMoveGroup::ArmMoveGroup()
+ArmMoveGroup::ArmMoveGroup(const rclcpp::NodeOptions &options)
 {
-	rclcpp::NodeOptions node_options;
+	rclcpp::NodeOptions node_options(options);
 	node_options.automatically_declare_parameters_from_overrides(true);
-	mg_node_ = rclcpp::Node::make_shared("aro_movegroup_", node_options);
 	node_ = rclcpp::Node::make_shared(NODE_NAME, node_options);
 
+	// Only share parameters, a container's node name remapping is meant for node_
+	rclcpp::NodeOptions mg_node_options;
+	mg_node_options.parameter_overrides(options.parameter_overrides());
+	mg_node_options.automatically_declare_parameters_from_overrides(true);
+	mg_node_ = rclcpp::Node::make_shared("aro_movegroup_", node_->get_namespace(), mg_node_options);
+
+
+	// Arm served by this instance, one per namespace when several share a process
+	if (node_->has_parameter("planning_group"))
+		planning_group_ = node_->get_parameter("planning_group").as_string();
+	if (node_->has_parameter("move_group_namespace"))
+		move_group_namespace_ = node_->get_parameter("move_group_namespace").as_string();
+
+	const std::string arm_ns = node_->get_namespace();
+	const std::string arm_dir = (arm_ns == "/") ? PKG_DIR : PKG_DIR + arm_ns;
+	POSE_DIR = arm_dir + "/poses/";
+	TRAJ_DIR = arm_dir + "/trajectories/";
+	ROADMAP_FILE = arm_dir + "/roadmap.bin";
+	TRACKING_DIR = arm_dir + "/tracking/";
+	JOURNAL_FILE = arm_dir + "/save.journal";
+
+	RCLCPP_INFO(node_->get_logger(), "Serving planning group %s in %s.", planning_group_.c_str(), arm_ns.c_str());
+
+	// Loaded once per process, the move groups of all arms share the model
+	robot_model_loader_ = shared_robot_model_loader(mg_node_);
+
 
 	using namespace std::placeholders;
 
@@ -57,6 +84,11 @@ ArmMoveGroup::ArmMoveGroup()
 		std::bind(&ArmMoveGroup::get_state_cb_, this, _1, _2)
 	);
 
+	record_srv_ = node_->create_service<Record>(
+		"arm/Record",
+		std::bind(&ArmMoveGroup::record_cb_, this, _1, _2)
+	);
+
 
 	// Read launch parameters
 	visualize_trajectories_ = node_->get_parameter("visualize_trajectory").as_bool();
@@ -70,8 +102,21 @@ ArmMoveGroup::ArmMoveGroup()
 	if (servoing_)
 	{
 		RCLCPP_INFO(node_->get_logger(), "In servo mode.");
+
+		mode_node_ = rclcpp::Node::make_shared("arm_move_group_mode_client", node_->get_namespace());
+		mode_cli_ = mode_node_->create_client<SetControlMode>("arm/SetControlMode");
+		mode_executor_.add_node(mode_node_);
+		mode_thread_ = std::thread([this]() { mode_executor_.spin(); });
+
+		// Feedback of the move_group server this arm plans with
+		std::string mg_ns = move_group_namespace_;
+		while (!mg_ns.empty() && mg_ns.back() == '/')
+			mg_ns.pop_back();
+		if (!mg_ns.empty() && mg_ns.front() != '/')
+			mg_ns = "/" + mg_ns;
+
 		execution_feedback_sub_ = node_->create_subscription<ExecutionFeedback>(
-			"/execute_trajectory/_action/feedback",
+			mg_ns + "/execute_trajectory/_action/feedback",
 			rclcpp::QoS(1),
 			std::bind(&ArmMoveGroup::exec_feedback_cb_, this, _1)
 		);
@@ -82,7 +127,7 @@ ArmMoveGroup::ArmMoveGroup()
 
 
 	// Check if pose and trajectory save folders exist -- make them if not
-	RCLCPP_INFO(node_->get_logger(), "Checking for save directories in %s...", PKG_DIR.c_str());
+	RCLCPP_INFO(node_->get_logger(), "Checking for save directories in %s...", arm_dir.c_str());
 	struct stat buffer;
 
 	// Check trajectory save path
@@ -124,12 +169,51 @@ ArmMoveGroup::ArmMoveGroup()
 	}
 
 
+	// Finish saves interrupted by a crash before the roadmap loads the poses
+	saves_ = std::make_unique<SaveWriter>(JOURNAL_FILE, node_->get_logger());
+	saves_->recover();
+
+
+	// Plan the saved pose roadmap in the background
+	roadmap_ = std::make_unique<PoseRoadmap>(options, arm_ns, planning_group_, POSE_DIR, ROADMAP_FILE);
+	roadmap_->start();
+
+	tracking_ = std::make_unique<TrackingMonitor>(options, arm_ns, TRACKING_DIR);
+
+	recorder_ = std::make_unique<DemoRecorder>(options, arm_ns);
+
+
 	RCLCPP_INFO(node_->get_logger(), "Initialized!\n");
 }
 
 ArmMoveGroup::~ArmMoveGroup()
 {
 	RCLCPP_INFO(node_->get_logger(), "Destruct sequence initiated.");
+
+	if (mode_thread_.joinable())
+	{
+		mode_executor_.cancel();
+		mode_thread_.join();
+	}
+}
+
+
+rclcpp::node_interfaces::NodeBaseInterface::SharedPtr ArmMoveGroup::get_node_base_interface() const
+{
+	return node_->get_node_base_interface();
+}
+
+
+/**
+ * @brief Move group options of this arm, with the process' shared robot model so a
+ * MoveGroupInterface does not load its own.
+ *
+ */
+moveit::planning_interface::MoveGroupInterface::Options ArmMoveGroup::move_group_options_() const
+{
+	moveit::planning_interface::MoveGroupInterface::Options opt(planning_group_, "robot_description", move_group_namespace_);
+	opt.robot_model_ = robot_model_loader_->getModel();
+	return opt;
 }
 
 
@@ -140,40 +224,57 @@ void ArmMoveGroup::exec_feedback_cb_(const ExecutionFeedback::SharedPtr feedback
 
 	if (servoing_)
 	{
+		// Execution finished, hand the arm back to servo
 		if (strcmp(state.c_str(), "IDLE") == 0)
 		{
-			// Node for pausing servo_node if needed
+			set_control_mode_("servo", false);
+			toggled_servo_mode_ = true;
+		}
+	}
+}
 
-			auto servo_pause_cli_node = rclcpp::Node::make_shared("pause_servo_cli_node_");
-			
-			rclcpp::Client<SetBool>::SharedPtr pause_servo_cli;
-			rclcpp::Client<SetBool>::SharedPtr sw_hw_ctrl_mode_cli;
-			pause_servo_cli = servo_pause_cli_node->create_client<SetBool>("servo_node/pause_servo");
-			sw_hw_ctrl_mode_cli = servo_pause_cli_node->create_client<SetBool>("arm_hw_node/toggle_servo_mode");
 
-			auto req = std::make_shared<SetBool::Request>();
-			req->data = false;
 
-			auto future = pause_servo_cli->async_send_request(req);
+/**
+ * @brief Requests a plan/servo mode switch from the mode manager.
+ *
+ * @param mode "plan" or "servo"
+ * @param wait Block until the switch completed (a switch takes milliseconds)
+ * @return true if the request was sent and, when waiting, the switch succeeded
+ */
+bool ArmMoveGroup::set_control_mode_(const std::string &mode, bool wait)
+{
+	if (!mode_cli_->service_is_ready())
+	{
+		RCLCPP_ERROR(node_->get_logger(), "arm/SetControlMode not available, is arm_servo/mode_manager running?");
+		return false;
+	}
 
-			if (rclcpp::spin_until_future_complete(servo_pause_cli_node, future) == rclcpp::FutureReturnCode::SUCCESS)
-				RCLCPP_INFO(node_->get_logger(), "Called pause_servo service: %s", future.get()->message.c_str());
-			else
-				RCLCPP_ERROR(node_->get_logger(), "Failed to call pause_servo service");
+	auto req = std::make_shared<SetControlMode::Request>();
+	req->mode = mode;
 
-			req->data = true;
-			future = sw_hw_ctrl_mode_cli->async_send_request(req);
-			if (rclcpp::spin_until_future_complete(servo_pause_cli_node, future) == rclcpp::FutureReturnCode::SUCCESS)
-				RCLCPP_INFO(node_->get_logger(), "Called arm_hw_node/toggle_servo_mode service: %s", future.get()->message.c_str());
+	auto future = mode_cli_->async_send_request(
+		req,
+		[this](rclcpp::Client<SetControlMode>::SharedFuture result) {
+			auto res = result.get();
+			if (res->success)
+				RCLCPP_INFO(node_->get_logger(), "%s (%.1f ms)", res->msg.c_str(), res->latency_ms);
 			else
-				RCLCPP_ERROR(node_->get_logger(), "Failed to call arm_hw_node/toggle_servo_mode service");
+				RCLCPP_ERROR(node_->get_logger(), "%s", res->msg.c_str());
+		});
 
-			toggled_servo_mode_ = true;
+	if (!wait)
+		return true;
 
-		}
+	if (future.wait_for(2s) != std::future_status::ready)
+	{
+		RCLCPP_ERROR(node_->get_logger(), "Switch to %s mode timed out", mode.c_str());
+		mode_cli_->remove_pending_request(future);
+		return false;
 	}
-}
 
+	return future.get()->success;
+}
 
 
 void ArmMoveGroup::joint_space_goal_cb_(
@@ -181,12 +282,13 @@ void ArmMoveGroup::joint_space_goal_cb_(
 	std::shared_ptr<JointSpaceGoal::Response> response)
 {
 	RCLCPP_INFO(node_->get_logger(), "Joint space goal received.");
+	plan_label_ = "joint_space_goal";
 	
 
 	// Node for move group interface
 	rclcpp::NodeOptions node_options;
 	node_options.automatically_declare_parameters_from_overrides(true);
-	auto move_group_node = rclcpp::Node::make_shared("mgn", node_options);
+	auto move_group_node = rclcpp::Node::make_shared("mgn", node_->get_namespace(), node_options);
 
 	// Add node to executor and spin in another thread
 	rclcpp::executors::SingleThreadedExecutor executor;
@@ -194,8 +296,8 @@ void ArmMoveGroup::joint_space_goal_cb_(
 	std::thread t([&executor]() { executor.spin(); });
 
 	// Create move group interface using move_group_node
-	auto move_group = moveit::planning_interface::MoveGroupInterface(move_group_node, PLANNING_GROUP);
-	// auto move_group = moveit::planning_interface::MoveGroupInterface(mg_node_, PLANNING_GROUP);
+	auto move_group = moveit::planning_interface::MoveGroupInterface(move_group_node, move_group_options_());
+	// auto move_group = moveit::planning_interface::MoveGroupInterface(mg_node_, planning_group_);
 	
 	
 	// Start monitoring state of arm
@@ -212,7 +314,7 @@ void ArmMoveGroup::joint_space_goal_cb_(
 	move_group.setStartState(*current_state);
 
 	const moveit::core::JointModelGroup* joint_model_group =
-		move_group.getCurrentState()->getJointModelGroup(PLANNING_GROUP);
+		move_group.getCurrentState()->getJointModelGroup(planning_group_);
 	
 	const moveit::core::LinkModel* ee_link = 
 		joint_model_group->getLinkModel(move_group.getEndEffectorLink());
@@ -293,12 +395,13 @@ void ArmMoveGroup::pose_goal_cb_(
 	std::shared_ptr<PoseGoal::Response> response)
 {
 	RCLCPP_INFO(node_->get_logger(), "PoseGoal service called.");
+	plan_label_ = "pose_goal";
 
 	
 	// Node for move group interface
 	rclcpp::NodeOptions node_options;
 	node_options.automatically_declare_parameters_from_overrides(true);
-	auto move_group_node = rclcpp::Node::make_shared("mgn", node_options);
+	auto move_group_node = rclcpp::Node::make_shared("mgn", node_->get_namespace(), node_options);
 
 	// Add node to executor and spin in another thread
 	rclcpp::executors::SingleThreadedExecutor executor;
@@ -306,8 +409,8 @@ void ArmMoveGroup::pose_goal_cb_(
 	std::thread t([&executor]() { executor.spin(); });
 
 	// Create move group interface using move_group_node
-	auto move_group = moveit::planning_interface::MoveGroupInterface(move_group_node, PLANNING_GROUP);
-	// auto move_group = moveit::planning_interface::MoveGroupInterface(mg_node_, PLANNING_GROUP);
+	auto move_group = moveit::planning_interface::MoveGroupInterface(move_group_node, move_group_options_());
+	// auto move_group = moveit::planning_interface::MoveGroupInterface(mg_node_, planning_group_);
 
 	// Use STOMP
 	move_group.setPlanningPipelineId("stomp");
@@ -323,7 +426,7 @@ void ArmMoveGroup::pose_goal_cb_(
 
 	
 	const moveit::core::JointModelGroup* joint_model_group =
-      move_group.getCurrentState()->getJointModelGroup(PLANNING_GROUP);
+      move_group.getCurrentState()->getJointModelGroup(planning_group_);
 
 	const moveit::core::LinkModel* ee_link = 
 		joint_model_group->getLinkModel(move_group.getEndEffectorLink());
@@ -418,7 +521,7 @@ void ArmMoveGroup::pose_goal_array_cb_(
 	// Node for move group interface
 	rclcpp::NodeOptions node_options;
 	node_options.automatically_declare_parameters_from_overrides(true);
-	auto move_group_node = rclcpp::Node::make_shared("mgn", node_options);
+	auto move_group_node = rclcpp::Node::make_shared("mgn", node_->get_namespace(), node_options);
 
 	// Add node to executor and spin in another thread
 	rclcpp::executors::SingleThreadedExecutor executor;
@@ -426,8 +529,8 @@ void ArmMoveGroup::pose_goal_array_cb_(
 	std::thread t([&executor]() { executor.spin(); });
 
 	// Create move group interface using move_group_node
-	auto move_group = moveit::planning_interface::MoveGroupInterface(move_group_node, PLANNING_GROUP);
-	// auto move_group = moveit::planning_interface::MoveGroupInterface(mg_node_, PLANNING_GROUP);
+	auto move_group = moveit::planning_interface::MoveGroupInterface(move_group_node, move_group_options_());
+	// auto move_group = moveit::planning_interface::MoveGroupInterface(mg_node_, planning_group_);
 	
 	
 	// Start monitoring state of arm
@@ -437,7 +540,7 @@ void ArmMoveGroup::pose_goal_array_cb_(
 	move_group.setStartState(start_state);
 
 	const moveit::core::JointModelGroup* joint_model_group =
-      move_group.getCurrentState()->getJointModelGroup(PLANNING_GROUP);
+      move_group.getCurrentState()->getJointModelGroup(planning_group_);
 	
 	const moveit::core::LinkModel* ee_link = 
 		joint_model_group->getLinkModel(move_group.getEndEffectorLink());
@@ -448,6 +551,17 @@ void ArmMoveGroup::pose_goal_array_cb_(
 
 	// Get type of motion
 	const std::string type = request->type;
+	plan_label_ = "pose_goal_array_" + type;
+
+	// Standard path constraint kept along the motion (e.g. upright), empty for none
+	moveit_msgs::msg::Constraints path_constraint;
+	if (!request->path_constraint.empty() && !load_path_constraint(node_, request->path_constraint, path_constraint))
+	{
+		response->success = false;
+		executor.cancel();
+		t.join();
+		return;
+	}
 
 	if (!strcmp(type.c_str(), "linear"))
 	{
@@ -465,7 +579,7 @@ void ArmMoveGroup::pose_goal_array_cb_(
 		// const double eef_step = 0.01; 		// 1cm interpolation resolution
 		const double jump_threshold = request->jump_threshold;
 		const double eef_step = request->step_size;
-		double fraction = move_group.computeCartesianPath(waypoints, eef_step, jump_threshold, trajectory);
+		double fraction = move_group.computeCartesianPath(waypoints, eef_step, jump_threshold, trajectory, path_constraint);
 
 		// If percent of path achieved >= 95%
 		if ((fraction * 100.0) >= 95.0 )
@@ -541,6 +655,17 @@ void ArmMoveGroup::pose_goal_array_cb_(
 		// Generate motion plan
 		bool success = (move_group.plan(plan_) == moveit::core::MoveItErrorCode::SUCCESS);
 
+		// Pilz interpolates the orientation between start and endpoint, check it stays within the path constraint
+		if (success && !path_constraint.name.empty())
+		{
+			const long violation = first_path_constraint_violation(move_group.getRobotModel(), plan_.trajectory, path_constraint);
+			if (violation >= 0)
+			{
+				RCLCPP_ERROR(node_->get_logger(), "Arc violates path constraint %s at waypoint %ld.", path_constraint.name.c_str(), violation);
+				success = false;
+			}
+		}
+
 		if (success)
 		{
 			RCLCPP_INFO(node_->get_logger(), "Motion plan successful!\n");
@@ -578,6 +703,70 @@ void ArmMoveGroup::pose_goal_array_cb_(
 
 		move_group.clearPathConstraints();
 	}
+	else if (!strcmp(type.c_str(), "constrained"))
+	{
+		RCLCPP_INFO(node_->get_logger(), "Constrained motion request received (%s).", path_constraint.name.c_str());
+
+		if (path_constraint.name.empty() || request->waypoints.empty())
+		{
+			RCLCPP_ERROR(node_->get_logger(), "Constrained motion needs a path_constraint and a goal waypoint.");
+			response->success = false;
+			executor.cancel();
+			t.join();
+			return;
+		}
+
+		// OMPL draws the constrained states from the constraint approximation database
+		// (generate_constraint_database), falling back to rejection sampling without one
+		move_group.setPlanningPipelineId("ompl");
+
+		geometry_msgs::msg::PoseStamped goal;
+		goal.pose = request->waypoints.back();
+		goal.header.frame_id = "arm_Link";
+		move_group.setPoseTarget(goal);
+		move_group.setPathConstraints(path_constraint);
+
+		const auto plan_start = std::chrono::steady_clock::now();
+		bool success = (move_group.plan(plan_) == moveit::core::MoveItErrorCode::SUCCESS);
+		const double plan_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - plan_start).count();
+
+		if (success)
+		{
+			RCLCPP_INFO(node_->get_logger(), "Motion plan successful (%.2fs)!\n", plan_time);
+			response->success = true;
+
+			if (visualize_trajectories_)
+			{
+				moveit_visual_tools::MoveItVisualTools visual_tools(
+					mg_node_,
+					move_group.getPlanningFrame(),
+					"arm_marker_array",
+					move_group.getRobotModel());
+
+				visual_tools.deleteAllMarkers();
+
+				bool visualized = visual_tools.publishTrajectoryLine(
+					plan_.trajectory,
+					ee_link,
+					joint_model_group
+				);
+
+				visual_tools.trigger();
+			
+				if (visualized)
+					RCLCPP_INFO(node_->get_logger(), "Motion plan visualized.");
+				else
+					RCLCPP_ERROR(node_->get_logger(), "Motion plan visualization failed\n");
+			}
+		}
+		else
+		{
+			RCLCPP_ERROR(node_->get_logger(), "Motion plan failed (%.2fs)\n", plan_time);
+			response->success = false;
+		}
+
+		move_group.clearPathConstraints();
+	}
 	else
 	{
 		RCLCPP_ERROR(node_->get_logger(), "Unrecognized pose goal array type (%s), see PoseGoalArray.srv", type.c_str());
@@ -603,7 +792,7 @@ void ArmMoveGroup::stop_cb_(
 	// Node for move group interface
 	rclcpp::NodeOptions node_options;
 	node_options.automatically_declare_parameters_from_overrides(true);
-	auto move_group_node = rclcpp::Node::make_shared("mg_stop_node", node_options);
+	auto move_group_node = rclcpp::Node::make_shared("mg_stop_node", node_->get_namespace(), node_options);
 
 	// Add node to executor and spin in another thread
 	rclcpp::executors::SingleThreadedExecutor executor;
@@ -611,12 +800,13 @@ void ArmMoveGroup::stop_cb_(
 	std::thread t([&executor]() { executor.spin(); });
 
 	// Create move group interface using move_group_node
-	auto move_group = moveit::planning_interface::MoveGroupInterface(move_group_node, PLANNING_GROUP);
-	// auto move_group = moveit::planning_interface::MoveGroupInterface(mg_node_, PLANNING_GROUP);
+	auto move_group = moveit::planning_interface::MoveGroupInterface(move_group_node, move_group_options_());
+	// auto move_group = moveit::planning_interface::MoveGroupInterface(mg_node_, planning_group_);
 
 	try
 	{
 		move_group.stop();
+		tracking_->cancel();
 		RCLCPP_INFO(node_->get_logger(), "Motion plan execution stopped!\n");
 		response->message = "Motion plan execution stopped!\n";
 		response->success = true;
@@ -638,7 +828,7 @@ void ArmMoveGroup::clear_cb_(const std_msgs::msg::Bool::SharedPtr clear_msg)
 {
 	if (clear_msg->data)
 	{
-		auto move_group = moveit::planning_interface::MoveGroupInterface(mg_node_, PLANNING_GROUP);
+		auto move_group = moveit::planning_interface::MoveGroupInterface(mg_node_, move_group_options_());
 		move_group.startStateMonitor(5.0);
 
 		if (joint_space_goal_recv_)
@@ -688,7 +878,7 @@ void ArmMoveGroup::save_cb_(
 	// Node for move group interface
 	rclcpp::NodeOptions node_options;
 	node_options.automatically_declare_parameters_from_overrides(true);
-	auto move_group_node = rclcpp::Node::make_shared("mgn", node_options);
+	auto move_group_node = rclcpp::Node::make_shared("mgn", node_->get_namespace(), node_options);
 
 	// Add node to executor and spin in another thread
 	rclcpp::executors::SingleThreadedExecutor executor;
@@ -696,8 +886,8 @@ void ArmMoveGroup::save_cb_(
 	std::thread t([&executor]() { executor.spin(); });
 
 	// Create move group interface using move_group_node
-	auto move_group = moveit::planning_interface::MoveGroupInterface(move_group_node, PLANNING_GROUP);
-	// auto move_group = moveit::planning_interface::MoveGroupInterface(mg_node_, PLANNING_GROUP);
+	auto move_group = moveit::planning_interface::MoveGroupInterface(move_group_node, move_group_options_());
+	// auto move_group = moveit::planning_interface::MoveGroupInterface(mg_node_, planning_group_);
 	
 	// Start monitoring state of arm
 	move_group.startStateMonitor(2.0);
@@ -707,7 +897,7 @@ void ArmMoveGroup::save_cb_(
 	
 	std::vector<double> current_joint_positions;
 	const moveit::core::JointModelGroup* joint_model_group =
-		move_group.getCurrentState()->getJointModelGroup(PLANNING_GROUP);
+		move_group.getCurrentState()->getJointModelGroup(planning_group_);
 
 	current_state->copyJointGroupPositions(joint_model_group, current_joint_positions);
 
@@ -720,7 +910,7 @@ void ArmMoveGroup::save_cb_(
 		file_name.append(label);
 		file_name.append(".pose.json");
 		
-		if (rcpputils::fs::exists(file_name))
+		if (saves_->exists(file_name))
 		{
 			RCLCPP_ERROR(node_->get_logger(), "Pose with label %s already exists, pick another label!", label.c_str());
 			response->msg = "Saved pose with that label already exists, pick another label!";
@@ -734,49 +924,33 @@ void ArmMoveGroup::save_cb_(
 		}
 		
 
-		// for (uint i = 0; i < NUM_JOINTS; i++)
-		// 	RCLCPP_INFO(node_->get_logger(), "J%d: %f", (i + 1), joint_group_positions[i]);
-
-
 		SerializedPose sp;
 		sp.joint_positions = current_joint_positions;
 	
 
-		//* Serialize current pose data and save into json
-		RCLCPP_INFO(node_->get_logger(), "Saving pose into: %s", file_name.c_str());
+		//* Serialize current pose data into json, written by the save journal
+		std::ostringstream os;
 		{
-			std::ofstream os(file_name.c_str());
 			cereal::JSONOutputArchive oa(os);
 
 			oa( cereal::make_nvp(label.c_str(), sp) );
 		}
 
-
-		// std::vector<double> joint_group_positions_temp;
-		SerializedPose sp_temp;
-		{
-			std::ifstream is(file_name.c_str(), std::ios::in);
-			cereal::JSONInputArchive ia(is);
-
-			ia( sp_temp );
-		}
-
-
-		RCLCPP_INFO(node_->get_logger(), "Reading back saved pose: ");
-		for (uint i = 0; i < NUM_JOINTS; i++)
-			RCLCPP_INFO(node_->get_logger(), "J%d: %f", (i + 1), sp_temp.joint_positions[i]);
-			
-
-		if (!memcmp(&current_joint_positions.front(), &sp_temp.joint_positions.front(), (size_t) NUM_JOINTS))
+		RCLCPP_INFO(node_->get_logger(), "Saving pose into: %s", file_name.c_str());
+		std::string msg;
+		if (save_file_(file_name, os.str(), msg))
 		{
 			RCLCPP_INFO(node_->get_logger(), "Pose successfully saved into %s", file_name.c_str());
 			response->msg = "Pose successfully saved!";
 			response->saved = true;
+
+			// Plan only the new pose's roadmap edges
+			roadmap_->add_pose(label, current_joint_positions);
 		}
 		else
 		{
 			RCLCPP_INFO(node_->get_logger(), "Saving pose failed.");
-			response->msg = "Saving pose failed, try again.";
+			response->msg = "Saving pose failed, try again. " + msg;
 			response->saved = false;
 		}
 
@@ -788,7 +962,7 @@ void ArmMoveGroup::save_cb_(
 		file_name.append(label);
 		file_name.append(".trajectory");
 
-		if (rcpputils::fs::exists(file_name))
+		if (saves_->exists(file_name))
 		{
 			RCLCPP_ERROR(node_->get_logger(), "Trajectory with label %s already exists, pick another label!", label.c_str());
 			response->msg = "Saved trajectory with that label already exists!";
@@ -801,53 +975,7 @@ void ArmMoveGroup::save_cb_(
 			return;
 		}
 
-		// Create SerializedTrajectory obj and allocate appropriate size for vectors
-		SerializedTrajectory st;
-		size_t num_points = plan_.trajectory.joint_trajectory.points.size();
-		st.points.resize(num_points);
-		st.starting_joint_positions.resize(plan_.trajectory.joint_trajectory.points[0].positions.size());
-		st.joint_names.resize(NUM_JOINTS);
-		st.sec.resize(num_points);
-		st.nanosec.resize(num_points);
-		st.frame_id.resize(move_group.getPlanningFrame().size()); 
-		st.model_id.resize(move_group.getRobotModel()->getName().size());
-
-		st.frame_id = move_group.getPlanningFrame();
-		st.model_id = move_group.getRobotModel()->getName();
-		RCLCPP_INFO(node_->get_logger(), "Saving start trajectory pose:\n");
-		for (uint i = 0; i < NUM_JOINTS; i++)
-		{
-			// Set 1st position in trajectory as starting pose
-			st.starting_joint_positions[i] = plan_.trajectory.joint_trajectory.points[0].positions[i];
-			RCLCPP_INFO(node_->get_logger(), "%f\n", plan_.trajectory.joint_trajectory.points[0].positions[i]);
-		}
-
-		RCLCPP_INFO(node_->get_logger(), "Saving trajectory with %lu points.", num_points);
-
-		// Copy over joint names
-		std::vector< std::string > joint_names_ = plan_.trajectory.joint_trajectory.joint_names;
-		for (uint i = 0; i < NUM_JOINTS; i++)
-			st.joint_names[i] = joint_names_[i];
-
-		// Copy over point joint positions and time stamps
-		for (uint i = 0; i < num_points; i++)
-		{
-			st.points[i].reserve(NUM_JOINTS);
-			st.points[i] = plan_.trajectory.joint_trajectory.points[i].positions;
-			st.sec[i] = plan_.trajectory.joint_trajectory.points[i].time_from_start.sec;
-			st.nanosec[i] = plan_.trajectory.joint_trajectory.points[i].time_from_start.nanosec;
-		}
-
-		// Serialize trajectory object and save into binary
-		{
-			std::ofstream os(file_name.c_str(), std::ios::binary);
-			cereal::BinaryOutputArchive oa(os);
-
-			oa( st );
-		}
-
-		RCLCPP_INFO(node_->get_logger(), "Trajectory saved at %s\n", file_name.c_str());
-		response->saved = true;
+		response->saved = save_trajectory_(file_name, plan_.trajectory.joint_trajectory, move_group.getPlanningFrame(), move_group.getRobotModel()->getName());
 	}
 	else
 	{
@@ -863,55 +991,112 @@ void ArmMoveGroup::save_cb_(
 }
 
 
-void ArmMoveGroup::execute_cb_(
-	const std::shared_ptr<Trigger::Request> request, 
-	std::shared_ptr<Trigger::Response> response)
+/**
+ * @brief Serializes a joint trajectory into a binary trajectory file.
+ * 
+ * @param file_name Trajectory file
+ * @param trajectory Trajectory, its first point is the starting pose
+ * @param frame_id Planning frame
+ * @param model_id Robot model name
+ * @return true if the file was written
+ */
+bool ArmMoveGroup::save_trajectory_(
+	const std::string &file_name,
+	const trajectory_msgs::msg::JointTrajectory &trajectory,
+	const std::string &frame_id,
+	const std::string &model_id)
 {
-	// Supress compiler warning
-	(void) request;
+	// Create SerializedTrajectory obj and allocate appropriate size for vectors
+	SerializedTrajectory st;
+	size_t num_points = trajectory.points.size();
+	st.points.resize(num_points);
+	st.starting_joint_positions.resize(trajectory.points[0].positions.size());
+	st.joint_names.resize(NUM_JOINTS);
+	st.sec.resize(num_points);
+	st.nanosec.resize(num_points);
+
+	st.frame_id = frame_id;
+	st.model_id = model_id;
+	RCLCPP_INFO(node_->get_logger(), "Saving start trajectory pose:\n");
+	for (uint i = 0; i < NUM_JOINTS; i++)
+	{
+		// Set 1st position in trajectory as starting pose
+		st.starting_joint_positions[i] = trajectory.points[0].positions[i];
+		RCLCPP_INFO(node_->get_logger(), "%f\n", trajectory.points[0].positions[i]);
+	}
 
-	// Pause servo_node if running
-	if (servoing_)
+	RCLCPP_INFO(node_->get_logger(), "Saving trajectory with %lu points.", num_points);
+
+	// Copy over joint names
+	for (uint i = 0; i < NUM_JOINTS; i++)
+		st.joint_names[i] = trajectory.joint_names[i];
+
+	// Copy over point joint positions and time stamps
+	for (uint i = 0; i < num_points; i++)
 	{
-		// Node for pausing servo_node if needed
-		auto servo_pause_cli_node = rclcpp::Node::make_shared("pause_servo_cli_node_");
-		
-		rclcpp::Client<SetBool>::SharedPtr pause_servo_cli;
-		rclcpp::Client<SetBool>::SharedPtr sw_hw_ctrl_mode_cli;
+		st.points[i] = trajectory.points[i].positions;
+		st.sec[i] = trajectory.points[i].time_from_start.sec;
+		st.nanosec[i] = trajectory.points[i].time_from_start.nanosec;
+	}
 
-		pause_servo_cli = servo_pause_cli_node->create_client<SetBool>("servo_node/pause_servo");
-		sw_hw_ctrl_mode_cli = servo_pause_cli_node->create_client<SetBool>("arm_hw_node/toggle_servo_mode");
-		
+	// Serialize trajectory object into binary, written by the save journal
+	std::ostringstream os(std::ios::binary);
+	{
+		cereal::BinaryOutputArchive oa(os);
 
-		auto req = std::make_shared<SetBool::Request>();
-		req->data = true;
+		oa( st );
+	}
 
-		auto future = pause_servo_cli->async_send_request(req);
-		if (rclcpp::spin_until_future_complete(servo_pause_cli_node, future) == rclcpp::FutureReturnCode::SUCCESS)
-			RCLCPP_INFO(node_->get_logger(), "Called pause_servo service: %s", future.get()->message.c_str());
-		else
-			RCLCPP_ERROR(node_->get_logger(), "Failed to call pause_servo service");
-		
+	std::string msg;
+	if (!save_file_(file_name, os.str(), msg))
+	{
+		RCLCPP_ERROR(node_->get_logger(), "Could not write trajectory %s: %s", file_name.c_str(), msg.c_str());
+		return false;
+	}
 
-		// if (!toggled_servo_mode_)
-		// {
-			req->data = false;
-			future = sw_hw_ctrl_mode_cli->async_send_request(req);
-			if (rclcpp::spin_until_future_complete(servo_pause_cli_node, future) == rclcpp::FutureReturnCode::SUCCESS)
-				RCLCPP_INFO(node_->get_logger(), "Called arm_hw_node/toggle_servo_mode service: %s", future.get()->message.c_str());
-			else
-				RCLCPP_ERROR(node_->get_logger(), "Failed to call arm_hw_node/toggle_servo_mode service");
+	RCLCPP_INFO(node_->get_logger(), "Trajectory saved at %s\n", file_name.c_str());
+	return true;
+}
 
-			toggled_servo_mode_ = true;
-		// }
 
+/**
+ * @brief Hands a serialized pose or trajectory to the save journal and waits until it is
+ * durable there. The file itself is put in place by the writer thread right after.
+ * 
+ * @param file_name Pose or trajectory file
+ * @param data File contents
+ * @param msg Reason on failure
+ * @return true once the save survives a crash
+ */
+bool ArmMoveGroup::save_file_(const std::string &file_name, std::string data, std::string &msg)
+{
+	SaveWriter::Result result = saves_->submit(file_name, std::move(data)).get();
+	msg = result.msg;
+	return result.durable;
+}
+
+
+void ArmMoveGroup::execute_cb_(
+	const std::shared_ptr<Trigger::Request> request, 
+	std::shared_ptr<Trigger::Response> response)
+{
+	// Supress compiler warning
+	(void) request;
+
+	// Take the arm over from servo before executing, servo_node would fight the trajectory
+	if (servoing_ && !set_control_mode_("plan", true))
+	{
+		RCLCPP_ERROR(node_->get_logger(), "Could not switch to planning mode, not executing\n");
+		response->message = "Could not switch to planning mode";
+		response->success = false;
+		return;
 	}
 
 
 	// Node for move group interface
 	rclcpp::NodeOptions node_options;
 	node_options.automatically_declare_parameters_from_overrides(true);
-	auto move_group_node = rclcpp::Node::make_shared("mgn", node_options);
+	auto move_group_node = rclcpp::Node::make_shared("mgn", node_->get_namespace(), node_options);
 
 	// Add node to executor and spin in another thread
 	rclcpp::executors::SingleThreadedExecutor executor;
@@ -919,8 +1104,8 @@ void ArmMoveGroup::execute_cb_(
 	std::thread t([&executor]() { executor.spin(); });
 
 	// Create move group interface using move_group_node
-	auto move_group = moveit::planning_interface::MoveGroupInterface(move_group_node, PLANNING_GROUP);
-	// auto move_group = moveit::planning_interface::MoveGroupInterface(mg_node_, PLANNING_GROUP);
+	auto move_group = moveit::planning_interface::MoveGroupInterface(move_group_node, move_group_options_());
+	// auto move_group = moveit::planning_interface::MoveGroupInterface(mg_node_, planning_group_);
 	
 	
 	// Start monitoring state of arm
@@ -928,6 +1113,9 @@ void ArmMoveGroup::execute_cb_(
 	move_group.setStartStateToCurrentState();
 
 
+	// Record from before the motion starts
+	tracking_->start(plan_label_, plan_.trajectory.joint_trajectory);
+
 	if (move_group.asyncExecute(plan_) == moveit::core::MoveItErrorCode::SUCCESS)
 	{
 		RCLCPP_INFO(node_->get_logger(), "Motion plan executed!\n");
@@ -939,6 +1127,8 @@ void ArmMoveGroup::execute_cb_(
 		RCLCPP_ERROR(node_->get_logger(), "Motion execution failed\n");
 		response->message = "Motion execution failed";
 		response->success = false;
+
+		tracking_->cancel();
 	}
 
 	// Stop executor spin and join thread
@@ -955,7 +1145,7 @@ void ArmMoveGroup::execute_saved_cb_(
 	// Node for move group interface
 	rclcpp::NodeOptions node_options;
 	node_options.automatically_declare_parameters_from_overrides(true);
-	auto move_group_node = rclcpp::Node::make_shared("mgn", node_options);
+	auto move_group_node = rclcpp::Node::make_shared("mgn", node_->get_namespace(), node_options);
 
 	// Preemptively make mgn /display_planned_path publisher
 	display_trajectory_pub_ = move_group_node->create_publisher<moveit_msgs::msg::DisplayTrajectory>(
@@ -970,13 +1160,13 @@ void ArmMoveGroup::execute_saved_cb_(
 
 
 	// Create move group interface using move_group_node
-	auto move_group = moveit::planning_interface::MoveGroupInterface(move_group_node, PLANNING_GROUP);
+	auto move_group = moveit::planning_interface::MoveGroupInterface(move_group_node, move_group_options_());
 	move_group.startStateMonitor(2.0);
 	moveit::core::RobotStatePtr current_state = move_group.getCurrentState(2.0);
 	move_group.setStartState(*current_state);
 
 	const moveit::core::JointModelGroup* joint_model_group =
-		current_state->getJointModelGroup(PLANNING_GROUP);
+		current_state->getJointModelGroup(planning_group_);
 
 	const moveit::core::LinkModel* ee_link = joint_model_group->getLinkModel(move_group.getEndEffectorLink());
 
@@ -987,6 +1177,7 @@ void ArmMoveGroup::execute_saved_cb_(
 
 	// Get user-selected pose/trajectory
 	const std::string label = request->label;
+	plan_label_ = type + "_" + label;
 
 
 	if (!strcmp(type.c_str(), "pose"))
@@ -996,15 +1187,22 @@ void ArmMoveGroup::execute_saved_cb_(
 		file_path.append(label);
 		file_path.append(".pose.json");
 
+		// A pose saved a moment ago may still be on its way from the journal
+		saves_->wait(file_path);
 		if (!rcpputils::fs::exists(file_path))
 		{
 			RCLCPP_ERROR(node_->get_logger(), "Pose labelled %s doesn't exist!", label.c_str());
 			response->executed = false;
 			response->msg = "Pose labelled " + label + " doesn't exist!";
+
+			// Stop executor spin and join thread
+			executor.cancel();
+			t.join();
+
 			return;
 		}
 
-		const double speed_factor = (double) (request->speed / 100);
+		const double speed_factor = request->speed / 100.0;
 		move_group.setMaxVelocityScalingFactor(speed_factor);
 
 		// Create and load serialized pose obj
@@ -1016,14 +1214,36 @@ void ArmMoveGroup::execute_saved_cb_(
 			ia( sp );
 		}
 
-		bool within_bounds = move_group.setJointValueTarget(sp.joint_positions);
-		if (!within_bounds)
+		// Roadmap route from the saved pose the arm is at, plan only if there is none
+		std::vector<double> current_joint_pos;
+		current_state->copyJointGroupPositions(joint_model_group, current_joint_pos);
+
+		moveit_msgs::msg::RobotTrajectory roadmap_trajectory;
+		bool success = false;
+
+		// speed 0 uses the default velocity scaling factor of joint_limits.yaml
+		if (roadmap_->lookup(current_joint_pos, label, (speed_factor > 0.0) ? speed_factor : 0.1, roadmap_trajectory))
 		{
-			RCLCPP_WARN(node_->get_logger(), "Target joint position(s) were outside of limits, but we will plan and clamp to the limits ");
+			roadmap_trajectory.joint_trajectory.header.frame_id = move_group.getPlanningFrame();
+			roadmap_trajectory.joint_trajectory.header.stamp = node_->now();
+
+			plan_.trajectory = roadmap_trajectory;
+			moveit::core::robotStateToRobotStateMsg(*current_state, plan_.start_state);
+			plan_.planning_time = 0.0;
+
+			RCLCPP_INFO(node_->get_logger(), "Using roadmap trajectory to %s.", label.c_str());
+			success = true;
 		}
+		else
+		{
+			bool within_bounds = move_group.setJointValueTarget(sp.joint_positions);
+			if (!within_bounds)
+			{
+				RCLCPP_WARN(node_->get_logger(), "Target joint position(s) were outside of limits, but we will plan and clamp to the limits ");
+			}
 
-		
-		bool success = (move_group.plan(plan_) == moveit::core::MoveItErrorCode::SUCCESS);
+			success = (move_group.plan(plan_) == moveit::core::MoveItErrorCode::SUCCESS);
+		}
 
 		if (success)
 		{
@@ -1071,6 +1291,7 @@ void ArmMoveGroup::execute_saved_cb_(
 		file_path.append(".trajectory");
 
 		// Check if trajectory file  with same label already exists
+		saves_->wait(file_path);
 		if (!rcpputils::fs::exists(file_path))
 		{
 			RCLCPP_ERROR(node_->get_logger(), "Trajectory labelled %s doesn't exist!", label.c_str());
@@ -1239,7 +1460,7 @@ void ArmMoveGroup::get_state_cb_(
 	// Node for move group interface
 	rclcpp::NodeOptions node_options;
 	node_options.automatically_declare_parameters_from_overrides(true);
-	auto move_group_node = rclcpp::Node::make_shared("mgn", node_options);
+	auto move_group_node = rclcpp::Node::make_shared("mgn", node_->get_namespace(), node_options);
 
 	// Add node to executor and spin in another thread
 	rclcpp::executors::SingleThreadedExecutor executor;
@@ -1247,8 +1468,8 @@ void ArmMoveGroup::get_state_cb_(
 	std::thread t([&executor]() { executor.spin(); });
 
 	// Create move group interface using move_group_node
-	auto move_group = moveit::planning_interface::MoveGroupInterface(move_group_node, PLANNING_GROUP);
-	// auto move_group = moveit::planning_interface::MoveGroupInterface(mg_node_, PLANNING_GROUP);
+	auto move_group = moveit::planning_interface::MoveGroupInterface(move_group_node, move_group_options_());
+	// auto move_group = moveit::planning_interface::MoveGroupInterface(mg_node_, planning_group_);
 	
 	
 	// Start monitoring state of arm
@@ -1282,27 +1503,108 @@ void ArmMoveGroup::get_state_cb_(
 
 
 
-int main(int argc, char** argv)
+/**
+ * @brief Teach by demonstration: records the arm's motion (e.g. jogged with servo) between
+ * "start" and "stop", then saves it as a trajectory replayable with arm/ExecuteSaved.
+ * 
+ * @param request "start" with the label to save under, "stop" or "cancel"
+ * @param response Success, and the recording statistics on stop
+ */
+void ArmMoveGroup::record_cb_(
+	const std::shared_ptr<Record::Request> request, 
+	std::shared_ptr<Record::Response> response)
 {
-	rclcpp::init(argc, argv);
+	const std::string action = request->action;
+	response->success = false;
 
-	auto arm_move_group = ArmMoveGroup();
+	if (!strcmp(action.c_str(), "cancel"))
+	{
+		recorder_->cancel();
+		response->success = true;
+		response->msg = "Recording discarded";
+		return;
+	}
+
+	if (strcmp(action.c_str(), "start") && strcmp(action.c_str(), "stop"))
+	{
+		response->msg = "Invalid action, choose 'start', 'stop' or 'cancel'";
+		return;
+	}
 
-	// rclcpp::executors::MultiThreadedExecutor executor;
-	// executor.add_node(arm_move_group.mg_node_);
-	// executor.add_node(arm_move_group.node_);
-	// std::thread([&executor]() { executor.spin(); }).detach();
+	if (!strcmp(action.c_str(), "start"))
+	{
+		std::string file_name = TRAJ_DIR + request->label + ".trajectory";
 
-	try
+		if (request->label.empty() || saves_->exists(file_name))
+		{
+			RCLCPP_ERROR(node_->get_logger(), "Trajectory with label %s already exists, pick another label!", request->label.c_str());
+			response->msg = "Saved trajectory with that label already exists, pick another label!";
+			return;
+		}
+	}
+	else if (!recorder_->recording())
 	{
-		rclcpp::spin(arm_move_group.node_);
-		// executor.spin();
+		response->msg = "Not recording";
+		return;
 	}
-	catch(const std::exception& e)
+
+
+	// Node for move group interface
+	rclcpp::NodeOptions node_options;
+	node_options.automatically_declare_parameters_from_overrides(true);
+	auto move_group_node = rclcpp::Node::make_shared("mgn", node_->get_namespace(), node_options);
+
+	// Add node to executor and spin in another thread
+	rclcpp::executors::SingleThreadedExecutor executor;
+	executor.add_node(move_group_node);
+	std::thread t([&executor]() { executor.spin(); });
+
+	// Create move group interface using move_group_node
+	auto move_group = moveit::planning_interface::MoveGroupInterface(move_group_node, move_group_options_());
+
+
+	if (!strcmp(action.c_str(), "start"))
 	{
-		std::cerr << "Exception caught during spin: " << e.what() << '\n';
+		record_label_ = request->label;
+		recorder_->start(move_group.getActiveJoints());
+
+		RCLCPP_INFO(node_->get_logger(), "Recording demonstration %s.", record_label_.c_str());
+		response->success = true;
+		response->msg = "Recording started";
+	}
+	else
+	{
+		DemoRecorder::Result result;
+		std::string msg;
+
+		std::string file_name = TRAJ_DIR + record_label_ + ".trajectory";
+
+		if (recorder_->stop(move_group.getRobotModel(), planning_group_, result, msg) &&
+			save_trajectory_(file_name, result.trajectory, move_group.getPlanningFrame(), move_group.getRobotModel()->getName()))
+		{
+			response->success = true;
+			response->msg = "Demonstration saved as trajectory " + record_label_;
+			response->samples = result.samples;
+			response->waypoints = result.waypoints;
+			response->duration = rclcpp::Duration(result.trajectory.points.back().time_from_start).seconds();
+		}
+		else
+		{
+			if (msg.empty())
+				msg = "Could not write " + file_name;
+
+			RCLCPP_ERROR(node_->get_logger(), "Recording %s failed: %s", record_label_.c_str(), msg.c_str());
+			response->msg = msg;
+			response->samples = result.samples;
+		}
 	}
 
-	rclcpp::shutdown();
-	return 0;
-}
\ No newline at end of file
+
+	// Stop executor spin and join thread
+	executor.cancel();
+	t.join();
+}
+
+
+// Standalone executable generated by rclcpp_components_register_node (see CMakeLists.txt)
+RCLCPP_COMPONENTS_REGISTER_NODE(ArmMoveGroup)
@@ -0,0 +1,67 @@
+#include <arm_move_group/arm_move_group.h>
+
+
+/**
+ * @brief Serves several arms from one process.
+ *
+ * Every entry of the `arms` parameter, "<namespace>:<planning group>", gets an ArmMoveGroup
+ * in that namespace (services, save folders and helper nodes), planning for that group.
+ * The parameters given to the process, e.g. the robot description of all arms, apply to
+ * every arm.
+ *
+ * The robot model (URDF/SRDF, collision geometry, kinematics plugins) is loaded by the first
+ * arm and shared read-only by the others, each arm adds its own state and scene monitors
+ * only. The arms spin on a multi-threaded executor, so requests to different arms are
+ * planned concurrently while the requests of one arm stay in order.
+ *
+ */
+int main(int argc, char **argv)
+{
+	rclcpp::init(argc, argv);
+
+	auto node = rclcpp::Node::make_shared("arm_move_group_multi");
+	const auto arms = node->declare_parameter<std::vector<std::string>>("arms", {"arm:arm_group"});
+	const auto threads = node->declare_parameter<int64_t>("threads", 0);
+
+	std::vector<std::unique_ptr<ArmMoveGroup>> arm_move_groups;
+	for (const std::string &arm : arms)
+	{
+		const size_t sep = arm.find(':');
+		if (sep == std::string::npos || sep == 0 || sep + 1 == arm.size())
+		{
+			RCLCPP_ERROR(node->get_logger(), "Skipping arm '%s', expected <namespace>:<planning group>.", arm.c_str());
+			continue;
+		}
+		const std::string ns = arm.substr(0, sep);
+		const std::string group = arm.substr(sep + 1);
+
+		rclcpp::NodeOptions options;
+		options.arguments({
+			"--ros-args",
+			"-r", "__ns:=" + (ns[0] == '/' ? ns : "/" + ns),
+			"-p", "planning_group:=" + group
+		});
+
+		const auto start = std::chrono::steady_clock::now();
+		arm_move_groups.push_back(std::make_unique<ArmMoveGroup>(options));
+		RCLCPP_INFO(node->get_logger(), "Arm %s (%s) up in %.2fs.", ns.c_str(), group.c_str(),
+			std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+	}
+
+	if (arm_move_groups.empty())
+	{
+		RCLCPP_ERROR(node->get_logger(), "No arms to serve.");
+		rclcpp::shutdown();
+		return 1;
+	}
+
+	rclcpp::executors::MultiThreadedExecutor executor(rclcpp::ExecutorOptions(),
+		threads > 0 ? (size_t) threads : std::max<size_t>(arm_move_groups.size(), 2));
+	for (const auto &arm : arm_move_groups)
+		executor.add_node(arm->get_node_base_interface());
+	executor.spin();
+
+	arm_move_groups.clear();
+	rclcpp::shutdown();
+	return 0;
+}
@@ -0,0 +1,350 @@
+#include <arm_move_group/demo_recorder.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include <moveit/robot_state/robot_state.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include <moveit/trajectory_processing/time_optimal_trajectory_generation.h>
+
+
+//* The smoothed recording has no content faster than this, compressed from samples this far apart [s]
+static constexpr double DECIMATE_DT = 0.01;
+
+//* Waypoint spacing of the timed trajectory [s]
+static constexpr double RESAMPLE_DT = 0.01;
+
+
+template <typename T>
+static T param(const rclcpp::Node::SharedPtr &node, const std::string &name, const T &default_value)
+{
+	if (!node->has_parameter(name))
+		return node->declare_parameter<T>(name, default_value);
+	return node->get_parameter(name).get_value<T>();
+}
+
+
+DemoRecorder::DemoRecorder(const rclcpp::NodeOptions &options, const std::string &ns)
+{
+	rclcpp::NodeOptions node_options;
+	node_options.parameter_overrides(options.parameter_overrides());
+	node_options.automatically_declare_parameters_from_overrides(true);
+	node_ = rclcpp::Node::make_shared("arm_demo_recorder", ns, node_options);
+
+	const std::string topic = param<std::string>(node_, "demo.state_topic", "joint_states");
+	max_duration_ = param<double>(node_, "demo.max_duration", 120.0);
+	max_rate_ = param<double>(node_, "demo.max_rate", 1000.0);
+	smoothing_time_ = param<double>(node_, "demo.smoothing_time", 0.05);
+	tolerance_ = param<double>(node_, "demo.tolerance", 0.002);
+	still_tolerance_ = param<double>(node_, "demo.still_tolerance", 0.002);
+	keep_pace_ = param<bool>(node_, "demo.keep_pace", true);
+
+	capacity_ = (size_t) (max_duration_ * max_rate_);
+
+	// Every cycle is needed, a deep queue keeps bursts from being dropped
+	state_sub_ = node_->create_subscription<sensor_msgs::msg::JointState>(
+		topic,
+		rclcpp::SensorDataQoS().keep_last(100),
+		std::bind(&DemoRecorder::state_cb_, this, std::placeholders::_1)
+	);
+
+	executor_.add_node(node_);
+	spin_thread_ = std::thread([this]() { executor_.spin(); });
+}
+
+
+DemoRecorder::~DemoRecorder()
+{
+	executor_.cancel();
+	if (spin_thread_.joinable())
+		spin_thread_.join();
+}
+
+
+void DemoRecorder::start(const std::vector<std::string> &joint_names)
+{
+	std::lock_guard<std::mutex> lock(mtx_);
+
+	if (recording_)
+		RCLCPP_WARN(node_->get_logger(), "Unfinished recording discarded.");
+
+	joint_names_ = joint_names;
+	index_.clear();
+
+	// Reserved once, kept between recordings
+	t_.clear();
+	q_.clear();
+	t_.reserve(capacity_);
+	q_.reserve(capacity_ * joint_names_.size());
+
+	truncated_ = false;
+	recording_ = true;
+
+	RCLCPP_INFO(node_->get_logger(), "Recording %s (up to %.0fs).", state_sub_->get_topic_name(), max_duration_);
+}
+
+
+void DemoRecorder::cancel()
+{
+	std::lock_guard<std::mutex> lock(mtx_);
+
+	if (recording_)
+		RCLCPP_INFO(node_->get_logger(), "Recording discarded.");
+
+	recording_ = false;
+}
+
+
+bool DemoRecorder::recording()
+{
+	std::lock_guard<std::mutex> lock(mtx_);
+	return recording_;
+}
+
+
+void DemoRecorder::state_cb_(const sensor_msgs::msg::JointState::SharedPtr state)
+{
+	std::lock_guard<std::mutex> lock(mtx_);
+
+	if (!recording_ || truncated_)
+		return;
+
+	// Joint order of the joint states, resolved on the first sample
+	if (index_.empty())
+	{
+		for (const auto &name : joint_names_)
+		{
+			auto it = std::find(state->name.begin(), state->name.end(), name);
+			if (it == state->name.end())
+			{
+				RCLCPP_ERROR(node_->get_logger(), "Recording discarded, joint states have no joint %s", name.c_str());
+				recording_ = false;
+				return;
+			}
+			index_.push_back(it - state->name.begin());
+		}
+	}
+
+	if (state->position.size() != state->name.size())
+		return;
+
+	if (t_.size() >= capacity_)
+	{
+		RCLCPP_WARN(node_->get_logger(), "Recording reached %.0fs, the rest is not recorded.", max_duration_);
+		truncated_ = true;
+		return;
+	}
+
+	const double stamp = rclcpp::Time(state->header.stamp).seconds();
+	if (t_.empty())
+		t0_ = stamp;
+
+	t_.push_back(stamp - t0_);
+	for (int i : index_)
+		q_.push_back(state->position[i]);
+}
+
+
+bool DemoRecorder::stop(const moveit::core::RobotModelConstPtr &model, const std::string &group, Result &result, std::string &msg)
+{
+	std::vector<double> t;
+	std::vector<double> q;
+	std::vector<std::string> joint_names;
+	bool truncated;
+	{
+		std::lock_guard<std::mutex> lock(mtx_);
+
+		if (!recording_)
+		{
+			msg = "Not recording";
+			return false;
+		}
+		recording_ = false;
+
+		t = t_;
+		q = q_;
+		joint_names = joint_names_;
+		truncated = truncated_;
+	}
+
+	const size_t joints = joint_names.size();
+	const size_t n = t.size();
+	result.samples = n;
+
+	const moveit::core::JointModelGroup *jmg = model->getJointModelGroup(group);
+	if (!jmg || jmg->getActiveJointModelNames() != joint_names)
+	{
+		msg = "Recorded joints do not match planning group " + group;
+		return false;
+	}
+
+	if (n < 2)
+	{
+		msg = "Nothing recorded, are joint states published?";
+		return false;
+	}
+
+	// Trim the still start and end, one still sample is kept on either side
+	auto moved = [&](size_t i, size_t ref) {
+		for (size_t j = 0; j < joints; j++)
+			if (std::abs(q[i * joints + j] - q[ref * joints + j]) > still_tolerance_)
+				return true;
+		return false;
+	};
+
+	size_t first = 0;
+	while (first < n - 1 && !moved(first + 1, 0))
+		first++;
+
+	size_t last = n - 1;
+	while (last > first && !moved(last - 1, n - 1))
+		last--;
+
+	if (last <= first + 1)
+	{
+		msg = "The arm did not move";
+		return false;
+	}
+
+	result.demo_duration = t[last] - t[first];
+	const double dt = result.demo_duration / (last - first);
+
+	smooth_(q, joints, first, last, (size_t) std::lround(0.5 * smoothing_time_ / dt));
+
+	// Decimated to the smoothed bandwidth, keeps the compression fast on long recordings
+	const size_t step = std::max((size_t) 1, (size_t) std::lround(DECIMATE_DT / dt));
+	std::vector<double> td;
+	std::vector<double> qd;
+	for (size_t i = first; ; i = std::min(i + step, last))
+	{
+		td.push_back(t[i]);
+		qd.insert(qd.end(), q.begin() + i * joints, q.begin() + (i + 1) * joints);
+		if (i == last)
+			break;
+	}
+
+	std::vector<size_t> kept = compress_(td, qd, joints, 0, td.size() - 1);
+	result.waypoints = kept.size();
+
+	// Time-optimal along the compressed path, blended within the tolerance
+	robot_trajectory::RobotTrajectory path(model, group);
+	moveit::core::RobotState state(model);
+	state.setToDefaultValues();
+	for (size_t k : kept)
+	{
+		state.setJointGroupPositions(jmg, &qd[k * joints]);
+		state.update();
+		path.addSuffixWayPoint(state, 0.0);
+	}
+
+	trajectory_processing::TimeOptimalTrajectoryGeneration totg(tolerance_, RESAMPLE_DT);
+	auto timed = std::make_shared<robot_trajectory::RobotTrajectory>(path, true);
+	if (!totg.computeTimeStamps(*timed))
+	{
+		msg = "Time parameterization failed";
+		return false;
+	}
+
+	// Faster than demonstrated: time-scaled replay at the demonstrated pace
+	const double duration = timed->getDuration();
+	if (keep_pace_ && duration < result.demo_duration)
+	{
+		const double scale = duration / result.demo_duration;
+
+		timed = std::make_shared<robot_trajectory::RobotTrajectory>(path, true);
+		if (!totg.computeTimeStamps(*timed, scale, scale * scale))
+		{
+			msg = "Time parameterization failed";
+			return false;
+		}
+	}
+
+	moveit_msgs::msg::RobotTrajectory trajectory;
+	timed->getRobotTrajectoryMsg(trajectory);
+	result.trajectory = trajectory.joint_trajectory;
+
+	RCLCPP_INFO(node_->get_logger(), "Recording of %.2fs (%lu samples) compressed to %lu waypoints, %.2fs trajectory%s.",
+		result.demo_duration, n, result.waypoints, timed->getDuration(), truncated ? " (truncated)" : "");
+
+	return true;
+}
+
+
+/**
+ * @brief Centred moving average of the samples first..last, the window shrinks towards
+ * the ends so the end points stay where they are.
+ *
+ */
+void DemoRecorder::smooth_(std::vector<double> &q, size_t joints, size_t first, size_t last, size_t half_window) const
+{
+	if (half_window == 0)
+		return;
+
+	const size_t n = last - first + 1;
+	std::vector<double> sum(n + 1);
+
+	for (size_t j = 0; j < joints; j++)
+	{
+		sum[0] = 0.0;
+		for (size_t i = 0; i < n; i++)
+			sum[i + 1] = sum[i] + q[(first + i) * joints + j];
+
+		for (size_t i = 0; i < n; i++)
+		{
+			const size_t h = std::min({ half_window, i, n - 1 - i });
+			q[(first + i) * joints + j] = (sum[i + h + 1] - sum[i - h]) / (2 * h + 1);
+		}
+	}
+}
+
+
+/**
+ * @brief Ramer-Douglas-Peucker: indices of the samples first..last a linear interpolation
+ * (in time) must pass through to stay within the tolerance on every joint.
+ *
+ */
+std::vector<size_t> DemoRecorder::compress_(const std::vector<double> &t, const std::vector<double> &q, size_t joints, size_t first, size_t last) const
+{
+	std::vector<bool> keep(last - first + 1, false);
+	keep.front() = true;
+	keep.back() = true;
+
+	// Iterative, long recordings would recurse deeply
+	std::vector<std::pair<size_t, size_t>> segments = { { first, last } };
+	while (!segments.empty())
+	{
+		auto [a, b] = segments.back();
+		segments.pop_back();
+
+		double worst = 0.0;
+		size_t worst_i = a;
+		for (size_t i = a + 1; i < b; i++)
+		{
+			const double w = (t[i] - t[a]) / (t[b] - t[a]);
+			for (size_t j = 0; j < joints; j++)
+			{
+				const double qa = q[a * joints + j];
+				const double dev = std::abs(q[i * joints + j] - (qa + w * (q[b * joints + j] - qa)));
+				if (dev > worst)
+				{
+					worst = dev;
+					worst_i = i;
+				}
+			}
+		}
+
+		if (worst > tolerance_)
+		{
+			keep[worst_i - first] = true;
+			segments.push_back({ a, worst_i });
+			segments.push_back({ worst_i, b });
+		}
+	}
+
+	std::vector<size_t> kept;
+	for (size_t i = 0; i < keep.size(); i++)
+		if (keep[i])
+			kept.push_back(first + i);
+
+	return kept;
+}
@@ -0,0 +1,165 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <rcpputils/filesystem_helper.hpp>
+#include <rclcpp/rclcpp.hpp>
+
+#include <moveit/ompl_interface/ompl_interface.h>
+#include <moveit/planning_scene/planning_scene.h>
+
+#include <arm_move_group/path_constraints.h>
+#include <arm_move_group/shared_robot_model.h>
+
+
+template <typename T>
+static T param(const rclcpp::Node::SharedPtr &node, const std::string &name, const T &default_value)
+{
+	if (!node->has_parameter(name))
+		return node->declare_parameter<T>(name, default_value);
+	return node->get_parameter(name).get_value<T>();
+}
+
+
+/**
+ * @brief Builds the constraint approximation database of the standard path constraints.
+ *
+ * For every constraint, valid states of the planning group that satisfy it are sampled
+ * offline and stored (OMPL state storage plus a manifest) in `constraint_database.output_dir`.
+ * move_group loads the folder (ompl.constraint_approximations_path) and OMPL then draws the
+ * states of a plan constrained by that name from the database, instead of sampling the
+ * whole joint space and rejecting almost every sample.
+ *
+ * The constraints are built in parallel, one OMPL interface per constraint, and saved
+ * together. Only states are stored unless `edges_per_sample` is set, which keeps the files
+ * small; the database is independent of the planning scene (self collisions only).
+ *
+ * Parameters (constraint_database.*):
+ *   output_dir        Database folder
+ *   planning_group    Group the states are sampled for
+ *   constraints       Constraints to build, all path_constraints.names if empty
+ *   samples           States per constraint
+ *   edges_per_sample  Precomputed connections per state, 0 for states only
+ *   max_edge_length   Longest precomputed connection
+ *   state_space       OMPL state space parameterization, has to match the one planning
+ *                     with the constraint (PoseModel for groups with an IK solver)
+ *   threads           Constraints built at once, 0 for all cores
+ *
+ */
+int main(int argc, char **argv)
+{
+	rclcpp::init(argc, argv);
+
+	rclcpp::NodeOptions node_options;
+	node_options.automatically_declare_parameters_from_overrides(true);
+	auto node = rclcpp::Node::make_shared("generate_constraint_database", node_options);
+	const rclcpp::Logger logger = node->get_logger();
+
+	const std::string default_dir = rcpputils::fs::current_path().string() + "/src/arm-project/arm_move_group/constraint_approximations";
+	const std::string output_dir = param<std::string>(node, "constraint_database.output_dir", default_dir);
+	const std::string group = param<std::string>(node, "constraint_database.planning_group", "arm_group");
+	std::vector<std::string> names = param<std::vector<std::string>>(node, "constraint_database.constraints", {});
+	const int64_t samples = param<int64_t>(node, "constraint_database.samples", 10000);
+	const int64_t edges_per_sample = param<int64_t>(node, "constraint_database.edges_per_sample", 0);
+	const double max_edge_length = param<double>(node, "constraint_database.max_edge_length", 0.2);
+	const std::string state_space = param<std::string>(node, "constraint_database.state_space", "PoseModel");
+	int64_t threads = param<int64_t>(node, "constraint_database.threads", 0);
+
+	if (names.empty())
+		names = path_constraint_names(node);
+
+	std::vector<moveit_msgs::msg::Constraints> constraints;
+	for (const std::string &name : names)
+	{
+		moveit_msgs::msg::Constraints c;
+		if (load_path_constraint(node, name, c))
+			constraints.push_back(c);
+	}
+
+	const robot_model_loader::RobotModelLoaderPtr loader = shared_robot_model_loader(node);
+	if (constraints.empty() || !loader->getModel())
+	{
+		RCLCPP_ERROR(logger, "Nothing to build, need a robot model and path_constraints.");
+		rclcpp::shutdown();
+		return 1;
+	}
+
+	// Empty scene, the database has to hold for any scene
+	auto scene = std::make_shared<planning_scene::PlanningScene>(loader->getModel());
+
+	ompl_interface::ConstraintApproximationConstructionOptions options;
+	options.state_space_parameterization = state_space;
+	options.samples = (unsigned int) samples;
+	options.edges_per_sample = (unsigned int) edges_per_sample;
+	options.max_edge_length = max_edge_length;
+	options.explicit_motions = edges_per_sample > 0;
+	options.explicit_points_resolution = 0.05;
+	options.max_explicit_points = 10;
+
+	// An OMPL interface (state space, samplers, constraints library) per constraint, so the
+	// constraints build without sharing any OMPL state
+	std::vector<std::unique_ptr<ompl_interface::OMPLInterface>> interfaces;
+	for (size_t i = 0; i < constraints.size(); i++)
+		interfaces.push_back(std::make_unique<ompl_interface::OMPLInterface>(loader->getModel(), node, "ompl"));
+
+	std::vector<ompl_interface::ConstraintApproximationConstructionResults> results(constraints.size());
+	std::atomic<size_t> next{0};
+
+	if (threads <= 0)
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	threads = std::min<int64_t>(threads, constraints.size());
+
+	RCLCPP_INFO(logger, "Building %zu constraint approximations of %s (%ld states each) on %ld threads...",
+		constraints.size(), group.c_str(), samples, threads);
+	const auto start = std::chrono::steady_clock::now();
+
+	std::vector<std::thread> workers;
+	for (int64_t w = 0; w < threads; w++)
+	{
+		workers.emplace_back([&]() {
+			for (size_t i = next++; i < constraints.size(); i = next++)
+			{
+				results[i] = interfaces[i]->getConstraintsLibraryNonConst()->addConstraintApproximation(
+					constraints[i], group, scene, options);
+			}
+		});
+	}
+	for (auto &worker : workers)
+		worker.join();
+
+	// Collect into one library, saved with a single manifest
+	const ompl_interface::ConstraintsLibraryPtr library = interfaces[0]->getConstraintsLibraryNonConst();
+	size_t built = 0;
+	for (size_t i = 0; i < constraints.size(); i++)
+	{
+		const auto &result = results[i];
+		if (!result.approx)
+		{
+			RCLCPP_ERROR(logger, "Could not build the approximation of %s.", constraints[i].name.c_str());
+			continue;
+		}
+
+		if (i > 0)
+			library->registerConstraintApproximation(result.approx);
+		built++;
+
+		RCLCPP_INFO(logger, "%s: sampled in %.1fs (%.1f%% of the samples valid), connected in %.1fs.",
+			constraints[i].name.c_str(), result.state_sampling_time, result.sampling_success_rate * 100.0, result.state_connection_time);
+	}
+
+	if (built > 0)
+	{
+		rcpputils::fs::create_directories(output_dir);
+		library->saveConstraintApproximations(output_dir);
+	}
+
+	RCLCPP_INFO(logger, "Saved %zu of %zu constraint approximations to %s in %.1fs.", built, constraints.size(), output_dir.c_str(),
+		std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+	rclcpp::shutdown();
+	return built == constraints.size() ? 0 : 1;
+}
@@ -0,0 +1,411 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include <rclcpp/rclcpp.hpp>
+#include <arm_msgs/srv/get_state.hpp>
+#include <arm_msgs/srv/joint_space_goal.hpp>
+#include <arm_msgs/srv/pose_goal.hpp>
+#include <arm_msgs/srv/save.hpp>
+
+using arm_msgs::srv::GetState;
+using arm_msgs::srv::JointSpaceGoal;
+using arm_msgs::srv::PoseGoal;
+using arm_msgs::srv::Save;
+
+using SteadyClock = std::chrono::steady_clock;
+
+
+/**
+ * @brief Closed-loop load generator for the arm_move_group services.
+ *
+ * `concurrency` clients run in parallel, each sends a request, waits for its response (or
+ * `timeout`) and sends the next, the service picked at random with the weights of `mix.*`.
+ * Runs for `duration` seconds or `requests` requests, every `report_period` and at the end
+ * the throughput, latency percentiles and results per service are logged.
+ *
+ * Results:
+ *   ok           response received, valid/saved set (GetState: any response)
+ *   failed       response received, valid/saved not set
+ *   timeout      no response within `timeout`, the request is abandoned
+ *   unavailable  service not ready when the request was due
+ *
+ * Latencies are measured on the steady clock, so the tool works with a sim stack on
+ * use_sim_time.
+ *
+ * @note arm/Save requests save the current pose under unique labels starting with
+ * `save_label_prefix`, delete them from the poses folder (and roadmap) after the test.
+ *
+ */
+class LoadGenerator : public rclcpp::Node
+{
+	public:
+		LoadGenerator();
+
+	private:
+		enum Service { GET_STATE, JOINT_SPACE_GOAL, POSE_GOAL, SAVE, NUM_SERVICES };
+		const std::array<const char *, NUM_SERVICES> SERVICE_NAMES = {
+			"arm/GetState", "arm/JointSpaceGoal", "arm/PoseGoal", "arm/Save"
+		};
+		const std::array<const char *, NUM_SERVICES> MIX_PARAMS = {
+			"mix.get_state", "mix.joint_space_goal", "mix.pose_goal", "mix.save"
+		};
+
+		enum Result { OK, FAILED, TIMEOUT, UNAVAILABLE, NUM_RESULTS };
+		const std::array<const char *, NUM_RESULTS> RESULT_NAMES = { "ok", "failed", "timeout", "unavailable" };
+
+		struct Stats
+		{
+			uint64_t results[NUM_RESULTS] = {};
+			std::vector<double> latency_ms;		// answered requests (ok, failed)
+		};
+
+		// One closed-loop client
+		struct Slot
+		{
+			bool busy = false;
+			Service service = GET_STATE;
+			SteadyClock::time_point start;
+			int64_t request_id = 0;
+			uint64_t seq = 0;
+		};
+
+		rclcpp::Client<GetState>::SharedPtr get_state_cli_;
+		rclcpp::Client<JointSpaceGoal>::SharedPtr joint_space_goal_cli_;
+		rclcpp::Client<PoseGoal>::SharedPtr pose_goal_cli_;
+		rclcpp::Client<Save>::SharedPtr save_cli_;
+		rclcpp::TimerBase::SharedPtr tick_timer_;
+
+		// Parameters
+		double duration_;
+		int64_t max_requests_;
+		double timeout_;
+		double report_period_;
+		uint8_t speed_;
+		std::vector<double> joint_goal_deg_;
+		double joint_spread_deg_;
+		std::vector<double> pose_goal_;
+		double pose_spread_;
+		std::string save_label_prefix_;
+		std::string output_file_;
+		std::ofstream csv_;
+
+		std::mt19937 rng_;
+		std::discrete_distribution<int> mix_;
+
+		std::vector<Slot> slots_;
+		uint64_t sent_ = 0;
+		bool stopping_ = false;
+		SteadyClock::time_point test_start_;
+		SteadyClock::time_point last_report_;
+
+		// Totals and the window since the last report
+		std::array<Stats, NUM_SERVICES> total_;
+		std::array<Stats, NUM_SERVICES> window_;
+
+		void tick_();
+		void send_(size_t slot);
+		void finish_(size_t slot, Result result);
+		void report_(const std::array<Stats, NUM_SERVICES> &stats, double seconds, const char *title);
+
+		template <typename ServiceT>
+		void call_(size_t slot,
+			const typename rclcpp::Client<ServiceT>::SharedPtr &client,
+			const typename ServiceT::Request::SharedPtr &request,
+			std::function<bool(const typename ServiceT::Response &)> ok);
+};
+
+
+LoadGenerator::LoadGenerator() : Node("arm_load_generator")
+{
+	const int concurrency = this->declare_parameter("concurrency", 4);
+	duration_ = this->declare_parameter("duration", 60.0);			// s, 0 to run until requests
+	max_requests_ = this->declare_parameter("requests", 0);			// 0 to run for duration
+	timeout_ = this->declare_parameter("timeout", 30.0);				// s
+	report_period_ = this->declare_parameter("report_period", 10.0);	// s
+	const int seed = this->declare_parameter("seed", 0);
+
+	std::vector<double> weights;
+	const std::array<double, NUM_SERVICES> default_weights = { 0.5, 0.2, 0.2, 0.1 };
+	for (int s = 0; s < NUM_SERVICES; s++)
+		weights.push_back(std::max(0.0, this->declare_parameter(MIX_PARAMS[s], default_weights[s])));
+
+	speed_ = (uint8_t) std::clamp(this->declare_parameter("speed", 10), 1, 100);
+	joint_goal_deg_ = this->declare_parameter("joint_goal_deg", std::vector<double>{ 10.0, 45.0, 0.0, 0.0, 60.0, 90.0 });
+	joint_spread_deg_ = this->declare_parameter("joint_spread_deg", 10.0);
+	pose_goal_ = this->declare_parameter("pose_goal", std::vector<double>{ 0.2, -0.5, 0.8, 0.0, 0.0, -0.7071, 0.7071 });
+	pose_spread_ = this->declare_parameter("pose_spread", 0.05);		// m
+	save_label_prefix_ = this->declare_parameter("save_label_prefix", std::string("load_test_"));
+	output_file_ = this->declare_parameter("output_file", std::string(""));
+
+	if (joint_goal_deg_.size() != 6 || pose_goal_.size() != 7)
+		throw std::invalid_argument("joint_goal_deg needs 6 values, pose_goal 7 (x, y, z, qx, qy, qz, qw)");
+	if (concurrency < 1 || std::all_of(weights.begin(), weights.end(), [](double w) { return w == 0.0; }))
+		throw std::invalid_argument("concurrency must be >= 1 and at least one mix.* weight > 0");
+
+	// Labels stay unique across runs
+	save_label_prefix_ += std::to_string(getpid()) + "_";
+
+	rng_.seed(seed ? seed : std::random_device{}());
+	mix_ = std::discrete_distribution<int>(weights.begin(), weights.end());
+
+	if (!output_file_.empty())
+	{
+		csv_.open(output_file_, std::ios::app);
+		if (!csv_)
+			RCLCPP_ERROR(this->get_logger(), "Could not open %s, not writing requests", output_file_.c_str());
+		else
+			csv_ << "service,start_s,latency_ms,result\n";
+	}
+
+	get_state_cli_ = this->create_client<GetState>(SERVICE_NAMES[GET_STATE]);
+	joint_space_goal_cli_ = this->create_client<JointSpaceGoal>(SERVICE_NAMES[JOINT_SPACE_GOAL]);
+	pose_goal_cli_ = this->create_client<PoseGoal>(SERVICE_NAMES[POSE_GOAL]);
+	save_cli_ = this->create_client<Save>(SERVICE_NAMES[SAVE]);
+
+	slots_.resize(concurrency);
+
+	// Waits for the services here, so the test does not start with a burst of unavailable
+	const std::array<rclcpp::ClientBase *, NUM_SERVICES> clients = {
+		get_state_cli_.get(), joint_space_goal_cli_.get(), pose_goal_cli_.get(), save_cli_.get()
+	};
+	for (int s = 0; s < NUM_SERVICES; s++)
+	{
+		if (weights[s] > 0.0 && !clients[s]->wait_for_service(std::chrono::seconds(10)))
+			RCLCPP_WARN(this->get_logger(), "%s not available, its requests count as unavailable", SERVICE_NAMES[s]);
+	}
+
+	RCLCPP_INFO(this->get_logger(), "Load test: %d concurrent clients, mix %.2f/%.2f/%.2f/%.2f (GetState/JointSpaceGoal/PoseGoal/Save), %s",
+		concurrency, weights[GET_STATE], weights[JOINT_SPACE_GOAL], weights[POSE_GOAL], weights[SAVE],
+		max_requests_ > 0 ? (std::to_string(max_requests_) + " requests").c_str() : (std::to_string(duration_) + " s").c_str());
+
+	test_start_ = last_report_ = SteadyClock::now();
+	for (size_t k = 0; k < slots_.size(); k++)
+		send_(k);
+
+	// Timeouts, idle slots (unavailable services) and reports, on the steady clock
+	tick_timer_ = this->create_wall_timer(std::chrono::milliseconds(100), std::bind(&LoadGenerator::tick_, this));
+}
+
+
+/**
+ * @brief Sends the next request of a slot, or leaves it idle once the test is over.
+ *
+ */
+void LoadGenerator::send_(size_t slot)
+{
+	Slot &s = slots_[slot];
+	s.busy = false;
+
+	const double elapsed = std::chrono::duration<double>(SteadyClock::now() - test_start_).count();
+	if ((max_requests_ > 0 && (int64_t) sent_ >= max_requests_) || (max_requests_ <= 0 && elapsed >= duration_))
+	{
+		stopping_ = true;
+		return;
+	}
+
+	s.service = (Service) mix_(rng_);
+	s.start = SteadyClock::now();
+	s.seq++;
+	s.busy = true;
+	sent_++;
+
+	std::uniform_real_distribution<double> unit(-1.0, 1.0);
+
+	switch (s.service)
+	{
+		case GET_STATE:
+			call_<GetState>(slot, get_state_cli_, std::make_shared<GetState::Request>(),
+				[](const GetState::Response &) { return true; });
+			break;
+
+		case JOINT_SPACE_GOAL:
+		{
+			auto request = std::make_shared<JointSpaceGoal::Request>();
+			request->speed = speed_;
+			for (size_t i = 0; i < request->joint_pos_deg.size(); i++)
+				request->joint_pos_deg[i] = std::lround(joint_goal_deg_[i] + joint_spread_deg_ * unit(rng_));
+
+			call_<JointSpaceGoal>(slot, joint_space_goal_cli_, request,
+				[](const JointSpaceGoal::Response &response) { return response.valid; });
+			break;
+		}
+
+		case POSE_GOAL:
+		{
+			auto request = std::make_shared<PoseGoal::Request>();
+			request->speed = speed_;
+			request->pose.position.x = pose_goal_[0] + pose_spread_ * unit(rng_);
+			request->pose.position.y = pose_goal_[1] + pose_spread_ * unit(rng_);
+			request->pose.position.z = pose_goal_[2] + pose_spread_ * unit(rng_);
+			request->pose.orientation.x = pose_goal_[3];
+			request->pose.orientation.y = pose_goal_[4];
+			request->pose.orientation.z = pose_goal_[5];
+			request->pose.orientation.w = pose_goal_[6];
+
+			call_<PoseGoal>(slot, pose_goal_cli_, request,
+				[](const PoseGoal::Response &response) { return response.valid; });
+			break;
+		}
+
+		case SAVE:
+		{
+			auto request = std::make_shared<Save::Request>();
+			request->type = "pose";
+			request->label = save_label_prefix_ + std::to_string(sent_);
+
+			call_<Save>(slot, save_cli_, request,
+				[](const Save::Response &response) { return response.saved; });
+			break;
+		}
+
+		default:
+			break;
+	}
+}
+
+
+template <typename ServiceT>
+void LoadGenerator::call_(size_t slot,
+	const typename rclcpp::Client<ServiceT>::SharedPtr &client,
+	const typename ServiceT::Request::SharedPtr &request,
+	std::function<bool(const typename ServiceT::Response &)> ok)
+{
+	if (!client->service_is_ready())
+	{
+		finish_(slot, UNAVAILABLE);
+		return;
+	}
+
+	const uint64_t seq = slots_[slot].seq;
+	auto future = client->async_send_request(request,
+		[this, slot, seq, ok](typename rclcpp::Client<ServiceT>::SharedFuture response) {
+			// A late response of a request that already timed out
+			if (!slots_[slot].busy || slots_[slot].seq != seq)
+				return;
+
+			finish_(slot, ok(*response.get()) ? OK : FAILED);
+			send_(slot);
+		});
+
+	slots_[slot].request_id = future.request_id;
+}
+
+
+/**
+ * @brief Records the result of a slot's request.
+ *
+ */
+void LoadGenerator::finish_(size_t slot, Result result)
+{
+	Slot &s = slots_[slot];
+	const double latency_ms = std::chrono::duration<double, std::milli>(SteadyClock::now() - s.start).count();
+
+	for (auto *stats : { &total_[s.service], &window_[s.service] })
+	{
+		stats->results[result]++;
+		if (result == OK || result == FAILED)
+			stats->latency_ms.push_back(latency_ms);
+	}
+
+	if (csv_)
+	{
+		csv_ << SERVICE_NAMES[s.service] << "," << std::chrono::duration<double>(s.start - test_start_).count()
+			<< "," << latency_ms << "," << RESULT_NAMES[result] << "\n";
+	}
+
+	s.busy = false;
+}
+
+
+void LoadGenerator::tick_()
+{
+	const auto now = SteadyClock::now();
+
+	for (size_t k = 0; k < slots_.size(); k++)
+	{
+		Slot &s = slots_[k];
+
+		if (s.busy && std::chrono::duration<double>(now - s.start).count() >= timeout_)
+		{
+			switch (s.service)
+			{
+				case GET_STATE: get_state_cli_->remove_pending_request(s.request_id); break;
+				case JOINT_SPACE_GOAL: joint_space_goal_cli_->remove_pending_request(s.request_id); break;
+				case POSE_GOAL: pose_goal_cli_->remove_pending_request(s.request_id); break;
+				case SAVE: save_cli_->remove_pending_request(s.request_id); break;
+				default: break;
+			}
+			finish_(k, TIMEOUT);
+		}
+
+		// Slots whose service was unavailable retry every tick instead of spinning
+		if (!s.busy && !stopping_)
+			send_(k);
+	}
+
+	if (report_period_ > 0.0 && std::chrono::duration<double>(now - last_report_).count() >= report_period_)
+	{
+		report_(window_, std::chrono::duration<double>(now - last_report_).count(), "Last");
+		for (Stats &stats : window_)
+			stats = Stats();
+		last_report_ = now;
+	}
+
+	const bool idle = std::none_of(slots_.begin(), slots_.end(), [](const Slot &s) { return s.busy; });
+	if (stopping_ && idle)
+	{
+		report_(total_, std::chrono::duration<double>(now - test_start_).count(), "Total");
+		tick_timer_->cancel();
+		rclcpp::shutdown();
+	}
+}
+
+
+/**
+ * @brief Logs per service: requests, throughput, results and latency percentiles.
+ *
+ */
+void LoadGenerator::report_(const std::array<Stats, NUM_SERVICES> &stats, double seconds, const char *title)
+{
+	RCLCPP_INFO(this->get_logger(), "%s %.1f s:", title, seconds);
+
+	for (int s = 0; s < NUM_SERVICES; s++)
+	{
+		uint64_t requests = 0;
+		for (uint64_t n : stats[s].results) requests += n;
+		if (requests == 0) continue;
+
+		std::vector<double> latency = stats[s].latency_ms;
+		std::sort(latency.begin(), latency.end());
+		auto percentile = [&latency](double p) {
+			if (latency.empty()) return 0.0;
+			size_t rank = (size_t) std::ceil(p / 100.0 * latency.size());
+			return latency[std::clamp<size_t>(rank, 1, latency.size()) - 1];
+		};
+
+		const auto &r = stats[s].results;
+		RCLCPP_INFO(this->get_logger(),
+			"  %-18s %6lu req %7.2f req/s | ok %5.1f%% failed %5.1f%% timeout %5.1f%% unavailable %5.1f%% | p50 %8.1f p90 %8.1f p99 %8.1f max %8.1f ms",
+			SERVICE_NAMES[s], requests, requests / seconds,
+			100.0 * r[OK] / requests, 100.0 * r[FAILED] / requests, 100.0 * r[TIMEOUT] / requests, 100.0 * r[UNAVAILABLE] / requests,
+			percentile(50), percentile(90), percentile(99), latency.empty() ? 0.0 : latency.back());
+	}
+}
+
+
+int main(int argc, char **argv)
+{
+	rclcpp::init(argc, argv);
+	rclcpp::spin(std::make_shared<LoadGenerator>());
+	rclcpp::shutdown();
+	return 0;
+}
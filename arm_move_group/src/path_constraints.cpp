@@ -0,0 +1,88 @@
+#include <arm_move_group/path_constraints.h>
+
+#include <moveit/kinematic_constraints/kinematic_constraint.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include <moveit/transforms/transforms.h>
+
+
+template <typename T>
+static bool get_param(const rclcpp::Node::SharedPtr &node, const std::string &name, T &value)
+{
+	if (!node->has_parameter(name))
+		return false;
+	value = node->get_parameter(name).get_value<T>();
+	return true;
+}
+
+
+std::vector<std::string> path_constraint_names(const rclcpp::Node::SharedPtr &node)
+{
+	std::vector<std::string> names;
+	get_param(node, "path_constraints.names", names);
+	return names;
+}
+
+
+bool load_path_constraint(
+	const rclcpp::Node::SharedPtr &node,
+	const std::string &name,
+	moveit_msgs::msg::Constraints &constraints)
+{
+	const std::string prefix = "path_constraints." + name + ".";
+
+	std::string link, frame;
+	std::vector<double> orientation, tolerance;
+	if (!get_param(node, prefix + "link", link) || !get_param(node, prefix + "frame", frame) ||
+		!get_param(node, prefix + "orientation", orientation) || !get_param(node, prefix + "tolerance", tolerance))
+	{
+		RCLCPP_ERROR(node->get_logger(), "Path constraint %s is not defined (%s*).", name.c_str(), prefix.c_str());
+		return false;
+	}
+
+	if (orientation.size() != 4 || tolerance.size() != 3)
+	{
+		RCLCPP_ERROR(node->get_logger(), "Path constraint %s: orientation needs 4 (x, y, z, w), tolerance 3 values.", name.c_str());
+		return false;
+	}
+
+	moveit_msgs::msg::OrientationConstraint ocm;
+	ocm.header.frame_id = frame;
+	ocm.link_name = link;
+	ocm.orientation.x = orientation[0];
+	ocm.orientation.y = orientation[1];
+	ocm.orientation.z = orientation[2];
+	ocm.orientation.w = orientation[3];
+	ocm.absolute_x_axis_tolerance = tolerance[0];
+	ocm.absolute_y_axis_tolerance = tolerance[1];
+	ocm.absolute_z_axis_tolerance = tolerance[2];
+	ocm.weight = 1.0;
+
+	constraints = moveit_msgs::msg::Constraints();
+	constraints.name = name;
+	constraints.orientation_constraints.push_back(ocm);
+	return true;
+}
+
+
+long first_path_constraint_violation(
+	const moveit::core::RobotModelConstPtr &robot_model,
+	const moveit_msgs::msg::RobotTrajectory &trajectory,
+	const moveit_msgs::msg::Constraints &constraints)
+{
+	// Frames of the standard constraints are robot links, no scene transforms needed
+	kinematic_constraints::KinematicConstraintSet constraint_set(robot_model);
+	constraint_set.add(constraints, moveit::core::Transforms(robot_model->getModelFrame()));
+
+	moveit::core::RobotState reference(robot_model);
+	reference.setToDefaultValues();
+
+	robot_trajectory::RobotTrajectory waypoints(robot_model);
+	waypoints.setRobotTrajectoryMsg(reference, trajectory);
+
+	for (size_t i = 0; i < waypoints.getWayPointCount(); i++)
+	{
+		if (!constraint_set.decide(waypoints.getWayPoint(i)).satisfied)
+			return (long) i;
+	}
+	return -1;
+}
@@ -0,0 +1,656 @@
+#include <arm_move_group/pose_roadmap.h>
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <queue>
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <cereal/archives/binary.hpp>
+#include <cereal/archives/json.hpp>
+
+#include <moveit/kinematic_constraints/utils.h>
+#include <moveit/robot_state/conversions.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+
+
+//* Saved pose file layout, see ArmMoveGroup::SerializedPose
+struct RoadmapPoseFile
+{
+	std::vector<double> joint_positions;
+
+	template <class Archive>
+	void serialize(Archive & archive)
+	{
+		archive( CEREAL_NVP(joint_positions) );
+	}
+};
+
+//* Save the roadmap after this many new edges (and whenever the job queue drains)
+static constexpr size_t SAVE_EVERY_EDGES = 10;
+
+//* Pose file edits smaller than this keep their edges
+static constexpr double POSE_EQUAL_TOL = 1e-6;
+
+
+template <typename T>
+T PoseRoadmap::param_(const std::string &name, const T &default_value)
+{
+	if (!node_->has_parameter(name))
+		return node_->declare_parameter<T>(name, default_value);
+	return node_->get_parameter(name).get_value<T>();
+}
+
+
+PoseRoadmap::PoseRoadmap(const rclcpp::NodeOptions &options, const std::string &ns, const std::string &group, const std::string &pose_dir, const std::string &roadmap_file)
+	: group_(group), pose_dir_(pose_dir), roadmap_file_(roadmap_file)
+{
+	// Own node for the scene monitor and the planning pipelines' parameters
+	rclcpp::NodeOptions node_options;
+	node_options.parameter_overrides(options.parameter_overrides());
+	node_options.automatically_declare_parameters_from_overrides(true);
+	node_ = rclcpp::Node::make_shared("arm_roadmap", ns, node_options);
+
+	enabled_ = param_<bool>("roadmap.enabled", true);
+	num_threads_ = param_<int64_t>("roadmap.threads", 0);
+	pipelines_ = param_<std::vector<std::string>>("roadmap.pipelines", {"stomp", "ompl"});
+	attempts_ = param_<int64_t>("roadmap.attempts", 2);
+	planning_time_ = param_<double>("roadmap.planning_time", 5.0);
+	start_tolerance_ = param_<double>("roadmap.start_tolerance", 0.01);
+
+	if (!enabled_)
+	{
+		RCLCPP_INFO(node_->get_logger(), "Roadmap disabled.");
+		return;
+	}
+
+	// The workers already plan in parallel, every worker's shortcut adapter runs on its own thread
+	for (const auto &name : pipelines_)
+	{
+		const std::string shortcut_threads = name + ".shortcut.threads";
+		if (node_->has_parameter(shortcut_threads))
+			node_->set_parameter(rclcpp::Parameter(shortcut_threads, int64_t(1)));
+		else
+			node_->declare_parameter(shortcut_threads, int64_t(1));
+	}
+
+	executor_.add_node(node_);
+	spin_thread_ = std::thread([this]() { executor_.spin(); });
+
+	// Own scene of this arm on the process' shared robot model
+	psm_ = std::make_shared<planning_scene_monitor::PlanningSceneMonitor>(node_, shared_robot_model_loader(node_));
+	if (!psm_->getPlanningScene())
+	{
+		RCLCPP_ERROR(node_->get_logger(), "Roadmap disabled, could not load the robot model.");
+		enabled_ = false;
+		return;
+	}
+
+	// Follow the scene maintained by move_group
+	psm_->startSceneMonitor();
+	if (!psm_->requestPlanningSceneState())
+		RCLCPP_WARN(node_->get_logger(), "Could not get the planning scene from move_group, planning against an empty scene until it is published.");
+}
+
+PoseRoadmap::~PoseRoadmap()
+{
+	stop_ = true;
+	jobs_cv_.notify_all();
+	for (auto &worker : workers_)
+		worker.join();
+
+	if (spin_thread_.joinable())
+	{
+		executor_.cancel();
+		spin_thread_.join();
+	}
+}
+
+
+void PoseRoadmap::start()
+{
+	if (!enabled_)
+		return;
+
+	load_poses_();
+	load_();
+
+	// Queue every pair missing an edge
+	{
+		std::lock_guard<std::mutex> graph_lock(graph_mtx_);
+		std::lock_guard<std::mutex> jobs_lock(jobs_mtx_);
+		for (auto a = poses_.begin(); a != poses_.end(); ++a)
+		{
+			for (auto b = std::next(a); b != poses_.end(); ++b)
+			{
+				if (!edges_.count({a->first, b->first}) || !edges_.count({b->first, a->first}))
+					jobs_.push_back({a->first, b->first});
+			}
+		}
+
+		RCLCPP_INFO(node_->get_logger(), "Roadmap: %zu poses, %zu edges loaded, %zu pairs to plan.",
+			poses_.size(), edges_.size(), jobs_.size());
+	}
+
+	// Core 0 runs the EtherCAT loop, leave it one core
+	const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+	size_t num_threads = num_threads_ ? num_threads_ : std::max(1u, cores - 1);
+	for (size_t i = 0; i < num_threads; i++)
+		workers_.emplace_back(&PoseRoadmap::worker_, this);
+}
+
+
+void PoseRoadmap::add_pose(const std::string &label, const std::vector<double> &joint_positions)
+{
+	if (!enabled_)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(graph_mtx_);
+		poses_[label] = joint_positions;
+
+		// A reused label invalidates its old edges
+		for (auto it = edges_.begin(); it != edges_.end();)
+		{
+			if (it->first.first == label || it->first.second == label)
+				it = edges_.erase(it);
+			else
+				++it;
+		}
+	}
+
+	queue_edges_(label);
+}
+
+
+bool PoseRoadmap::lookup(
+	const std::vector<double> &current_positions,
+	const std::string &goal,
+	double speed_factor,
+	moveit_msgs::msg::RobotTrajectory &trajectory)
+{
+	if (!enabled_)
+		return false;
+
+	std::lock_guard<std::mutex> lock(graph_mtx_);
+
+	if (!poses_.count(goal))
+		return false;
+
+	// Start at the saved pose the arm is sitting at
+	std::string start;
+	double best = start_tolerance_;
+	for (const auto &[label, positions] : poses_)
+	{
+		double d = distance_(current_positions, positions);
+		if (d <= best)
+		{
+			best = d;
+			start = label;
+		}
+	}
+
+	if (start.empty() || start == goal)
+		return false;
+
+	// Shortest route, dropping edges that collide in the current scene until one is valid
+	std::map<EdgeKey, bool> validity;
+	std::vector<EdgeKey> path;
+	{
+		planning_scene_monitor::LockedPlanningSceneRO scene(psm_);
+
+		bool found = false;
+		while (!found && shortest_path_(start, goal, validity, path))
+		{
+			found = true;
+			for (const auto &key : path)
+			{
+				auto it = validity.find(key);
+				if (it == validity.end())
+					it = validity.emplace(key, edge_valid_(scene, edges_.at(key))).first;
+
+				if (!it->second)
+				{
+					found = false;
+					break;
+				}
+			}
+		}
+
+		if (!found)
+		{
+			RCLCPP_WARN(node_->get_logger(), "Roadmap has no valid route %s -> %s.", start.c_str(), goal.c_str());
+			return false;
+		}
+	}
+
+	//* Concatenate the edges, each starts and ends at rest
+	speed_factor = std::clamp(speed_factor, 0.01, 1.0);
+
+	trajectory.joint_trajectory.joint_names = edges_.at(path.front()).joint_names;
+	trajectory.joint_trajectory.points.clear();
+
+	double t_offset = 0.0;
+	for (size_t e = 0; e < path.size(); e++)
+	{
+		const Edge &edge = edges_.at(path[e]);
+		for (size_t i = (e == 0) ? 0 : 1; i < edge.positions.size(); i++)
+		{
+			trajectory_msgs::msg::JointTrajectoryPoint point;
+			point.positions = edge.positions[i];
+			point.velocities = edge.velocities[i];
+			point.accelerations = edge.accelerations[i];
+			for (auto &v : point.velocities) v *= speed_factor;
+			for (auto &a : point.accelerations) a *= speed_factor * speed_factor;
+			point.time_from_start = rclcpp::Duration::from_seconds((t_offset + edge.time_from_start[i]) / speed_factor);
+
+			trajectory.joint_trajectory.points.push_back(point);
+		}
+		t_offset += edge.duration();
+	}
+
+	// Start exactly where the arm is
+	trajectory.joint_trajectory.points.front().positions = current_positions;
+
+	std::string route = start;
+	for (const auto &key : path)
+		route += " -> " + key.second;
+	RCLCPP_INFO(node_->get_logger(), "Roadmap route %s (%.2f s)", route.c_str(), t_offset / speed_factor);
+
+	return true;
+}
+
+
+void PoseRoadmap::worker_()
+{
+	// Off core 0, where arm_ethercat_interface pins its SCHED_FIFO loop. Planner threads
+	// started from here inherit the mask.
+	const unsigned cores = std::thread::hardware_concurrency();
+	if (cores > 1)
+	{
+		cpu_set_t mask;
+		CPU_ZERO(&mask);
+		for (unsigned c = 1; c < cores; c++)
+			CPU_SET(c, &mask);
+
+		if (pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask) != 0)
+			RCLCPP_WARN(node_->get_logger(), "Roadmap worker could not leave core 0.");
+	}
+
+	// Planners keep per-request state, so every worker gets its own pipelines. Plugin loading
+	// declares parameters on the shared node, do it one worker at a time
+	static std::mutex init_mtx;
+	std::map<std::string, std::shared_ptr<planning_pipeline::PlanningPipeline>> pipelines;
+	{
+		std::lock_guard<std::mutex> lock(init_mtx);
+		for (const auto &name : pipelines_)
+			pipelines[name] = std::make_shared<planning_pipeline::PlanningPipeline>(psm_->getRobotModel(), node_, name);
+	}
+
+	while (true)
+	{
+		EdgeKey job;
+		{
+			std::unique_lock<std::mutex> lock(jobs_mtx_);
+			jobs_cv_.wait(lock, [this]() { return stop_ || !jobs_.empty(); });
+			if (stop_)
+				return;
+
+			job = jobs_.front();
+			jobs_.pop_front();
+			jobs_in_progress_++;
+		}
+
+		Edge edge;
+		bool planned = plan_edge_(pipelines, job.first, job.second, edge);
+		if (planned)
+		{
+			std::lock_guard<std::mutex> lock(graph_mtx_);
+
+			// Pose re-saved while planning
+			if (poses_.count(edge.from) && poses_.count(edge.to) &&
+				distance_(poses_[edge.from], edge.from_positions) < POSE_EQUAL_TOL &&
+				distance_(poses_[edge.to], edge.to_positions) < POSE_EQUAL_TOL)
+			{
+				edges_[{edge.from, edge.to}] = edge;
+				edges_[{edge.to, edge.from}] = reversed_(edge);
+			}
+		}
+		else
+			RCLCPP_WARN(node_->get_logger(), "Roadmap edge %s <-> %s could not be planned.", job.first.c_str(), job.second.c_str());
+
+		bool save = false;
+		{
+			std::lock_guard<std::mutex> lock(jobs_mtx_);
+			jobs_in_progress_--;
+			edges_since_save_ += planned;
+
+			if (edges_since_save_ && (edges_since_save_ >= SAVE_EVERY_EDGES || (jobs_.empty() && jobs_in_progress_ == 0)))
+			{
+				save = true;
+				edges_since_save_ = 0;
+			}
+		}
+
+		if (save)
+			save_();
+	}
+}
+
+
+bool PoseRoadmap::plan_edge_(
+	const std::map<std::string, std::shared_ptr<planning_pipeline::PlanningPipeline>> &pipelines,
+	const std::string &from,
+	const std::string &to,
+	Edge &edge)
+{
+	std::vector<double> from_positions, to_positions;
+	{
+		std::lock_guard<std::mutex> lock(graph_mtx_);
+		if (!poses_.count(from) || !poses_.count(to))
+			return false;
+
+		from_positions = poses_[from];
+		to_positions = poses_[to];
+	}
+
+	// Snapshot of the current scene, the live one keeps updating while we plan
+	planning_scene::PlanningScenePtr scene;
+	{
+		planning_scene_monitor::LockedPlanningSceneRO locked(psm_);
+		scene = planning_scene::PlanningScene::clone(locked);
+	}
+
+	const moveit::core::JointModelGroup *jmg = scene->getRobotModel()->getJointModelGroup(group_);
+
+	moveit::core::RobotState start_state(scene->getCurrentState());
+	start_state.setJointGroupPositions(jmg, from_positions);
+	start_state.update();
+	scene->setCurrentState(start_state);
+
+	moveit::core::RobotState goal_state(start_state);
+	goal_state.setJointGroupPositions(jmg, to_positions);
+	goal_state.update();
+
+	planning_interface::MotionPlanRequest req;
+	req.group_name = group_;
+	req.allowed_planning_time = planning_time_;
+	req.max_velocity_scaling_factor = 1.0;
+	req.max_acceleration_scaling_factor = 1.0;
+	moveit::core::robotStateToRobotStateMsg(start_state, req.start_state);
+	req.goal_constraints.push_back(kinematic_constraints::constructGoalConstraints(goal_state, jmg));
+
+	// Keep the fastest of all attempts
+	double best = std::numeric_limits<double>::infinity();
+	for (const auto &[name, pipeline] : pipelines)
+	{
+		req.pipeline_id = name;
+		for (int attempt = 0; attempt < attempts_ && !stop_; attempt++)
+		{
+			planning_interface::MotionPlanResponse res;
+			if (!pipeline->generatePlan(scene, req, res) || res.error_code.val != moveit_msgs::msg::MoveItErrorCodes::SUCCESS || !res.trajectory)
+				continue;
+
+			if (res.trajectory->getDuration() >= best)
+				continue;
+			best = res.trajectory->getDuration();
+
+			moveit_msgs::msg::RobotTrajectory msg;
+			res.trajectory->getRobotTrajectoryMsg(msg);
+
+			edge.from = from;
+			edge.to = to;
+			edge.from_positions = from_positions;
+			edge.to_positions = to_positions;
+			edge.joint_names = msg.joint_trajectory.joint_names;
+			edge.positions.clear();
+			edge.velocities.clear();
+			edge.accelerations.clear();
+			edge.time_from_start.clear();
+
+			for (const auto &point : msg.joint_trajectory.points)
+			{
+				edge.positions.push_back(point.positions);
+				edge.velocities.push_back(point.velocities);
+				edge.accelerations.push_back(point.accelerations);
+				edge.time_from_start.push_back(rclcpp::Duration(point.time_from_start).seconds());
+			}
+		}
+	}
+
+	return std::isfinite(best);
+}
+
+
+void PoseRoadmap::queue_edges_(const std::string &label)
+{
+	size_t queued = 0;
+	{
+		std::lock_guard<std::mutex> graph_lock(graph_mtx_);
+		std::lock_guard<std::mutex> jobs_lock(jobs_mtx_);
+		for (const auto &[other, positions] : poses_)
+		{
+			if (other == label)
+				continue;
+
+			jobs_.push_back({label, other});
+			queued++;
+		}
+	}
+
+	RCLCPP_INFO(node_->get_logger(), "Roadmap: queued %zu edges for pose %s.", queued, label.c_str());
+	jobs_cv_.notify_all();
+}
+
+
+void PoseRoadmap::load_poses_()
+{
+	const std::string suffix = ".pose.json";
+
+	std::lock_guard<std::mutex> lock(graph_mtx_);
+	std::error_code ec;
+	for (const auto &entry : std::filesystem::directory_iterator(pose_dir_, ec))
+	{
+		const std::string name = entry.path().filename().string();
+		if (name.size() <= suffix.size() || name.compare(name.size() - suffix.size(), suffix.size(), suffix))
+			continue;
+
+		try
+		{
+			RoadmapPoseFile pose;
+			std::ifstream is(entry.path(), std::ios::in);
+			cereal::JSONInputArchive ia(is);
+			ia( pose );
+
+			poses_[name.substr(0, name.size() - suffix.size())] = pose.joint_positions;
+		}
+		catch (const std::exception &e)
+		{
+			RCLCPP_WARN(node_->get_logger(), "Skipping unreadable pose file %s: %s", name.c_str(), e.what());
+		}
+	}
+}
+
+
+void PoseRoadmap::load_()
+{
+	if (!std::filesystem::exists(roadmap_file_))
+		return;
+
+	uint32_t version = 0;
+	std::vector<Edge> edges;
+	try
+	{
+		std::ifstream is(roadmap_file_, std::ios::binary);
+		cereal::BinaryInputArchive ia(is);
+		ia( version );
+		if (version == ROADMAP_VERSION)
+			ia( edges );
+	}
+	catch (const std::exception &e)
+	{
+		RCLCPP_WARN(node_->get_logger(), "Discarding unreadable roadmap %s: %s", roadmap_file_.c_str(), e.what());
+		return;
+	}
+
+	if (version != ROADMAP_VERSION)
+	{
+		RCLCPP_WARN(node_->get_logger(), "Discarding roadmap %s with version %u.", roadmap_file_.c_str(), version);
+		return;
+	}
+
+	// Keep edges whose end poses still exist unchanged
+	std::lock_guard<std::mutex> lock(graph_mtx_);
+	for (auto &edge : edges)
+	{
+		auto from = poses_.find(edge.from);
+		auto to = poses_.find(edge.to);
+		if (from == poses_.end() || to == poses_.end() ||
+			distance_(from->second, edge.from_positions) >= POSE_EQUAL_TOL ||
+			distance_(to->second, edge.to_positions) >= POSE_EQUAL_TOL)
+			continue;
+
+		EdgeKey key{edge.from, edge.to};
+		edges_[key] = std::move(edge);
+	}
+}
+
+
+void PoseRoadmap::save_()
+{
+	std::vector<Edge> edges;
+	{
+		std::lock_guard<std::mutex> lock(graph_mtx_);
+		edges.reserve(edges_.size());
+		for (const auto &[key, edge] : edges_)
+			edges.push_back(edge);
+	}
+
+	// Write aside and rename, a crash never leaves a truncated roadmap
+	std::lock_guard<std::mutex> lock(file_mtx_);
+	const std::string tmp_file = roadmap_file_ + ".tmp";
+	{
+		std::ofstream os(tmp_file, std::ios::binary);
+		cereal::BinaryOutputArchive oa(os);
+		oa( ROADMAP_VERSION, edges );
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(tmp_file, roadmap_file_, ec);
+	if (ec)
+		RCLCPP_ERROR(node_->get_logger(), "Saving roadmap to %s failed: %s", roadmap_file_.c_str(), ec.message().c_str());
+	else
+		RCLCPP_INFO(node_->get_logger(), "Roadmap saved (%zu edges).", edges.size());
+}
+
+
+bool PoseRoadmap::edge_valid_(const planning_scene::PlanningSceneConstPtr &scene, const Edge &edge) const
+{
+	const moveit::core::JointModelGroup *jmg = scene->getRobotModel()->getJointModelGroup(group_);
+
+	moveit::core::RobotState state(scene->getCurrentState());
+	for (const auto &positions : edge.positions)
+	{
+		state.setJointGroupPositions(jmg, positions);
+		state.update();
+		if (!scene->isStateValid(state, group_))
+			return false;
+	}
+
+	return true;
+}
+
+
+bool PoseRoadmap::shortest_path_(const std::string &start, const std::string &goal, const std::map<EdgeKey, bool> &validity, std::vector<EdgeKey> &path) const
+{
+	// Dijkstra on trajectory duration, skipping edges known to be invalid
+	std::map<std::string, double> cost;
+	std::map<std::string, std::string> parent;
+	using Entry = std::pair<double, std::string>;
+	std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+
+	cost[start] = 0.0;
+	open.push({0.0, start});
+
+	while (!open.empty())
+	{
+		auto [c, node] = open.top();
+		open.pop();
+
+		if (c > cost[node])
+			continue;
+		if (node == goal)
+			break;
+
+		for (auto it = edges_.lower_bound({node, ""}); it != edges_.end() && it->first.first == node; ++it)
+		{
+			auto v = validity.find(it->first);
+			if (v != validity.end() && !v->second)
+				continue;
+
+			const std::string &next = it->first.second;
+			double next_cost = c + it->second.duration();
+			auto known = cost.find(next);
+			if (known == cost.end() || next_cost < known->second)
+			{
+				cost[next] = next_cost;
+				parent[next] = node;
+				open.push({next_cost, next});
+			}
+		}
+	}
+
+	if (!parent.count(goal))
+		return false;
+
+	path.clear();
+	for (std::string node = goal; node != start; node = parent[node])
+		path.push_back({parent[node], node});
+	std::reverse(path.begin(), path.end());
+
+	return true;
+}
+
+
+PoseRoadmap::Edge PoseRoadmap::reversed_(const Edge &edge)
+{
+	// q(T - t): same positions backwards, velocities flip sign, accelerations keep it
+	Edge rev;
+	rev.from = edge.to;
+	rev.to = edge.from;
+	rev.from_positions = edge.to_positions;
+	rev.to_positions = edge.from_positions;
+	rev.joint_names = edge.joint_names;
+
+	const double duration = edge.duration();
+	for (size_t i = edge.positions.size(); i-- > 0;)
+	{
+		rev.positions.push_back(edge.positions[i]);
+
+		std::vector<double> velocities = edge.velocities[i];
+		for (auto &v : velocities) v = -v;
+		rev.velocities.push_back(velocities);
+
+		rev.accelerations.push_back(edge.accelerations[i]);
+		rev.time_from_start.push_back(duration - edge.time_from_start[i]);
+	}
+
+	return rev;
+}
+
+
+double PoseRoadmap::distance_(const std::vector<double> &a, const std::vector<double> &b)
+{
+	if (a.size() != b.size())
+		return std::numeric_limits<double>::infinity();
+
+	double d = 0.0;
+	for (size_t i = 0; i < a.size(); i++)
+		d = std::max(d, std::abs(a[i] - b[i]));
+	return d;
+}
+
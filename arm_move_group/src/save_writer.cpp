@@ -0,0 +1,362 @@
+#include <arm_move_group/save_writer.h>
+
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+
+//* Journal record: header, path, data. The CRC covers path and data
+struct JournalRecordHeader
+{
+	uint32_t magic;
+	uint32_t path_size;
+	uint64_t data_size;
+	uint32_t crc;
+	uint32_t reserved;
+};
+
+static constexpr uint32_t JOURNAL_MAGIC = 0x4a534d41;	// "AMSJ"
+
+
+static bool write_all(int fd, const char *data, size_t size)
+{
+	while (size > 0)
+	{
+		ssize_t n = ::write(fd, data, size);
+		if (n < 0)
+		{
+			if (errno == EINTR) continue;
+			return false;
+		}
+		data += n;
+		size -= (size_t) n;
+	}
+	return true;
+}
+
+
+static bool read_file(const std::string &path, std::string &data)
+{
+	int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return false;
+
+	data.clear();
+	char buf[65536];
+	ssize_t n;
+	while ((n = ::read(fd, buf, sizeof(buf))) != 0)
+	{
+		if (n < 0)
+		{
+			if (errno == EINTR) continue;
+			::close(fd);
+			return false;
+		}
+		data.append(buf, (size_t) n);
+	}
+	::close(fd);
+	return true;
+}
+
+
+uint32_t SaveWriter::crc32(const void *data, size_t size, uint32_t crc)
+{
+	// IEEE 802.3 polynomial, reflected
+	static const auto table = []() {
+		std::vector<uint32_t> t(256);
+		for (uint32_t i = 0; i < 256; i++)
+		{
+			uint32_t c = i;
+			for (int k = 0; k < 8; k++)
+				c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+			t[i] = c;
+		}
+		return t;
+	}();
+
+	const uint8_t *p = static_cast<const uint8_t *>(data);
+	crc = ~crc;
+	for (size_t i = 0; i < size; i++)
+		crc = table[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+	return ~crc;
+}
+
+
+SaveWriter::SaveWriter(const std::string &journal_file, const rclcpp::Logger &logger)
+	: journal_file_(journal_file), logger_(logger)
+{
+	worker_ = std::thread(&SaveWriter::worker_loop_, this);
+}
+
+
+SaveWriter::~SaveWriter()
+{
+	{
+		std::lock_guard<std::mutex> lock(mtx_);
+		stop_ = true;
+	}
+	queue_cv_.notify_all();
+
+	if (worker_.joinable())
+		worker_.join();
+
+	if (journal_fd_ >= 0)
+		::close(journal_fd_);
+}
+
+
+size_t SaveWriter::recover()
+{
+	std::string journal;
+	if (!read_file(journal_file_, journal) || journal.empty())
+		return 0;
+
+	size_t offset = 0;
+	size_t restored = 0;
+	std::set<std::string> dirs;
+	while (offset + sizeof(JournalRecordHeader) <= journal.size())
+	{
+		JournalRecordHeader header;
+		std::memcpy(&header, journal.data() + offset, sizeof(header));
+
+		const size_t body = offset + sizeof(header);
+		if (header.magic != JOURNAL_MAGIC || header.data_size > journal.size() ||
+			body + header.path_size + header.data_size > journal.size())
+			break;
+
+		const char *path = journal.data() + body;
+		const char *data = path + header.path_size;
+		uint32_t crc = crc32(path, header.path_size);
+		crc = crc32(data, header.data_size, crc);
+		if (crc != header.crc)
+			break;
+
+		if (materialize_(std::string(path, header.path_size), std::string(data, header.data_size), crc32(data, header.data_size), dirs))
+			restored++;
+		else
+			keep_journal_ = true;
+
+		offset = body + header.path_size + header.data_size;
+	}
+
+	if (offset < journal.size())
+		RCLCPP_WARN(logger_, "Save journal: discarded %zu bytes of an incomplete or corrupt save.", journal.size() - offset);
+
+	sync_dirs_(dirs);
+	RCLCPP_INFO(logger_, "Save journal: restored %zu saves.", restored);
+
+	if (!keep_journal_)
+	{
+		std::error_code ec;
+		std::filesystem::remove(journal_file_, ec);
+	}
+	return restored;
+}
+
+
+std::future<SaveWriter::Result> SaveWriter::submit(const std::string &path, std::string data)
+{
+	Entry entry;
+	entry.path = path;
+	entry.crc = crc32(data.data(), data.size());
+	entry.data = std::move(data);
+	std::future<Result> future = entry.done.get_future();
+
+	{
+		std::lock_guard<std::mutex> lock(mtx_);
+		pending_[path]++;
+		queue_.push_back(std::move(entry));
+	}
+	queue_cv_.notify_one();
+
+	return future;
+}
+
+
+bool SaveWriter::exists(const std::string &path)
+{
+	{
+		std::lock_guard<std::mutex> lock(mtx_);
+		if (pending_.count(path))
+			return true;
+	}
+	std::error_code ec;
+	return std::filesystem::exists(path, ec);
+}
+
+
+void SaveWriter::wait(const std::string &path)
+{
+	std::unique_lock<std::mutex> lock(mtx_);
+	done_cv_.wait(lock, [this, &path]() { return !pending_.count(path); });
+}
+
+
+/**
+ * @brief Group commit: everything queued while the last batch was flushed goes into the
+ * journal with one fdatasync.
+ *
+ */
+void SaveWriter::worker_loop_()
+{
+	while (true)
+	{
+		std::vector<Entry> batch;
+		{
+			std::unique_lock<std::mutex> lock(mtx_);
+			queue_cv_.wait(lock, [this]() { return stop_ || !queue_.empty(); });
+			if (queue_.empty())
+				return;
+
+			for (Entry &entry : queue_)
+				batch.push_back(std::move(entry));
+			queue_.clear();
+		}
+
+		std::string error;
+		const bool durable = append_(batch, error);
+		for (Entry &entry : batch)
+			entry.done.set_value({ durable, durable ? "" : error });
+
+		std::set<std::string> dirs;
+		for (const Entry &entry : batch)
+		{
+			if (durable && !materialize_(entry.path, entry.data, entry.crc, dirs))
+				keep_journal_ = true;
+		}
+		sync_dirs_(dirs);
+
+		bool idle;
+		{
+			std::lock_guard<std::mutex> lock(mtx_);
+			for (const Entry &entry : batch)
+			{
+				auto it = pending_.find(entry.path);
+				if (it != pending_.end() && --it->second == 0)
+					pending_.erase(it);
+			}
+			idle = queue_.empty();
+		}
+		done_cv_.notify_all();
+
+		// Everything journaled is in place, the journal starts over
+		if (idle && !keep_journal_)
+			truncate_journal_();
+	}
+}
+
+
+bool SaveWriter::append_(const std::vector<Entry> &batch, std::string &error)
+{
+	if (journal_fd_ < 0)
+	{
+		journal_fd_ = ::open(journal_file_.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+		journal_size_ = (journal_fd_ < 0) ? 0 : ::lseek(journal_fd_, 0, SEEK_END);
+		if (journal_fd_ < 0 || journal_size_ < 0)
+		{
+			error = "Could not open save journal " + journal_file_ + ": " + std::strerror(errno);
+			RCLCPP_ERROR(logger_, "%s", error.c_str());
+			if (journal_fd_ >= 0) ::close(journal_fd_);
+			journal_fd_ = -1;
+			return false;
+		}
+	}
+
+	std::string records;
+	for (const Entry &entry : batch)
+	{
+		JournalRecordHeader header{};
+		header.magic = JOURNAL_MAGIC;
+		header.path_size = (uint32_t) entry.path.size();
+		header.data_size = entry.data.size();
+		header.crc = crc32(entry.data.data(), entry.data.size(), crc32(entry.path.data(), entry.path.size()));
+
+		records.append(reinterpret_cast<const char *>(&header), sizeof(header));
+		records.append(entry.path);
+		records.append(entry.data);
+	}
+
+	if (::lseek(journal_fd_, journal_size_, SEEK_SET) == journal_size_ &&
+		write_all(journal_fd_, records.data(), records.size()) &&
+		::fdatasync(journal_fd_) == 0)
+	{
+		journal_size_ += (off_t) records.size();
+		return true;
+	}
+
+	error = std::string("Writing the save journal failed: ") + std::strerror(errno);
+	RCLCPP_ERROR(logger_, "%s", error.c_str());
+
+	// Cut off the partial batch, later records must not follow garbage
+	if (::ftruncate(journal_fd_, journal_size_) != 0)
+		RCLCPP_ERROR(logger_, "Could not roll back the save journal: %s", std::strerror(errno));
+	return false;
+}
+
+
+/**
+ * @brief Writes a file aside, verifies it against the CRC and renames it into place.
+ *
+ */
+bool SaveWriter::materialize_(const std::string &path, const std::string &data, uint32_t crc, std::set<std::string> &dirs)
+{
+	const std::string tmp = path + ".tmp";
+
+	int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0)
+	{
+		RCLCPP_ERROR(logger_, "Could not write %s: %s", tmp.c_str(), std::strerror(errno));
+		return false;
+	}
+
+	const bool written = write_all(fd, data.data(), data.size()) && ::fsync(fd) == 0;
+	::close(fd);
+
+	std::string read_back;
+	if (!written || !read_file(tmp, read_back) || read_back.size() != data.size() ||
+		crc32(read_back.data(), read_back.size()) != crc)
+	{
+		RCLCPP_ERROR(logger_, "Writing %s failed verification, kept in the save journal.", path.c_str());
+		::unlink(tmp.c_str());
+		return false;
+	}
+
+	if (::rename(tmp.c_str(), path.c_str()) != 0)
+	{
+		RCLCPP_ERROR(logger_, "Could not rename %s into place: %s", tmp.c_str(), std::strerror(errno));
+		::unlink(tmp.c_str());
+		return false;
+	}
+
+	dirs.insert(std::filesystem::path(path).parent_path().string());
+	return true;
+}
+
+
+//* Makes the renames durable
+void SaveWriter::sync_dirs_(const std::set<std::string> &dirs)
+{
+	for (const std::string &dir : dirs)
+	{
+		int fd = ::open(dir.empty() ? "." : dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if (fd < 0 || ::fsync(fd) != 0)
+			RCLCPP_WARN(logger_, "Could not sync directory %s: %s", dir.c_str(), std::strerror(errno));
+		if (fd >= 0)
+			::close(fd);
+	}
+}
+
+
+void SaveWriter::truncate_journal_()
+{
+	if (journal_fd_ < 0 || journal_size_ == 0)
+		return;
+
+	if (::ftruncate(journal_fd_, 0) == 0 && ::fdatasync(journal_fd_) == 0)
+		journal_size_ = 0;
+	else
+		RCLCPP_WARN(logger_, "Could not truncate the save journal: %s", std::strerror(errno));
+}
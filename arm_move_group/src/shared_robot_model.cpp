@@ -0,0 +1,37 @@
+#include <arm_move_group/shared_robot_model.h>
+
+#include <chrono>
+#include <map>
+#include <mutex>
+
+
+robot_model_loader::RobotModelLoaderPtr shared_robot_model_loader(
+	const rclcpp::Node::SharedPtr &node,
+	const std::string &description)
+{
+	static std::mutex mtx;
+	static std::map<std::string, robot_model_loader::RobotModelLoaderPtr> loaders;
+
+	// Arms starting together wait for the first one's load instead of loading in parallel
+	std::lock_guard<std::mutex> lock(mtx);
+
+	robot_model_loader::RobotModelLoaderPtr &loader = loaders[description];
+	if (!loader)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		loader = std::make_shared<robot_model_loader::RobotModelLoader>(node, description, true);
+
+		if (!loader->getModel())
+		{
+			// Not cached, the next arm tries again
+			RCLCPP_ERROR(node->get_logger(), "Could not load the robot model from %s.", description.c_str());
+			robot_model_loader::RobotModelLoaderPtr failed = loader;
+			loaders.erase(description);
+			return failed;
+		}
+
+		RCLCPP_INFO(node->get_logger(), "Loaded robot model %s in %.2fs, shared by all arms of this process.",
+			loader->getModel()->getName().c_str(), std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+	}
+	return loader;
+}
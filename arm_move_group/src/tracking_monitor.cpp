@@ -0,0 +1,351 @@
+#include <arm_move_group/tracking_monitor.h>
+
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+
+
+//* Upper bound of the controller state rate, for the recording buffer size [Hz]
+static constexpr double MAX_STATE_RATE = 1000.0;
+
+//* Recording time allowed per second of trajectory, covers slow speed overrides and holds
+static constexpr double TIME_MARGIN = 4.0;
+static constexpr double TIME_EXTRA = 10.0;
+
+//* Reference within this of the goal counts as arrived [rad]
+static constexpr double GOAL_EPS = 1e-6;
+
+//* Joints moving less than this have no lag or overshoot [rad]
+static constexpr double MIN_TRAVEL = 1e-3;
+
+//* Override this close to 100% counts as nominal time [%]
+static constexpr double OVERRIDE_EPS = 0.5;
+
+//* Below this state rate the lag and peak error are coarse, the controller's
+// state_publish_rate is likely at its default [Hz]
+static constexpr double MIN_STATE_RATE = 200.0;
+
+
+template <typename T>
+static T param(const rclcpp::Node::SharedPtr &node, const std::string &name, const T &default_value)
+{
+	if (!node->has_parameter(name))
+		return node->declare_parameter<T>(name, default_value);
+	return node->get_parameter(name).get_value<T>();
+}
+
+
+TrackingMonitor::TrackingMonitor(const rclcpp::NodeOptions &options, const std::string &ns, const std::string &summary_dir)
+	: summary_dir_(summary_dir)
+{
+	rclcpp::NodeOptions node_options;
+	node_options.parameter_overrides(options.parameter_overrides());
+	node_options.automatically_declare_parameters_from_overrides(true);
+	node_ = rclcpp::Node::make_shared("arm_tracking", ns, node_options);
+
+	enabled_ = param<bool>(node_, "tracking.enabled", true);
+	settle_time_ = param<double>(node_, "tracking.settle_time", 0.5);
+	max_lag_ = param<double>(node_, "tracking.max_lag", 0.2);
+	feedback_period_ = param<double>(node_, "tracking.feedback_period", 0.01);
+	const std::string topic = param<std::string>(node_, "tracking.state_topic", "arm_group_controller/controller_state");
+	const std::string override_topic = param<std::string>(node_, "tracking.override_topic", "arm/speed_override/scale");
+
+	if (!enabled_)
+	{
+		RCLCPP_INFO(node_->get_logger(), "Tracking analysis disabled.");
+		return;
+	}
+
+	// Every state is needed for the reference, a deep queue keeps bursts from being dropped
+	state_sub_ = node_->create_subscription<ControllerState>(
+		topic,
+		rclcpp::SensorDataQoS().keep_last(100),
+		std::bind(&TrackingMonitor::state_cb_, this, std::placeholders::_1)
+	);
+
+	// Latched by arm_ethercat_interface, the value in effect arrives on subscription
+	override_sub_ = node_->create_subscription<std_msgs::msg::Float64>(
+		override_topic,
+		rclcpp::QoS(1).reliable().transient_local(),
+		std::bind(&TrackingMonitor::override_cb_, this, std::placeholders::_1)
+	);
+
+	executor_.add_node(node_);
+	spin_thread_ = std::thread([this]() { executor_.spin(); });
+
+	RCLCPP_INFO(node_->get_logger(), "Tracking analysis of %s, summaries in %s", topic.c_str(), summary_dir_.c_str());
+}
+
+
+TrackingMonitor::~TrackingMonitor()
+{
+	executor_.cancel();
+	if (spin_thread_.joinable())
+		spin_thread_.join();
+}
+
+
+void TrackingMonitor::start(const std::string &label, const trajectory_msgs::msg::JointTrajectory &trajectory)
+{
+	if (!enabled_ || trajectory.points.empty())
+		return;
+
+	const auto &last = trajectory.points.back();
+	const double duration = rclcpp::Duration(last.time_from_start).seconds();
+	const size_t joints = trajectory.joint_names.size();
+
+	std::lock_guard<std::mutex> lock(mtx_);
+
+	if (recording_)
+		RCLCPP_WARN(node_->get_logger(), "Tracking of %s discarded, a new execution started.", label_.c_str());
+
+	label_ = label;
+	joint_names_ = trajectory.joint_names;
+	goal_ = last.positions;
+	index_.clear();
+
+	// Sized once per execution, the state callback only copies into it
+	capacity_ = (size_t) ((duration * TIME_MARGIN + settle_time_ + TIME_EXTRA) * MAX_STATE_RATE);
+	t_.clear();
+	ref_.clear();
+	act_.clear();
+	t_.reserve(capacity_);
+	ref_.reserve(capacity_ * joints);
+	act_.reserve(capacity_ * joints);
+
+	t_arrived_ = -1.0;
+	moved_ = false;
+	override_min_ = override_;
+	override_max_ = override_;
+	recording_ = true;
+}
+
+
+void TrackingMonitor::override_cb_(const std_msgs::msg::Float64::SharedPtr msg)
+{
+	std::lock_guard<std::mutex> lock(mtx_);
+
+	override_ = msg->data;
+	if (recording_)
+	{
+		override_min_ = std::min(override_min_, override_);
+		override_max_ = std::max(override_max_, override_);
+	}
+}
+
+
+void TrackingMonitor::cancel()
+{
+	std::lock_guard<std::mutex> lock(mtx_);
+
+	if (recording_)
+		RCLCPP_INFO(node_->get_logger(), "Tracking of %s discarded, execution stopped.", label_.c_str());
+
+	recording_ = false;
+}
+
+
+void TrackingMonitor::state_cb_(const ControllerState::SharedPtr state)
+{
+	std::lock_guard<std::mutex> lock(mtx_);
+
+	if (!recording_)
+		return;
+
+	const size_t joints = joint_names_.size();
+
+	// Joint order of the controller, resolved on the first sample
+	if (index_.empty())
+	{
+		for (const auto &name : joint_names_)
+		{
+			auto it = std::find(state->joint_names.begin(), state->joint_names.end(), name);
+			if (it == state->joint_names.end())
+			{
+				RCLCPP_ERROR(node_->get_logger(), "Tracking of %s discarded, controller has no joint %s", label_.c_str(), name.c_str());
+				recording_ = false;
+				return;
+			}
+			index_.push_back(it - state->joint_names.begin());
+		}
+	}
+
+	const auto &ref = state->reference.positions;
+	const auto &act = state->feedback.positions;
+	if (ref.size() != state->joint_names.size() || act.size() != state->joint_names.size())
+		return;
+
+	const double stamp = rclcpp::Time(state->header.stamp).seconds();
+	if (t_.empty())
+		t0_ = stamp;
+
+	const double t = stamp - t0_;
+	t_.push_back(t);
+
+	bool at_goal = true;
+	for (size_t j = 0; j < joints; j++)
+	{
+		const double r = ref[index_[j]];
+		ref_.push_back(r);
+		act_.push_back(act[index_[j]]);
+
+		if (std::abs(r - goal_[j]) > GOAL_EPS)
+			at_goal = false;
+		if (std::abs(r - ref_[j]) > GOAL_EPS)
+			moved_ = true;
+	}
+
+	// The reference on the goal only counts once it has moved, a closed trajectory starts there
+	if (!at_goal)
+		t_arrived_ = -1.0;
+	else if (t_arrived_ < 0.0 && moved_)
+		t_arrived_ = t;
+
+	bool settled = (t_arrived_ >= 0.0) && (t - t_arrived_ >= settle_time_);
+	bool full = t_.size() >= capacity_;
+
+	if (!settled && !full)
+		return;
+
+	recording_ = false;
+
+	if (full && t_arrived_ < 0.0)
+	{
+		RCLCPP_WARN(node_->get_logger(), "Tracking of %s discarded, the reference never arrived at the goal within %.1fs.", label_.c_str(), t);
+		return;
+	}
+
+	Summary summary = analyse_();
+	store_(label_, summary);
+
+	if (summary.state_rate < MIN_STATE_RATE)
+	{
+		RCLCPP_WARN_ONCE(node_->get_logger(), "Controller state at %.0f Hz, lag resolution %.1f ms and the peak error is undersampled. "
+			"Set the controller's state_publish_rate to its update rate.", summary.state_rate, 1e3 / summary.state_rate);
+	}
+
+	if (summary.override_min < 100.0 - OVERRIDE_EPS || summary.override_max > 100.0 + OVERRIDE_EPS)
+	{
+		RCLCPP_WARN(node_->get_logger(), "Tracking %s ran at a %.0f-%.0f%% speed override, the reference was not on the arm's time. "
+			"Stored as not nominal.", label_.c_str(), summary.override_min, summary.override_max);
+		return;
+	}
+
+	// Worst joint in the log, the rest is in the summary file
+	size_t worst = std::max_element(summary.max.begin(), summary.max.end()) - summary.max.begin();
+	RCLCPP_INFO(node_->get_logger(), "Tracking %s: %.2fs, %s max error %.5f rad, rms %.5f rad, lag %.1f ms (resolution %.1f ms), overshoot %.5f rad",
+		label_.c_str(), summary.duration, joint_names_[worst].c_str(),
+		summary.max[worst], summary.rms[worst], summary.lag_ms[worst], summary.resolution_ms, summary.overshoot[worst]);
+}
+
+
+TrackingMonitor::Summary TrackingMonitor::analyse_() const
+{
+	const size_t n = t_.size();
+	const size_t joints = joint_names_.size();
+
+	Summary s;
+	s.duration = t_arrived_;
+	s.samples = n;
+	s.override_min = override_min_;
+	s.override_max = override_max_;
+	s.rms.assign(joints, 0.0);
+	s.max.assign(joints, 0.0);
+	s.lag_ms.assign(joints, std::numeric_limits<double>::quiet_NaN());
+	s.overshoot.assign(joints, 0.0);
+
+	// First sample with the reference at the goal
+	size_t arrived = std::lower_bound(t_.begin(), t_.end(), t_arrived_) - t_.begin();
+
+	// Lag search in whole samples of the mean cycle time
+	const double dt = (n > 1) ? (t_[n - 1] - t_[0]) / (n - 1) : 0.0;
+	s.state_rate = (dt > 0.0) ? 1.0 / dt : 0.0;
+	s.resolution_ms = std::max(dt, feedback_period_) * 1e3;
+	const size_t max_shift = (dt > 0.0) ? std::min(n / 2, (size_t) std::lround(max_lag_ / dt)) : 0;
+
+	for (size_t j = 0; j < joints; j++)
+	{
+		double sum_sq = 0.0;
+		double ref_min = ref_[j];
+		double ref_max = ref_[j];
+
+		for (size_t i = 0; i < n; i++)
+		{
+			const double r = ref_[i * joints + j];
+			const double e = r - act_[i * joints + j];
+			sum_sq += e * e;
+			s.max[j] = std::max(s.max[j], std::abs(e));
+			ref_min = std::min(ref_min, r);
+			ref_max = std::max(ref_max, r);
+		}
+		s.rms[j] = std::sqrt(sum_sq / n);
+
+		if (ref_max - ref_min < MIN_TRAVEL)
+			continue;
+
+		// Shift of the reference with the least squared difference to the measured motion
+		double best = std::numeric_limits<double>::infinity();
+		for (size_t k = 0; k <= max_shift; k++)
+		{
+			double cost = 0.0;
+			for (size_t i = k; i < n; i++)
+			{
+				const double e = act_[i * joints + j] - ref_[(i - k) * joints + j];
+				cost += e * e;
+			}
+			cost /= (n - k);
+
+			if (cost < best)
+			{
+				best = cost;
+				s.lag_ms[j] = k * dt * 1e3;
+			}
+		}
+
+		// Travel past the goal in the direction of the motion
+		const double travel = goal_[j] - ref_[j];
+		if (std::abs(travel) < MIN_TRAVEL)
+			continue;
+
+		const double dir = std::copysign(1.0, travel);
+		for (size_t i = arrived; i < n; i++)
+			s.overshoot[j] = std::max(s.overshoot[j], dir * (act_[i * joints + j] - goal_[j]));
+	}
+
+	return s;
+}
+
+
+void TrackingMonitor::store_(const std::string &label, const Summary &summary) const
+{
+	std::error_code ec;
+	std::filesystem::create_directories(summary_dir_, ec);
+
+	const std::string file_path = summary_dir_ + label + ".csv";
+	const bool new_file = !std::filesystem::exists(file_path);
+
+	std::ofstream os(file_path, std::ios::app);
+	if (!os)
+	{
+		RCLCPP_ERROR(node_->get_logger(), "Could not write tracking summary %s", file_path.c_str());
+		return;
+	}
+
+	if (new_file)
+	{
+		os << "stamp,duration,samples,state_rate,resolution_ms,override_min,override_max,nominal";
+		for (const auto &name : joint_names_)
+			os << "," << name << "_rms," << name << "_max," << name << "_lag_ms," << name << "_overshoot";
+		os << "\n";
+	}
+
+	const bool nominal = summary.override_min >= 100.0 - OVERRIDE_EPS && summary.override_max <= 100.0 + OVERRIDE_EPS;
+	os << (int64_t) std::time(nullptr) << "," << summary.duration << "," << summary.samples << "," << summary.state_rate << ","
+		<< summary.resolution_ms << "," << summary.override_min << "," << summary.override_max << "," << (nominal ? 1 : 0);
+	for (size_t j = 0; j < joint_names_.size(); j++)
+		os << "," << summary.rms[j] << "," << summary.max[j] << "," << summary.lag_ms[j] << "," << summary.overshoot[j];
+	os << "\n";
+}
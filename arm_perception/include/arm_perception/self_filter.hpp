@@ -0,0 +1,102 @@
+#ifndef __SELF_FILTER_HPP__
+#define __SELF_FILTER_HPP__
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include <Eigen/Geometry>
+
+#include <geometric_shapes/bodies.h>
+#include <geometric_shapes/body_operations.h>
+#include <moveit/robot_model/robot_model.h>
+#include <moveit/robot_state/robot_state.h>
+
+namespace arm_perception
+{
+
+/**
+ * @brief Removes the points on the arm itself, for the joint state given to update().
+ *
+ * Every collision shape of every link becomes a body, inflated by padding (which should
+ * cover the voxel size and the joint state's age) and posed from the robot state. A point
+ * is first tested against the bodies' bounding spheres, only points inside a sphere are
+ * tested against the body, so most of the cloud costs a few sphere tests.
+ *
+ */
+class SelfFilter
+{
+    public:
+        SelfFilter(const moveit::core::RobotModelConstPtr &model, double padding)
+        {
+            for (const moveit::core::LinkModel *link : model->getLinkModelsWithCollisionGeometry())
+            {
+                const auto &shapes = link->getShapes();
+                for (size_t i = 0; i < shapes.size(); i++)
+                {
+                    Body body;
+                    body.link = link;
+                    body.origin = link->getCollisionOriginTransforms()[i];
+                    body.body.reset(bodies::createBodyFromShape(shapes[i].get()));
+                    if (!body.body)
+                        continue;
+
+                    body.body->setPadding(padding);
+                    bodies_.push_back(std::move(body));
+                }
+            }
+        }
+
+        size_t numBodies() const { return bodies_.size(); }
+
+        //* Poses the bodies, state is in the frame of the points given to filter()
+        void update(const moveit::core::RobotState &state)
+        {
+            for (Body &body : bodies_)
+            {
+                body.body->setPose(state.getGlobalLinkTransform(body.link) * body.origin);
+                body.body->computeBoundingSphere(body.sphere);
+                body.radius_sq = body.sphere.radius * body.sphere.radius;
+            }
+        }
+
+        /**
+         * @brief Removes the points inside the arm.
+         *
+         * @return Number of points removed
+         */
+        size_t filter(std::vector<Eigen::Vector3f> &points) const
+        {
+            const size_t before = points.size();
+            points.erase(std::remove_if(points.begin(), points.end(),
+                [this](const Eigen::Vector3f &p) { return contains_(p.cast<double>()); }), points.end());
+            return before - points.size();
+        }
+
+
+    private:
+        struct Body
+        {
+            const moveit::core::LinkModel *link;
+            Eigen::Isometry3d origin;
+            std::unique_ptr<bodies::Body> body;
+            bodies::BoundingSphere sphere;
+            double radius_sq = 0.0;
+        };
+
+        std::vector<Body> bodies_;
+
+        bool contains_(const Eigen::Vector3d &p) const
+        {
+            for (const Body &body : bodies_)
+            {
+                if ((p - body.sphere.center).squaredNorm() <= body.radius_sq && body.body->containsPoint(p))
+                    return true;
+            }
+            return false;
+        }
+};
+
+}  // namespace arm_perception
+
+#endif
@@ -0,0 +1,269 @@
+#ifndef __VOXEL_FILTER_HPP__
+#define __VOXEL_FILTER_HPP__
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include <Eigen/Geometry>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace arm_perception
+{
+
+/**
+ * @brief Voxel grid downsampling of point clouds inside a workspace box.
+ *
+ * Points are transformed into the workspace frame, cropped to the box and reduced to the
+ * center of every occupied voxel. The transform, crop and voxel index computation run four
+ * points at a time with SSE2 (scalar fallback elsewhere) on x/y/z arrays; invalid (NaN)
+ * points fail the box test and are dropped on the way. Voxel keys pack the three 10 bit
+ * indices into one word and are deduplicated with a radix sort, so a frame costs O(n).
+ *
+ * @note The box holds at most 1024 voxels per axis. The buffers are kept between frames,
+ * filter() and rayEnds() only allocate while the clouds grow.
+ */
+class VoxelFilter
+{
+    public:
+        static constexpr uint32_t AXIS_BITS = 10;
+        static constexpr uint32_t MAX_VOXELS_PER_AXIS = 1u << AXIS_BITS;
+
+        VoxelFilter(float resolution, const Eigen::Vector3f &min, const Eigen::Vector3f &max) :
+            resolution_(resolution), inv_resolution_(1.0f / resolution), min_(min)
+        {
+            if (!(resolution > 0.0f))
+                throw std::invalid_argument("voxel resolution must be > 0");
+
+            for (int i = 0; i < 3; i++)
+            {
+                const float cells = std::ceil((max[i] - min[i]) * inv_resolution_);
+                if (!(cells >= 1.0f) || cells > MAX_VOXELS_PER_AXIS)
+                    throw std::invalid_argument("workspace box must span 1 to 1024 voxels per axis");
+                dims_[i] = static_cast<uint32_t>(cells);
+            }
+        }
+
+        float resolution() const { return resolution_; }
+
+        /**
+         * @brief Downsamples a cloud.
+         *
+         * @param x, y, z Point coordinates in the sensor frame, n each
+         * @param transform Sensor frame to workspace frame
+         * @param centers Voxel centers in the workspace frame, one per occupied voxel
+         */
+        void filter(const float *x, const float *y, const float *z, size_t n,
+                    const Eigen::Isometry3f &transform, std::vector<Eigen::Vector3f> &centers)
+        {
+            // Grid coordinates g = R' p + t', folding the crop offset and voxel size in
+            const Eigen::Matrix3f r = transform.linear() * inv_resolution_;
+            const Eigen::Vector3f t = (transform.translation() - min_) * inv_resolution_;
+
+            keys_.resize(n);
+            size_t kept = 0;
+            size_t i = 0;
+
+#if defined(__SSE2__)
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 dx = _mm_set1_ps(static_cast<float>(dims_[0]));
+            const __m128 dy = _mm_set1_ps(static_cast<float>(dims_[1]));
+            const __m128 dz = _mm_set1_ps(static_cast<float>(dims_[2]));
+
+            for (; i + 4 <= n; i += 4)
+            {
+                const __m128 px = _mm_loadu_ps(x + i);
+                const __m128 py = _mm_loadu_ps(y + i);
+                const __m128 pz = _mm_loadu_ps(z + i);
+
+                const __m128 gx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(r(0, 0)), px), _mm_mul_ps(_mm_set1_ps(r(0, 1)), py)),
+                                             _mm_add_ps(_mm_mul_ps(_mm_set1_ps(r(0, 2)), pz), _mm_set1_ps(t[0])));
+                const __m128 gy = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(r(1, 0)), px), _mm_mul_ps(_mm_set1_ps(r(1, 1)), py)),
+                                             _mm_add_ps(_mm_mul_ps(_mm_set1_ps(r(1, 2)), pz), _mm_set1_ps(t[1])));
+                const __m128 gz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(r(2, 0)), px), _mm_mul_ps(_mm_set1_ps(r(2, 1)), py)),
+                                             _mm_add_ps(_mm_mul_ps(_mm_set1_ps(r(2, 2)), pz), _mm_set1_ps(t[2])));
+
+                // 0 <= g < dims per axis, false for NaN
+                __m128 inside = _mm_and_ps(_mm_cmpge_ps(gx, zero), _mm_cmplt_ps(gx, dx));
+                inside = _mm_and_ps(inside, _mm_and_ps(_mm_cmpge_ps(gy, zero), _mm_cmplt_ps(gy, dy)));
+                inside = _mm_and_ps(inside, _mm_and_ps(_mm_cmpge_ps(gz, zero), _mm_cmplt_ps(gz, dz)));
+
+                const int mask = _mm_movemask_ps(inside);
+                if (mask == 0)
+                    continue;
+
+                // Truncation is floor for g >= 0
+                const __m128i key = _mm_or_si128(
+                    _mm_cvttps_epi32(gx),
+                    _mm_or_si128(_mm_slli_epi32(_mm_cvttps_epi32(gy), AXIS_BITS),
+                                 _mm_slli_epi32(_mm_cvttps_epi32(gz), 2 * AXIS_BITS)));
+
+                alignas(16) uint32_t k[4];
+                _mm_store_si128(reinterpret_cast<__m128i *>(k), key);
+                for (int j = 0; j < 4; j++)
+                {
+                    if (mask & (1 << j))
+                        keys_[kept++] = k[j];
+                }
+            }
+#endif
+
+            for (; i < n; i++)
+            {
+                const Eigen::Vector3f g = r * Eigen::Vector3f(x[i], y[i], z[i]) + t;
+                if (g[0] >= 0.0f && g[0] < dims_[0] && g[1] >= 0.0f && g[1] < dims_[1] && g[2] >= 0.0f && g[2] < dims_[2])
+                {
+                    keys_[kept++] = static_cast<uint32_t>(g[0]) |
+                                    (static_cast<uint32_t>(g[1]) << AXIS_BITS) |
+                                    (static_cast<uint32_t>(g[2]) << (2 * AXIS_BITS));
+                }
+            }
+            keys_.resize(kept);
+
+            radix_sort_();
+            centers_(centers);
+        }
+
+        /**
+         * @brief Ends of the sensor rays inside the workspace box, one per voxel.
+         *
+         * Every valid point's ray from the sensor origin is shortened to max_range and
+         * clipped to the box, and the voxel at the end of the part inside the box is kept.
+         * Casting these clears the space in front of every point, also of the ones beyond
+         * the box or the range that filter() drops.
+         *
+         * @param x, y, z Point coordinates in the sensor frame, n each
+         * @param transform Sensor frame to workspace frame, its translation is the ray origin
+         * @param max_range Longest ray [m]
+         * @param ends Voxel centers at the ray ends in the workspace frame
+         */
+        void rayEnds(const float *x, const float *y, const float *z, size_t n,
+                     const Eigen::Isometry3f &transform, float max_range, std::vector<Eigen::Vector3f> &ends)
+        {
+            const Eigen::Matrix3f r = transform.linear();
+            const Eigen::Vector3f origin = transform.translation();
+
+            keys_.resize(n);
+            size_t kept = 0;
+
+            for (size_t i = 0; i < n; i++)
+            {
+                Eigen::Vector3f d = r * Eigen::Vector3f(x[i], y[i], z[i]);
+                const float length = d.norm();
+                if (!(length > 0.0f) || !std::isfinite(length))
+                    continue;
+                if (length > max_range)
+                    d *= max_range / length;
+
+                float t0, t1;
+                if (!clip(origin, d, t0, t1))
+                    continue;
+
+                // The end may sit on the far face, rounding could put it outside
+                const Eigen::Vector3f g = (origin + t1 * d - min_) * inv_resolution_;
+                uint32_t key = 0;
+                for (int a = 0; a < 3; a++)
+                {
+                    const float cell = std::clamp(std::floor(g[a]), 0.0f, static_cast<float>(dims_[a] - 1));
+                    key |= static_cast<uint32_t>(cell) << (a * AXIS_BITS);
+                }
+                keys_[kept++] = key;
+            }
+            keys_.resize(kept);
+
+            radix_sort_();
+            centers_(ends);
+        }
+
+        /**
+         * @brief Clips the segment origin + t * d, t in [0, 1], to the workspace box.
+         *
+         * @return false if the segment misses the box, else its part inside is [t0, t1]
+         */
+        bool clip(const Eigen::Vector3f &origin, const Eigen::Vector3f &d, float &t0, float &t1) const
+        {
+            t0 = 0.0f;
+            t1 = 1.0f;
+            for (int a = 0; a < 3; a++)
+            {
+                const float lo = min_[a] - origin[a];
+                const float hi = lo + dims_[a] * resolution_;
+                if (d[a] == 0.0f)
+                {
+                    if (lo > 0.0f || hi < 0.0f)
+                        return false;
+                    continue;
+                }
+
+                float ta = lo / d[a];
+                float tb = hi / d[a];
+                if (ta > tb)
+                    std::swap(ta, tb);
+                t0 = std::max(t0, ta);
+                t1 = std::min(t1, tb);
+            }
+            return t0 <= t1;
+        }
+
+
+    private:
+        float resolution_;
+        float inv_resolution_;
+        Eigen::Vector3f min_;
+        uint32_t dims_[3];
+
+        std::vector<uint32_t> keys_;
+        std::vector<uint32_t> scratch_;
+        std::vector<uint32_t> counts_ = std::vector<uint32_t>(MAX_VOXELS_PER_AXIS);
+
+        //* One center per distinct key, keys sorted
+        void centers_(std::vector<Eigen::Vector3f> &centers) const
+        {
+            centers.clear();
+            const uint32_t axis_mask = MAX_VOXELS_PER_AXIS - 1;
+            for (size_t k = 0; k < keys_.size(); k++)
+            {
+                if (k > 0 && keys_[k] == keys_[k - 1])
+                    continue;
+
+                const uint32_t key = keys_[k];
+                centers.emplace_back(
+                    min_[0] + ((key & axis_mask) + 0.5f) * resolution_,
+                    min_[1] + (((key >> AXIS_BITS) & axis_mask) + 0.5f) * resolution_,
+                    min_[2] + ((key >> (2 * AXIS_BITS)) + 0.5f) * resolution_);
+            }
+        }
+
+        //* LSD radix sort of the keys, one pass per axis
+        void radix_sort_()
+        {
+            scratch_.resize(keys_.size());
+            for (uint32_t shift = 0; shift < 3 * AXIS_BITS; shift += AXIS_BITS)
+            {
+                std::fill(counts_.begin(), counts_.end(), 0);
+                for (uint32_t key : keys_)
+                    counts_[(key >> shift) & (MAX_VOXELS_PER_AXIS - 1)]++;
+
+                uint32_t offset = 0;
+                for (uint32_t &count : counts_)
+                {
+                    const uint32_t c = count;
+                    count = offset;
+                    offset += c;
+                }
+
+                for (uint32_t key : keys_)
+                    scratch_[counts_[(key >> shift) & (MAX_VOXELS_PER_AXIS - 1)]++] = key;
+                keys_.swap(scratch_);
+            }
+        }
+};
+
+}  // namespace arm_perception
+
+#endif
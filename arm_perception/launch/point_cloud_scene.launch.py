@@ -0,0 +1,51 @@
+from launch import LaunchDescription
+from launch_ros.actions import Node
+from launch.actions import DeclareLaunchArgument
+from launch.substitutions import LaunchConfiguration
+from moveit_configs_utils import MoveItConfigsBuilder
+
+
+def generate_launch_description():
+    moveit_config = MoveItConfigsBuilder("zeroerr_arm", package_name="arm_config").to_moveit_configs()
+
+    cloud_topic_param = DeclareLaunchArgument(
+        "cloud_topic",
+        default_value="camera/points",
+        description="PointCloud2 topic of the camera, e.g. played back from a bag."
+    )
+
+    resolution_param = DeclareLaunchArgument(
+        "resolution",
+        default_value="0.02",
+        description="Voxel and occupancy map resolution [m]."
+    )
+
+    use_sim_time_param = DeclareLaunchArgument(
+        "use_sim_time",
+        default_value="False",
+        description="'True' when playing a bag with --clock or running the sim stack."
+    )
+
+
+    # Camera point clouds to the planning scene's occupancy map
+    point_cloud_scene = Node(
+        package="arm_perception",
+        executable="point_cloud_scene",
+        output="screen",
+        parameters=[
+            moveit_config.robot_description,
+            moveit_config.robot_description_semantic,
+            {"cloud_topic": LaunchConfiguration("cloud_topic")},
+            {"resolution": LaunchConfiguration("resolution")},
+            {"use_sim_time": LaunchConfiguration("use_sim_time")},
+        ],
+    )
+
+    return LaunchDescription(
+        [
+            cloud_topic_param,
+            resolution_param,
+            use_sim_time_param,
+            point_cloud_scene
+        ]
+    )
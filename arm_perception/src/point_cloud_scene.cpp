@@ -0,0 +1,483 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <rclcpp/rclcpp.hpp>
+#include <rclcpp_components/register_node_macro.hpp>
+#include <sensor_msgs/msg/joint_state.hpp>
+#include <sensor_msgs/msg/point_cloud2.hpp>
+#include <moveit_msgs/msg/planning_scene.hpp>
+
+#include <tf2_eigen/tf2_eigen.hpp>
+#include <tf2_ros/buffer.h>
+#include <tf2_ros/transform_listener.h>
+
+#include <octomap/octomap.h>
+#include <octomap_msgs/conversions.h>
+
+#include <moveit/robot_model_loader/robot_model_loader.h>
+
+#include "arm_perception/self_filter.hpp"
+#include "arm_perception/voxel_filter.hpp"
+
+using SteadyClock = std::chrono::steady_clock;
+
+namespace arm_perception
+{
+
+static int64_t thread_cpu_ns()
+{
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+static double ms_since(const SteadyClock::time_point &start, const SteadyClock::time_point &end)
+{
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+
+/**
+ * @brief Keeps the planning scene's occupancy map up to date from a point cloud sensor.
+ *
+ * Every cloud goes through
+ *
+ *   unpack     x/y/z of the PointCloud2 into separate arrays
+ *   voxel      transform into the robot model frame, crop to the workspace box and keep one
+ *              point per voxel (SIMD, see VoxelFilter)
+ *   self       drop the voxels on the arm, posed from the latest joint state (SelfFilter)
+ *   rays       ray ends of all valid points, shortened to max_range and clipped to the
+ *              workspace box, one per voxel (VoxelFilter::rayEnds)
+ *   octomap    cast the rays from the sensor origin into the occupancy tree, marking the
+ *              space along them free and the voxels off the arm occupied
+ *
+ * The tree is kept between frames, so each cloud updates the occupancy instead of
+ * replacing it, and objects disappear once they are seen through: the rays to points
+ * beyond the box or the range, or on the arm, clear the space in front of them too. The tree is sent to
+ * the planning scene as a diff at most publish_rate times a second and only if a cloud
+ * came in since. Clouds arriving faster than max_frame_rate are dropped, the subscription
+ * keeps the latest cloud only.
+ *
+ * Every report_period the CPU time (thread CPU clock) and wall time per frame and per stage
+ * are logged, with the points per frame before and after each filter.
+ *
+ * Parameters:
+ *   cloud_topic          PointCloud2 input (x, y, z float32 fields)
+ *   joint_state_topic    Joint states posing the self filter
+ *   scene_topic          Planning scene diffs
+ *   resolution           Voxel and occupancy map resolution [m]
+ *   workspace_min/max    Workspace box in the robot model frame [m]
+ *   max_range            Points further from the sensor are not marked occupied, their
+ *                        rays clear the space up to this distance [m]
+ *   max_frame_rate       Clouds processed per second, 0 for all
+ *   publish_rate         Scene updates per second
+ *   self_filter_padding  Padding of the arm's collision shapes [m]
+ *   report_period        Timing report period [s]
+ *
+ */
+class PointCloudScene
+{
+    public:
+        explicit PointCloudScene(const rclcpp::NodeOptions &options = rclcpp::NodeOptions());
+
+        // Component interface
+        rclcpp::node_interfaces::NodeBaseInterface::SharedPtr get_node_base_interface() const { return nh_->get_node_base_interface(); }
+
+
+    private:
+        // Sums over a report period
+        struct Stats
+        {
+            size_t frames = 0;
+            size_t dropped = 0;
+            size_t points = 0;
+            size_t voxels = 0;
+            size_t kept = 0;
+            double cpu_ms = 0.0;
+            double max_cpu_ms = 0.0;
+            double wall_ms = 0.0;
+            double max_wall_ms = 0.0;
+            double unpack_ms = 0.0;
+            double voxel_ms = 0.0;
+            double self_ms = 0.0;
+            double ray_ms = 0.0;
+            double octomap_ms = 0.0;
+            size_t updates = 0;
+            double update_cpu_ms = 0.0;
+            size_t update_bytes = 0;
+        };
+
+        rclcpp::Node::SharedPtr nh_;
+
+        rclcpp::Subscription<sensor_msgs::msg::PointCloud2>::SharedPtr cloud_sub_;
+        rclcpp::Subscription<sensor_msgs::msg::JointState>::SharedPtr joint_state_sub_;
+        rclcpp::Publisher<moveit_msgs::msg::PlanningScene>::SharedPtr scene_pub_;
+        rclcpp::TimerBase::SharedPtr publish_timer_;
+        rclcpp::TimerBase::SharedPtr report_timer_;
+
+        std::shared_ptr<tf2_ros::Buffer> tf_buffer_;
+        std::shared_ptr<tf2_ros::TransformListener> tf_listener_;
+
+        robot_model_loader::RobotModelLoaderPtr robot_model_loader_;
+        moveit::core::RobotModelConstPtr robot_model_;
+        std::unique_ptr<moveit::core::RobotState> state_;
+        std::string model_frame_;
+
+        std::unique_ptr<VoxelFilter> voxel_filter_;
+        std::unique_ptr<SelfFilter> self_filter_;
+        std::unique_ptr<octomap::OcTree> octree_;
+
+        double max_range_;
+        std::chrono::nanoseconds min_frame_period_{0};
+        double report_period_;
+
+        // All callbacks run in the node's mutually exclusive default group
+        bool have_joint_state_ = false;
+        bool changed_ = false;
+        SteadyClock::time_point last_frame_;
+        std::vector<float> x_, y_, z_;
+        std::vector<Eigen::Vector3f> voxels_;
+        std::vector<Eigen::Vector3f> ray_ends_;
+        octomap::KeySet free_cells_;
+        octomap::KeySet occupied_cells_;
+        octomap::KeyRay key_ray_;
+        Stats stats_;
+
+        void cloud_cb_(const sensor_msgs::msg::PointCloud2::ConstSharedPtr cloud);
+        void joint_state_cb_(const sensor_msgs::msg::JointState::ConstSharedPtr joint_state);
+        void publish_cb_();
+        void report_cb_();
+
+        bool unpack_(const sensor_msgs::msg::PointCloud2 &cloud);
+        void insert_(const Eigen::Vector3f &origin);
+};
+
+
+PointCloudScene::PointCloudScene(const rclcpp::NodeOptions &options)
+{
+    nh_ = rclcpp::Node::make_shared("point_cloud_scene", options);
+
+    const std::string cloud_topic = nh_->declare_parameter("cloud_topic", std::string("camera/points"));
+    const std::string joint_state_topic = nh_->declare_parameter("joint_state_topic", std::string("joint_states"));
+    const std::string scene_topic = nh_->declare_parameter("scene_topic", std::string("/planning_scene"));
+    const double resolution = nh_->declare_parameter("resolution", 0.02);
+    std::vector<double> workspace_min = nh_->declare_parameter("workspace_min", std::vector<double>{ -1.0, -1.0, -0.6 });
+    const std::vector<double> workspace_max = nh_->declare_parameter("workspace_max", std::vector<double>{ 1.0, 1.0, 1.2 });
+    max_range_ = nh_->declare_parameter("max_range", 1.5);
+    const double max_frame_rate = nh_->declare_parameter("max_frame_rate", 10.0);
+    const double publish_rate = nh_->declare_parameter("publish_rate", 2.0);
+    const double padding = nh_->declare_parameter("self_filter_padding", 0.03);
+    report_period_ = nh_->declare_parameter("report_period", 5.0);
+
+    if (workspace_min.size() != 3 || workspace_max.size() != 3)
+        throw std::invalid_argument("workspace_min and workspace_max need 3 values (x, y, z)");
+
+    // Voxels on the occupancy map's grid, so every voxel center is one map cell
+    for (double &v : workspace_min)
+        v = std::floor(v / resolution) * resolution;
+
+    voxel_filter_ = std::make_unique<VoxelFilter>(
+        static_cast<float>(resolution),
+        Eigen::Map<const Eigen::Vector3d>(workspace_min.data()).cast<float>(),
+        Eigen::Map<const Eigen::Vector3d>(workspace_max.data()).cast<float>());
+
+    robot_model_loader_ = std::make_shared<robot_model_loader::RobotModelLoader>(nh_, "robot_description", false);
+    robot_model_ = robot_model_loader_->getModel();
+    if (!robot_model_)
+        throw std::runtime_error("could not load the robot model, the self filter needs robot_description");
+
+    model_frame_ = robot_model_->getModelFrame();
+    state_ = std::make_unique<moveit::core::RobotState>(robot_model_);
+    state_->setToDefaultValues();
+    self_filter_ = std::make_unique<SelfFilter>(robot_model_, padding);
+
+    octree_ = std::make_unique<octomap::OcTree>(resolution);
+
+    if (max_frame_rate > 0.0)
+        min_frame_period_ = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<double>(1.0 / max_frame_rate));
+
+    tf_buffer_ = std::make_shared<tf2_ros::Buffer>(nh_->get_clock());
+    tf_listener_ = std::make_shared<tf2_ros::TransformListener>(*tf_buffer_);
+
+    scene_pub_ = nh_->create_publisher<moveit_msgs::msg::PlanningScene>(scene_topic, rclcpp::QoS(1));
+
+    // Latest cloud only, a cloud that waited for the previous one is stale anyway
+    cloud_sub_ = nh_->create_subscription<sensor_msgs::msg::PointCloud2>(
+        cloud_topic,
+        rclcpp::SensorDataQoS().keep_last(1),
+        std::bind(&PointCloudScene::cloud_cb_, this, std::placeholders::_1));
+
+    joint_state_sub_ = nh_->create_subscription<sensor_msgs::msg::JointState>(
+        joint_state_topic,
+        rclcpp::SensorDataQoS(),
+        std::bind(&PointCloudScene::joint_state_cb_, this, std::placeholders::_1));
+
+    publish_timer_ = nh_->create_wall_timer(
+        std::chrono::duration<double>(1.0 / std::max(publish_rate, 0.01)),
+        std::bind(&PointCloudScene::publish_cb_, this));
+
+    report_timer_ = nh_->create_wall_timer(
+        std::chrono::duration<double>(std::max(report_period_, 0.1)),
+        std::bind(&PointCloudScene::report_cb_, this));
+
+    RCLCPP_INFO(nh_->get_logger(), "Updating %s from %s: %.3fm voxels in [%.2f, %.2f, %.2f] - [%.2f, %.2f, %.2f] (%s), "
+        "%zu self filter bodies, scene updates at %.1fHz.",
+        scene_topic.c_str(), cloud_topic.c_str(), resolution,
+        workspace_min[0], workspace_min[1], workspace_min[2], workspace_max[0], workspace_max[1], workspace_max[2],
+        model_frame_.c_str(), self_filter_->numBodies(), publish_rate);
+}
+
+
+void PointCloudScene::joint_state_cb_(const sensor_msgs::msg::JointState::ConstSharedPtr joint_state)
+{
+    const size_t n = std::min(joint_state->name.size(), joint_state->position.size());
+    for (size_t i = 0; i < n; i++)
+    {
+        if (robot_model_->hasJointModel(joint_state->name[i]))
+            state_->setVariablePosition(joint_state->name[i], joint_state->position[i]);
+    }
+    have_joint_state_ = true;
+}
+
+
+void PointCloudScene::cloud_cb_(const sensor_msgs::msg::PointCloud2::ConstSharedPtr cloud)
+{
+    const int64_t cpu_start = thread_cpu_ns();
+    const auto start = SteadyClock::now();
+
+    if (start - last_frame_ < min_frame_period_)
+        return;
+
+    if (!have_joint_state_)
+    {
+        RCLCPP_WARN_THROTTLE(nh_->get_logger(), *nh_->get_clock(), 5000, "No joint state yet, cannot self filter the clouds.");
+        stats_.dropped++;
+        return;
+    }
+
+    // Sensor pose when the cloud was taken, the camera rides on the arm
+    Eigen::Isometry3f sensor_pose;
+    try
+    {
+        sensor_pose = tf2::transformToEigen(tf_buffer_->lookupTransform(
+            model_frame_, cloud->header.frame_id, cloud->header.stamp, rclcpp::Duration::from_seconds(0.05))).cast<float>();
+    }
+    catch (const tf2::TransformException &e)
+    {
+        RCLCPP_WARN_THROTTLE(nh_->get_logger(), *nh_->get_clock(), 5000, "Dropping cloud: %s", e.what());
+        stats_.dropped++;
+        return;
+    }
+
+    if (!unpack_(*cloud))
+    {
+        stats_.dropped++;
+        return;
+    }
+    last_frame_ = start;
+    const auto unpacked = SteadyClock::now();
+
+    voxel_filter_->filter(x_.data(), y_.data(), z_.data(), x_.size(), sensor_pose, voxels_);
+    const size_t voxels = voxels_.size();
+    const auto voxelized = SteadyClock::now();
+
+    state_->update();
+    self_filter_->update(*state_);
+    self_filter_->filter(voxels_);
+    const auto self_filtered = SteadyClock::now();
+
+    voxel_filter_->rayEnds(x_.data(), y_.data(), z_.data(), x_.size(), sensor_pose, static_cast<float>(max_range_), ray_ends_);
+    const auto rays = SteadyClock::now();
+
+    insert_(sensor_pose.translation());
+    changed_ = true;
+    const auto end = SteadyClock::now();
+
+    const double cpu_ms = (thread_cpu_ns() - cpu_start) / 1e6;
+    const double wall_ms = ms_since(start, end);
+    stats_.frames++;
+    stats_.points += x_.size();
+    stats_.voxels += voxels;
+    stats_.kept += voxels_.size();
+    stats_.cpu_ms += cpu_ms;
+    stats_.max_cpu_ms = std::max(stats_.max_cpu_ms, cpu_ms);
+    stats_.wall_ms += wall_ms;
+    stats_.max_wall_ms = std::max(stats_.max_wall_ms, wall_ms);
+    stats_.unpack_ms += ms_since(start, unpacked);
+    stats_.voxel_ms += ms_since(unpacked, voxelized);
+    stats_.self_ms += ms_since(voxelized, self_filtered);
+    stats_.ray_ms += ms_since(self_filtered, rays);
+    stats_.octomap_ms += ms_since(rays, end);
+}
+
+
+/**
+ * @brief Updates the occupancy tree: free along the rays, occupied at the voxels off the arm.
+ *
+ * Like octomap's insertPointCloud, but with the rays to all points (ray_ends_) instead of
+ * only the occupied ones. A cell that is hit in this frame is not also cleared.
+ *
+ */
+void PointCloudScene::insert_(const Eigen::Vector3f &origin)
+{
+    occupied_cells_.clear();
+    free_cells_.clear();
+
+    const float max_range_sq = static_cast<float>(max_range_ * max_range_);
+    octomap::OcTreeKey key;
+    for (const Eigen::Vector3f &p : voxels_)
+    {
+        if ((p - origin).squaredNorm() <= max_range_sq && octree_->coordToKeyChecked(octomap::point3d(p.x(), p.y(), p.z()), key))
+            occupied_cells_.insert(key);
+    }
+
+    // Rays start where they enter the box, the sensor may be outside it
+    for (const Eigen::Vector3f &end : ray_ends_)
+    {
+        const Eigen::Vector3f d = end - origin;
+        float t0, t1;
+        if (!voxel_filter_->clip(origin, d, t0, t1))
+            continue;
+
+        const Eigen::Vector3f start = origin + t0 * d;
+        if (octree_->computeRayKeys(octomap::point3d(start.x(), start.y(), start.z()), octomap::point3d(end.x(), end.y(), end.z()), key_ray_))
+            free_cells_.insert(key_ray_.begin(), key_ray_.end());
+    }
+
+    for (const octomap::OcTreeKey &k : free_cells_)
+    {
+        if (occupied_cells_.find(k) == occupied_cells_.end())
+            octree_->updateNode(k, false, true);
+    }
+    for (const octomap::OcTreeKey &k : occupied_cells_)
+        octree_->updateNode(k, true, true);
+
+    octree_->updateInnerOccupancy();
+}
+
+
+/**
+ * @brief Copies x, y and z out of the interleaved cloud.
+ *
+ */
+bool PointCloudScene::unpack_(const sensor_msgs::msg::PointCloud2 &cloud)
+{
+    int offset[3] = { -1, -1, -1 };
+    const char *names[3] = { "x", "y", "z" };
+    for (const auto &field : cloud.fields)
+    {
+        for (int a = 0; a < 3; a++)
+        {
+            if (field.name == names[a] && field.datatype == sensor_msgs::msg::PointField::FLOAT32)
+                offset[a] = static_cast<int>(field.offset);
+        }
+    }
+
+    if (offset[0] < 0 || offset[1] < 0 || offset[2] < 0 || cloud.is_bigendian)
+    {
+        RCLCPP_ERROR_THROTTLE(nh_->get_logger(), *nh_->get_clock(), 5000, "Clouds need little endian float32 x, y and z fields.");
+        return false;
+    }
+
+    // The layout has to fit the data, a truncated or malformed cloud is dropped
+    const int max_offset = std::max({ offset[0], offset[1], offset[2] });
+    if (static_cast<uint64_t>(max_offset) + sizeof(float) > cloud.point_step ||
+        static_cast<uint64_t>(cloud.width) * cloud.point_step > cloud.row_step ||
+        static_cast<uint64_t>(cloud.height) * cloud.row_step > cloud.data.size())
+    {
+        RCLCPP_ERROR_THROTTLE(nh_->get_logger(), *nh_->get_clock(), 5000,
+            "Dropping malformed cloud: %ux%u points, point_step %u, row_step %u, %zu bytes of data.",
+            cloud.width, cloud.height, cloud.point_step, cloud.row_step, cloud.data.size());
+        return false;
+    }
+
+    const size_t n = static_cast<size_t>(cloud.width) * cloud.height;
+    x_.resize(n);
+    y_.resize(n);
+    z_.resize(n);
+
+    size_t i = 0;
+    for (uint32_t row = 0; row < cloud.height; row++)
+    {
+        const uint8_t *point = cloud.data.data() + static_cast<size_t>(row) * cloud.row_step;
+        for (uint32_t col = 0; col < cloud.width; col++, i++, point += cloud.point_step)
+        {
+            std::memcpy(&x_[i], point + offset[0], sizeof(float));
+            std::memcpy(&y_[i], point + offset[1], sizeof(float));
+            std::memcpy(&z_[i], point + offset[2], sizeof(float));
+        }
+    }
+    return true;
+}
+
+
+/**
+ * @brief Sends the occupancy map to the planning scene, if a cloud changed it.
+ *
+ */
+void PointCloudScene::publish_cb_()
+{
+    if (!changed_)
+        return;
+
+    const int64_t cpu_start = thread_cpu_ns();
+
+    octree_->prune();
+
+    moveit_msgs::msg::PlanningScene scene;
+    scene.is_diff = true;
+    scene.robot_state.is_diff = true;
+    scene.world.octomap.header.frame_id = model_frame_;
+    scene.world.octomap.header.stamp = nh_->now();
+    scene.world.octomap.origin.orientation.w = 1.0;
+
+    if (!octomap_msgs::binaryMapToMsg(*octree_, scene.world.octomap.octomap))
+    {
+        RCLCPP_ERROR(nh_->get_logger(), "Could not serialize the occupancy map.");
+        return;
+    }
+
+    stats_.update_bytes += scene.world.octomap.octomap.data.size();
+    scene_pub_->publish(scene);
+    changed_ = false;
+
+    stats_.updates++;
+    stats_.update_cpu_ms += (thread_cpu_ns() - cpu_start) / 1e6;
+}
+
+
+void PointCloudScene::report_cb_()
+{
+    const Stats &s = stats_;
+    if (s.frames == 0)
+    {
+        if (s.dropped > 0)
+            RCLCPP_INFO(nh_->get_logger(), "No clouds processed, %zu dropped.", s.dropped);
+        stats_ = Stats();
+        return;
+    }
+
+    const double f = static_cast<double>(s.frames);
+    RCLCPP_INFO(nh_->get_logger(),
+        "%zu frames (%zu dropped), %.0f points -> %.0f voxels -> %.0f off the arm per frame. "
+        "CPU per frame %.2fms (max %.2fms), wall %.2fms (max %.2fms): unpack %.2f, voxel %.2f, self %.2f, rays %.2f, octomap %.2fms. "
+        "%zu scene updates, %.2fms CPU and %.0fkB each, %zu map nodes.",
+        s.frames, s.dropped, s.points / f, s.voxels / f, s.kept / f,
+        s.cpu_ms / f, s.max_cpu_ms, s.wall_ms / f, s.max_wall_ms,
+        s.unpack_ms / f, s.voxel_ms / f, s.self_ms / f, s.ray_ms / f, s.octomap_ms / f,
+        s.updates, s.updates ? s.update_cpu_ms / s.updates : 0.0, s.updates ? s.update_bytes / 1024.0 / s.updates : 0.0,
+        octree_->size());
+
+    stats_ = Stats();
+}
+
+}  // namespace arm_perception
+
+RCLCPP_COMPONENTS_REGISTER_NODE(arm_perception::PointCloudScene)
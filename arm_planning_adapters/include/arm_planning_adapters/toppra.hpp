@@ -0,0 +1,116 @@
+#ifndef __ARM_PLANNING_ADAPTERS_TOPPRA_H__
+#define __ARM_PLANNING_ADAPTERS_TOPPRA_H__
+
+#include <cstddef>
+#include <vector>
+
+namespace arm_planning_adapters
+{
+
+    /**
+     * @brief C2 geometric path through joint space waypoints.
+     *
+     * One natural cubic spline per joint, parameterized by the cumulative chord length s
+     * of the waypoints, so that q'(s) is close to unit length and the TOPP-RA gridpoints are
+     * spread evenly along the motion.
+     *
+     */
+    class CubicSplinePath
+    {
+        public:
+            /**
+             * @brief Fits the path. Consecutive duplicate waypoints are dropped.
+             *
+             * @param waypoints Joint positions, all of the same size
+             * @return false if fewer than two distinct waypoints remain
+             */
+            bool fit(const std::vector<std::vector<double>>& waypoints);
+
+            double length() const { return s_.empty() ? 0.0 : s_.back(); }
+            size_t dof() const { return dof_; }
+
+            /**
+             * @brief Evaluates q(s), q'(s) and q''(s). s is clamped to [0, length()].
+             *
+             */
+            void eval(double s, std::vector<double>& q, std::vector<double>& qs, std::vector<double>& qss) const;
+
+
+        private:
+            size_t dof_ = 0;
+            std::vector<double> s_;                 // knots
+            std::vector<std::vector<double>> q_;    // q_[joint][knot]
+            std::vector<std::vector<double>> m_;    // second derivatives at the knots
+    };
+
+
+    /**
+     * @brief Linear path constraint lo <= a * u + b * x + c <= hi at one gridpoint.
+     *
+     * x = sdot^2 and u = sddot. Joint acceleration and inverse dynamics torque limits are
+     * both of this form along a fixed path.
+     *
+     */
+    struct PathConstraint
+    {
+        double a;
+        double b;
+        double c;
+        double lo;
+        double hi;
+    };
+
+
+    /**
+     * @brief Time-optimal path parameterization by reachability analysis (TOPP-RA).
+     *
+     * Pham & Pham, "A New Approach to Time-Optimal Path Parameterization based on
+     * Reachability Analysis", IEEE T-RO 2018. The backward pass computes the controllable
+     * set [x_min, x_max] at every gridpoint (the squared path speeds from which the end of
+     * the path can still be reached at rest); the forward pass then greedily takes the
+     * largest admissible path acceleration that stays inside the next controllable set.
+     * Each step is a two variable LP, solved exactly by vertex enumeration.
+     *
+     */
+    class Toppra
+    {
+        public:
+            /**
+             * @brief Solves for the squared path speed at every gridpoint.
+             *
+             * Starts and ends at rest.
+             *
+             * @param s Gridpoints, increasing
+             * @param x_bound Upper bound on x at each gridpoint (velocity limits)
+             * @param constraints Constraints at each gridpoint
+             * @param x Output x = sdot^2 at each gridpoint
+             * @return false if the path is infeasible under the constraints
+             */
+            bool solve(
+                const std::vector<double>& s,
+                const std::vector<double>& x_bound,
+                const std::vector<std::vector<PathConstraint>>& constraints,
+                std::vector<double>& x) const;
+
+            /**
+             * @brief Time at each gridpoint for the solved x, starting at 0.
+             *
+             */
+            static void timestamps(const std::vector<double>& s, const std::vector<double>& x, std::vector<double>& t);
+
+
+        private:
+            // Half plane p_x * x + p_u * u <= r
+            struct HalfPlane
+            {
+                double p_x;
+                double p_u;
+                double r;
+            };
+
+            static bool lp_x_range_(const std::vector<HalfPlane>& planes, double& x_min, double& x_max);
+    };
+
+}   // namespace arm_planning_adapters
+
+#endif
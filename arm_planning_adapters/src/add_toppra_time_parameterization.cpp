@@ -0,0 +1,390 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <rclcpp/rclcpp.hpp>
+#include <pluginlib/class_list_macros.hpp>
+
+#include <moveit/planning_interface/planning_response_adapter.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include <moveit/trajectory_processing/time_optimal_trajectory_generation.h>
+#include <moveit_msgs/msg/move_it_error_codes.hpp>
+
+#include <kdl/chain.hpp>
+#include <kdl/chainidsolver_recursive_newton_euler.hpp>
+#include <kdl/tree.hpp>
+#include <kdl_parser/kdl_parser.hpp>
+
+#include "arm_planning_adapters/toppra.hpp"
+
+#define LOGGER "AddToppraTimeParameterization"
+
+namespace arm_planning_adapters
+{
+
+    /**
+     * @brief Times the planned path with TOPP-RA under joint velocity, joint acceleration
+     * and drive torque limits.
+     *
+     * Torques come from the URDF inertials through KDL inverse dynamics, so the timing
+     * accounts for the load each drive actually sees along the path instead of a uniform
+     * acceleration limit. Every plan is also timed with TOTG (what this adapter replaces)
+     * under the same velocity and acceleration limits, so the logged cycle time gain (and
+     * the optional CSV report) is down to the torque model and the solver alone. Falls back
+     * to the TOTG timing if the TOPP-RA problem is infeasible, or if the resampled waypoints
+     * are in collision or violate the path constraints: TOPP-RA follows a spline through the
+     * planned waypoints, which may leave the checked straight segments between them.
+     *
+     * Parameters, under <pipeline>.topp_ra:
+     *   base_link, tip_link    KDL chain used for inverse dynamics
+     *   num_gridpoints         path discretization
+     *   max_velocity           [rad/s] per joint, in group order (tightened by the joint limits)
+     *   max_acceleration       [rad/s^2] per joint (tightened by the joint limits)
+     *   max_torque             [Nm] per joint
+     *   report_file            CSV file the per-plan comparison is appended to, empty to disable
+     *
+     */
+    class AddToppraTimeParameterization : public planning_interface::PlanningResponseAdapter
+    {
+        public:
+            void initialize(const rclcpp::Node::SharedPtr& node, const std::string& parameter_namespace) override
+            {
+                const std::string ns = parameter_namespace + ".topp_ra.";
+
+                base_link_ = declare_(node, ns + "base_link", std::string("arm_Link"));
+                tip_link_ = declare_(node, ns + "tip_link", std::string("camera_Link"));
+                num_gridpoints_ = declare_(node, ns + "num_gridpoints", int64_t(200));
+                max_velocity_ = declare_(node, ns + "max_velocity", std::vector<double>{});
+                max_acceleration_ = declare_(node, ns + "max_acceleration", std::vector<double>{});
+                max_torque_ = declare_(node, ns + "max_torque", std::vector<double>{});
+                report_file_ = declare_(node, ns + "report_file", std::string(""));
+
+                num_gridpoints_ = std::max<int64_t>(num_gridpoints_, 2);
+            }
+
+            std::string getDescription() const override
+            {
+                return std::string("Add TOPP-RA time parameterization");
+            }
+
+            void adapt(
+                const planning_scene::PlanningSceneConstPtr& planning_scene,
+                const planning_interface::MotionPlanRequest& req,
+                planning_interface::MotionPlanResponse& res) const override
+            {
+                if (!res.trajectory || res.trajectory->getWayPointCount() < 2)
+                    return;
+
+                const moveit::core::JointModelGroup* group = res.trajectory->getGroup();
+                if (!group)
+                    return;
+
+                const double vel_scale = scaling_factor_(req.max_velocity_scaling_factor);
+                const double acc_scale = scaling_factor_(req.max_acceleration_scaling_factor);
+
+                std::vector<double> v_max, a_max;
+                const bool limits_ok = limits_(group, v_max, a_max);
+
+                //* Reference timing, what the pipeline used before, under the same limits
+                robot_trajectory::RobotTrajectory totg_traj(*res.trajectory, true);
+                trajectory_processing::TimeOptimalTrajectoryGeneration totg;
+                bool totg_ok;
+                if (limits_ok)
+                {
+                    std::unordered_map<std::string, double> vel_limits, acc_limits;
+                    const auto& names = group->getActiveJointModelNames();
+                    for (size_t j = 0; j < names.size(); j++)
+                    {
+                        vel_limits[names[j]] = v_max[j];
+                        acc_limits[names[j]] = a_max[j];
+                    }
+                    totg_ok = totg.computeTimeStamps(totg_traj, vel_limits, acc_limits, vel_scale, acc_scale);
+                }
+                else
+                    totg_ok = totg.computeTimeStamps(totg_traj, vel_scale, acc_scale);
+                const double totg_duration = totg_ok ? totg_traj.getDuration() : std::numeric_limits<double>::quiet_NaN();
+
+                auto toppra_traj = std::make_shared<robot_trajectory::RobotTrajectory>(*res.trajectory, true);
+                const char* toppra_failure = nullptr;
+                if (!limits_ok || !compute_time_stamps_(planning_scene->getRobotModel(), *toppra_traj, v_max, a_max, vel_scale, acc_scale))
+                    toppra_failure = "infeasible";
+                else if (!planning_scene->isPathValid(*toppra_traj, req.path_constraints, req.group_name))
+                    toppra_failure = "path invalid (collision or path constraints)";
+
+                if (toppra_failure)
+                {
+                    if (!totg_ok)
+                    {
+                        RCLCPP_ERROR(rclcpp::get_logger(LOGGER), "TOPP-RA %s and TOTG time parameterization failed", toppra_failure);
+                        res.error_code.val = moveit_msgs::msg::MoveItErrorCodes::FAILURE;
+                        return;
+                    }
+
+                    RCLCPP_WARN(rclcpp::get_logger(LOGGER), "TOPP-RA %s, falling back to TOTG (%.3f s)", toppra_failure, totg_duration);
+                    *res.trajectory = totg_traj;
+                    report_(req, totg_duration, std::numeric_limits<double>::quiet_NaN());
+                    return;
+                }
+
+                const double toppra_duration = toppra_traj->getDuration();
+                RCLCPP_INFO(rclcpp::get_logger(LOGGER), "TOPP-RA %.3f s, TOTG %.3f s, gain %.1f%%",
+                    toppra_duration, totg_duration, 100.0 * (totg_duration - toppra_duration) / totg_duration);
+
+                res.trajectory = toppra_traj;
+                report_(req, totg_duration, toppra_duration);
+            }
+
+
+        private:
+            std::string base_link_;
+            std::string tip_link_;
+            int64_t num_gridpoints_;
+            std::vector<double> max_velocity_;
+            std::vector<double> max_acceleration_;
+            std::vector<double> max_torque_;
+            std::string report_file_;
+
+            // Inverse dynamics chain, built on the first plan (the robot model is only known then)
+            mutable std::mutex chain_mtx_;
+            mutable KDL::Chain chain_;
+            mutable std::vector<int> chain_to_group_;
+            mutable bool chain_ready_ = false;
+
+
+            template <typename T>
+            static T declare_(const rclcpp::Node::SharedPtr& node, const std::string& name, const T& default_value)
+            {
+                if (!node->has_parameter(name))
+                    node->declare_parameter<T>(name, default_value);
+                return node->get_parameter(name).get_value<T>();
+            }
+
+            static double scaling_factor_(double factor)
+            {
+                return (factor > 0.0 && factor <= 1.0) ? factor : 1.0;
+            }
+
+            bool init_chain_(const moveit::core::RobotModelConstPtr& model, const moveit::core::JointModelGroup* group) const
+            {
+                if (chain_ready_)
+                    return true;
+
+                KDL::Tree tree;
+                if (!kdl_parser::treeFromUrdfModel(*model->getURDF(), tree) || !tree.getChain(base_link_, tip_link_, chain_))
+                {
+                    RCLCPP_ERROR(rclcpp::get_logger(LOGGER), "Could not build KDL chain %s -> %s", base_link_.c_str(), tip_link_.c_str());
+                    return false;
+                }
+
+                // KDL joint order -> group variable order
+                const auto& names = group->getActiveJointModelNames();
+                chain_to_group_.clear();
+                for (const auto& segment : chain_.segments)
+                {
+                    if (segment.getJoint().getType() == KDL::Joint::None)
+                        continue;
+
+                    auto it = std::find(names.begin(), names.end(), segment.getJoint().getName());
+                    if (it == names.end())
+                    {
+                        RCLCPP_ERROR(rclcpp::get_logger(LOGGER), "Chain joint %s is not in group %s",
+                            segment.getJoint().getName().c_str(), group->getName().c_str());
+                        return false;
+                    }
+                    chain_to_group_.push_back(it - names.begin());
+                }
+
+                if (chain_to_group_.size() != names.size())
+                {
+                    RCLCPP_ERROR(rclcpp::get_logger(LOGGER), "Chain %s -> %s does not cover group %s",
+                        base_link_.c_str(), tip_link_.c_str(), group->getName().c_str());
+                    return false;
+                }
+
+                chain_ready_ = true;
+                return true;
+            }
+
+            /**
+             * @brief Drive velocity and acceleration limits, tightened by the joint limits the
+             * rest of MoveIt uses (joint_limits.yaml), unscaled.
+             *
+             * @return false if the topp_ra limits do not have one entry per joint
+             */
+            bool limits_(const moveit::core::JointModelGroup* group, std::vector<double>& v_max, std::vector<double>& a_max) const
+            {
+                const auto& joints = group->getActiveJointModels();
+                const size_t dof = joints.size();
+                if (max_velocity_.size() != dof || max_acceleration_.size() != dof || max_torque_.size() != dof)
+                {
+                    RCLCPP_ERROR(rclcpp::get_logger(LOGGER), "topp_ra limits must have %zu entries", dof);
+                    return false;
+                }
+
+                v_max.resize(dof);
+                a_max.resize(dof);
+                for (size_t j = 0; j < dof; j++)
+                {
+                    const auto& bounds = joints[j]->getVariableBounds()[0];
+
+                    v_max[j] = max_velocity_[j];
+                    if (bounds.velocity_bounded_)
+                        v_max[j] = std::min(v_max[j], bounds.max_velocity_);
+
+                    a_max[j] = max_acceleration_[j];
+                    if (bounds.acceleration_bounded_)
+                        a_max[j] = std::min(a_max[j], bounds.max_acceleration_);
+                }
+                return true;
+            }
+
+            bool compute_time_stamps_(
+                const moveit::core::RobotModelConstPtr& model,
+                robot_trajectory::RobotTrajectory& traj,
+                std::vector<double> v_max,
+                std::vector<double> a_max,
+                double vel_scale,
+                double acc_scale) const
+            {
+                const moveit::core::JointModelGroup* group = traj.getGroup();
+                const size_t dof = v_max.size();
+
+                std::lock_guard<std::mutex> lock(chain_mtx_);
+                if (!init_chain_(model, group))
+                    return false;
+
+                for (size_t j = 0; j < dof; j++)
+                {
+                    v_max[j] *= vel_scale;
+                    a_max[j] *= acc_scale;
+                }
+
+                //* Geometric path
+                std::vector<std::vector<double>> waypoints(traj.getWayPointCount());
+                for (size_t i = 0; i < waypoints.size(); i++)
+                    traj.getWayPoint(i).copyJointGroupPositions(group, waypoints[i]);
+
+                CubicSplinePath path;
+                if (!path.fit(waypoints))
+                    return false;
+
+                //* Constraints at the gridpoints
+                const size_t n = num_gridpoints_;
+                std::vector<double> s(n), x_bound(n);
+                std::vector<std::vector<PathConstraint>> constraints(n);
+                std::vector<std::vector<double>> q(n), qs(n), qss(n);
+
+                KDL::ChainIdSolver_RNE id_solver(chain_, KDL::Vector(0.0, 0.0, -9.80665));
+                KDL::JntArray kq(dof), kqd(dof), kqdd(dof), tau_c(dof), tau_a(dof), tau_b(dof);
+                KDL::Wrenches wrenches(chain_.getNrOfSegments(), KDL::Wrench::Zero());
+
+                for (size_t i = 0; i < n; i++)
+                {
+                    s[i] = path.length() * i / (n - 1);
+                    path.eval(s[i], q[i], qs[i], qss[i]);
+
+                    // Velocity: |q'| sdot <= v_max
+                    x_bound[i] = std::numeric_limits<double>::max();
+                    for (size_t j = 0; j < dof; j++)
+                    {
+                        if (std::abs(qs[i][j]) > 1e-9)
+                            x_bound[i] = std::min(x_bound[i], v_max[j] * v_max[j] / (qs[i][j] * qs[i][j]));
+                    }
+
+                    // Acceleration: qdd = q' u + q'' x
+                    for (size_t j = 0; j < dof; j++)
+                        constraints[i].push_back({qs[i][j], qss[i][j], 0.0, -a_max[j], a_max[j]});
+
+                    // Torque: tau = ID(q, q' sdot, q' u + q'' x) = a u + b x + c, with
+                    // c = ID(q, 0, 0), a = ID(q, 0, q') - c and b = ID(q, q', q'') - c
+                    for (size_t k = 0; k < dof; k++)
+                    {
+                        kq(k) = q[i][chain_to_group_[k]];
+                        kqd(k) = 0.0;
+                        kqdd(k) = 0.0;
+                    }
+                    if (id_solver.CartToJnt(kq, kqd, kqdd, wrenches, tau_c) < 0)
+                        return false;
+
+                    for (size_t k = 0; k < dof; k++)
+                        kqdd(k) = qs[i][chain_to_group_[k]];
+                    if (id_solver.CartToJnt(kq, kqd, kqdd, wrenches, tau_a) < 0)
+                        return false;
+
+                    for (size_t k = 0; k < dof; k++)
+                    {
+                        kqd(k) = qs[i][chain_to_group_[k]];
+                        kqdd(k) = qss[i][chain_to_group_[k]];
+                    }
+                    if (id_solver.CartToJnt(kq, kqd, kqdd, wrenches, tau_b) < 0)
+                        return false;
+
+                    for (size_t k = 0; k < dof; k++)
+                    {
+                        const double limit = max_torque_[chain_to_group_[k]];
+                        constraints[i].push_back({tau_a(k) - tau_c(k), tau_b(k) - tau_c(k), tau_c(k), -limit, limit});
+                    }
+                }
+
+                std::vector<double> x, t;
+                Toppra toppra;
+                if (!toppra.solve(s, x_bound, constraints, x))
+                    return false;
+                Toppra::timestamps(s, x, t);
+
+                //* Retime: one waypoint per gridpoint
+                moveit::core::RobotState state(traj.getFirstWayPoint());
+                traj.clear();
+
+                std::vector<double> vel(dof), acc(dof);
+                for (size_t i = 0; i < n; i++)
+                {
+                    const double sdot = std::sqrt(x[i]);
+                    const double sddot = (i + 1 < n) ? (x[i + 1] - x[i]) / (2.0 * (s[i + 1] - s[i])) : 0.0;
+                    for (size_t j = 0; j < dof; j++)
+                    {
+                        vel[j] = qs[i][j] * sdot;
+                        acc[j] = qs[i][j] * sddot + qss[i][j] * x[i];
+                    }
+
+                    state.setJointGroupPositions(group, q[i]);
+                    state.setJointGroupVelocities(group, vel);
+                    state.setJointGroupAccelerations(group, acc);
+                    state.update();
+                    traj.addSuffixWayPoint(state, (i == 0) ? 0.0 : t[i] - t[i - 1]);
+                }
+
+                return true;
+            }
+
+            void report_(const planning_interface::MotionPlanRequest& req, double totg_duration, double toppra_duration) const
+            {
+                if (report_file_.empty())
+                    return;
+
+                std::ofstream file(report_file_, std::ios::app);
+                if (!file)
+                    return;
+
+                if (file.tellp() == 0)
+                    file << "group,velocity_scaling,acceleration_scaling,totg_s,toppra_s,gain_percent\n";
+
+                file << req.group_name << ","
+                    << req.max_velocity_scaling_factor << ","
+                    << req.max_acceleration_scaling_factor << ","
+                    << totg_duration << ","
+                    << toppra_duration << ","
+                    << 100.0 * (totg_duration - toppra_duration) / totg_duration << "\n";
+            }
+    };
+
+}   // namespace arm_planning_adapters
+
+PLUGINLIB_EXPORT_CLASS(arm_planning_adapters::AddToppraTimeParameterization, planning_interface::PlanningResponseAdapter)
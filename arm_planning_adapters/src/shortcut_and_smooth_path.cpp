@@ -0,0 +1,384 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <rclcpp/rclcpp.hpp>
+#include <pluginlib/class_list_macros.hpp>
+
+#include <moveit/planning_interface/planning_response_adapter.h>
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include <moveit/trajectory_processing/time_optimal_trajectory_generation.h>
+
+#define LOGGER "ShortcutAndSmoothPath"
+
+namespace arm_planning_adapters
+{
+
+    /**
+     * @brief Shortens and smooths the planned path before it is timed.
+     *
+     * STOMP paths wander around the straight line between start and goal. Every thread
+     * shortcuts its own copy of the path, replacing random stretches with straight lines
+     * that are collision-free, until the time budget is used up. The shortest result is kept.
+     * Its waypoints then become the control polygon of a clamped cubic B-spline, which is
+     * collision checked and sampled. Where the spline collides, the polygon is refined so the
+     * spline hugs it closer; the shortcut polyline is kept if that does not help.
+     *
+     * The path length and the TOTG duration before and after are logged, and optionally
+     * appended to a CSV report. Timing is left to the next adapter.
+     *
+     * Parameters, under <pipeline>.shortcut:
+     *   time_budget            [s] shortcutting time
+     *   threads                shortcutting threads, 0 for all cores
+     *   collision_resolution   [rad] max joint step between collision checked states
+     *   num_samples            waypoints sampled from the B-spline
+     *   report_file            CSV file the per-plan comparison is appended to, empty to disable
+     *
+     */
+    class ShortcutAndSmoothPath : public planning_interface::PlanningResponseAdapter
+    {
+        public:
+            void initialize(const rclcpp::Node::SharedPtr& node, const std::string& parameter_namespace) override
+            {
+                const std::string ns = parameter_namespace + ".shortcut.";
+
+                time_budget_ = declare_(node, ns + "time_budget", 0.1);
+                threads_ = declare_(node, ns + "threads", int64_t(0));
+                collision_resolution_ = declare_(node, ns + "collision_resolution", 0.01);
+                num_samples_ = declare_(node, ns + "num_samples", int64_t(100));
+                report_file_ = declare_(node, ns + "report_file", std::string(""));
+
+                if (threads_ <= 0)
+                    threads_ = std::max(1u, std::thread::hardware_concurrency());
+                collision_resolution_ = std::max(collision_resolution_, 1e-4);
+                num_samples_ = std::max<int64_t>(num_samples_, 2);
+            }
+
+            std::string getDescription() const override
+            {
+                return std::string("Shortcut and smooth path");
+            }
+
+            void adapt(
+                const planning_scene::PlanningSceneConstPtr& planning_scene,
+                const planning_interface::MotionPlanRequest& req,
+                planning_interface::MotionPlanResponse& res) const override
+            {
+                if (!res.trajectory || res.trajectory->getWayPointCount() < 3)
+                    return;
+
+                const moveit::core::JointModelGroup* group = res.trajectory->getGroup();
+                if (!group)
+                    return;
+
+                const auto start_time = std::chrono::steady_clock::now();
+
+                Path path(res.trajectory->getWayPointCount());
+                for (size_t i = 0; i < path.size(); i++)
+                    res.trajectory->getWayPoint(i).copyJointGroupPositions(group, path[i]);
+
+                const double length_before = length_(path);
+
+                //* Shortcutting, one copy of the path per thread
+                const auto deadline = start_time + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    std::chrono::duration<double>(time_budget_));
+
+                std::vector<Path> results(threads_, path);
+                if (threads_ == 1)
+                {
+                    // Caller's thread, e.g. the roadmap workers that already plan in parallel
+                    shortcut_(*planning_scene, req, group, results[0], deadline, std::random_device{}());
+                }
+                else
+                {
+                    std::vector<std::thread> workers;
+                    for (int64_t k = 0; k < threads_; k++)
+                    {
+                        workers.emplace_back([&, k]() {
+                            shortcut_(*planning_scene, req, group, results[k], deadline, std::random_device{}() + k);
+                        });
+                    }
+                    for (auto& worker : workers)
+                        worker.join();
+                }
+
+                Path shortest = *std::min_element(results.begin(), results.end(),
+                    [](const Path& a, const Path& b) { return length_(a) < length_(b); });
+
+                //* Smoothing
+                Path smoothed;
+                if (!smooth_(*planning_scene, req, group, shortest, smoothed))
+                {
+                    RCLCPP_WARN(rclcpp::get_logger(LOGGER), "B-spline collides, keeping the shortcut path");
+                    smoothed = densify_(shortest);
+                }
+
+                const double length_after = length_(smoothed);
+                const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+                auto adapted = std::make_shared<robot_trajectory::RobotTrajectory>(res.trajectory->getRobotModel(), group);
+                moveit::core::RobotState state(res.trajectory->getFirstWayPoint());
+                for (const auto& q : smoothed)
+                {
+                    state.setJointGroupPositions(group, q);
+                    state.update();
+                    adapted->addSuffixWayPoint(state, 0.0);
+                }
+
+                //* Execution time comparison, with the timing the pipeline falls back to
+                const double duration_before = totg_duration_(*res.trajectory, req);
+                const double duration_after = totg_duration_(*adapted, req);
+
+                RCLCPP_INFO(rclcpp::get_logger(LOGGER), "Path %.3f -> %.3f rad (-%.1f%%), TOTG %.3f -> %.3f s (-%.1f%%), %lu -> %lu waypoints in %.0f ms",
+                    length_before, length_after, 100.0 * (length_before - length_after) / length_before,
+                    duration_before, duration_after, 100.0 * (duration_before - duration_after) / duration_before,
+                    path.size(), shortest.size(), elapsed * 1e3);
+
+                res.trajectory = adapted;
+                report_(req, length_before, length_after, duration_before, duration_after, elapsed);
+            }
+
+
+        private:
+            using Path = std::vector<std::vector<double>>;
+
+            double time_budget_;
+            int64_t threads_;
+            double collision_resolution_;
+            int64_t num_samples_;
+            std::string report_file_;
+
+
+            template <typename T>
+            static T declare_(const rclcpp::Node::SharedPtr& node, const std::string& name, const T& default_value)
+            {
+                if (!node->has_parameter(name))
+                    node->declare_parameter<T>(name, default_value);
+                return node->get_parameter(name).get_value<T>();
+            }
+
+            static double distance_(const std::vector<double>& a, const std::vector<double>& b)
+            {
+                double sum = 0.0;
+                for (size_t j = 0; j < a.size(); j++)
+                    sum += (a[j] - b[j]) * (a[j] - b[j]);
+                return std::sqrt(sum);
+            }
+
+            static double length_(const Path& path)
+            {
+                double length = 0.0;
+                for (size_t i = 1; i < path.size(); i++)
+                    length += distance_(path[i - 1], path[i]);
+                return length;
+            }
+
+            /**
+             * @brief Checks the straight line a -> b at collision_resolution, a excluded.
+             *
+             */
+            bool segment_valid_(
+                const planning_scene::PlanningScene& scene,
+                const planning_interface::MotionPlanRequest& req,
+                const moveit::core::JointModelGroup* group,
+                moveit::core::RobotState& state,
+                const std::vector<double>& a,
+                const std::vector<double>& b) const
+            {
+                double max_step = 0.0;
+                for (size_t j = 0; j < a.size(); j++)
+                    max_step = std::max(max_step, std::abs(b[j] - a[j]));
+
+                const size_t steps = std::max<size_t>(1, std::ceil(max_step / collision_resolution_));
+                std::vector<double> q(a.size());
+                for (size_t s = 1; s <= steps; s++)
+                {
+                    const double w = (double) s / steps;
+                    for (size_t j = 0; j < a.size(); j++)
+                        q[j] = a[j] + w * (b[j] - a[j]);
+
+                    state.setJointGroupPositions(group, q);
+                    state.update();
+                    if (!scene.isStateValid(state, req.path_constraints, group->getName()))
+                        return false;
+                }
+                return true;
+            }
+
+            /**
+             * @brief Randomized shortcutting until the deadline or a straight line is left.
+             *
+             */
+            void shortcut_(
+                const planning_scene::PlanningScene& scene,
+                const planning_interface::MotionPlanRequest& req,
+                const moveit::core::JointModelGroup* group,
+                Path& path,
+                std::chrono::steady_clock::time_point deadline,
+                unsigned int seed) const
+            {
+                std::mt19937 rng(seed);
+                moveit::core::RobotState state(scene.getCurrentState());
+
+                while (path.size() > 2 && std::chrono::steady_clock::now() < deadline)
+                {
+                    std::uniform_int_distribution<size_t> pick(0, path.size() - 1);
+                    size_t i = pick(rng);
+                    size_t j = pick(rng);
+                    if (i > j)
+                        std::swap(i, j);
+                    if (j - i < 2)
+                        continue;
+
+                    if (segment_valid_(scene, req, group, state, path[i], path[j]))
+                        path.erase(path.begin() + i + 1, path.begin() + j);
+                }
+            }
+
+            /**
+             * @brief Samples the clamped uniform cubic B-spline of the control polygon, the
+             * spline starts and ends on the polygon's end points.
+             *
+             */
+            Path bspline_(const Path& control) const
+            {
+                // Repeated end points clamp the spline
+                Path p;
+                p.push_back(control.front());
+                p.push_back(control.front());
+                p.insert(p.end(), control.begin(), control.end());
+                p.push_back(control.back());
+                p.push_back(control.back());
+
+                const size_t segments = p.size() - 3;
+                const size_t dof = control.front().size();
+
+                Path samples(num_samples_, std::vector<double>(dof));
+                for (int64_t k = 0; k < num_samples_; k++)
+                {
+                    const double u = (double) k / (num_samples_ - 1) * segments;
+                    const size_t seg = std::min((size_t) u, segments - 1);
+                    const double t = u - seg;
+
+                    const double b0 = (1 - t) * (1 - t) * (1 - t) / 6.0;
+                    const double b1 = (3 * t * t * t - 6 * t * t + 4) / 6.0;
+                    const double b2 = (-3 * t * t * t + 3 * t * t + 3 * t + 1) / 6.0;
+                    const double b3 = t * t * t / 6.0;
+
+                    for (size_t j = 0; j < dof; j++)
+                        samples[k][j] = b0 * p[seg][j] + b1 * p[seg + 1][j] + b2 * p[seg + 2][j] + b3 * p[seg + 3][j];
+                }
+                return samples;
+            }
+
+            /**
+             * @brief B-spline through the shortcut path, with the control polygon refined
+             * (midpoints added) until the spline is collision-free.
+             *
+             */
+            bool smooth_(
+                const planning_scene::PlanningScene& scene,
+                const planning_interface::MotionPlanRequest& req,
+                const moveit::core::JointModelGroup* group,
+                const Path& path,
+                Path& smoothed) const
+            {
+                moveit::core::RobotState state(scene.getCurrentState());
+
+                Path control = path;
+                for (int refinement = 0; refinement < 3; refinement++)
+                {
+                    smoothed = bspline_(control);
+
+                    bool valid = true;
+                    for (size_t i = 1; i < smoothed.size() && valid; i++)
+                        valid = segment_valid_(scene, req, group, state, smoothed[i - 1], smoothed[i]);
+                    if (valid)
+                        return true;
+
+                    Path refined;
+                    for (size_t i = 0; i + 1 < control.size(); i++)
+                    {
+                        refined.push_back(control[i]);
+                        std::vector<double> mid(control[i].size());
+                        for (size_t j = 0; j < mid.size(); j++)
+                            mid[j] = 0.5 * (control[i][j] + control[i + 1][j]);
+                        refined.push_back(mid);
+                    }
+                    refined.push_back(control.back());
+                    control = refined;
+                }
+                return false;
+            }
+
+            /**
+             * @brief Polyline with waypoints at most collision_resolution * 10 apart, so the
+             * spline fitted by the time parameterization stays close to the straight lines.
+             *
+             */
+            Path densify_(const Path& path) const
+            {
+                Path dense = { path.front() };
+                for (size_t i = 1; i < path.size(); i++)
+                {
+                    const size_t steps = std::max<size_t>(1, std::ceil(distance_(path[i - 1], path[i]) / (10.0 * collision_resolution_)));
+                    for (size_t s = 1; s <= steps; s++)
+                    {
+                        std::vector<double> q(path[i].size());
+                        for (size_t j = 0; j < q.size(); j++)
+                            q[j] = path[i - 1][j] + (double) s / steps * (path[i][j] - path[i - 1][j]);
+                        dense.push_back(q);
+                    }
+                }
+                return dense;
+            }
+
+            static double totg_duration_(const robot_trajectory::RobotTrajectory& trajectory, const planning_interface::MotionPlanRequest& req)
+            {
+                auto scaling = [](double factor) { return (factor > 0.0 && factor <= 1.0) ? factor : 1.0; };
+
+                robot_trajectory::RobotTrajectory timed(trajectory, true);
+                trajectory_processing::TimeOptimalTrajectoryGeneration totg;
+                if (!totg.computeTimeStamps(timed, scaling(req.max_velocity_scaling_factor), scaling(req.max_acceleration_scaling_factor)))
+                    return std::numeric_limits<double>::quiet_NaN();
+                return timed.getDuration();
+            }
+
+            void report_(
+                const planning_interface::MotionPlanRequest& req,
+                double length_before, double length_after,
+                double duration_before, double duration_after,
+                double elapsed) const
+            {
+                if (report_file_.empty())
+                    return;
+
+                std::ofstream file(report_file_, std::ios::app);
+                if (!file)
+                    return;
+
+                if (file.tellp() == 0)
+                    file << "group,length_before_rad,length_after_rad,length_reduction_percent,duration_before_s,duration_after_s,duration_reduction_percent,time_ms\n";
+
+                file << req.group_name << ","
+                    << length_before << ","
+                    << length_after << ","
+                    << 100.0 * (length_before - length_after) / length_before << ","
+                    << duration_before << ","
+                    << duration_after << ","
+                    << 100.0 * (duration_before - duration_after) / duration_before << ","
+                    << elapsed * 1e3 << "\n";
+            }
+    };
+
+}   // namespace arm_planning_adapters
+
+PLUGINLIB_EXPORT_CLASS(arm_planning_adapters::ShortcutAndSmoothPath, planning_interface::PlanningResponseAdapter)
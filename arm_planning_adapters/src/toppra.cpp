@@ -0,0 +1,244 @@
+#include "arm_planning_adapters/toppra.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace arm_planning_adapters
+{
+    //* Waypoints closer than this (joint space norm) are treated as duplicates
+    static constexpr double DUPLICATE_TOL = 1e-9;
+
+    //* LP feasibility tolerance
+    static constexpr double LP_TOL = 1e-9;
+
+
+    bool CubicSplinePath::fit(const std::vector<std::vector<double>>& waypoints)
+    {
+        s_.clear();
+        q_.clear();
+        m_.clear();
+
+        if (waypoints.empty())
+            return false;
+
+        dof_ = waypoints[0].size();
+        q_.assign(dof_, {});
+
+        // Cumulative chord length, dropping duplicates
+        double s = 0.0;
+        const std::vector<double>* prev = nullptr;
+        for (const auto& wp : waypoints)
+        {
+            if (prev)
+            {
+                double d = 0.0;
+                for (size_t j = 0; j < dof_; j++)
+                    d += (wp[j] - (*prev)[j]) * (wp[j] - (*prev)[j]);
+                d = std::sqrt(d);
+
+                if (d < DUPLICATE_TOL)
+                    continue;
+                s += d;
+            }
+
+            s_.push_back(s);
+            for (size_t j = 0; j < dof_; j++)
+                q_[j].push_back(wp[j]);
+            prev = &wp;
+        }
+
+        const size_t n = s_.size();
+        if (n < 2)
+            return false;
+
+        // Natural spline second derivatives, tridiagonal system solved per joint (Thomas)
+        m_.assign(dof_, std::vector<double>(n, 0.0));
+        if (n == 2)
+            return true;
+
+        std::vector<double> diag(n), rhs(n), upper(n);
+        for (size_t j = 0; j < dof_; j++)
+        {
+            const auto& y = q_[j];
+            for (size_t i = 1; i < n - 1; i++)
+            {
+                double h0 = s_[i] - s_[i - 1];
+                double h1 = s_[i + 1] - s_[i];
+
+                diag[i] = 2.0 * (h0 + h1);
+                upper[i] = h1;
+                rhs[i] = 6.0 * ((y[i + 1] - y[i]) / h1 - (y[i] - y[i - 1]) / h0);
+
+                if (i > 1)
+                {
+                    double w = h0 / diag[i - 1];
+                    diag[i] -= w * upper[i - 1];
+                    rhs[i] -= w * rhs[i - 1];
+                }
+            }
+
+            auto& m = m_[j];
+            for (size_t i = n - 2; i >= 1; i--)
+                m[i] = (rhs[i] - upper[i] * m[i + 1]) / diag[i];
+        }
+
+        return true;
+    }
+
+
+    void CubicSplinePath::eval(double s, std::vector<double>& q, std::vector<double>& qs, std::vector<double>& qss) const
+    {
+        q.resize(dof_);
+        qs.resize(dof_);
+        qss.resize(dof_);
+
+        s = std::clamp(s, 0.0, length());
+        size_t i = std::upper_bound(s_.begin(), s_.end(), s) - s_.begin();
+        i = std::clamp<size_t>(i, 1, s_.size() - 1) - 1;
+
+        double h = s_[i + 1] - s_[i];
+        double a = (s_[i + 1] - s) / h;
+        double b = (s - s_[i]) / h;
+
+        for (size_t j = 0; j < dof_; j++)
+        {
+            const double y0 = q_[j][i], y1 = q_[j][i + 1];
+            const double m0 = m_[j][i], m1 = m_[j][i + 1];
+
+            q[j] = a * y0 + b * y1 + ((a * a * a - a) * m0 + (b * b * b - b) * m1) * h * h / 6.0;
+            qs[j] = (y1 - y0) / h - (3.0 * a * a - 1.0) / 6.0 * h * m0 + (3.0 * b * b - 1.0) / 6.0 * h * m1;
+            qss[j] = a * m0 + b * m1;
+        }
+    }
+
+
+    bool Toppra::solve(
+        const std::vector<double>& s,
+        const std::vector<double>& x_bound,
+        const std::vector<std::vector<PathConstraint>>& constraints,
+        std::vector<double>& x) const
+    {
+        const size_t n = s.size();
+        if (n < 2 || x_bound.size() != n || constraints.size() != n)
+            return false;
+
+        //* Backward pass: controllable sets, the path ends at rest
+        std::vector<double> k_lo(n, 0.0), k_hi(n, 0.0);
+        std::vector<HalfPlane> planes;
+
+        for (size_t i = n - 1; i-- > 0;)
+        {
+            const double delta = s[i + 1] - s[i];
+
+            planes.clear();
+            planes.push_back({-1.0, 0.0, 0.0});
+            planes.push_back({1.0, 0.0, x_bound[i]});
+            for (const auto& c : constraints[i])
+            {
+                planes.push_back({c.b, c.a, c.hi - c.c});
+                planes.push_back({-c.b, -c.a, c.c - c.lo});
+            }
+            // x_{i+1} = x_i + 2 * delta * u_i must be controllable
+            planes.push_back({1.0, 2.0 * delta, k_hi[i + 1]});
+            planes.push_back({-1.0, -2.0 * delta, -k_lo[i + 1]});
+
+            if (!lp_x_range_(planes, k_lo[i], k_hi[i]))
+                return false;
+        }
+
+        if (k_lo[0] > LP_TOL)
+            return false;
+
+        //* Forward pass: greedy maximum path acceleration
+        x.assign(n, 0.0);
+        for (size_t i = 0; i + 1 < n; i++)
+        {
+            const double delta = s[i + 1] - s[i];
+
+            double u_lo = (k_lo[i + 1] - x[i]) / (2.0 * delta);
+            double u_hi = (k_hi[i + 1] - x[i]) / (2.0 * delta);
+            for (const auto& c : constraints[i])
+            {
+                if (std::abs(c.a) < 1e-12)
+                    continue;
+
+                double lo = (c.lo - c.c - c.b * x[i]) / c.a;
+                double hi = (c.hi - c.c - c.b * x[i]) / c.a;
+                if (c.a < 0.0)
+                    std::swap(lo, hi);
+
+                u_lo = std::max(u_lo, lo);
+                u_hi = std::min(u_hi, hi);
+            }
+
+            // x[i] is inside the controllable set, so the range is only empty by round off
+            double u = (u_hi >= u_lo) ? u_hi : u_lo;
+            x[i + 1] = std::clamp(x[i] + 2.0 * delta * u, k_lo[i + 1], k_hi[i + 1]);
+            x[i + 1] = std::max(x[i + 1], 0.0);
+        }
+
+        return true;
+    }
+
+
+    void Toppra::timestamps(const std::vector<double>& s, const std::vector<double>& x, std::vector<double>& t)
+    {
+        t.assign(s.size(), 0.0);
+        for (size_t i = 0; i + 1 < s.size(); i++)
+        {
+            // Constant path acceleration between gridpoints
+            double sdot_sum = std::sqrt(std::max(x[i], 0.0)) + std::sqrt(std::max(x[i + 1], 0.0));
+            t[i + 1] = t[i] + 2.0 * (s[i + 1] - s[i]) / std::max(sdot_sum, 1e-9);
+        }
+    }
+
+
+    bool Toppra::lp_x_range_(const std::vector<HalfPlane>& planes, double& x_min, double& x_max)
+    {
+        // The feasible polygon is bounded (0 <= x <= x_bound and the next controllable set
+        // bound u), so the extreme values of x are attained at vertices
+        x_min = std::numeric_limits<double>::infinity();
+        x_max = -std::numeric_limits<double>::infinity();
+
+        for (size_t i = 0; i < planes.size(); i++)
+        {
+            for (size_t j = i + 1; j < planes.size(); j++)
+            {
+                const auto& p = planes[i];
+                const auto& q = planes[j];
+
+                double det = p.p_x * q.p_u - p.p_u * q.p_x;
+                if (std::abs(det) < 1e-12)
+                    continue;
+
+                double vx = (p.r * q.p_u - p.p_u * q.r) / det;
+                double vu = (p.p_x * q.r - p.r * q.p_x) / det;
+
+                bool feasible = true;
+                for (const auto& h : planes)
+                {
+                    if (h.p_x * vx + h.p_u * vu > h.r + LP_TOL * (1.0 + std::abs(h.r)))
+                    {
+                        feasible = false;
+                        break;
+                    }
+                }
+
+                if (feasible)
+                {
+                    x_min = std::min(x_min, vx);
+                    x_max = std::max(x_max, vx);
+                }
+            }
+        }
+
+        if (x_min > x_max)
+            return false;
+
+        x_min = std::max(x_min, 0.0);
+        x_max = std::max(x_max, x_min);
+        return true;
+    }
+
+}   // namespace arm_planning_adapters
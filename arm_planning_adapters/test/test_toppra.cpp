@@ -0,0 +1,159 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <vector>
+
+#include "arm_planning_adapters/toppra.hpp"
+
+using arm_planning_adapters::CubicSplinePath;
+using arm_planning_adapters::PathConstraint;
+using arm_planning_adapters::Toppra;
+
+
+namespace
+{
+
+constexpr size_t GRIDPOINTS = 400;
+
+// Gridpoints, velocity bounds and acceleration constraints of a path, as the adapter builds them
+struct Problem
+{
+    std::vector<double> s;
+    std::vector<double> x_bound;
+    std::vector<std::vector<PathConstraint>> constraints;
+    std::vector<std::vector<double>> qs;
+    std::vector<std::vector<double>> qss;
+
+    Problem(const CubicSplinePath &path, const std::vector<double> &v_max, const std::vector<double> &a_max)
+        : s(GRIDPOINTS), x_bound(GRIDPOINTS), constraints(GRIDPOINTS), qs(GRIDPOINTS), qss(GRIDPOINTS)
+    {
+        std::vector<double> q;
+        for (size_t i = 0; i < GRIDPOINTS; i++)
+        {
+            s[i] = path.length() * i / (GRIDPOINTS - 1);
+            path.eval(s[i], q, qs[i], qss[i]);
+
+            x_bound[i] = 1e300;
+            for (size_t j = 0; j < path.dof(); j++)
+            {
+                if (std::abs(qs[i][j]) > 1e-9)
+                    x_bound[i] = std::min(x_bound[i], v_max[j] * v_max[j] / (qs[i][j] * qs[i][j]));
+                constraints[i].push_back({qs[i][j], qss[i][j], 0.0, -a_max[j], a_max[j]});
+            }
+        }
+    }
+};
+
+}  // namespace
+
+
+TEST(CubicSplinePath, InterpolatesTheWaypoints)
+{
+    const std::vector<std::vector<double>> waypoints = {{0.0, 0.0}, {1.0, 0.5}, {1.0, 0.5}, {2.0, -0.5}, {2.5, 0.0}};
+
+    CubicSplinePath path;
+    ASSERT_TRUE(path.fit(waypoints));
+    EXPECT_EQ(path.dof(), 2u);
+
+    // The duplicate is dropped, the knots sit at the chord lengths
+    std::vector<double> q, qs, qss;
+    double s = 0.0;
+    for (size_t i = 0; i < waypoints.size(); i++)
+    {
+        if (i > 0)
+            s += std::hypot(waypoints[i][0] - waypoints[i - 1][0], waypoints[i][1] - waypoints[i - 1][1]);
+        path.eval(s, q, qs, qss);
+        EXPECT_NEAR(q[0], waypoints[i][0], 1e-9);
+        EXPECT_NEAR(q[1], waypoints[i][1], 1e-9);
+    }
+    EXPECT_NEAR(path.length(), s, 1e-9);
+
+    EXPECT_FALSE(path.fit({{1.0, 2.0}, {1.0, 2.0}}));
+}
+
+
+TEST(Toppra, StraightLineIsTimeOptimal)
+{
+    // 2 rad at 1 rad/s and 1 rad/s^2: 1s up, 1s at speed, 1s down
+    CubicSplinePath path;
+    ASSERT_TRUE(path.fit({{0.0}, {2.0}}));
+    Problem problem(path, {1.0}, {1.0});
+
+    std::vector<double> x, t;
+    ASSERT_TRUE(Toppra().solve(problem.s, problem.x_bound, problem.constraints, x));
+    Toppra::timestamps(problem.s, x, t);
+
+    EXPECT_DOUBLE_EQ(x.front(), 0.0);
+    EXPECT_DOUBLE_EQ(x.back(), 0.0);
+    EXPECT_NEAR(t.back(), 3.0, 0.03);
+}
+
+
+TEST(Toppra, StaysWithinTheJointLimits)
+{
+    CubicSplinePath path;
+    ASSERT_TRUE(path.fit({{0.0, 0.0, 0.0}, {0.8, -0.4, 0.3}, {1.2, 0.6, -0.2}, {0.5, 1.4, 0.4}, {-0.3, 1.0, 1.1}}));
+
+    const std::vector<double> v_max = {1.5, 0.8, 2.0};
+    const std::vector<double> a_max = {3.0, 1.0, 4.0};
+    Problem problem(path, v_max, a_max);
+
+    std::vector<double> x;
+    ASSERT_TRUE(Toppra().solve(problem.s, problem.x_bound, problem.constraints, x));
+
+    // Velocity and acceleration at every gridpoint, with the path acceleration between
+    // gridpoints i and i + 1 the adapter writes
+    bool velocity_limited = false;
+    for (size_t i = 0; i < GRIDPOINTS; i++)
+    {
+        const double sdot = std::sqrt(x[i]);
+        const double sddot = (i + 1 < GRIDPOINTS) ? (x[i + 1] - x[i]) / (2.0 * (problem.s[i + 1] - problem.s[i])) : 0.0;
+        for (size_t j = 0; j < path.dof(); j++)
+        {
+            const double vel = problem.qs[i][j] * sdot;
+            const double acc = problem.qs[i][j] * sddot + problem.qss[i][j] * x[i];
+            ASSERT_LE(std::abs(vel), v_max[j] * (1.0 + 1e-6)) << "gridpoint " << i << " joint " << j;
+            ASSERT_LE(std::abs(acc), a_max[j] * (1.0 + 1e-6)) << "gridpoint " << i << " joint " << j;
+            velocity_limited |= std::abs(vel) > 0.99 * v_max[j];
+        }
+    }
+
+    // Time optimal, some joint reaches its velocity limit on a path this long
+    EXPECT_TRUE(velocity_limited);
+}
+
+
+TEST(Toppra, TorqueLimitSlowsTheMotion)
+{
+    CubicSplinePath path;
+    ASSERT_TRUE(path.fit({{0.0}, {2.0}}));
+    Problem problem(path, {1.0}, {1.0});
+
+    std::vector<double> x, t;
+    ASSERT_TRUE(Toppra().solve(problem.s, problem.x_bound, problem.constraints, x));
+    Toppra::timestamps(problem.s, x, t);
+    const double unloaded = t.back();
+
+    // A static load (c) of 0.5 out of a torque limit of 1 leaves 0.5 for accelerating upwards
+    for (auto &constraints : problem.constraints)
+        constraints.push_back({1.0, 0.0, 0.5, -1.0, 1.0});
+    ASSERT_TRUE(Toppra().solve(problem.s, problem.x_bound, problem.constraints, x));
+    Toppra::timestamps(problem.s, x, t);
+
+    EXPECT_GT(t.back(), unloaded + 0.4);
+}
+
+
+TEST(Toppra, ReportsInfeasiblePaths)
+{
+    CubicSplinePath path;
+    ASSERT_TRUE(path.fit({{0.0}, {1.0}}));
+    Problem problem(path, {1.0}, {1.0});
+
+    // A static load beyond the torque limit cannot be held anywhere on the path
+    for (auto &constraints : problem.constraints)
+        constraints.push_back({1.0, 0.0, 1.5, -1.0, 1.0});
+
+    std::vector<double> x;
+    EXPECT_FALSE(Toppra().solve(problem.s, problem.x_bound, problem.constraints, x));
+}
@@ -0,0 +1,120 @@
+#ifndef __POSE_SMOOTHER_HPP__
+#define __POSE_SMOOTHER_HPP__
+
+#include <algorithm>
+#include <cmath>
+
+#include <Eigen/Core>
+
+namespace arm_servo
+{
+
+/**
+ * @brief Turns sparse Cartesian position targets into a continuous setpoint stream.
+ * 
+ * Critically damped second-order filter (natural frequency omega) on the end effector
+ * position, with the filter's velocity, acceleration and jerk clamped to the configured
+ * limits. Limits are applied to vector norms so the setpoint moves along a straight
+ * line towards the target instead of axis by axis.
+ * 
+ * @note Allocation-free, call update() once per output cycle.
+ */
+class PoseSmoother
+{
+    public:
+        struct Limits
+        {
+            double omega = 8.0;         // rad/s, filter natural frequency
+            double max_velocity = 0.25; // m/s
+            double max_accel = 1.0;     // m/s^2
+            double max_jerk = 10.0;     // m/s^3
+        };
+
+        PoseSmoother() { reset(Eigen::Vector3d::Zero()); }
+
+        void setLimits(const Limits &limits) { limits_ = limits; }
+
+        const Limits &getLimits() const { return limits_; }
+
+        /**
+         * @brief Restarts the filter at rest at position
+         */
+        void reset(const Eigen::Vector3d &position)
+        {
+            position_ = position;
+            target_ = position;
+            velocity_.setZero();
+            accel_.setZero();
+        }
+
+        void setTarget(const Eigen::Vector3d &target) { target_ = target; }
+
+        const Eigen::Vector3d &getTarget() const { return target_; }
+
+        const Eigen::Vector3d &getPosition() const { return position_; }
+
+        /**
+         * @brief True once the setpoint reached the target and came to rest
+         */
+        bool settled(double tolerance = 1e-5) const
+        {
+            return (target_ - position_).norm() < tolerance &&
+                   velocity_.norm() < tolerance;
+        }
+
+        /**
+         * @brief Advances the setpoint by dt seconds
+         * 
+         * @return New smoothed position setpoint
+         */
+        const Eigen::Vector3d &update(double dt)
+        {
+            if (dt <= 0.0) return position_;
+
+            const double w = limits_.omega;
+            const Eigen::Vector3d error = target_ - position_;
+
+            // Critically damped acceleration demand
+            Eigen::Vector3d accel_des = (w * w) * error - (2.0 * w) * velocity_;
+            clampNorm(accel_des, limits_.max_accel);
+
+            // Jerk limit the change in acceleration
+            Eigen::Vector3d jerk = accel_des - accel_;
+            clampNorm(jerk, limits_.max_jerk * dt);
+            accel_ += jerk;
+
+            velocity_ += accel_ * dt;
+            clampNorm(velocity_, limits_.max_velocity);
+
+            position_ += velocity_ * dt;
+
+            // The limits add lag to the ideal response, never let it carry the setpoint past the target
+            if ((target_ - position_).dot(error) <= 0.0)
+            {
+                position_ = target_;
+                velocity_.setZero();
+                accel_.setZero();
+            }
+
+            return position_;
+        }
+
+
+    private:
+        static inline void clampNorm(Eigen::Vector3d &v, double max_norm)
+        {
+            const double n = v.norm();
+            if (n > max_norm && n > 0.0) v *= (max_norm / n);
+        }
+
+        Limits limits_;
+
+        Eigen::Vector3d position_;
+        Eigen::Vector3d target_;
+        Eigen::Vector3d velocity_;
+        Eigen::Vector3d accel_;
+};
+
+}
+
+#endif // __POSE_SMOOTHER_HPP__
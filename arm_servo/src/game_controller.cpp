@@ -7,6 +7,11 @@
 #include <geometry_msgs/msg/twist_stamped.hpp>
 #include <geometry_msgs/msg/pose_stamped.hpp>
 #include <moveit_msgs/srv/servo_command_type.hpp>
+#include <tf2_ros/buffer.h>
+#include <tf2_ros/transform_listener.h>
+#include <rclcpp_components/register_node_macro.hpp>
+
+#include "arm_servo/pose_smoother.hpp"
 
 const std::string JOINT_TOPIC = "/servo_node/delta_joint_cmds";
 const std::string TWIST_TOPIC = "/servo_node/delta_twist_cmds";
@@ -50,12 +55,21 @@ enum Button
 
 #define PRESSED 1
 
+namespace arm_servo
+{
+
 class GameController
 {
     public:
-        GameController();
+        explicit GameController(const rclcpp::NodeOptions &options = rclcpp::NodeOptions());
         rclcpp::Node::SharedPtr nh_;
 
+        // Component interface, nh_ is the node loaded into a container
+        rclcpp::node_interfaces::NodeBaseInterface::SharedPtr get_node_base_interface() const
+        {
+            return nh_->get_node_base_interface();
+        }
+
     private:
         rclcpp::Node::SharedPtr service_node_;
 
@@ -68,11 +82,26 @@ class GameController
 
         rclcpp::Client<moveit_msgs::srv::ServoCommandType>::SharedPtr servo_cmd_type_cli_;
         std::shared_ptr<moveit_msgs::srv::ServoCommandType::Request> servo_command_type_;
+        rclcpp::TimerBase::SharedPtr servo_init_timer_;
         double joint_vel_cmd_;       // rad/s
         double cartesian_step_size_; // meters
         double pose_step_size_;
         std::string command_frame_id_;
 
+        // Pose mode on-line smoothing
+        std::shared_ptr<tf2_ros::Buffer> tf_buffer_;
+        std::shared_ptr<tf2_ros::TransformListener> tf_listener_;
+        rclcpp::TimerBase::SharedPtr pose_stream_timer_;
+        arm_servo::PoseSmoother pose_smoother_;
+        geometry_msgs::msg::Quaternion pose_orientation_;
+        double pose_stream_period_;  // s
+        double pose_max_lead_;       // m, max distance the target may run ahead of the setpoint
+        bool pose_anchored_;
+
+        // Latency probe, stamps outgoing commands with the joy input stamp (see teleop_latency)
+        bool latency_probe_;
+        builtin_interfaces::msg::Time last_joy_stamp_;
+
         bool enabled_;
 
         // Flag to enable rising-edge triggering of buttons
@@ -92,13 +121,19 @@ class GameController
         int joint_num_;
 
         void joy_cb_(const sensor_msgs::msg::Joy::SharedPtr joy_msg);
+        bool anchor_pose_();
+        void pose_stream_cb_();
+        builtin_interfaces::msg::Time command_stamp_();
+        void servo_init_cb_();
 };
 
-GameController::GameController() : 
+GameController::GameController(const rclcpp::NodeOptions &options) : 
     joint_vel_cmd_(0.1), 
     cartesian_step_size_(0.1),
     pose_step_size_(0.01),
     command_frame_id_{"arm_Link"},
+    pose_anchored_(false),
+    latency_probe_(false),
     enabled_(false),
     enable_cmd_toggle_(true),
     servo_cmd_toggle_(true),
@@ -107,7 +142,7 @@ GameController::GameController() :
     joint_num_(0)
 {
     // Node bridging Joy with MoveIt2 Servo
-    nh_ = rclcpp::Node::make_shared("servo_game_controller");
+    nh_ = rclcpp::Node::make_shared("servo_game_controller", options);
     service_node_ = rclcpp::Node::make_shared("servo_game_controller_sn_");
 
     RCLCPP_INFO(nh_->get_logger(), "MoveIt2 Servo via Game Controller");
@@ -124,26 +159,80 @@ GameController::GameController() :
     joy_sub_ = nh_->create_subscription<sensor_msgs::msg::Joy>(JOY_TOPIC, ROS_QUEUE_SIZE, std::bind(&GameController::joy_cb_, this, std::placeholders::_1));
 
 
+    // Pose mode smoothing, stick input moves a target which is streamed as a jerk-limited setpoint
+    arm_servo::PoseSmoother::Limits limits;
+    limits.omega        = nh_->declare_parameter("pose_smoothing.omega", limits.omega);
+    limits.max_velocity = nh_->declare_parameter("pose_smoothing.max_velocity", limits.max_velocity);
+    limits.max_accel    = nh_->declare_parameter("pose_smoothing.max_acceleration", limits.max_accel);
+    limits.max_jerk     = nh_->declare_parameter("pose_smoothing.max_jerk", limits.max_jerk);
+    pose_max_lead_      = nh_->declare_parameter("pose_smoothing.max_lead", 0.05);
+    pose_stream_period_ = 1.0 / nh_->declare_parameter("pose_smoothing.rate", 100.0);
+    pose_smoother_.setLimits(limits);
+
+    tf_buffer_ = std::make_shared<tf2_ros::Buffer>(nh_->get_clock());
+    tf_listener_ = std::make_shared<tf2_ros::TransformListener>(*tf_buffer_);
+
+    pose_stream_timer_ = nh_->create_wall_timer(
+        std::chrono::duration<double>(pose_stream_period_),
+        std::bind(&GameController::pose_stream_cb_, this));
+
+
+    latency_probe_ = nh_->declare_parameter("latency_probe", false);
+    if (latency_probe_)
+        RCLCPP_WARN(nh_->get_logger(), "Latency probe enabled, servo commands carry the joy input stamp");
+
+
     // Client for switching input types, start in JointJog mode by default
     servo_command_type_ = std::make_shared<moveit_msgs::srv::ServoCommandType::Request>();
     servo_command_type_->command_type = moveit_msgs::srv::ServoCommandType::Request::JOINT_JOG;
-    servo_cmd_type_cli_ = service_node_->create_client<moveit_msgs::srv::ServoCommandType>("servo_node/switch_command_type");
-    while(!servo_cmd_type_cli_->wait_for_service(std::chrono::seconds(1)));
-    
-    auto future = servo_cmd_type_cli_->async_send_request(servo_command_type_);
-    
-    using namespace std::chrono_literals;
-    while(rclcpp::spin_until_future_complete(service_node_, future, 5s) != rclcpp::FutureReturnCode::SUCCESS){
-        RCLCPP_ERROR(service_node_->get_logger(), "Could not call /servo_node/switch_command_type...");
-    }
+    servo_cmd_type_cli_ = nh_->create_client<moveit_msgs::srv::ServoCommandType>("servo_node/switch_command_type");
+
+    // Don't block construction on servo, a component container loads nodes one at a time
+    servo_init_timer_ = nh_->create_wall_timer(
+        std::chrono::seconds(1),
+        std::bind(&GameController::servo_init_cb_, this));
 
-    RCLCPP_INFO(service_node_->get_logger(), "Servo mode starting in JointJog mode.");
     RCLCPP_WARN(nh_->get_logger(), "Input is currently disabled. Press the GUIDE button to enable.");
 }
 
 
+/**
+ * @brief Puts servo in JointJog mode once /servo_node/switch_command_type is available,
+ * retried every second until servo accepts.
+ * 
+ */
+void GameController::servo_init_cb_()
+{
+    if (!servo_cmd_type_cli_->service_is_ready())
+    {
+        RCLCPP_INFO_ONCE(nh_->get_logger(), "Waiting for /servo_node/switch_command_type...");
+        return;
+    }
+
+    servo_init_timer_->cancel();
+
+    auto request = std::make_shared<moveit_msgs::srv::ServoCommandType::Request>();
+    request->command_type = moveit_msgs::srv::ServoCommandType::Request::JOINT_JOG;
+
+    servo_cmd_type_cli_->async_send_request(request,
+        [this](rclcpp::Client<moveit_msgs::srv::ServoCommandType>::SharedFuture future) {
+            if (future.get()->success)
+            {
+                RCLCPP_INFO(nh_->get_logger(), "Servo mode starting in JointJog mode.");
+            }
+            else
+            {
+                RCLCPP_ERROR(nh_->get_logger(), "Could not call /servo_node/switch_command_type, retrying...");
+                servo_init_timer_->reset();
+            }
+        });
+}
+
+
 void GameController::joy_cb_(const sensor_msgs::msg::Joy::SharedPtr joy_msg)
 {
+    last_joy_stamp_ = joy_msg->header.stamp;
+
     // GUIDE button used to enable/disable game controller input manually
     if ((joy_msg->buttons[GUIDE] == PRESSED) && enable_cmd_toggle_)
     {
@@ -177,9 +266,6 @@ void GameController::joy_cb_(const sensor_msgs::msg::Joy::SharedPtr joy_msg)
     // MENU button used to toggle b/e Joint and Cartesian jogging modes
     if ((joy_msg->buttons[MENU] == PRESSED) && servo_cmd_toggle_)
     {
-        rclcpp::executors::SingleThreadedExecutor executor;
-        executor.add_node(service_node_);
-        std::thread t([&executor]() { executor.spin(); });
 
         if (servo_command_type_->command_type == moveit_msgs::srv::ServoCommandType::Request::JOINT_JOG)
         {
@@ -197,6 +283,9 @@ void GameController::joy_cb_(const sensor_msgs::msg::Joy::SharedPtr joy_msg)
 
             // rclcpp::spin_until_future_complete(service_node_, future);
 
+            // Start smoothing from the current end effector pose
+            pose_anchored_ = anchor_pose_();
+
             RCLCPP_INFO(service_node_->get_logger(), "Servo command type switch to Pose mode");
         }
         else if (servo_command_type_->command_type == moveit_msgs::srv::ServoCommandType::Request::POSE)
@@ -209,10 +298,6 @@ void GameController::joy_cb_(const sensor_msgs::msg::Joy::SharedPtr joy_msg)
             RCLCPP_INFO(service_node_->get_logger(), "Servo command type switch to JointJog");
         }
 
-        executor.cancel();
-        t.join();
-        // RCLCPP_INFO(service_node_->get_logger(), "Joined service node");
-
         servo_cmd_toggle_ = false;
         return;
     }
@@ -232,6 +317,11 @@ void GameController::joy_cb_(const sensor_msgs::msg::Joy::SharedPtr joy_msg)
             joint_vel_cmd_ += 0.1;
             RCLCPP_INFO(nh_->get_logger(), "JointJog speed increased: %frad/s", joint_vel_cmd_);
         }
+        else if (servo_command_type_->command_type == moveit_msgs::srv::ServoCommandType::Request::POSE)
+        {
+            pose_step_size_ += 0.005;
+            RCLCPP_INFO(nh_->get_logger(), "Pose step increased: %fcm", (pose_step_size_ * 100));
+        }
         else
         {
             cartesian_step_size_ += 0.01;
@@ -257,6 +347,19 @@ void GameController::joy_cb_(const sensor_msgs::msg::Joy::SharedPtr joy_msg)
                 RCLCPP_INFO(nh_->get_logger(), "JointJog speed decreased: %frad/s", joint_vel_cmd_);
             }
         }
+        else if (servo_command_type_->command_type == moveit_msgs::srv::ServoCommandType::Request::POSE)
+        {
+            pose_step_size_ -= 0.005;
+            if (pose_step_size_ <= 0)
+            {
+                pose_step_size_ = 0.005;
+                RCLCPP_WARN(nh_->get_logger(), "Pose step size minimum reached: %fcm", (pose_step_size_ * 100));
+            }
+            else
+            {
+                RCLCPP_INFO(nh_->get_logger(), "Pose step decreased: %fcm", (pose_step_size_ * 100));
+            }
+        }
         else
         {
             cartesian_step_size_ -= 0.01;
@@ -293,7 +396,7 @@ void GameController::joy_cb_(const sensor_msgs::msg::Joy::SharedPtr joy_msg)
     {
         control_msgs::msg::JointJog joint_msg_;
         joint_msg_.header.frame_id = "arm_Link";
-        joint_msg_.header.stamp = nh_->now();
+        joint_msg_.header.stamp = command_stamp_();
         joint_msg_.velocities.resize(6, 0.0);
         joint_msg_.joint_names.resize(6);
         joint_msg_.joint_names = { "j1", "j2", "j3", "j4", "j5", "j6"};
@@ -373,7 +476,7 @@ void GameController::joy_cb_(const sensor_msgs::msg::Joy::SharedPtr joy_msg)
     {
         auto twist_msg = std::make_unique<geometry_msgs::msg::TwistStamped>();
         twist_msg->header.frame_id = "j1_Link";
-        twist_msg->header.stamp = nh_->now();
+        twist_msg->header.stamp = command_stamp_();
 
         // RIGHT/LEFT TRIGGER(s) used to jog joint at variable speed
         if (joy_msg->axes[RIGHT_TRIGGER])
@@ -448,20 +551,22 @@ void GameController::joy_cb_(const sensor_msgs::msg::Joy::SharedPtr joy_msg)
     }
     else if (servo_command_type_->command_type == moveit_msgs::srv::ServoCommandType::Request::POSE)
     {
-        auto pose_msg = std::make_unique<geometry_msgs::msg::PoseStamped>();
-        pose_msg->header.frame_id = "j1_Link";
-        pose_msg->header.stamp = nh_->now();
-
-        // geometry_msgs::msg::PoseStamped pose_msg;
-        // pose_msg.header.frame_id = "j6_Link";
-        // pose_msg.header.stamp = nh_->now();
+        if (!pose_anchored_ && !(pose_anchored_ = anchor_pose_()))
+            return;
 
+        // LEFT STICK moves the pose target in the yz plane, pose_stream_cb_() smooths the motion
         if (joy_msg->axes[LEFT_STICK_X] || joy_msg->axes[LEFT_STICK_Y])
         {
-            pose_msg->pose.position.y = pose_step_size_ * joy_msg->axes[LEFT_STICK_X];
-            pose_msg->pose.position.z = -pose_step_size_ * joy_msg->axes[LEFT_STICK_Y];
-            pose_pub_->publish(std::move(pose_msg));
+            Eigen::Vector3d target = pose_smoother_.getTarget();
+            target.y() += pose_step_size_ * joy_msg->axes[LEFT_STICK_X];
+            target.z() -= pose_step_size_ * joy_msg->axes[LEFT_STICK_Y];
 
+            // Bound how far the target runs ahead so the arm stops shortly after the stick is released
+            Eigen::Vector3d lead = target - pose_smoother_.getPosition();
+            if (lead.norm() > pose_max_lead_)
+                target = pose_smoother_.getPosition() + lead * (pose_max_lead_ / lead.norm());
+
+            pose_smoother_.setTarget(target);
             return;
         }
     }
@@ -469,22 +574,83 @@ void GameController::joy_cb_(const sensor_msgs::msg::Joy::SharedPtr joy_msg)
 }
 
 
-
-int main(int argc, char **argv)
+/**
+ * @brief Looks up the current end effector pose and restarts the pose smoother from it.
+ * 
+ * @return true if the end effector pose was available
+ */
+bool GameController::anchor_pose_()
 {
-    rclcpp::init(argc, argv);
-    auto game_controller = GameController();
-
+    geometry_msgs::msg::TransformStamped ee_tf;
     try
     {
-        rclcpp::spin(game_controller.nh_);
+        ee_tf = tf_buffer_->lookupTransform(PLANNING_FRAME_ID, EE_FRAME_ID, tf2::TimePointZero);
     }
-    catch(const std::exception& e)
+    catch (const tf2::TransformException &ex)
     {
-        std::cerr << e.what() << '\n';
+        RCLCPP_WARN(nh_->get_logger(), "Could not get end effector pose for pose mode: %s", ex.what());
+        return false;
     }
-    
 
-    rclcpp::shutdown();
-    return 0;
-}
\ No newline at end of file
+    pose_smoother_.reset(Eigen::Vector3d(
+        ee_tf.transform.translation.x,
+        ee_tf.transform.translation.y,
+        ee_tf.transform.translation.z));
+    pose_orientation_ = ee_tf.transform.rotation;
+
+    RCLCPP_INFO(nh_->get_logger(), "Pose mode anchored at [%f, %f, %f]",
+        ee_tf.transform.translation.x, ee_tf.transform.translation.y, ee_tf.transform.translation.z);
+
+    return true;
+}
+
+
+/**
+ * @brief Streams the smoothed pose setpoint to servo at pose_smoothing.rate while in pose mode.
+ * 
+ */
+void GameController::pose_stream_cb_()
+{
+    if (!enabled_ || !pose_anchored_ ||
+        servo_command_type_->command_type != moveit_msgs::srv::ServoCommandType::Request::POSE ||
+        pose_smoother_.settled())
+    {
+        return;
+    }
+
+    const Eigen::Vector3d &position = pose_smoother_.update(pose_stream_period_);
+
+    auto pose_msg = std::make_unique<geometry_msgs::msg::PoseStamped>();
+    pose_msg->header.frame_id = PLANNING_FRAME_ID;
+    pose_msg->header.stamp = command_stamp_();
+    pose_msg->pose.position.x = position.x();
+    pose_msg->pose.position.y = position.y();
+    pose_msg->pose.position.z = position.z();
+    pose_msg->pose.orientation = pose_orientation_;
+
+    pose_pub_->publish(std::move(pose_msg));
+}
+
+
+
+/**
+ * @brief Stamp for outgoing servo commands.
+ * 
+ * @return stamp of the joy message that caused the command when latency_probe is set,
+ * current time otherwise
+ */
+builtin_interfaces::msg::Time GameController::command_stamp_()
+{
+    if (latency_probe_ && rclcpp::Time(last_joy_stamp_).nanoseconds() != 0)
+        return last_joy_stamp_;
+
+    return nh_->now();
+}
+
+
+
+}  // namespace arm_servo
+
+
+// Standalone executable generated by rclcpp_components_register_node (see CMakeLists.txt)
+RCLCPP_COMPONENTS_REGISTER_NODE(arm_servo::GameController)
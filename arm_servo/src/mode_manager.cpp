@@ -0,0 +1,426 @@
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <rclcpp/rclcpp.hpp>
+#include <std_msgs/msg/string.hpp>
+#include <std_srvs/srv/set_bool.hpp>
+#include <controller_manager_msgs/srv/list_controllers.hpp>
+#include <controller_manager_msgs/srv/switch_controller.hpp>
+#include <rclcpp_components/register_node_macro.hpp>
+
+#include "arm_msgs/srv/set_control_mode.hpp"
+
+const std::string MODE_SERVICE = "arm/SetControlMode";
+const std::string MODE_TOPIC = "arm/control_mode";
+const std::string PAUSE_SERVO_SERVICE = "servo_node/pause_servo";
+const std::string HW_MODE_SERVICE = "arm_hw_node/toggle_servo_mode";
+const std::string SWITCH_CONTROLLER_SERVICE = "/controller_manager/switch_controller";
+const std::string LIST_CONTROLLERS_SERVICE = "/controller_manager/list_controllers";
+
+namespace arm_servo
+{
+
+/**
+ * @brief Switches the arm between motion planning and servo (teleop) control.
+ *
+ * Owns persistent clients to everything a switch involves and runs a transition as a
+ * chain of asynchronous calls, no thread waits on a service:
+ *
+ *   plan -> servo  [activate forward controller], hardware to servo, resume servo_node
+ *   servo -> plan  pause servo_node, hardware to plan, [activate trajectory controller]
+ *
+ * The bracketed steps only run with direct_streaming, they switch STRICT: the controllers
+ * already in the wanted state are left out, any other activation or deactivation failing
+ * fails the step. The hardware seeds the new mode's
+ * command from the measured joint positions and servo_node restarts from the current
+ * state when resumed, so a switch does not move the arm. The arm/SetControlMode response
+ * is sent once the last step acknowledged and carries the switch latency; requests arriving
+ * during a switch are queued. The current mode is latched on arm/control_mode.
+ *
+ * A step fails if its service is not available, refuses or does not answer in time. The
+ * steps already run (and the failed one, it may have been applied before timing out) are
+ * then undone in reverse order, so a failed switch leaves servo_node, hardware and
+ * controllers in the old mode. Starting in servo mode, the servo transition runs once the
+ * services came up; this node is the only one resuming servo_node.
+ *
+ * Parameters:
+ *   control_mode      Mode at startup, "plan" or "servo"
+ *   direct_streaming  Servo output goes to the forward controller instead of the JTC
+ *   plan_controller   Controller executing motion plans
+ *   servo_controller  Controller streaming servo output (direct_streaming)
+ *   step_timeout      Time allowed per step [s]
+ *
+ */
+class ModeManager
+{
+    public:
+        explicit ModeManager(const rclcpp::NodeOptions &options = rclcpp::NodeOptions());
+
+        // Component interface
+        rclcpp::node_interfaces::NodeBaseInterface::SharedPtr get_node_base_interface() const { return nh_->get_node_base_interface(); }
+
+
+    private:
+        using SetControlMode = arm_msgs::srv::SetControlMode;
+        using SetBool = std_srvs::srv::SetBool;
+        using SwitchController = controller_manager_msgs::srv::SwitchController;
+        using ListControllers = controller_manager_msgs::srv::ListControllers;
+
+        // A call starts a service request and reports the result through the given callback
+        using StepDone = std::function<void(bool success, const std::string &msg)>;
+        using Call = std::function<void(StepDone)>;
+
+        struct Step
+        {
+            Call apply;
+            Call undo;
+        };
+
+        struct PendingRequest
+        {
+            std::shared_ptr<rmw_request_id_t> header;  // nullptr for the startup transition
+            std::string mode;
+            std::chrono::steady_clock::time_point received;
+        };
+
+        rclcpp::Node::SharedPtr nh_;
+
+        rclcpp::Service<SetControlMode>::SharedPtr mode_srv_;
+        rclcpp::Publisher<std_msgs::msg::String>::SharedPtr mode_pub_;
+        rclcpp::Client<SetBool>::SharedPtr pause_servo_cli_;
+        rclcpp::Client<SetBool>::SharedPtr hw_mode_cli_;
+        rclcpp::Client<SwitchController>::SharedPtr switch_controller_cli_;
+        rclcpp::Client<ListControllers>::SharedPtr list_controllers_cli_;
+        rclcpp::TimerBase::SharedPtr step_timer_;
+        rclcpp::TimerBase::SharedPtr startup_timer_;
+
+        std::string mode_;
+        bool direct_streaming_;
+        std::string plan_controller_;
+        std::string servo_controller_;
+        std::chrono::nanoseconds step_timeout_;
+
+        // Transition in progress, all callbacks run in the node's mutually exclusive default group
+        std::deque<PendingRequest> requests_;
+        std::vector<Step> steps_;
+        size_t step_ = 0;
+        uint64_t step_seq_ = 0;
+        bool busy_ = false;
+
+        // Undoing the steps of a failed transition, step_ counts down
+        bool rolling_back_ = false;
+        bool rollback_ok_ = true;
+        std::string failure_;
+
+        void mode_cb_(const std::shared_ptr<rmw_request_id_t> header, const std::shared_ptr<SetControlMode::Request> request);
+        void startup_cb_();
+
+        void next_transition_();
+        void run_step_();
+        void step_done_(uint64_t seq, bool success, const std::string &msg);
+        void finish_(bool success, const std::string &msg);
+
+        Step set_bool_step_(const rclcpp::Client<SetBool>::SharedPtr &client, bool data);
+        Step switch_controller_step_(const std::string &activate, const std::string &deactivate);
+        Call switch_controller_call_(const std::string &activate, const std::string &deactivate);
+};
+
+
+ModeManager::ModeManager(const rclcpp::NodeOptions &options)
+{
+    nh_ = rclcpp::Node::make_shared("arm_mode_manager", options);
+
+    mode_ = nh_->declare_parameter("control_mode", std::string("plan"));
+    direct_streaming_ = nh_->declare_parameter("direct_streaming", false);
+    plan_controller_ = nh_->declare_parameter("plan_controller", std::string("arm_group_controller"));
+    servo_controller_ = nh_->declare_parameter("servo_controller", std::string("arm_group_forward_controller"));
+    step_timeout_ = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::duration<double>(nh_->declare_parameter("step_timeout", 1.0)));
+
+    // Persistent clients, created once instead of per switch
+    pause_servo_cli_ = nh_->create_client<SetBool>(PAUSE_SERVO_SERVICE);
+    hw_mode_cli_ = nh_->create_client<SetBool>(HW_MODE_SERVICE);
+    switch_controller_cli_ = nh_->create_client<SwitchController>(SWITCH_CONTROLLER_SERVICE);
+    list_controllers_cli_ = nh_->create_client<ListControllers>(LIST_CONTROLLERS_SERVICE);
+
+    // Latched, late subscribers get the current mode
+    mode_pub_ = nh_->create_publisher<std_msgs::msg::String>(MODE_TOPIC, rclcpp::QoS(1).transient_local());
+
+    // Deferred response, sent once the transition completed
+    mode_srv_ = nh_->create_service<SetControlMode>(
+        MODE_SERVICE,
+        std::bind(&ModeManager::mode_cb_, this, std::placeholders::_1, std::placeholders::_2));
+
+    std_msgs::msg::String msg;
+    msg.data = mode_;
+    mode_pub_->publish(msg);
+
+    // servo_node and the hardware start paused/waiting, bring them into servo mode
+    if (mode_ == "servo")
+        startup_timer_ = nh_->create_wall_timer(std::chrono::milliseconds(100), std::bind(&ModeManager::startup_cb_, this));
+
+    RCLCPP_INFO(nh_->get_logger(), "Control mode manager ready, in %s mode%s", mode_.c_str(), direct_streaming_ ? " (direct streaming)" : "");
+}
+
+
+void ModeManager::mode_cb_(const std::shared_ptr<rmw_request_id_t> header, const std::shared_ptr<SetControlMode::Request> request)
+{
+    if (request->mode != "plan" && request->mode != "servo")
+    {
+        SetControlMode::Response response;
+        response.success = false;
+        response.msg = "Unknown control mode '" + request->mode + "' -- possible values ['plan', 'servo']";
+        mode_srv_->send_response(*header, response);
+        return;
+    }
+
+    requests_.push_back({ header, request->mode, std::chrono::steady_clock::now() });
+
+    if (!busy_)
+        next_transition_();
+}
+
+
+void ModeManager::startup_cb_()
+{
+    if (!pause_servo_cli_->service_is_ready() || !hw_mode_cli_->service_is_ready() ||
+        (direct_streaming_ && (!switch_controller_cli_->service_is_ready() || !list_controllers_cli_->service_is_ready())))
+        return;
+
+    startup_timer_->cancel();
+    requests_.push_back({ nullptr, "servo", std::chrono::steady_clock::now() });
+
+    if (!busy_)
+        next_transition_();
+}
+
+
+void ModeManager::next_transition_()
+{
+    if (requests_.empty())
+    {
+        busy_ = false;
+        return;
+    }
+
+    busy_ = true;
+    const std::string &target = requests_.front().mode;
+
+    steps_.clear();
+    step_ = 0;
+    rolling_back_ = false;
+    rollback_ok_ = true;
+
+    // Already there, still run the steps: a restarted servo_node or hardware may disagree
+    if (target == "servo")
+    {
+        if (direct_streaming_)
+            steps_.push_back(switch_controller_step_(servo_controller_, plan_controller_));
+        steps_.push_back(set_bool_step_(hw_mode_cli_, true));
+        steps_.push_back(set_bool_step_(pause_servo_cli_, false));
+    }
+    else
+    {
+        steps_.push_back(set_bool_step_(pause_servo_cli_, true));
+        steps_.push_back(set_bool_step_(hw_mode_cli_, false));
+        if (direct_streaming_)
+            steps_.push_back(switch_controller_step_(plan_controller_, servo_controller_));
+    }
+
+    run_step_();
+}
+
+
+void ModeManager::run_step_()
+{
+    Call call;
+    if (rolling_back_)
+    {
+        if (step_ == 0)
+        {
+            finish_(false, failure_ + (rollback_ok_ ? ", rolled back" : ", rollback incomplete"));
+            return;
+        }
+        call = steps_[--step_].undo;
+    }
+    else
+    {
+        if (step_ >= steps_.size())
+        {
+            finish_(true, "Switched to " + requests_.front().mode + " mode");
+            return;
+        }
+        call = steps_[step_].apply;
+    }
+
+    // Late answers of a timed out step carry an old sequence number and are ignored
+    const uint64_t seq = ++step_seq_;
+
+    step_timer_ = nh_->create_wall_timer(step_timeout_, [this, seq]() {
+        step_done_(seq, false, "timed out");
+    });
+
+    // call is a copy, a step may complete right away and the finished transition clears steps_
+    call([this, seq](bool success, const std::string &msg) {
+        step_done_(seq, success, msg);
+    });
+}
+
+
+void ModeManager::step_done_(uint64_t seq, bool success, const std::string &msg)
+{
+    if (seq != step_seq_ || !busy_)
+        return;
+
+    // Invalidates the other outcome of this step (answer or timeout)
+    ++step_seq_;
+    step_timer_->cancel();
+
+    if (rolling_back_)
+    {
+        // Keep undoing the others, the response reports an incomplete rollback
+        if (!success)
+        {
+            RCLCPP_ERROR(nh_->get_logger(), "Rollback step failed: %s", msg.c_str());
+            rollback_ok_ = false;
+        }
+    }
+    else
+    {
+        if (!success)
+        {
+            failure_ = "Switch to " + requests_.front().mode + " mode failed: " + msg;
+            rolling_back_ = true;
+        }
+
+        // Rolling back starts with the failed step
+        step_++;
+    }
+
+    run_step_();
+}
+
+
+void ModeManager::finish_(bool success, const std::string &msg)
+{
+    PendingRequest request = requests_.front();
+    requests_.pop_front();
+
+    const double latency_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - request.received).count();
+
+    if (success)
+    {
+        mode_ = request.mode;
+
+        std_msgs::msg::String mode_msg;
+        mode_msg.data = mode_;
+        mode_pub_->publish(mode_msg);
+
+        RCLCPP_INFO(nh_->get_logger(), "%s in %.1f ms", msg.c_str(), latency_ms);
+    }
+    else
+        RCLCPP_ERROR(nh_->get_logger(), "%s after %.1f ms, still in %s mode", msg.c_str(), latency_ms, mode_.c_str());
+
+    if (request.header)
+    {
+        SetControlMode::Response response;
+        response.success = success;
+        response.msg = msg;
+        response.latency_ms = latency_ms;
+        mode_srv_->send_response(*request.header, response);
+    }
+
+    next_transition_();
+}
+
+
+ModeManager::Step ModeManager::set_bool_step_(const rclcpp::Client<SetBool>::SharedPtr &client, bool data)
+{
+    auto call = [client](bool data) -> Call {
+        return [client, data](StepDone done) {
+            // A switch the servo_node or hardware did not take part in would leave them in the old mode
+            if (!client->service_is_ready())
+            {
+                done(false, std::string(client->get_service_name()) + " not available");
+                return;
+            }
+
+            auto req = std::make_shared<SetBool::Request>();
+            req->data = data;
+
+            client->async_send_request(req, [client, done](rclcpp::Client<SetBool>::SharedFuture future) {
+                const auto &res = future.get();
+                done(res->success, std::string(client->get_service_name()) + ": " + res->message);
+            });
+        };
+    };
+
+    return { call(data), call(!data) };
+}
+
+
+ModeManager::Step ModeManager::switch_controller_step_(const std::string &activate, const std::string &deactivate)
+{
+    return { switch_controller_call_(activate, deactivate), switch_controller_call_(deactivate, activate) };
+}
+
+
+ModeManager::Call ModeManager::switch_controller_call_(const std::string &activate, const std::string &deactivate)
+{
+    return [this, activate, deactivate](StepDone done) {
+        if (!switch_controller_cli_->service_is_ready() || !list_controllers_cli_->service_is_ready())
+        {
+            done(false, (switch_controller_cli_->service_is_ready() ? LIST_CONTROLLERS_SERVICE : SWITCH_CONTROLLER_SERVICE) + " not available");
+            return;
+        }
+
+        // STRICT fails on a controller already in the wanted state, e.g. the startup transition
+        // or a repeated request, only the changes still needed are requested
+        auto list_req = std::make_shared<ListControllers::Request>();
+        list_controllers_cli_->async_send_request(list_req, [this, activate, deactivate, done](rclcpp::Client<ListControllers>::SharedFuture future) {
+            auto req = std::make_shared<SwitchController::Request>();
+            bool found = false;
+            for (const auto &controller : future.get()->controller)
+            {
+                if (controller.name == activate)
+                {
+                    found = true;
+                    if (controller.state != "active")
+                        req->activate_controllers = { activate };
+                }
+                else if (controller.name == deactivate && controller.state == "active")
+                    req->deactivate_controllers = { deactivate };
+            }
+
+            if (!found)
+            {
+                done(false, activate + " not loaded");
+                return;
+            }
+            if (req->activate_controllers.empty() && req->deactivate_controllers.empty())
+            {
+                done(true, activate + " already active");
+                return;
+            }
+
+            // Both in the same controller manager cycle, the activated controller starts from
+            // the command interfaces the hardware seeded with the measured positions
+            req->strictness = SwitchController::Request::STRICT;
+            req->activate_asap = true;
+
+            switch_controller_cli_->async_send_request(req, [activate, done](rclcpp::Client<SwitchController>::SharedFuture future) {
+                done(future.get()->ok, "activating " + activate);
+            });
+        });
+    };
+}
+
+
+}  // namespace arm_servo
+
+
+// Standalone executable generated by rclcpp_components_register_node (see CMakeLists.txt)
+RCLCPP_COMPONENTS_REGISTER_NODE(arm_servo::ModeManager)
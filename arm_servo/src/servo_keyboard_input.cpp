@@ -33,14 +33,20 @@
  *********************************************************************/
 
 
+#include <atomic>
+#include <cerrno>
 #include <chrono>
+#include <mutex>
+#include <thread>
 #include <control_msgs/msg/joint_jog.hpp>
 #include <geometry_msgs/msg/twist_stamped.hpp>
 #include <moveit_msgs/srv/servo_command_type.hpp>
 #include <std_msgs/msg/bool.hpp>
 #include <std_srvs/srv/trigger.hpp>
 #include <std_srvs/srv/set_bool.hpp>
+#include <arm_msgs/srv/set_control_mode.hpp>
 #include <rclcpp/rclcpp.hpp>
+#include <poll.h>
 #include <signal.h>
 #include <stdio.h>
 #include <termios.h>
@@ -81,6 +87,16 @@ const std::string JOINT_TOPIC = "/servo_node/delta_joint_cmds";
 const size_t ROS_QUEUE_SIZE = 10;
 const std::string PLANNING_FRAME_ID = "arm_Link";
 const std::string EE_FRAME_ID = "j6_Link";
+
+// Rate at which held commands are streamed to servo
+const std::chrono::milliseconds PUBLISH_PERIOD(10);
+
+// A command stays active this long after its last key event, which bridges the
+// gaps between terminal auto-repeats while a key is held down
+const std::chrono::milliseconds KEY_HOLD_TIMEOUT(100);
+
+// Upper bound on how long the key loop sleeps in poll() before re-checking rclcpp::ok()
+const int POLL_TIMEOUT_MS = 250;
 }  // namespace
 
 // A class for reading the key inputs from the terminal
@@ -99,13 +115,51 @@ public:
     raw.c_cc[VEOF] = 2;
     tcsetattr(file_descriptor_, TCSANOW, &raw);
   }
-  void readOne(char* c)
+  enum class PollResult
   {
-    int rc = read(file_descriptor_, c, 1);
+    KEY,
+    TIMEOUT,
+    END_OF_INPUT
+  };
+
+  /**
+   * @brief Waits up to timeout_ms for a key press without busy-waiting.
+   *
+   * A closed terminal or pipe (hangup, error, zero byte read) is reported as END_OF_INPUT,
+   * poll() would return right away for it on every call.
+   *
+   * @return KEY if a key was read into c, TIMEOUT or END_OF_INPUT otherwise
+   */
+  PollResult pollOne(char* c, int timeout_ms)
+  {
+    struct pollfd pfd;
+    pfd.fd = file_descriptor_;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+
+    int rc = poll(&pfd, 1, timeout_ms);
+    if (rc < 0)
+    {
+      if (errno == EINTR)
+        return PollResult::TIMEOUT;
+      throw std::runtime_error("poll failed");
+    }
+    if (rc == 0)
+    {
+      return PollResult::TIMEOUT;
+    }
+    // Keys still buffered before a hangup are read first
+    if (!(pfd.revents & POLLIN))
+    {
+      return (pfd.revents & (POLLHUP | POLLERR | POLLNVAL)) ? PollResult::END_OF_INPUT : PollResult::TIMEOUT;
+    }
+
+    rc = read(file_descriptor_, c, 1);
     if (rc < 0)
     {
       throw std::runtime_error("read failed");
     }
+    return rc == 1 ? PollResult::KEY : PollResult::END_OF_INPUT;
   }
   void shutdown()
   {
@@ -122,20 +176,33 @@ class KeyboardServo
 {
 public:
   KeyboardServo();
+  ~KeyboardServo();
   int keyLoop();
 
 private:
-  void spin();
+  enum class HeldCommand
+  {
+    NONE,
+    TWIST,
+    JOINT
+  };
+
+  void publishHeldCommand();
+  void streamHeldCommand();
+  void holdCommand(HeldCommand type);
+  void switchCommandType(int8_t command_type, const std::string& name);
+  void setServoMode(bool servo_mode);
 
   rclcpp::Node::SharedPtr nh_;
-  rclcpp::Node::SharedPtr service_node_;
+  rclcpp::executors::SingleThreadedExecutor executor_;
+  std::thread executor_thread_;
+  rclcpp::TimerBase::SharedPtr publish_timer_;
 
   rclcpp::Publisher<std_msgs::msg::Bool>::SharedPtr reset_start_pos_pub_;
   rclcpp::Publisher<geometry_msgs::msg::TwistStamped>::SharedPtr twist_pub_;
   rclcpp::Publisher<control_msgs::msg::JointJog>::SharedPtr joint_pub_;
   rclcpp::Client<moveit_msgs::srv::ServoCommandType>::SharedPtr switch_input_;
-  rclcpp::Client<std_srvs::srv::SetBool>::SharedPtr pause_servo_cli_;
-  rclcpp::Client<std_srvs::srv::SetBool>::SharedPtr sw_hw_ctrl_mode_cli_;
+  rclcpp::Client<arm_msgs::srv::SetControlMode>::SharedPtr mode_cli_;
   rclcpp::Service<std_srvs::srv::Trigger>::SharedPtr pause_servo_input_srv_;
 
   void pause_servo_cb_(const std::shared_ptr<std_srvs::srv::Trigger::Request> request, std::shared_ptr<std_srvs::srv::Trigger::Response> response);
@@ -144,17 +211,26 @@ private:
   double joint_vel_cmd_;       // rad/s
   double cartesian_step_size_; // meters
   std::string command_frame_id_;
-  bool input_paused_;
+  std::atomic<bool> input_paused_;
+
+  // Command currently held by the keyboard, streamed at PUBLISH_PERIOD by publish_timer_
+  std::mutex held_mutex_;
+  HeldCommand held_type_;
+  geometry_msgs::msg::Twist held_twist_;
+  std::vector<double> held_joint_velocities_;
+  std::string held_frame_id_;
+  std::chrono::steady_clock::time_point last_key_time_;
 };
 
 KeyboardServo::KeyboardServo() : 
   joint_vel_cmd_(0.1), 
   cartesian_step_size_(0.1), 
   command_frame_id_{ "arm_Link" },
-  input_paused_(false)
+  input_paused_(false),
+  held_type_(HeldCommand::NONE),
+  held_joint_velocities_(6, 0.0)
 {
   nh_ = rclcpp::Node::make_shared("servo_keyboard_input");
-  service_node_ = rclcpp::Node::make_shared("servo_keyboard_input_sn_");
 
   request_ = std::make_shared<moveit_msgs::srv::ServoCommandType::Request>();
 
@@ -166,15 +242,28 @@ KeyboardServo::KeyboardServo() :
   // Client for switching input types
   switch_input_ = nh_->create_client<moveit_msgs::srv::ServoCommandType>("servo_node/switch_command_type");
 
-  // Client to un/pause servo node
-  pause_servo_cli_ = service_node_->create_client<std_srvs::srv::SetBool>("servo_node/pause_servo");
-
-  sw_hw_ctrl_mode_cli_ = service_node_->create_client<std_srvs::srv::SetBool>("arm_hw_node/toggle_servo_mode");
+  // Client of the plan/servo mode manager, pauses/resumes servo node and switches the hardware
+  mode_cli_ = nh_->create_client<arm_msgs::srv::SetControlMode>("arm/SetControlMode");
 
   // Service for pausing keyboard input and to pause servo node
   pause_servo_input_srv_ = nh_->create_service<std_srvs::srv::Trigger>(
     "pause_servo_input", 
     std::bind(&KeyboardServo::pause_servo_cb_, this, std::placeholders::_1, std::placeholders::_2));
+
+  // Fixed-rate command stream, only running while a key is held
+  publish_timer_ = nh_->create_wall_timer(PUBLISH_PERIOD, std::bind(&KeyboardServo::publishHeldCommand, this));
+  publish_timer_->cancel();
+
+  // Executor blocks in its wait set between events instead of polling with spin_some
+  executor_.add_node(nh_);
+  executor_thread_ = std::thread([this]() { executor_.spin(); });
+}
+
+KeyboardServo::~KeyboardServo()
+{
+  executor_.cancel();
+  if (executor_thread_.joinable())
+    executor_thread_.join();
 }
 
 void KeyboardServo::pause_servo_cb_(
@@ -188,33 +277,131 @@ void KeyboardServo::pause_servo_cb_(
   RCLCPP_INFO(nh_->get_logger(), "Keyboard input paused.");
   input_paused_ = true;
 
-  auto req = std::make_shared<std_srvs::srv::SetBool::Request>();
-  req->data = true;
+  {
+    std::lock_guard<std::mutex> lock(held_mutex_);
+    held_type_ = HeldCommand::NONE;
+  }
 
-  auto future = pause_servo_cli_->async_send_request(req);
+  setServoMode(false);
+}
 
-  if (rclcpp::spin_until_future_complete(service_node_, future) == rclcpp::FutureReturnCode::SUCCESS)
+/**
+ * @brief Requests servo or plan mode from the mode manager without blocking the caller.
+ *
+ * @param servo_mode true to resume servoing, false to pause it
+ */
+void KeyboardServo::setServoMode(bool servo_mode)
+{
+  if (!mode_cli_->service_is_ready())
   {
-    RCLCPP_INFO(nh_->get_logger(), "Called pause_servo service: %s", future.get()->message.c_str());
+    RCLCPP_WARN(nh_->get_logger(), "arm/SetControlMode not available, is arm_servo/mode_manager running?");
+    return;
   }
-  else
+
+  auto req = std::make_shared<arm_msgs::srv::SetControlMode::Request>();
+  req->mode = servo_mode ? "servo" : "plan";
+
+  mode_cli_->async_send_request(
+    req,
+    [this](rclcpp::Client<arm_msgs::srv::SetControlMode>::SharedFuture future) {
+      auto res = future.get();
+      if (res->success)
+        RCLCPP_INFO(nh_->get_logger(), "%s (%.1f ms)", res->msg.c_str(), res->latency_ms);
+      else
+        RCLCPP_WARN(nh_->get_logger(), "%s", res->msg.c_str());
+    });
+}
+
+/**
+ * @brief Asynchronously switches servo_node's input command type.
+ *
+ * @param command_type moveit_msgs::srv::ServoCommandType::Request command type
+ * @param name Human readable command type for logging
+ */
+void KeyboardServo::switchCommandType(int8_t command_type, const std::string& name)
+{
+  if (!switch_input_->service_is_ready())
   {
-    RCLCPP_ERROR(nh_->get_logger(), "Failed to call pause_servo service");
+    RCLCPP_WARN_STREAM(nh_->get_logger(), "servo_node/switch_command_type not available, could not switch input to: " << name);
+    return;
   }
 
-  
-  req->data = false;
-  future = sw_hw_ctrl_mode_cli_->async_send_request(req);
+  request_->command_type = command_type;
+  auto req = std::make_shared<moveit_msgs::srv::ServoCommandType::Request>(*request_);
 
-  if (rclcpp::spin_until_future_complete(service_node_, future) == rclcpp::FutureReturnCode::SUCCESS)
+  switch_input_->async_send_request(
+    req,
+    [this, name](rclcpp::Client<moveit_msgs::srv::ServoCommandType>::SharedFuture future) {
+      if (future.get()->success)
+      {
+        RCLCPP_INFO_STREAM(nh_->get_logger(), "Switched to input type: " << name);
+      }
+      else
+      {
+        RCLCPP_WARN_STREAM(nh_->get_logger(), "Could not switch input to: " << name);
+      }
+    });
+}
+
+/**
+ * @brief Marks the held command as refreshed by a key event and (re)starts the publish timer.
+ *
+ * @note Caller must hold held_mutex_.
+ */
+void KeyboardServo::holdCommand(HeldCommand type)
+{
+  held_type_ = type;
+  last_key_time_ = std::chrono::steady_clock::now();
+
+  if (publish_timer_->is_canceled())
   {
-    RCLCPP_INFO(nh_->get_logger(), "Called pause_servo service: %s", future.get()->message.c_str());
+    publish_timer_->reset();
+    // Publish the first message right away instead of waiting a full period
+    streamHeldCommand();
   }
-  else
+}
+
+/**
+ * @brief Publish timer callback.
+ */
+void KeyboardServo::publishHeldCommand()
+{
+  std::lock_guard<std::mutex> lock(held_mutex_);
+  streamHeldCommand();
+}
+
+/**
+ * @brief Publishes the held command, or stops the publish timer once KEY_HOLD_TIMEOUT expired.
+ *
+ * @note Caller must hold held_mutex_.
+ */
+void KeyboardServo::streamHeldCommand()
+{
+  if (held_type_ == HeldCommand::NONE ||
+      (std::chrono::steady_clock::now() - last_key_time_) > KEY_HOLD_TIMEOUT)
   {
-    RCLCPP_ERROR(nh_->get_logger(), "Failed to call pause_servo service");
+    held_type_ = HeldCommand::NONE;
+    publish_timer_->cancel();
+    return;
   }
 
+  if (held_type_ == HeldCommand::TWIST)
+  {
+    auto twist_msg = std::make_unique<geometry_msgs::msg::TwistStamped>();
+    twist_msg->header.stamp = nh_->now();
+    twist_msg->header.frame_id = held_frame_id_;
+    twist_msg->twist = held_twist_;
+    twist_pub_->publish(std::move(twist_msg));
+  }
+  else if (held_type_ == HeldCommand::JOINT)
+  {
+    auto joint_msg = std::make_unique<control_msgs::msg::JointJog>();
+    joint_msg->header.stamp = nh_->now();
+    joint_msg->header.frame_id = PLANNING_FRAME_ID;
+    joint_msg->joint_names = { "j1", "j2", "j3", "j4", "j5", "j6" };
+    joint_msg->velocities = held_joint_velocities_;
+    joint_pub_->publish(std::move(joint_msg));
+  }
 }
 
 KeyboardReader input;
@@ -241,22 +428,12 @@ int main(int argc, char** argv)
   return rc;
 }
 
-void KeyboardServo::spin()
-{
-  while (rclcpp::ok())
-  {
-    rclcpp::spin_some(nh_);
-  }
-}
-
 int KeyboardServo::keyLoop()
 {
   char c;
   bool publish_twist = false;
   bool publish_joint = false;
 
-  std::thread{ [this]() { return spin(); } }.detach();
-
   puts("Reading from keyboard");
   puts("---------------------------");
   puts("All commands are in the planning frame");
@@ -268,12 +445,19 @@ int KeyboardServo::keyLoop()
   puts("Use 'i' to increase the speed, 'o' to decrease the speed");
   puts("'Q' to quit.");
 
-  for (;;)
+  while (rclcpp::ok())
   {
-    // get the next event from the keyboard
+    // wait for the next event from the keyboard, sleeping in poll() while idle
     try
     {
-      input.readOne(&c);
+      const KeyboardReader::PollResult result = input.pollOne(&c, POLL_TIMEOUT_MS);
+      if (result == KeyboardReader::PollResult::END_OF_INPUT)
+      {
+        RCLCPP_INFO(nh_->get_logger(), "End of keyboard input, quit");
+        return 0;
+      }
+      if (result == KeyboardReader::PollResult::TIMEOUT)
+        continue;
     }
     catch (const std::runtime_error&)
     {
@@ -292,31 +476,7 @@ int KeyboardServo::keyLoop()
         // msg.data = true;
         // reset_start_pos_pub_->publish(msg);
 
-        auto req = std::make_shared<std_srvs::srv::SetBool::Request>();
-        req->data = false;
-
-        auto future = pause_servo_cli_->async_send_request(req);
-
-        if (rclcpp::spin_until_future_complete(service_node_, future) == rclcpp::FutureReturnCode::SUCCESS)
-        {
-          RCLCPP_INFO(nh_->get_logger(), "Called pause_servo service: %s", future.get()->message.c_str());
-        }
-        else
-        {
-          RCLCPP_ERROR(nh_->get_logger(), "Failed to call pause_servo service");
-        }
-
-        req->data = true;
-        future = sw_hw_ctrl_mode_cli_->async_send_request(req);
-
-        if (rclcpp::spin_until_future_complete(service_node_, future) == rclcpp::FutureReturnCode::SUCCESS)
-        {
-          RCLCPP_INFO(nh_->get_logger(), "Called toggle_servo_mode service: %s", future.get()->message.c_str());
-        }
-        else
-        {
-          RCLCPP_ERROR(nh_->get_logger(), "Failed to call pause_servo service");
-        }
+        setServoMode(true);
 
         continue;
       }
@@ -335,14 +495,10 @@ int KeyboardServo::keyLoop()
     RCLCPP_DEBUG(nh_->get_logger(), "value: 0x%02X\n", c);
     // RCLCPP_INFO(nh_->get_logger(), "value: 0x%02X\n", c);
 
-    // Create the messages we might publish
+    // Create the commands we might hold
     auto twist_msg = std::make_unique<geometry_msgs::msg::TwistStamped>();
     auto joint_msg = std::make_unique<control_msgs::msg::JointJog>();
 
-    joint_msg->joint_names.resize(6);
-    joint_msg->joint_names = { "j1", "j2", "j3", "j4",
-                               "j5", "j6"};
-
     joint_msg->velocities.resize(6);
     std::fill(joint_msg->velocities.begin(), joint_msg->velocities.end(), 0.0);
     // Use read key-press
@@ -414,35 +570,11 @@ int KeyboardServo::keyLoop()
         break;
       case KEYCODE_J:
         RCLCPP_DEBUG(nh_->get_logger(), "j");
-        request_->command_type = moveit_msgs::srv::ServoCommandType::Request::JOINT_JOG;
-        if (switch_input_->wait_for_service(std::chrono::seconds(1)))
-        {
-          auto result = switch_input_->async_send_request(request_);
-          if (result.get()->success)
-          {
-            RCLCPP_INFO_STREAM(nh_->get_logger(), "Switched to input type: JointJog");
-          }
-          else
-          {
-            RCLCPP_WARN_STREAM(nh_->get_logger(), "Could not switch input to: JointJog");
-          }
-        }
+        switchCommandType(moveit_msgs::srv::ServoCommandType::Request::JOINT_JOG, "JointJog");
         break;
       case KEYCODE_T:
         RCLCPP_DEBUG(nh_->get_logger(), "t");
-        request_->command_type = moveit_msgs::srv::ServoCommandType::Request::TWIST;
-        if (switch_input_->wait_for_service(std::chrono::seconds(1)))
-        {
-          auto result = switch_input_->async_send_request(request_);
-          if (result.get()->success)
-          {
-            RCLCPP_INFO_STREAM(nh_->get_logger(), "Switched to input type: Twist");
-          }
-          else
-          {
-            RCLCPP_WARN_STREAM(nh_->get_logger(), "Could not switch input to: Twist");
-          }
-        }
+        switchCommandType(moveit_msgs::srv::ServoCommandType::Request::TWIST, "Twist");
         break;
       case KEYCODE_W:
         RCLCPP_DEBUG(nh_->get_logger(), "w");
@@ -491,19 +623,20 @@ int KeyboardServo::keyLoop()
         return 0;
     }
 
-    // If a key requiring a publish was pressed, publish the message now
+    // If a key requiring a publish was pressed, hold it so the publish timer streams it
     if (publish_twist)
     {
-      twist_msg->header.stamp = nh_->now();
-      twist_msg->header.frame_id = command_frame_id_;
-      twist_pub_->publish(std::move(twist_msg));
+      std::lock_guard<std::mutex> lock(held_mutex_);
+      held_twist_ = twist_msg->twist;
+      held_frame_id_ = command_frame_id_;
+      holdCommand(HeldCommand::TWIST);
       publish_twist = false;
     }
     else if (publish_joint)
     {
-      joint_msg->header.stamp = nh_->now();
-      joint_msg->header.frame_id = PLANNING_FRAME_ID;
-      joint_pub_->publish(std::move(joint_msg));
+      std::lock_guard<std::mutex> lock(held_mutex_);
+      held_joint_velocities_ = joint_msg->velocities;
+      holdCommand(HeldCommand::JOINT);
       publish_joint = false;
     }
   }
@@ -0,0 +1,364 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <rclcpp/rclcpp.hpp>
+#include <sensor_msgs/msg/joy.hpp>
+#include <sensor_msgs/msg/joint_state.hpp>
+#include <sensor_msgs/msg/time_reference.hpp>
+#include <control_msgs/msg/joint_jog.hpp>
+#include <geometry_msgs/msg/twist_stamped.hpp>
+#include <geometry_msgs/msg/pose_stamped.hpp>
+#include <std_msgs/msg/float64_multi_array.hpp>
+#include <trajectory_msgs/msg/joint_trajectory.hpp>
+
+#include <arm_hardware/latency_histogram.hpp>
+
+const std::string JOY_TOPIC = "/joy";
+const std::string JOINT_TOPIC = "/servo_node/delta_joint_cmds";
+const std::string TWIST_TOPIC = "/servo_node/delta_twist_cmds";
+const std::string POSE_TOPIC = "/servo_node/pose_target_cmds";
+const std::string SERVO_TRAJ_TOPIC = "/arm_group_controller/joint_trajectory";
+const std::string SERVO_FORWARD_TOPIC = "/arm_group_forward_controller/commands";
+const std::string ARM_CMD_TOPIC = "arm/command";
+const std::string MOTION_ONSET_TOPIC = "arm/motion_onset";
+const size_t ROS_QUEUE_SIZE = 10;
+
+// Joint position change treated as motion in servo output and arm/command [rad]
+const double POSITION_EPSILON = 1e-6;
+
+
+/**
+ * @brief End-to-end teleoperation latency measurement.
+ *
+ * Each probe starts with game controller input after the arm has been idle and follows it
+ * through every stage until the encoders move:
+ *
+ *   joy input (driver stamp) -> teleop command (game_controller output)
+ *   -> servo output (first changed position) -> hardware write (arm/command stamp)
+ *   -> PDO latch -> encoder motion onset (arm/motion_onset from arm_ethercat_interface)
+ *
+ * @note Run game_controller and arm_ethercat_interface with latency_probe:=true. Tap a
+ * stick with pauses of at least rest_time in between, every tap is one probe.
+ *
+ */
+class TeleopLatency : public rclcpp::Node
+{
+    public:
+        TeleopLatency();
+        ~TeleopLatency();
+
+    private:
+        enum Stage
+        {
+            JOY_TO_TELEOP,
+            TELEOP_TO_SERVO,
+            SERVO_TO_HW_WRITE,
+            HW_WRITE_TO_LATCH,
+            LATCH_TO_ONSET,
+            TOTAL,
+            NUM_STAGES
+        };
+        const std::array<const char *, NUM_STAGES> STAGE_NAMES = {
+            "joy -> teleop cmd", "teleop cmd -> servo out", "servo out -> hw write",
+            "hw write -> PDO latch", "PDO latch -> onset", "joy -> onset (total)"
+        };
+
+        // Probe event times [ns], 0 while not observed
+        struct Probe
+        {
+            int64_t joy = 0;
+            int64_t teleop = 0;
+            int64_t servo = 0;
+            int64_t hw_write = 0;
+            int64_t latch = 0;
+            int64_t onset = 0;
+        };
+
+        bool probe_active_ = false;
+        Probe probe_;
+        int64_t input_released_ns_ = 0;
+        bool input_active_ = false;
+
+        std::vector<double> servo_rest_;
+        std::vector<double> hw_rest_;
+
+        double deadzone_;
+        double rest_time_;
+        double probe_timeout_;
+        int report_every_;
+        std::string output_file_;
+        std::ofstream csv_;
+
+        size_t completed_ = 0;
+        size_t timed_out_ = 0;
+        // 1ms bins up to 250ms
+        std::vector<arm_hardware::LatencyHistogram> histograms_ =
+            std::vector<arm_hardware::LatencyHistogram>(NUM_STAGES, arm_hardware::LatencyHistogram(1000000, 250));
+
+        rclcpp::Subscription<sensor_msgs::msg::Joy>::SharedPtr joy_sub_;
+        rclcpp::Subscription<control_msgs::msg::JointJog>::SharedPtr joint_sub_;
+        rclcpp::Subscription<geometry_msgs::msg::TwistStamped>::SharedPtr twist_sub_;
+        rclcpp::Subscription<geometry_msgs::msg::PoseStamped>::SharedPtr pose_sub_;
+        rclcpp::Subscription<trajectory_msgs::msg::JointTrajectory>::SharedPtr servo_traj_sub_;
+        rclcpp::Subscription<std_msgs::msg::Float64MultiArray>::SharedPtr servo_forward_sub_;
+        rclcpp::Subscription<sensor_msgs::msg::JointState>::SharedPtr arm_cmd_sub_;
+        rclcpp::Subscription<sensor_msgs::msg::TimeReference>::SharedPtr onset_sub_;
+        rclcpp::TimerBase::SharedPtr timeout_timer_;
+
+        int64_t now_ns_() { return this->now().nanoseconds(); }
+
+        void joy_cb_(const sensor_msgs::msg::Joy::SharedPtr joy_msg);
+        void teleop_cb_();
+        void servo_out_cb_(const std::vector<double> &positions);
+        void arm_cmd_cb_(const sensor_msgs::msg::JointState::SharedPtr arm_cmd);
+        void onset_cb_(const sensor_msgs::msg::TimeReference::SharedPtr onset);
+        void timeout_cb_();
+
+        void finish_probe_();
+        void report_();
+};
+
+
+TeleopLatency::TeleopLatency() : Node("teleop_latency")
+{
+    deadzone_ = this->declare_parameter("deadzone", 0.05);
+    rest_time_ = this->declare_parameter("rest_time", 0.5);          // s
+    probe_timeout_ = this->declare_parameter("probe_timeout", 2.0);  // s
+    report_every_ = this->declare_parameter("report_every", 10);
+    output_file_ = this->declare_parameter("output_file", std::string(""));
+
+    if (!output_file_.empty())
+    {
+        csv_.open(output_file_, std::ios::app);
+        if (!csv_)
+            RCLCPP_ERROR(this->get_logger(), "Could not open %s, not writing probes", output_file_.c_str());
+        else
+            csv_ << "joy_ns,teleop_ns,servo_ns,hw_write_ns,latch_ns,onset_ns\n";
+    }
+
+    joy_sub_ = this->create_subscription<sensor_msgs::msg::Joy>(
+        JOY_TOPIC, ROS_QUEUE_SIZE, std::bind(&TeleopLatency::joy_cb_, this, std::placeholders::_1));
+
+    joint_sub_ = this->create_subscription<control_msgs::msg::JointJog>(
+        JOINT_TOPIC, ROS_QUEUE_SIZE, [this](const control_msgs::msg::JointJog::SharedPtr) { teleop_cb_(); });
+    twist_sub_ = this->create_subscription<geometry_msgs::msg::TwistStamped>(
+        TWIST_TOPIC, ROS_QUEUE_SIZE, [this](const geometry_msgs::msg::TwistStamped::SharedPtr) { teleop_cb_(); });
+    pose_sub_ = this->create_subscription<geometry_msgs::msg::PoseStamped>(
+        POSE_TOPIC, ROS_QUEUE_SIZE, [this](const geometry_msgs::msg::PoseStamped::SharedPtr) { teleop_cb_(); });
+
+    // Servo output goes to one of the two controllers depending on direct_streaming
+    servo_traj_sub_ = this->create_subscription<trajectory_msgs::msg::JointTrajectory>(
+        SERVO_TRAJ_TOPIC, ROS_QUEUE_SIZE,
+        [this](const trajectory_msgs::msg::JointTrajectory::SharedPtr traj) {
+            if (!traj->points.empty()) servo_out_cb_(traj->points.front().positions);
+        });
+    servo_forward_sub_ = this->create_subscription<std_msgs::msg::Float64MultiArray>(
+        SERVO_FORWARD_TOPIC, ROS_QUEUE_SIZE,
+        [this](const std_msgs::msg::Float64MultiArray::SharedPtr cmd) { servo_out_cb_(cmd->data); });
+
+    arm_cmd_sub_ = this->create_subscription<sensor_msgs::msg::JointState>(
+        ARM_CMD_TOPIC, ROS_QUEUE_SIZE, std::bind(&TeleopLatency::arm_cmd_cb_, this, std::placeholders::_1));
+    onset_sub_ = this->create_subscription<sensor_msgs::msg::TimeReference>(
+        MOTION_ONSET_TOPIC, ROS_QUEUE_SIZE, std::bind(&TeleopLatency::onset_cb_, this, std::placeholders::_1));
+
+    timeout_timer_ = this->create_wall_timer(
+        std::chrono::milliseconds(100), std::bind(&TeleopLatency::timeout_cb_, this));
+
+    RCLCPP_INFO(this->get_logger(), "Teleop latency probe ready, tap a stick with %.1fs pauses in between", rest_time_);
+}
+
+
+TeleopLatency::~TeleopLatency()
+{
+    report_();
+}
+
+
+/**
+ * @brief Starts a probe on the first stick/trigger input after rest_time without input.
+ *
+ */
+void TeleopLatency::joy_cb_(const sensor_msgs::msg::Joy::SharedPtr joy_msg)
+{
+    int64_t now_ns = now_ns_();
+
+    bool active = std::any_of(joy_msg->axes.begin(), joy_msg->axes.end(),
+        [this](float axis) { return std::abs(axis) > deadzone_; });
+
+    if (!active)
+    {
+        if (input_active_) input_released_ns_ = now_ns;
+        input_active_ = false;
+        return;
+    }
+
+    bool rested = !input_active_ && (now_ns - input_released_ns_) >= rest_time_ * 1e9;
+    input_active_ = true;
+
+    if (probe_active_ || !rested) return;
+
+    probe_ = Probe();
+    probe_.joy = rclcpp::Time(joy_msg->header.stamp).nanoseconds();
+    if (probe_.joy == 0) probe_.joy = now_ns;
+    probe_active_ = true;
+}
+
+
+void TeleopLatency::teleop_cb_()
+{
+    if (probe_active_ && !probe_.teleop)
+        probe_.teleop = now_ns_();
+}
+
+
+/**
+ * @brief Servo output has no usable stamp, the first output moving away from the last
+ * output before the probe is taken at receive time.
+ *
+ */
+void TeleopLatency::servo_out_cb_(const std::vector<double> &positions)
+{
+    if (!probe_active_ || servo_rest_.size() != positions.size())
+    {
+        servo_rest_ = positions;
+        return;
+    }
+
+    if (probe_.servo) return;
+
+    for (size_t i = 0; i < positions.size(); i++)
+    {
+        if (std::abs(positions[i] - servo_rest_[i]) > POSITION_EPSILON)
+        {
+            probe_.servo = now_ns_();
+            return;
+        }
+    }
+}
+
+
+/**
+ * @brief arm/command is streamed every hardware cycle, the first changed command is
+ * taken at its write() stamp.
+ *
+ */
+void TeleopLatency::arm_cmd_cb_(const sensor_msgs::msg::JointState::SharedPtr arm_cmd)
+{
+    if (!probe_active_ || hw_rest_.size() != arm_cmd->position.size())
+    {
+        hw_rest_ = arm_cmd->position;
+        return;
+    }
+
+    if (probe_.hw_write) return;
+
+    for (size_t i = 0; i < arm_cmd->position.size(); i++)
+    {
+        if (std::abs(arm_cmd->position[i] - hw_rest_[i]) > POSITION_EPSILON)
+        {
+            probe_.hw_write = rclcpp::Time(arm_cmd->header.stamp).nanoseconds();
+            return;
+        }
+    }
+}
+
+
+void TeleopLatency::onset_cb_(const sensor_msgs::msg::TimeReference::SharedPtr onset)
+{
+    int64_t onset_ns = rclcpp::Time(onset->header.stamp).nanoseconds();
+    if (!probe_active_ || onset_ns < probe_.joy) return;
+
+    probe_.latch = rclcpp::Time(onset->time_ref).nanoseconds();
+    probe_.onset = onset_ns;
+
+    finish_probe_();
+}
+
+
+void TeleopLatency::timeout_cb_()
+{
+    if (!probe_active_ || (now_ns_() - probe_.joy) < probe_timeout_ * 1e9)
+        return;
+
+    timed_out_++;
+    RCLCPP_WARN(this->get_logger(), "Probe timed out before motion onset (teleop %s, servo %s, hw write %s)",
+        probe_.teleop ? "seen" : "missing", probe_.servo ? "seen" : "missing", probe_.hw_write ? "seen" : "missing");
+
+    probe_active_ = false;
+}
+
+
+/**
+ * @brief Adds a completed probe to the stage histograms. Stages with a missing start or
+ * end event are skipped, the total is always recorded.
+ *
+ */
+void TeleopLatency::finish_probe_()
+{
+    const std::array<int64_t, NUM_STAGES + 1> events = {
+        probe_.joy, probe_.teleop, probe_.servo, probe_.hw_write, probe_.latch, probe_.onset, 0
+    };
+
+    for (int stage = JOY_TO_TELEOP; stage < TOTAL; stage++)
+    {
+        if (events[stage] && events[stage + 1])
+            histograms_[stage].add(events[stage + 1] - events[stage]);
+    }
+    histograms_[TOTAL].add(probe_.onset - probe_.joy);
+
+    RCLCPP_INFO(this->get_logger(), "Probe %zu: %.1fms joy -> onset", completed_ + 1, (probe_.onset - probe_.joy) / 1e6);
+
+    if (csv_)
+    {
+        csv_ << probe_.joy << "," << probe_.teleop << "," << probe_.servo << ","
+             << probe_.hw_write << "," << probe_.latch << "," << probe_.onset << "\n";
+        csv_.flush();
+    }
+
+    probe_active_ = false;
+    completed_++;
+
+    if (report_every_ > 0 && completed_ % report_every_ == 0)
+        report_();
+}
+
+
+/**
+ * @brief Logs per-stage percentiles and the total latency histogram.
+ *
+ */
+void TeleopLatency::report_()
+{
+    if (completed_ == 0) return;
+
+    RCLCPP_INFO(this->get_logger(), "Teleop latency, %zu probes (%zu timed out)", completed_, timed_out_);
+    RCLCPP_INFO(this->get_logger(), "%-24s %5s %8s %8s %8s %8s", "stage", "n", "p50", "p90", "p99", "max");
+
+    for (int stage = 0; stage < NUM_STAGES; stage++)
+    {
+        const auto &hist = histograms_[stage];
+        RCLCPP_INFO(this->get_logger(), "%-24s %5lu %6.1fms %6.1fms %6.1fms %6.1fms",
+            STAGE_NAMES[stage], hist.count(), hist.percentile(50) / 1e6, hist.percentile(90) / 1e6,
+            hist.percentile(99) / 1e6, hist.max() / 1e6);
+    }
+
+    for (const auto &row : histograms_[TOTAL].bars())
+        RCLCPP_INFO(this->get_logger(), "%s", row.c_str());
+}
+
+
+
+int main(int argc, char **argv)
+{
+    rclcpp::init(argc, argv);
+
+    auto node = std::make_shared<TeleopLatency>();
+    rclcpp::spin(node);
+
+    rclcpp::shutdown();
+    return 0;
+}